@@ -65,7 +65,8 @@ void basethread_t::start_log(string logdir)
     }
 }
 
-void basethread_t::start_archiver(string archdir, size_t wsize, size_t bsize)
+void basethread_t::start_archiver(string archdir, size_t wsize, size_t bsize,
+        size_t sortThreads)
 {
     LogArchiver* logArchiver;
 
@@ -73,6 +74,7 @@ void basethread_t::start_archiver(string archdir, size_t wsize, size_t bsize)
     _options.set_string_option("sm_archdir", archdir);
     _options.set_int_option("sm_archiver_workspace_size", wsize);
     _options.set_int_option("sm_archiver_block_size", bsize);
+    _options.set_int_option("sm_archiver_sort_threads", sortThreads);
     logArchiver = new LogArchiver(_options);
     cerr << "OK" << endl;
 
@@ -23,8 +23,9 @@ public:
     static void start_base();
     static void start_buffer();
     static void start_log(string logdir);
-    // default archiver workspace size = 800MB
-    static void start_archiver(string archdir, size_t wsize, size_t bsize);
+    // workspace size (wsize) is given in MB
+    static void start_archiver(string archdir, size_t wsize, size_t bsize,
+            size_t sortThreads = 1);
     static void start_merger(string archdir);
     static void start_other();
     static void print_stats();
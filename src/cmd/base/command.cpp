@@ -161,10 +161,19 @@ void Command::setupSMOptions(po::options_description& options)
         "Whether to truncate log archive runs at SM shutdown")
     ("sm_log_partition_size", po::value<int>()->default_value(1024),
         "Size of a log partition in MB")
+    ("sm_log_stripe_dirs", po::value<string>(),
+        "Comma-separated additional log directories (e.g., on other devices) "
+        "on which log partitions are placed round-robin with sm_logdir")
     ("sm_log_max_partitions", po::value<int>()->default_value(0),
         "Maximum number of partitions maintained in log directory")
     ("sm_log_delete_old_partitions", po::value<bool>()->default_value(true),
         "Whether to delete old log partitions as cleaner and chkpt make progress")
+    ("sm_log_delta_images", po::value<bool>()->default_value(true),
+        "Log only the changed bytes of B-tree update and overwrite images")
+    ("sm_btree_optimistic_traverse", po::value<bool>()->default_value(false),
+        "Traverse B-tree inner pages without latches, validating page versions")
+    ("sm_btree_simd_search", po::value<bool>()->default_value(false),
+        "Narrow B-tree page searches by comparing poor man's keys with SIMD")
     ("sm_bufpoolsize", po::value<int>()->default_value(1024),
         "Size of buffer pool in MB")
     ("sm_fakeiodelay-enable", po::value<int>()->default_value(0),
@@ -175,6 +184,11 @@ void Command::setupSMOptions(po::options_description& options)
             "Path to the error log of the storage manager")
     ("sm_chkpt_interval", po::value<int>(),
             "Interval for checkpoint flushes")
+    ("sm_chkpt_incremental", po::value<bool>()->default_value(false),
+            "Take checkpoints from the buffer pool and transaction list "
+            "instead of scanning the log, and write them as deltas")
+    ("sm_chkpt_full_interval", po::value<int>()->default_value(16),
+            "With sm_chkpt_incremental, write every n-th checkpoint in full")
     ("sm_log_fetch_buf_partitions", po::value<uint>()->default_value(0),
         "Number of partitions to buffer in memory for recovery")
     ("sm_log_page_flushers", po::value<uint>()->default_value(1),
@@ -200,10 +214,17 @@ void Command::setupSMOptions(po::options_description& options)
          will be ignored (uses write elision and single-page recovery)")
     ("sm_vol_o_direct", po::value<bool>(),
         "Whether to open volume (i.e., db file) with O_DIRECT")
+    ("sm_alloc_chunk_pages", po::value<int>(),
+        "Number of page IDs each thread reserves at once for a store, \
+         so that pages of the same store are allocated contiguously")
     ("sm_restart_instant", po::value<bool>(),
         "Enable instant restart")
     ("sm_restart_log_based_redo", po::value<bool>(),
         "Perform non-instant restart with log-based redo instead of page-based")
+    ("sm_restart_redo_threads", po::value<int>(),
+        "Number of threads replaying page log records in log-based redo")
+    ("sm_restart_undo_threads", po::value<int>(),
+        "Number of threads rolling back loser transactions in undo")
     ("sm_rawlock_gc_interval_ms", po::value<int>(),
         "Garbage Collection Interval in ms")
     ("sm_rawlock_lockpool_segsize", po::value<int>(),
@@ -224,10 +245,16 @@ void Command::setupSMOptions(po::options_description& options)
         "Garbage Collection Maximum Segment Count")
     ("sm_locktablesize", po::value<int>(),
         "Lock table size")
+    ("sm_locktable_partitions", po::value<int>()->default_value(16),
+        "Number of lock table partitions (a power of 2, at most 256)")
+    ("sm_locktable_grow", po::value<bool>()->default_value(false),
+        "Lock table partitions double their lock queues when they get crowded")
     ("sm_rawlock_xctpool_initseg", po::value<int>(),
         "Transaction Pool Initialization Segment")
     ("sm_cleaner_decoupled", po::value<bool>(),
         "Enable/Disable decoupled cleaner")
+    ("sm_cleaner_decoupled_log", po::value<bool>(),
+        "Decoupled cleaner replays log records from the recovery log instead of the log archive")
     ("sm_cleaner_interval_millisec", po::value<int>(),
         "Cleaner sleep interval in ms")
     ("sm_cleaner_workspace_size", po::value<int>(),
@@ -238,6 +265,12 @@ void Command::setupSMOptions(po::options_description& options)
         "Policy used by cleaner to select candidates")
     ("sm_cleaner_min_write_size", po::value<int>(),
         "Page cleaner only writes clusters of pages with this minimum size")
+    ("sm_cleaner_max_gap", po::value<int>(),
+        "Max. gap in pages between dirty pages filled with cached pages to form larger writes")
+    ("sm_cleaner_io_budget", po::value<int>(),
+        "Write bandwidth allowed to the cleaner in MB/s (0 for no limit)")
+    ("sm_cleaner_recovery_distance", po::value<int>(),
+        "Recovery distance goal (MB of log) of the adaptive cleaner policy")
     ("sm_cleaner_min_write_ignore_freq", po::value<int>(),
         "Ignore min_write_size every N rounds of cleaning")
     ("sm_cleaner_ignore_metadata", po::value<bool>(),
@@ -275,6 +308,10 @@ void Command::setupSMOptions(po::options_description& options)
         "Ticker interval in millisec")
     ("sm_prefetch", po::value<bool>(),
         "Enable/Disable prefetching")
+    ("sm_io_uring", po::value<bool>()->default_value(false),
+        "Submit batched I/O of cleaner, backup prefetcher and log with io_uring")
+    ("sm_io_uring_depth", po::value<int>()->default_value(64),
+        "Queue depth of the per-thread io_uring")
     ("sm_backup_prefetcher_segments", po::value<int>(),
         "Segment size restore")
     ("sm_restore_segsize", po::value<int>(),
@@ -301,6 +338,10 @@ void Command::setupSMOptions(po::options_description& options)
         "Support on-demand restore")
     ("sm_restore_sched_random", po::value<bool>(),
         "Use random page order in restore scheduler")
+    ("sm_restore_sched_hot", po::value<bool>(),
+        "Restore segments without on-demand requests in order of hotness")
+    ("sm_restore_pipeline", po::value<bool>(),
+        "Overlap backup and log archive reads, log replay, and writes of different segments in restore")
     ("sm_bufferpool_swizzle", po::value<bool>(),
         "Enable/Disable bufferpool swizzle")
     ("sm_archiver_eager", po::value<bool>(),
@@ -309,6 +350,8 @@ void Command::setupSMOptions(po::options_description& options)
         "Enable/Disable reading whole blocks in the archiver")
     ("sm_archiver_slow_log_grace_period", po::value<int>(),
         "Enable/Disable slow log grace period")
+    ("sm_archiver_sort_threads", po::value<int>(),
+        "Number of threads used by the log archiver to sort runs")
     ("sm_errlog_level", po::value<string>(),
         "Specify a errorlog level. Options:")
         //TODO Stefan Find levels and insert them
@@ -318,7 +361,17 @@ void Command::setupSMOptions(po::options_description& options)
     ("sm_backup_dir", po::value<string>(),
         "Path to a backup directory")
     ("sm_bufferpool_replacement_policy", po::value<string>(),
-        "Replacement Policy")
+        "Replacement policy: clock, clock_pro, or random")
+    ("sm_bufferpool_prefetch_threads", po::value<int>(),
+        "Number of threads serving asynchronous page prefetch requests (0 disables prefetching)")
+    ("sm_bufferpool_freelist_shards", po::value<int>(),
+        "Number of buffer pool free list shards (0 means one per hardware thread)")
+    ("sm_evictor_low_watermark", po::value<int>(),
+        "Percentage of free buffer frames below which the background evictor is woken up (0 disables it)")
+    ("sm_evictor_high_watermark", po::value<int>(),
+        "Percentage of buffer frames the background evictor keeps free")
+    ("sm_evictor_interval_millisec", po::value<int>(),
+        "Interval at which the background evictor checks the watermarks")
     ("sm_archdir", po::value<string>()->default_value("archive"),
         "Path to archive directory");
     options.add(smoptions);
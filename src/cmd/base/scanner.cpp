@@ -35,6 +35,14 @@ BlockScanner::BlockScanner(const po::variables_map& options,
     : BaseScanner(options), pnum(-1)
 {
     logdir = options["logdir"].as<string>().c_str();
+    logdirs.push_back(logdir);
+    if (options.count("sm_log_stripe_dirs")) {
+        stringstream stripes(options["sm_log_stripe_dirs"].as<string>());
+        string dir;
+        while (getline(stripes, dir, ',')) {
+            if (!dir.empty()) { logdirs.push_back(dir); }
+        }
+    }
     // blockSize = options["sm_archiver_block_size"].as<int>();
     // CS TODO no option for archiver block size
     blockSize = LogArchiver::DFT_BLOCK_SIZE;
@@ -56,37 +64,41 @@ BlockScanner::BlockScanner(const po::variables_map& options,
 void BlockScanner::findFirstFile()
 {
     pnum = numeric_limits<int>::max();
-    os_dir_t dir = os_opendir(logdir);
-    if (!dir) {
-        cerr << "Error: could not open recovery log dir: " << logdir << endl;
-        W_COERCE(RC(fcOS));
-    }
-    os_dirent_t* entry = os_readdir(dir);
     const char * PREFIX = "log.";
 
-    while (entry != NULL) {
-        const char* fname = entry->d_name;
-        if (strncmp(PREFIX, fname, strlen(PREFIX)) == 0) {
-            int p = atoi(fname + strlen(PREFIX));
-            if (p < pnum) {
-                pnum = p;
+    for (auto& d : logdirs) {
+        os_dir_t dir = os_opendir(d.c_str());
+        if (!dir) {
+            cerr << "Error: could not open recovery log dir: " << d << endl;
+            W_COERCE(RC(fcOS));
+        }
+        os_dirent_t* entry = os_readdir(dir);
+
+        while (entry != NULL) {
+            const char* fname = entry->d_name;
+            if (strncmp(PREFIX, fname, strlen(PREFIX)) == 0) {
+                int p = atoi(fname + strlen(PREFIX));
+                if (p < pnum) {
+                    pnum = p;
+                }
             }
+            entry = os_readdir(dir);
         }
-        entry = os_readdir(dir);
+        os_closedir(dir);
     }
-    os_closedir(dir);
 }
 
 string BlockScanner::getNextFile()
 {
     stringstream fname;
-    fname << logdir << "/";
     if (pnum < 0) {
         findFirstFile();
     }
     else {
         pnum++;
     }
+    // partitions are placed round-robin on the log directories
+    fname << logdirs[pnum % logdirs.size()] << "/";
     fname << "log." << pnum;
 
     if (openFileCallback) {
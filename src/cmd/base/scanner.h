@@ -55,6 +55,8 @@ private:
     LogScanner* logScanner;
     char* currentBlock;
     const char* logdir;
+    /// logdir followed by sm_log_stripe_dirs, as in log_storage
+    vector<string> logdirs;
     size_t blockSize;
     int pnum;
 
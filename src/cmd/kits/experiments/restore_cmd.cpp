@@ -63,6 +63,12 @@ void RestoreCmd::setupOptions()
             ->implicit_value(true),
             "Single-pass policy of scheduler proceeds in random order among \
             segments, instead of sequential")
+        ("hotFirst", po::value<bool>(&opt_hotFirst)->default_value(false)
+            ->implicit_value(true),
+            "Restore segments that were hot before the failure first")
+        ("pipeline", po::value<bool>(&opt_pipeline)->default_value(false)
+            ->implicit_value(true),
+            "Overlap reads, log replay, and writes of different segments")
         ("evict", po::value<bool>(&opt_evict)->default_value(false)
             ->implicit_value(true),
             "Evict all pages from buffer pool when failure happens")
@@ -87,6 +93,8 @@ void RestoreCmd::loadOptions(sm_options& options)
     options.set_bool_option("sm_restore_sched_singlepass", opt_singlePass);
     options.set_bool_option("sm_restore_sched_ondemand", opt_onDemand);
     options.set_bool_option("sm_restore_sched_random", opt_randomOrder);
+    options.set_bool_option("sm_restore_sched_hot", opt_hotFirst);
+    options.set_bool_option("sm_restore_pipeline", opt_pipeline);
 }
 
 void RestoreCmd::run()
@@ -20,6 +20,8 @@ protected:
     bool opt_offline;
     bool opt_onDemand;
     bool opt_randomOrder;
+    bool opt_hotFirst;
+    bool opt_pipeline;
 
     bool hasFailed;
 
@@ -101,6 +101,10 @@ void KitsCommand::setupOptions()
         ("eager", po::value<bool>(&opt_eager)->default_value(true)
             ->implicit_value(true),
             "Run log archiving in eager mode")
+        ("pipelineCommit", po::value<bool>(&opt_pipelineCommit)->default_value(false)
+            ->implicit_value(true),
+            "Let worker threads run the next transaction while the commit of \
+            the previous one is flushed; clients are notified once it is durable")
         ("skew", po::value<bool>(&opt_skew)->default_value(false)
             ->implicit_value(true),
             "Activate skew on transaction inputs (currently only 80:20 skew \
@@ -396,6 +400,7 @@ void KitsCommand::initShoreEnv()
     shoreEnv->set_sf(opt_queried_sf);
     shoreEnv->set_qf(opt_queried_sf);
     shoreEnv->set_loaders(opt_num_threads);
+    shoreEnv->setPipelinedCommit(opt_pipelineCommit);
 
     shoreEnv->init();
     shoreEnv->set_clobber(opt_load);
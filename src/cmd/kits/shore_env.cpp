@@ -115,7 +115,9 @@ ShoreEnv::ShoreEnv(po::variables_map& vm)
       _request_pool(sizeof(trx_request_t)),
       _bUseSLI(false),
       _bUseELR(false),
-      _bUseFlusher(false)
+      _bUseFlusher(false),
+      _asynch_commit(false),
+      _pipelined_commit(false)
       // _logger(NULL)
 {
     optionValues = vm;
@@ -1077,6 +1079,49 @@ void ShoreEnv::setAsynchCommit(const bool bAsynch)
 }
 
 
+/******************************************************************
+ *
+ *  @fn:    setPipelinedCommit()
+ *
+ *  @brief: Sets whether pipelined commit will be used or not
+ *
+ ******************************************************************/
+
+void ShoreEnv::setPipelinedCommit(const bool bPipelined)
+{
+    _pipelined_commit = bPipelined;
+}
+
+
+/******************************************************************
+ *
+ *  @fn:    commit_pipelined()
+ *
+ *  @brief: Commits the attached xct without waiting for the log flush.
+ *          The client is notified, and the commit is counted, by the
+ *          log flush daemon once the commit is durable.
+ *
+ *  @note:  The worker destroys the request as soon as it returns, so
+ *          the notification keeps only the client's cond var.
+ *
+ ******************************************************************/
+
+w_rc_t ShoreEnv::commit_pipelined(Request* prequest)
+{
+    condex* pcondex = prequest->_result.get_notify();
+    prequest->_result.set_notify(NULL);
+
+    w_rc_t e = _pssm->commit_xct_async([this, pcondex] {
+        if (pcondex) pcondex->signal();
+        if ((*&_measure) == MST_MEASURE) _env_stats.inc_trx_com();
+    });
+
+    // on error, the caller aborts the xct and notifies the client
+    if (e.is_error()) prequest->_result.set_notify(pcondex);
+    return (e);
+}
+
+
 #if 0
 
 /******************************************************************
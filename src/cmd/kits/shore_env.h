@@ -127,7 +127,10 @@ const int SHORE_NUM_OF_RETRIES       = 3;
         _inc_##trxlid##_att();                                          \
         w_rc_t e = xct_##trximpl(xct_id, in);                           \
         if (!e.is_error()) {                                            \
-            if (isAsynchCommit()) e = _pssm->commit_xct(true);          \
+            if (isPipelinedCommit()) {                                  \
+                e = commit_pipelined(prequest);                         \
+                if (!e.is_error()) return (RCOK); }                     \
+            else if (isAsynchCommit()) e = _pssm->commit_xct(true);     \
             else e = _pssm->commit_xct(); }                             \
         if (e.is_error()) {                                             \
             if (e.err_num() != eDEADLOCK)                    \
@@ -643,6 +646,13 @@ public:
     inline bool isAsynchCommit() const { return (_asynch_commit); }
     void setAsynchCommit(const bool bAsynch);
 
+    // Control whether pipelined commit will be used, i.e., whether workers
+    // go on with the next request while the commit of the previous one is
+    // being flushed, and the client is notified once it is durable
+    inline bool isPipelinedCommit() const { return (_pipelined_commit); }
+    void setPipelinedCommit(const bool bPipelined);
+    w_rc_t commit_pipelined(Request* prequest);
+
 
     // SLI
 public:
@@ -678,6 +688,7 @@ protected:
     // returns 0 on success
     int _set_sys_params();
     bool _asynch_commit;
+    bool _pipelined_commit;
 
 }; // EOF ShoreEnv
 
@@ -95,6 +95,8 @@ int trx_worker_t::_work_ACTIVE_impl()
         ar = _pqueue->pop();
 
         // Execute the particular request and deallocate it
+        // (with pipelined commit, the request may still be waiting for its
+        // commit to become durable, which does not involve the request)
         if (ar) {
             _serve_action(ar);
             ++_stats._served_input;
@@ -18,7 +18,7 @@ void RestoreTrace::run()
 }
 
 RestoreTraceHandler::RestoreTraceHandler()
-    : currentTick(0)
+    : currentTick(0), failureTick(-1), firstCommitTick(-1)
 {
 }
 
@@ -31,4 +31,22 @@ void RestoreTraceHandler::invoke(logrec_t& r)
         uint32_t segment = *((uint32_t*) r.data_ssx());
         std::cout << currentTick << " " << segment << std::endl;
     }
+    else if (r.type() == logrec_t::t_restore_begin) {
+        failureTick = currentTick;
+        firstCommitTick = -1;
+    }
+    else if (r.type() == logrec_t::t_xct_end && failureTick >= 0
+            && firstCommitTick < 0)
+    {
+        firstCommitTick = currentTick;
+    }
+}
+
+void RestoreTraceHandler::finalize()
+{
+    // lines starting with # are skipped by plotting tools such as gnuplot
+    if (failureTick >= 0 && firstCommitTick >= 0) {
+        std::cout << "# first commit " << firstCommitTick - failureTick
+            << " ticks after failure" << std::endl;
+    }
 }
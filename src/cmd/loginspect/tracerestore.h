@@ -14,8 +14,13 @@ class RestoreTraceHandler : public Handler {
 public:
     RestoreTraceHandler();
     virtual void invoke(logrec_t& r);
+    virtual void finalize();
 protected:
     int currentTick;
+
+    /// Tick of the volume failure and of the first commit after it (or -1)
+    int failureTick;
+    int firstCommitTick;
 };
 
 #endif
@@ -1,5 +1,6 @@
 #include "genarchive.h"
 #include "log_core.h"
+#include "stopwatch.h"
 
 #include <fstream>
 
@@ -12,6 +13,15 @@ void GenArchive::setupOptions()
             "Directory where the archive runs will be stored (must exist)")
         // ("maxLogSize,m", po::value<long>(&maxLogSize)->default_value(m),
         //     "max_logsize parameter of Shore-MT (default should be fine)")
+        ("threads,t", po::value<size_t>(&sortThreads)->default_value(1),
+            "Number of threads used to sort each run")
+        ("workspace,w", po::value<size_t>(&workspaceSize)->default_value(300),
+            "Size of the sort workspace in MB")
+        ("benchmark,b", po::value<bool>(&benchmark)->default_value(false)
+         ->implicit_value(true),
+            "Archive the whole log once for each power of two up to the given "
+            "number of threads and report the throughput of each "
+            "(deletes existing runs)")
     ;
 }
 
@@ -32,15 +42,36 @@ void GenArchive::run()
      * and if it already exists, check if there are any files in it
      */
 
-    const size_t blockSize = 1048576;
-    const size_t workspaceSize = 300 * blockSize;
-
     start_base();
     start_log(logdir);
-    start_archiver(archdir, workspaceSize, blockSize);
+
+    if (!benchmark) {
+        archive(sortThreads);
+        return;
+    }
+
+    // runs from the previous round must not be picked up by the next one
+    _options.set_bool_option("sm_format", true);
+    for (size_t t = 1; t <= sortThreads; t *= 2) {
+        archive(t);
+        if (t < sortThreads && t * 2 > sortThreads) {
+            // also measure the requested number if it isn't a power of two
+            archive(sortThreads);
+        }
+    }
+}
+
+void GenArchive::archive(size_t threads)
+{
+    const size_t blockSize = 1048576;
+
+    start_archiver(archdir, workspaceSize, blockSize, threads);
 
     lsn_t durableLSN = smlevel_0::log->durable_lsn();
-    cerr << "Activating log archiver until LSN " << durableLSN << endl;
+    cerr << "Activating log archiver until LSN " << durableLSN
+        << " with " << threads << " sort thread(s)" << endl;
+
+    stopwatch_t timer;
 
     LogArchiver* la = smlevel_0::logArchiver;
     la->fork();
@@ -62,4 +93,23 @@ void GenArchive::run()
 
     la->shutdown();
     la->join();
+
+    double elapsed = timer.time();
+
+    std::list<LogArchiver::ArchiveDirectory::RunFileStats> stats;
+    W_COERCE(la->getDirectory()->listFileStats(stats));
+    size_t archived = 0;
+    for (auto& s : stats) {
+        archived += s.fileSize;
+    }
+
+    cout << "threads " << threads
+        << " runs " << stats.size()
+        << " archived_mb " << archived / 1048576
+        << " time_s " << elapsed
+        << " mb_per_s " << (archived / 1048576.0) / elapsed
+        << endl;
+
+    delete la;
+    smlevel_0::logArchiver = NULL;
 }
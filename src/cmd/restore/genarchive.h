@@ -12,6 +12,11 @@ private:
     string logdir;
     string archdir;
     long maxLogSize;
+    size_t sortThreads;
+    size_t workspaceSize;
+    bool benchmark;
+
+    void archive(size_t threads);
 };
 
 #endif
@@ -98,6 +98,8 @@ extern class sthread_stats SthreadStats;
 std::vector<sdisk_t*> sthread_t::_disks;
 unsigned        sthread_t::open_max = 0;
 unsigned        sthread_t::open_count = 0;
+bool            sthread_t::_io_uring_enabled = false;
+unsigned        sthread_t::_io_uring_depth = 64;
 
 static          queue_based_lock_t    protectFDs;
 
@@ -1001,6 +1003,20 @@ w_rc_t    sthread_t::pwrite(int fd, const void *buf, int n, fileoff_t pos)
 }
 
 
+w_rc_t    sthread_t::pio(int fd, io_request_t *reqs, int count)
+{
+    sdisk_t* disk = get_disk(fd);
+    return disk->pio(reqs, count);
+}
+
+
+void    sthread_t::set_io_uring(bool enable, unsigned depth)
+{
+    _io_uring_enabled = enable;
+    _io_uring_depth = depth;
+}
+
+
 w_rc_t    sthread_t::fsync(int fd)
 {
     sdisk_t* disk = get_disk(fd);
@@ -0,0 +1,170 @@
+#include "io_uring_queue.h"
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+
+static int sys_io_uring_setup(unsigned entries, io_uring_params* p)
+{
+    return (int) syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit,
+        unsigned min_complete, unsigned flags)
+{
+    return (int) syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+            flags, NULL, 0);
+}
+
+io_uring_queue_t::io_uring_queue_t(unsigned entries)
+    : _ring_fd(-1), _sq_entries(0), _to_submit(0),
+    _sq_ptr(MAP_FAILED), _sq_size(0), _cq_ptr(MAP_FAILED), _cq_size(0),
+    _sqes((io_uring_sqe*) MAP_FAILED), _sqes_size(0)
+{
+    io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int fd = sys_io_uring_setup(entries, &p);
+    if (fd < 0) {
+        return;
+    }
+    _ring_fd = fd;
+    _sq_entries = p.sq_entries;
+
+    _sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    _cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        _sq_size = _cq_size = std::max(_sq_size, _cq_size);
+    }
+
+    _sq_ptr = mmap(0, _sq_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_SQ_RING);
+    if (single_mmap) {
+        _cq_ptr = _sq_ptr;
+    }
+    else if (_sq_ptr != MAP_FAILED) {
+        _cq_ptr = mmap(0, _cq_size, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_CQ_RING);
+    }
+    _sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+    if (_cq_ptr != MAP_FAILED) {
+        _sqes = (io_uring_sqe*) mmap(0, _sqes_size, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_SQES);
+    }
+    if (_sqes == MAP_FAILED) {
+        _unmap();
+        ::close(_ring_fd);
+        _ring_fd = -1;
+        return;
+    }
+
+    char* sq = (char*) _sq_ptr;
+    _sq_head = (unsigned*) (sq + p.sq_off.head);
+    _sq_tail = (unsigned*) (sq + p.sq_off.tail);
+    _sq_mask = (unsigned*) (sq + p.sq_off.ring_mask);
+    _sq_array = (unsigned*) (sq + p.sq_off.array);
+
+    char* cq = (char*) _cq_ptr;
+    _cq_head = (unsigned*) (cq + p.cq_off.head);
+    _cq_tail = (unsigned*) (cq + p.cq_off.tail);
+    _cq_mask = (unsigned*) (cq + p.cq_off.ring_mask);
+    _cqes = (io_uring_cqe*) (cq + p.cq_off.cqes);
+}
+
+io_uring_queue_t::~io_uring_queue_t()
+{
+    if (_ring_fd >= 0) {
+        _unmap();
+        ::close(_ring_fd);
+    }
+}
+
+void io_uring_queue_t::_unmap()
+{
+    if (_sqes != MAP_FAILED) {
+        munmap(_sqes, _sqes_size);
+    }
+    if (_cq_ptr != MAP_FAILED && _cq_ptr != _sq_ptr) {
+        munmap(_cq_ptr, _cq_size);
+    }
+    if (_sq_ptr != MAP_FAILED) {
+        munmap(_sq_ptr, _sq_size);
+    }
+}
+
+bool io_uring_queue_t::prepare(int fd, const io_request_t& req,
+        uint64_t user_data)
+{
+    // we are the only producer; the kernel advances the head
+    unsigned tail = *_sq_tail;
+    unsigned head = __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE);
+    if (tail - head >= _sq_entries) {
+        return false;
+    }
+
+    unsigned idx = tail & *_sq_mask;
+    io_uring_sqe* sqe = &_sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = req.is_write ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t) req.iov;
+    sqe->len = req.iovcnt;
+    sqe->off = req.pos;
+    sqe->user_data = user_data;
+    _sq_array[idx] = idx;
+
+    __atomic_store_n(_sq_tail, tail + 1, __ATOMIC_RELEASE);
+    _to_submit++;
+    return true;
+}
+
+int io_uring_queue_t::submit_and_wait(unsigned min_complete)
+{
+    unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    int ret = sys_io_uring_enter(_ring_fd, _to_submit, min_complete, flags);
+    if (ret < 0) {
+        return -errno;
+    }
+    _to_submit -= std::min<unsigned>(ret, _to_submit);
+    return ret;
+}
+
+bool io_uring_queue_t::reap(uint64_t& user_data, int& result)
+{
+    // we are the only consumer; the kernel advances the tail
+    unsigned head = *_cq_head;
+    unsigned tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+        return false;
+    }
+
+    io_uring_cqe* cqe = &_cqes[head & *_cq_mask];
+    user_data = cqe->user_data;
+    result = cqe->res;
+
+    __atomic_store_n(_cq_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+io_uring_queue_t* io_uring_queue_t::get_thread_queue(unsigned entries)
+{
+    // destroyed (and the ring closed) when the thread exits
+    static thread_local std::unique_ptr<io_uring_queue_t> queue;
+    static thread_local bool unsupported = false;
+
+    if (!queue && !unsupported) {
+        queue.reset(new io_uring_queue_t(entries));
+        if (!queue->is_valid()) {
+            queue.reset();
+            unsupported = true;
+        }
+    }
+    return queue.get();
+}
@@ -0,0 +1,85 @@
+#ifndef IO_URING_QUEUE_H
+#define IO_URING_QUEUE_H
+
+#include "w_defines.h"
+#include "w.h"
+#include "sdisk.h"
+
+#include <stdint.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/**
+ * Minimal wrapper around a Linux io_uring instance, used as asynchronous
+ * backend of sdisk_unix_t::pio. It uses the raw system calls, so that no
+ * additional library is required.
+ *
+ * A queue is meant to be used by a single thread: requests of a batch are
+ * queued with prepare(), submitted with a single system call in
+ * submit_and_wait(), and completions are polled with reap(). Each thread
+ * obtains its own queue with get_thread_queue(), which returns NULL if
+ * io_uring is not supported by the kernel -- in that case the caller falls
+ * back to synchronous preadv/pwritev.
+ */
+class io_uring_queue_t {
+public:
+    typedef sdisk_base_t::io_request_t io_request_t;
+
+    io_uring_queue_t(unsigned entries);
+    ~io_uring_queue_t();
+
+    /** Whether the ring could be set up */
+    bool is_valid() const { return _ring_fd >= 0; }
+
+    /** Number of submission queue entries */
+    unsigned get_entries() const { return _sq_entries; }
+
+    /**
+     * Queues a vectored read or write on the given file, tagged with
+     * user_data. Returns false if the submission queue is full.
+     */
+    bool prepare(int fd, const io_request_t& req, uint64_t user_data);
+
+    /**
+     * Submits all queued requests and waits until at least min_complete
+     * completions are available. Returns the number of submitted requests
+     * or a negative errno.
+     */
+    int submit_and_wait(unsigned min_complete);
+
+    /** Pops one completion; returns false if there is none */
+    bool reap(uint64_t& user_data, int& result);
+
+    /**
+     * Queue of the calling thread with the given depth, created on first use.
+     * Returns NULL if io_uring is not available.
+     */
+    static io_uring_queue_t* get_thread_queue(unsigned entries);
+
+private:
+    int _ring_fd;
+    unsigned _sq_entries;
+    unsigned _to_submit;
+
+    void* _sq_ptr;
+    size_t _sq_size;
+    void* _cq_ptr;
+    size_t _cq_size;
+    io_uring_sqe* _sqes;
+    size_t _sqes_size;
+
+    unsigned* _sq_head;
+    unsigned* _sq_tail;
+    unsigned* _sq_mask;
+    unsigned* _sq_array;
+
+    unsigned* _cq_head;
+    unsigned* _cq_tail;
+    unsigned* _cq_mask;
+    io_uring_cqe* _cqes;
+
+    void _unmap();
+};
+
+#endif // IO_URING_QUEUE_H
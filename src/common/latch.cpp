@@ -73,7 +73,7 @@ const char* const  latch_t::latch_mode_str[4] = { "NL", "Q", "SH", "EX" };
 
 
 latch_t::latch_t() :
-    _total_count(0)
+    _total_count(0), _version(0)
 {
 }
 
@@ -521,6 +521,10 @@ w_rc_t latch_t::_acquire(latch_mode_t new_mode,
         w_assert2(me->_count == 0);
         me->_mode = new_mode;
     }
+    if (new_mode == LATCH_EX) {
+        // odd version tells optimistic readers that a writer is in
+        lintel::unsafe::atomic_fetch_add(&_version, 1);
+    }
     lintel::unsafe::atomic_fetch_add(&_total_count, 1);// BUG_SEMANTICS_FIX
     me->_count++;// BUG_SEMANTICS_FIX
     DBGTHRD(<< "acquired " << *this );
@@ -551,6 +555,7 @@ latch_t::_release(latch_holder_t* me)
     }
     else {
         w_assert2(_lock.has_writer());
+        lintel::unsafe::atomic_fetch_add(&_version, 1);
         if (_lock.has_writer())
             _lock.release_write();
     }
@@ -574,6 +579,7 @@ latch_t::_downgrade(latch_holder_t* me)
     w_assert3(me->_mode == LATCH_EX);
     w_assert3(me->_count > 0);
 
+    lintel::unsafe::atomic_fetch_add(&_version, 1);
     _lock.downgrade();
     me->_mode = LATCH_SH;
 
@@ -225,6 +225,17 @@ public:
     /// string names of modes.
     static const char* const    latch_mode_str[4];
 
+    /**\brief Version for optimistic (latch-free) readers.
+     * \details
+     * Incremented when the latch is acquired in EX mode and again when the
+     * EX latch is released or downgraded, so it is odd while a writer holds
+     * the latch. A reader that saw the same even version before and after
+     * reading the protected data read a consistent state.
+     */
+    uint32_t                optimistic_version() const;
+    /// True if no EX latch was acquired since optimistic_version() returned v.
+    bool                    optimistic_validate(uint32_t v) const;
+
 private:
     // found, iterator
     w_rc_t                _acquire(latch_mode_t m,
@@ -248,8 +259,23 @@ private:
     latch_t&                     operator=(const latch_t&);
 
     uint32_t            _total_count;
+    uint32_t            _version;
 };
 
+inline uint32_t
+latch_t::optimistic_version() const
+{
+    return lintel::unsafe::atomic_load(&_version);
+}
+
+inline bool
+latch_t::optimistic_validate(uint32_t v) const
+{
+    // order the reads of the protected data before the version check
+    lintel::atomic_thread_fence(lintel::memory_order_acquire);
+    return lintel::unsafe::atomic_load(&_version) == v;
+}
+
 inline bool
 latch_t::is_latched() const
 {
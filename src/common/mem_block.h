@@ -179,7 +179,7 @@ struct block {
     block_list*     _owner;
     block*          _next;
     // The memory managed:
-    char            _data[EMPTY_ARRAY_DIM];
+    char            _data[1];
 };
 
 
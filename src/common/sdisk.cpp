@@ -177,6 +177,38 @@ w_rc_t    sdisk_t::pwrite(const void *, int , fileoff_t ,
   return RC(fcNOTIMPLEMENTED);
 }
 
+/* Emulate a batch of requests with one positioned I/O per iovec. Requests
+   are executed in order; a short transfer ends the request, an error the
+   whole batch. */
+
+w_rc_t    sdisk_t::pio(io_request_t *reqs, int count)
+{
+    int    n;
+    w_rc_t    e;
+
+    for (int r = 0; r < count; r++) {
+        io_request_t& req = reqs[r];
+        req.done = 0;
+        for (int i = 0; i < req.iovcnt; i++) {
+            if (req.is_write) {
+                e = pwrite(req.iov[i].iov_base, req.iov[i].iov_len,
+                        req.pos + req.done, n);
+            }
+            else {
+                e = pread(req.iov[i].iov_base, req.iov[i].iov_len,
+                        req.pos + req.done, n);
+            }
+            if (e.is_error())
+                return e;
+            req.done += n;
+            if (size_t(n) != req.iov[i].iov_len)
+                break;
+        }
+    }
+
+    return RCOK;
+}
+
 w_rc_t    sdisk_t::rename(const char*, const char*)
 {
     return RC(fcNOTIMPLEMENTED);
@@ -131,6 +131,23 @@ public:
         SEEK_AT_END=2        // from end-of-file
     };
 
+    /*
+     * A positioned, vectored read or write which is submitted together with
+     * other requests in a batch (see sdisk_t::pio). On completion, done holds
+     * the number of bytes transferred, which may be short for reads.
+     */
+    struct io_request_t {
+        bool            is_write;
+        const iovec_t*  iov;
+        int             iovcnt;
+        fileoff_t       pos;
+        int             done;
+
+        io_request_t(bool write = false, const iovec_t *v = 0, int cnt = 0,
+                fileoff_t p = 0)
+            : is_write(write), iov(v), iovcnt(cnt), pos(p), done(0) { }
+    };
+
     /* utility functions */
     static    int    vsize(const iovec_t *iov, int iovcnt);
 };
@@ -163,6 +180,9 @@ public:
     virtual    w_rc_t    pwrite(const void *buf, int count,
                    fileoff_t pos, int &done);
 
+    /* batch of positioned requests, which may be executed concurrently */
+    virtual w_rc_t    pio(io_request_t *reqs, int count);
+
     virtual w_rc_t    seek(fileoff_t pos, int origin, fileoff_t &newpos) = 0;
 
     virtual w_rc_t    rename(const char* oldname, const char* newname) = 0;
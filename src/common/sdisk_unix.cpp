@@ -81,6 +81,7 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
 #include <sthread.h>
 #include <sdisk.h>
 #include <sdisk_unix.h>
+#include <io_uring_queue.h>
 #include <sthread_stats.h>
 extern class sthread_stats SthreadStats;
 
@@ -302,6 +303,86 @@ w_rc_t    sdisk_unix_t::pwrite(const void *buf, int count, fileoff_t pos,
     return RCOK;
 }
 
+/*
+ * With io_uring enabled, the whole batch is submitted to the ring of the
+ * calling thread (in chunks of the queue depth) and completions are polled
+ * until all requests are done. Otherwise, or if the kernel lacks io_uring,
+ * each request is executed synchronously with preadv/pwritev.
+ */
+w_rc_t    sdisk_unix_t::pio(io_request_t *reqs, int count)
+{
+    if (_fd == FD_NONE)
+        return RC(stBADFD);
+
+    io_uring_queue_t* ring = NULL;
+    if (sthread_t::io_uring_enabled()) {
+        ring = io_uring_queue_t::get_thread_queue(
+                sthread_t::io_uring_depth());
+    }
+
+    if (!ring) {
+        for (int r = 0; r < count; r++) {
+            io_request_t& req = reqs[r];
+            int n;
+            if (req.is_write) {
+                n = ::pwritev(_fd, (const struct iovec *) req.iov,
+                        req.iovcnt, req.pos);
+            }
+            else {
+                n = ::preadv(_fd, (const struct iovec *) req.iov,
+                        req.iovcnt, req.pos);
+            }
+            CHECK_ERRNO(n);
+            req.done = n;
+            INC_STH_STATS(io_sync_requests);
+        }
+        return RCOK;
+    }
+
+    int submitted = 0;
+    int completed = 0;
+    int error = 0;
+    while (completed < count) {
+        bool queued = false;
+        while (submitted < count && ring->prepare(_fd, reqs[submitted],
+                    submitted))
+        {
+            submitted++;
+            queued = true;
+        }
+        if (queued) {
+            INC_STH_STATS(io_uring_submits);
+        }
+
+        // requests already in the ring reference the caller's buffers, so
+        // we must wait for them even if the system call is interrupted
+        int n = ring->submit_and_wait(1);
+        if (n < 0 && n != -EINTR && n != -EAGAIN && n != -EBUSY) {
+            W_FATAL_MSG(fcOS, << "io_uring_enter failed with errno " << -n);
+        }
+
+        uint64_t idx;
+        int res;
+        while (ring->reap(idx, res)) {
+            completed++;
+            if (res < 0) {
+                error = -res;
+            }
+            else {
+                reqs[idx].done = res;
+            }
+        }
+    }
+    ADD_STH_STATS(io_uring_requests, count);
+
+    if (error) {
+        errno = error;
+        W_RETURN_RC_MSG(fcOS, << "Kernel errno code: " << errno);
+    }
+
+    return RCOK;
+}
+
 w_rc_t    sdisk_unix_t::seek(fileoff_t pos, int origin, fileoff_t &newpos)
 {
     if (_fd == FD_NONE)
@@ -80,6 +80,8 @@ public:
     w_rc_t    pread(void *buf, int count, fileoff_t pos, int &done);
     w_rc_t    pwrite(const void *buf, int count, fileoff_t pos, int &done);
 
+    w_rc_t    pio(io_request_t *reqs, int count);
+
     w_rc_t    seek(fileoff_t pos, int origin, fileoff_t &newpos);
 
     w_rc_t    rename(const char* oldname, const char* newname);
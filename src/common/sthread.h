@@ -176,6 +176,7 @@ public:
     typedef sdisk_base_t::fileoff_t    fileoff_t;
     typedef sdisk_base_t::filestat_t   filestat_t;
     typedef sdisk_base_t::iovec_t      iovec_t;
+    typedef sdisk_base_t::io_request_t io_request_t;
 
 
     /* XXX magic number */
@@ -724,6 +725,18 @@ public:
                             int& done);
     static w_rc_t        pwrite(int fd, const void *buf, int n,
                            fileoff_t pos);
+    /* batch of positioned requests (see sdisk_t::pio) */
+    static w_rc_t        pio(int fd, io_request_t *reqs, int count);
+
+    /*
+     * Selects the backend of pio(): if enabled, batches are submitted to a
+     * per-thread io_uring with the given queue depth; otherwise, or if the
+     * kernel does not support io_uring, they are executed with
+     * preadv/pwritev.
+     */
+    static void          set_io_uring(bool enable, unsigned depth = 64);
+    static bool          io_uring_enabled() { return _io_uring_enabled; }
+    static unsigned      io_uring_depth() { return _io_uring_depth; }
     static w_rc_t        lseek(
                             int                fd,
                             fileoff_t            offset,
@@ -849,6 +862,8 @@ private:
     static    std::vector<sdisk_t*> _disks;
     static    unsigned       open_max;
     static    unsigned       open_count;
+    static    bool           _io_uring_enabled;
+    static    unsigned       _io_uring_depth;
 
     /* in-thread startup and shutdown */
     static void            __start(void *arg_thread);
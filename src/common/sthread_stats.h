@@ -94,6 +94,7 @@ extern ostream &operator<<(ostream &, const sthread_stats &stats);
 
 
 #    define INC_STH_STATS(x) sthread_t::me()->SthreadStats.x++;
+#    define ADD_STH_STATS(x, y) sthread_t::me()->SthreadStats.x += (y);
 #    define GET_STH_STATS(x) sthread_t::me()->SthreadStats.x
 
 
@@ -187,13 +187,13 @@ public:
      * [Non-atomic] Equality operator on the contained pointer value.
      */
     bool operator==(const GcPointer &other) const {
-        return _raw == other._raw;
+        return _raw.word == other._raw.word;
     }
     /**
      * [Non-atomic] Inequality operator on the contained pointer value.
      */
     bool operator!=(const GcPointer &other) const {
-        return _raw != other._raw;
+        return _raw.word != other._raw.word;
     }
     /**
      * [Non-atomic] Equality operator that compares only the address
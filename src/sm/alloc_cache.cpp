@@ -11,67 +11,81 @@
 #include "smthread.h"
 #include "eventlog.h"
 
+#include <limits>
+#include <algorithm>
+
 const size_t alloc_cache_t::extent_size = alloc_page::bits_held;
 
-alloc_cache_t::alloc_cache_t(stnode_cache_t& stcache, bool virgin)
-    : last_alloc_page(0), stcache(stcache)
+/** Number of extents addressable with a PageID */
+static const size_t max_extents =
+    ((size_t) std::numeric_limits<PageID>::max() + 1) / alloc_page::bits_held;
+
+/** Source of alloc_cache_t::_generation */
+static std::atomic<uint64_t> next_generation(1);
+
+thread_local std::vector<alloc_cache_t::chunk_t> alloc_cache_t::_chunks;
+
+alloc_cache_t::alloc_cache_t(stnode_cache_t& stcache, bool virgin,
+        size_t chunk_pages)
+    : extents(max_extents), last_alloc_page(0), last_reserved_page(0),
+    chunk_pages(chunk_pages > 0 ? chunk_pages : 1),
+    _generation(next_generation++), stcache(stcache)
 {
-    vector<StoreID> stores;
-    stcache.get_used_stores(stores);
+    for (size_t i = 0; i < extents.size(); i++) {
+        extents[i] = NULL;
+    }
 
     if (virgin) {
         // Extend 0 and stnode pid are always allocated
-        loaded_extents.push_back(true);
+        extent_t* e = new extent_t;
+        e->set_bit(0);
+        e->set_bit(stnode_page::stpid);
+        extents[0] = e;
         last_alloc_page = stnode_page::stpid;
     }
     else {
         // Load last extent eagerly and the rest of them on demand
         extent_id_t ext = stcache.get_last_extent();
-        loaded_extents.resize(ext + 1, false);
         W_COERCE(load_alloc_page(ext, true));
     }
+    last_reserved_page = last_alloc_page;
 }
 
-rc_t alloc_cache_t::load_alloc_page(extent_id_t ext, bool is_last_ext)
+alloc_cache_t::~alloc_cache_t()
 {
-    spinlock_write_critical_section cs(&_latch);
-
-    // protect against race on concurrent loads
-    if (loaded_extents[ext]) {
-        return RCOK;
+    for (size_t i = 0; i < extents.size(); i++) {
+        delete extents[i].load();
     }
+}
+
+rc_t alloc_cache_t::load_alloc_page(extent_id_t ext, bool is_last_ext)
+{
+    // caller holds _latch in write mode (or is the constructor)
+    w_assert1(ext < extents.size());
 
     PageID alloc_pid = ext * extent_size;
     fixable_page_h p;
     W_DO(p.fix_direct(alloc_pid, LATCH_EX, false, false));
 
-    if (is_last_ext) {
-        // we know that at least all pids in lower extents were once allocated
-        last_alloc_page = alloc_pid;
-    }
-
     alloc_page* page = (alloc_page*) p.get_generic_page();
+    extent_t* e = new extent_t;
 
-    size_t last_alloc = 0;
-    size_t j = alloc_page::bits_held;
-    while (j > 0) {
+    // we know that at least all pids in lower extents were once allocated
+    PageID last_alloc = alloc_pid;
+    for (size_t j = 1; j < extent_size; j++) {
         if (page->get_bit(j)) {
-            if (last_alloc == 0) {
-                last_alloc = j;
-                if (is_last_ext) {
-                    last_alloc_page = alloc_pid + j;
-                }
-            }
+            e->set_bit(j);
+            last_alloc = alloc_pid + j;
         }
-        else if (last_alloc != 0) {
-            freed_pages.insert(alloc_pid + j);
-        }
-
-        j--;
     }
+    // the alloc page itself is always allocated
+    e->set_bit(0);
+    e->page_lsn = p.lsn();
 
-    page_lsns[p.pid()] = p.lsn();
-    loaded_extents[ext] = true;
+    if (is_last_ext) {
+        last_alloc_page = last_alloc;
+    }
+    extents[ext] = e;
 
     // pass argument evict=true because we won't be maintaining the page
     p.unfix(true);
@@ -79,92 +93,158 @@ rc_t alloc_cache_t::load_alloc_page(extent_id_t ext, bool is_last_ext)
     return RCOK;
 }
 
+alloc_cache_t::extent_t* alloc_cache_t::get_extent(extent_id_t ext)
+{
+    // Pointers never change once set, so a non-null one can be used without
+    // latching. Races on concurrent loads are resolved under the latch.
+    extent_t* e = extents[ext];
+    if (e) { return e; }
+
+    spinlock_write_critical_section cs(&_latch);
+    e = extents[ext];
+    if (!e) {
+        W_COERCE(load_alloc_page(ext, false));
+        e = extents[ext];
+    }
+    return e;
+}
+
+void alloc_cache_t::update_last_alloc_page(PageID pid)
+{
+    PageID last = last_alloc_page;
+    while (last < pid && !last_alloc_page.compare_exchange_weak(last, pid)) {}
+}
+
 PageID alloc_cache_t::get_last_allocated_pid() const
 {
-    spinlock_read_critical_section cs(&_latch);
     return last_alloc_page;
 }
 
 lsn_t alloc_cache_t::get_page_lsn(PageID pid)
 {
-    spinlock_read_critical_section cs(&_latch);
-    map<PageID, lsn_t>::const_iterator it = page_lsns.find(pid);
-    if (it == page_lsns.end()) { return lsn_t::null; }
-    return it->second;
+    extent_t* e = extents[pid / extent_size];
+    if (!e) { return lsn_t::null; }
+    spinlock_read_critical_section cs(&e->latch);
+    return e->page_lsn;
 }
 
-bool alloc_cache_t::is_allocated(PageID pid)
+void alloc_cache_t::get_page_lsns(map<PageID, lsn_t>& page_lsns_out,
+        map<PageID, lsn_t>& clean_lsns_out)
 {
-    // No latching required to check if loaded. Any races will be
-    // resolved inside load_alloc_page
-    extent_id_t ext = pid / extent_size;
-    if (!loaded_extents[ext]) {
-        W_COERCE(load_alloc_page(ext, false));
+    extent_id_t last_extent;
+    {
+        spinlock_read_critical_section cs(&_latch);
+        last_extent = last_reserved_page / extent_size;
     }
 
-    spinlock_read_critical_section cs(&_latch);
-
-    // loaded cannot go from true to false, so this is safe
-    w_assert0(loaded_extents[ext]);
+    page_lsns_out.clear();
+    clean_lsns_out.clear();
+    for (extent_id_t ext = 0; ext <= last_extent; ext++) {
+        extent_t* e = extents[ext];
+        if (!e) { continue; }
+        PageID alloc_pid = ext * extent_size;
+        spinlock_read_critical_section cs(&e->latch);
+        page_lsns_out[alloc_pid] = e->page_lsn;
+        if (!e->clean_lsn.is_null()) {
+            clean_lsns_out[alloc_pid] = e->clean_lsn;
+        }
+    }
+}
 
+bool alloc_cache_t::is_allocated(PageID pid)
+{
     if (pid > last_alloc_page) { return false; }
 
-    pid_set::const_iterator iter = freed_pages.find(pid);
-    return (iter == freed_pages.end());
+    extent_t* e = get_extent(pid / extent_size);
+    return e->get_bit(pid % extent_size);
 }
 
-rc_t alloc_cache_t::sx_allocate_page(PageID& pid, bool redo)
+rc_t alloc_cache_t::reserve_chunk(chunk_t& chunk)
 {
     spinlock_write_critical_section cs(&_latch);
 
+    PageID pid = last_reserved_page + 1;
+    w_assert1(pid != stnode_page::stpid);
+
+    extent_id_t ext = pid / extent_size;
+    if (pid % extent_size == 0) {
+        W_DO(stcache.sx_append_extent(ext));
+        w_assert1(ext < extents.size());
+
+        extent_t* e = new extent_t;
+        e->set_bit(0);
+        extents[ext] = e;
+        pid++;
+    }
+
+    // A chunk never spans two extents
+    PageID end = std::min<PageID>(pid + chunk_pages, (ext + 1) * extent_size);
+
+    chunk.next = pid;
+    chunk.end = end;
+    chunk.generation = _generation;
+    last_reserved_page = end - 1;
+
+    INC_TSTAT(page_alloc_chunks);
+
+    return RCOK;
+}
+
+rc_t alloc_cache_t::sx_allocate_page(PageID& pid, bool redo, StoreID stid)
+{
     if (redo) {
-        // all space before this pid must not be contiguous free space
-        if (last_alloc_page < pid) {
-            last_alloc_page = pid;
-        }
-        // if pid is on freed list, remove
-        pid_set::iterator iter = freed_pages.find(pid);
-        if (iter != freed_pages.end()) {
-            freed_pages.erase(iter);
+        extent_t* e = get_extent(pid / extent_size);
+        e->set_bit(pid % extent_size);
+        update_last_alloc_page(pid);
+
+        // all space before this pid must not be handed out again
+        spinlock_write_critical_section cs(&_latch);
+        if (last_reserved_page < pid) {
+            last_reserved_page = pid;
         }
+        return RCOK;
     }
-    else {
-        pid = last_alloc_page + 1;
-        w_assert1(pid != stnode_page::stpid);
 
-        if (pid % extent_size == 0) {
-            extent_id_t ext = last_alloc_page / extent_size + 1;
-            pid = ext * extent_size + 1;
-            W_DO(stcache.sx_append_extent(ext));
-        }
+    if (_chunks.size() <= stid) {
+        _chunks.resize(stid + 1, chunk_t{0, 0, 0});
+    }
+    chunk_t& chunk = _chunks[stid];
+    if (chunk.generation != _generation || chunk.next >= chunk.end) {
+        W_DO(reserve_chunk(chunk));
+    }
 
-        last_alloc_page = pid;
+    pid = chunk.next++;
 
-        // CS TODO: page allocation should transfer ownership instead of just
-        // marking the page as allocated; otherwise, zombie pages may appear
-        // due to system failures after allocation but before setting the
-        // pointer on the new owner/parent page. To fix this, an SSX to
-        // allocate an emptry b-tree child would be the best option.
+    // Extents of reserved chunks are always in memory
+    extent_t* e = extents[pid / extent_size];
+    w_assert1(e);
+    w_assert1(!e->get_bit(pid % extent_size));
+    e->set_bit(pid % extent_size);
+    update_last_alloc_page(pid);
 
-        // Entry in page_lsns array is updated by the log insertion
-        extent_id_t ext = pid / extent_size;
-        sysevent::log_alloc_page(pid, page_lsns[ext * extent_size]);
-    }
+    // CS TODO: page allocation should transfer ownership instead of just
+    // marking the page as allocated; otherwise, zombie pages may appear
+    // due to system failures after allocation but before setting the
+    // pointer on the new owner/parent page. To fix this, an SSX to
+    // allocate an emptry b-tree child would be the best option.
+
+    // Page LSN of the extent is updated by the log insertion; the latch
+    // keeps the per-page chain of log records consistent
+    spinlock_write_critical_section cs(&e->latch);
+    sysevent::log_alloc_page(pid, e->page_lsn);
 
     return RCOK;
 }
 
 rc_t alloc_cache_t::sx_deallocate_page(PageID pid, bool redo)
 {
-    spinlock_write_critical_section cs(&_latch);
-
-    // Just add to list of freed pages
-    freed_pages.insert(pid);
+    extent_t* e = get_extent(pid / extent_size);
+    e->unset_bit(pid % extent_size);
 
     if (!redo) {
-        // Entry in page_lsns array is updated by the log insertion
-        extent_id_t ext = pid / extent_size;
-        sysevent::log_dealloc_page(pid, page_lsns[ext * extent_size]);
+        // Page LSN of the extent is updated by the log insertion
+        spinlock_write_critical_section cs(&e->latch);
+        sysevent::log_dealloc_page(pid, e->page_lsn);
     }
 
     return RCOK;
@@ -176,25 +256,29 @@ rc_t alloc_cache_t::write_dirty_pages(lsn_t rec_lsn)
     lsn_t page_lsn = lsn_t::null;
     extent_id_t last_extent = 0;
 
-    // We just have to iterate over the extents in the page_lsns table, since
-    // those are the only ones which were modified since the system started.
+    // We just have to iterate over the extents in memory, since those are
+    // the only ones which were modified since the system started.
     {
         spinlock_read_critical_section cs (&_latch);
-        last_extent = last_alloc_page / extent_size;
+        last_extent = last_reserved_page / extent_size;
     }
 
-    map<PageID, lsn_t>::const_iterator iter;
     for (extent_id_t ext = 0; ext <= last_extent; ext++) {
         PageID alloc_pid = ext * extent_size;
+        extent_t* e = extents[ext];
+        if (!e) { continue; }
+
         // While in the critical section, just verify if the extent alloc page
         // needs to be written, to avoid blocking threads trying to allocate
         // pages for too long.
         {
-            spinlock_read_critical_section cs(&_latch);
-            iter = page_lsns.find(alloc_pid);
-            if (iter == page_lsns.end()) { continue; }
-            if (iter->second > rec_lsn) { continue; }
-            page_lsn = iter->second;
+            spinlock_read_critical_section cs(&e->latch);
+            if (e->page_lsn > rec_lsn) { continue; }
+            // already written with all its updates
+            if (!e->clean_lsn.is_null() && e->page_lsn <= e->clean_lsn) {
+                continue;
+            }
+            page_lsn = e->page_lsn;
         }
 
         if (!buf) {
@@ -207,9 +291,13 @@ rc_t alloc_cache_t::write_dirty_pages(lsn_t rec_lsn)
         W_DO(smlevel_0::vol->read_page_verify(alloc_pid, buf, page_lsn));
         W_DO(smlevel_0::vol->write_page(alloc_pid, buf));
         sysevent::log_page_write(alloc_pid, rec_lsn, 1);
+        {
+            spinlock_write_critical_section cs(&e->latch);
+            e->clean_lsn = rec_lsn;
+        }
     }
 
-    if (buf) { delete[] buf; }
+    if (buf) { free(buf); }
 
     return RCOK;
 }
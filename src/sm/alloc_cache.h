@@ -9,7 +9,8 @@
 #include "alloc_page.h"
 #include "latch.h"
 #include <vector>
-#include <unordered_set>
+#include <map>
+#include <atomic>
 
 class bf_fixed_m;
 
@@ -18,20 +19,40 @@ class bf_fixed_m;
  *
  * \details
  * This object handles allocation/deallocation requests for one volume.
- * All allocation/deallocation are logged and done in a critical section.
- * To make it scalable, this object is designed to be as fast as possible.
+ * All allocation/deallocation are logged.
+ *
+ * Each thread reserves chunks of contiguous page IDs for each store it
+ * allocates pages for, and hands out pages from its chunk without touching
+ * any shared state other than the allocation bitmap of the extent. This way,
+ * pages of one store allocated by one thread stay physically clustered, and
+ * allocations from different threads and stores do not contend on a single
+ * latch. The only latches taken on that path are the per-extent latch
+ * required to maintain the log chain of the alloc page and, once every
+ * chunk, the latch protecting the end of the reserved space.
+ *
+ * Page IDs of a chunk that are never allocated (e.g., because the thread
+ * terminated or the system restarted) are left as free holes in the
+ * allocation bitmap; like deallocated pages, they are currently not reused.
  * @See alloc_page_h
  */
 class alloc_cache_t {
 public:
-    alloc_cache_t(stnode_cache_t& stcache, bool virgin);
+    /**
+     * @param[in] chunk_pages Number of page IDs reserved at once by a thread
+     * for a store (option sm_alloc_chunk_pages); 1 gives every allocation
+     * the next page ID of the volume.
+     */
+    alloc_cache_t(stnode_cache_t& stcache, bool virgin, size_t chunk_pages = 1);
+    ~alloc_cache_t();
 
     /**
      * Allocates one page. (System transaction)
      * @param[out] pid allocated page ID.
      * @param[in] redo If redoing the operation (no log generated)
+     * @param[in] stid Store for which the page is allocated, or 0 if not
+     * known; determines the chunk from which the page is taken.
      */
-    rc_t sx_allocate_page(PageID &pid, bool redo = false);
+    rc_t sx_allocate_page(PageID &pid, bool redo = false, StoreID stid = 0);
 
     /**
      * Deallocates one page. (System transaction)
@@ -43,15 +64,12 @@ public:
      * Writes out any allocation page whose page LSN is greater than the given
      * rec_lsn. Since we don't maintain a page image by flipping a bit and
      * marking a page dirty upon every allocation (allocating a page requires
-     * just incrementing a counter and generating an SSX log record), this
+     * just setting a bit in memory and generating an SSX log record), this
      * requires rebuilding the page images. We use single-page recovery for
      * that, but only on the pages that require propagation, i.e., only those
-     * of loaded extents with greater PageLSN.
+     * of loaded extents with greater PageLSN that were not written yet.
      *
-     * For any extent for which loaded_extents[ext] == true, all free pages
-     * with id lower than last_alloc_page are guaranteed to be in the free
-     * list. Extents for which loaded_extents[ext] == false, on the other hand,
-     * are guaranteed to be up-do-date on disk.
+     * Extents which are not loaded are guaranteed to be up-do-date on disk.
      */
     rc_t write_dirty_pages(lsn_t rec_lsn);
 
@@ -61,55 +79,103 @@ public:
 
     lsn_t get_page_lsn(PageID pid);
 
+    /**
+     * Copies the page LSN of each loaded alloc page, and the LSN up to which
+     * each alloc page was last written by write_dirty_pages (only for pages
+     * written since the system started).
+     */
+    void get_page_lsns(map<PageID, lsn_t>& page_lsns_out,
+            map<PageID, lsn_t>& clean_lsns_out);
+
     static const size_t extent_size;
 
     static bool is_alloc_pid(PageID pid) { return pid % extent_size == 0; }
 
 private:
 
+    /** In-memory image of one alloc page */
+    struct extent_t {
+        static const size_t words = alloc_page::bits_held / 64;
+
+        /** Allocation bitmap of the extent, one bit per page ID */
+        std::atomic<uint64_t> bits[words];
+
+        /**
+         * CS TODO
+         * The page LSN is needed for the sole purpose of maintaining per-page
+         * log-record chains. Since we don't apply allocation operations on
+         * the pages directly (i.e., no page fix is performed), this is
+         * required to generate a correct prev_page pointer when logging
+         * allocations. Protected by latch.
+         */
+        lsn_t page_lsn;
+
+        /** rec_lsn given to the last write_dirty_pages that wrote the page */
+        lsn_t clean_lsn;
+
+        srwlock_t latch;
+
+        extent_t() : page_lsn(lsn_t::null), clean_lsn(lsn_t::null)
+        {
+            for (size_t i = 0; i < words; i++) { bits[i] = 0; }
+        }
+
+        bool get_bit(size_t index) const
+        {
+            return (bits[index / 64] & (1ul << (index % 64))) != 0;
+        }
+        void set_bit(size_t index) { bits[index / 64] |= 1ul << (index % 64); }
+        void unset_bit(size_t index) { bits[index / 64] &= ~(1ul << (index % 64)); }
+    };
+
+    /** Range of page IDs reserved by a thread for one store */
+    struct chunk_t {
+        PageID next;
+        PageID end;
+        /** Instance that reserved the chunk (see _generation) */
+        uint64_t generation;
+    };
+
     /**
-     * Keep track of free pages using the ID of the last allocated page and
-     * a list of free pages whose IDs are lower than that.
-     *
-     * Pages which are freed end up in the list of freed pages, again
-     * one for each store. Currently, these lists are only used to determine
-     * whether a certain page is allocated or not. To avoid fragmentation in
-     * a workload with many deletions, items should be removed from these lists
-     * when allocating a page to avoid fragmentation. One extreme policy would
-     * be to only use the contiguous space when the corresponding list is
-     * empty, i.e., when the non-contiguous space has been fully utilized.
-     * Policies that trade off allocation performance for fragmentation by
-     * managing allocations from both contiguous and non-contiguous space would
-     * be the more flexible and robust option.
+     * Extents indexed by extent ID; null if the extent was not loaded yet.
+     * Allocation information of each extent is loaded on demand, except for
+     * the last extent, which is loaded eagerly. Pointers never change once
+     * set.
      */
-    PageID last_alloc_page;
+    std::vector<std::atomic<extent_t*> > extents;
 
-    typedef unordered_set<PageID> pid_set;
-    pid_set freed_pages;
+    /** Highest page ID ever allocated */
+    std::atomic<PageID> last_alloc_page;
 
-    /**
-     * Bitmap of extents whose allocation pages were already loaded. This is
-     * needed because the allocation information of each extent is loaded on
-     * demand.
-     */
-    vector<bool> loaded_extents;
+    /** Highest page ID reserved by any chunk; protected by _latch */
+    PageID last_reserved_page;
+
+    size_t chunk_pages;
 
     /**
-     * CS TODO
-     * This map is needed for the sole purpose of maintaining per-page
-     * log-record chains. It keeps track of the current pageLSN of each
-     * alloc page. Since we don't apply allocation operations on the pages
-     * directly (i.e., no page fix is performed), this is required to
-     * generate a correct prev_page pointer when logging allocations.
+     * Distinguishes chunks reserved by this instance from chunks left in
+     * thread-local storage by instances of previous runs in the same process.
      */
-    map<PageID, lsn_t> page_lsns;
+    uint64_t _generation;
+
+    /** Chunks reserved by the calling thread, indexed by StoreID */
+    static thread_local std::vector<chunk_t> _chunks;
 
     stnode_cache_t& stcache;
 
-    /** all operations in this object are protected by this lock. */
+    /** protects reservation of chunks and loading of extents */
     mutable srwlock_t _latch;
 
     rc_t load_alloc_page(extent_id_t ext, bool is_last_ext);
+
+    /** Returns the extent, loading it if needed */
+    extent_t* get_extent(extent_id_t ext);
+
+    /** Reserves a new chunk at the end of the reserved space */
+    rc_t reserve_chunk(chunk_t& chunk);
+
+    /** Raises last_alloc_page to at least pid */
+    void update_last_alloc_page(PageID pid);
 };
 
 #endif // ALLOC_CACHE_H
@@ -29,33 +29,76 @@ BackupReader::~BackupReader()
     // delete[] buffer;
 }
 
-BackupOnDemandReader::BackupOnDemandReader(vol_t* volume, size_t segmentSize, size_t numThreads)
-    : BackupReader(segmentSize * sizeof(generic_page) * numThreads),
-      volume(volume), segmentSize(segmentSize)
+WorkspaceSlots::WorkspaceSlots(char* buffer, size_t segmentSize,
+        size_t numThreads, size_t slotsPerThread)
+    : buffer(buffer), segmentSizeBytes(segmentSize * sizeof(generic_page)),
+    slotsPerThread(slotsPerThread), fixed(numThreads * slotsPerThread, -1)
+{
+    w_assert0(slotsPerThread > 0);
+    DO_PTHREAD(pthread_mutex_init(&mutex, NULL));
+}
+
+WorkspaceSlots::~WorkspaceSlots()
+{
+    DO_PTHREAD(pthread_mutex_destroy(&mutex));
+}
+
+char* WorkspaceSlots::fix(unsigned segment, unsigned thread_id)
+{
+    size_t first = thread_id * slotsPerThread;
+    w_assert1(first < fixed.size());
+    while (true) {
+        {
+            CRITICAL_SECTION(cs, &mutex);
+            for (size_t i = first; i < first + slotsPerThread; i++) {
+                if (fixed[i] < 0) {
+                    fixed[i] = segment;
+                    return buffer + (i * segmentSizeBytes);
+                }
+            }
+        }
+        // all slots of the thread are waiting to be written
+        usleep(WAIT_TIME);
+    }
+}
+
+void WorkspaceSlots::unfix(unsigned segment)
+{
+    CRITICAL_SECTION(cs, &mutex);
+    for (size_t i = 0; i < fixed.size(); i++) {
+        if (fixed[i] == (int) segment) {
+            fixed[i] = -1;
+            return;
+        }
+    }
+    w_assert1(false);
+}
+
+BackupOnDemandReader::BackupOnDemandReader(vol_t* volume, size_t segmentSize,
+        size_t numThreads, size_t slotsPerThread)
+    : BackupReader(segmentSize * sizeof(generic_page) * numThreads
+            * slotsPerThread),
+      volume(volume), segmentSize(segmentSize),
+      slots(buffer, segmentSize, numThreads, slotsPerThread)
 {
     w_assert1(volume);
-    W_IFDEBUG1(fixedSegment = -1);
 }
 
 char* BackupOnDemandReader::fix(unsigned segment, unsigned thread_id)
 {
     INC_TSTAT(restore_backup_reads);
-    // w_assert1(fixedSegment < 0);
 
     // CS: TODO call getPidForSegment
     PageID offset = PageID(segment * segmentSize);
-    char* buf = buffer + (thread_id * segmentSize * sizeof(generic_page));
+    char* buf = slots.fix(segment, thread_id);
     W_COERCE(volume->read_backup(offset, segmentSize, buf));
 
-    // W_IFDEBUG1(fixedSegment = segment);
-
     return buf;
 }
 
-void BackupOnDemandReader::unfix(unsigned /* segment */)
+void BackupOnDemandReader::unfix(unsigned segment)
 {
-    // w_assert1(fixedSegment == (int) segment);
-    // W_IFDEBUG1(fixedSegment = -1);
+    slots.unfix(segment);
 }
 
 BackupPrefetcher::BackupPrefetcher(vol_t* volume, size_t numSegments,
@@ -96,11 +139,12 @@ void BackupPrefetcher::prefetch(unsigned segment, int priority)
         }
     }
 
-    // if segment was already requested, ignore
-    for (std::deque<unsigned>::iterator iter = requests.begin();
-            iter != requests.end(); iter++)
-    {
-        if (*iter == segment) { return; }
+    // if segment was already requested, ignore unless it must move ahead
+    std::deque<unsigned>::iterator iter
+        = std::find(requests.begin(), requests.end(), segment);
+    if (iter != requests.end()) {
+        if (priority <= 0) { return; }
+        requests.erase(iter);
     }
 
     // add request to the queue
@@ -199,6 +243,8 @@ void BackupPrefetcher::run()
         char* readSlot = NULL;
         unsigned next = numSegments; // invalid value
         PageID firstPage;
+        // additional segments read in the same batch: (slot, segment)
+        std::vector<std::pair<size_t, unsigned> > batch;
 
         if (wait) {
             usleep(WAIT_TIME);
@@ -284,6 +330,32 @@ void BackupPrefetcher::run()
             w_assert0(readSlot);
             requests.pop_front();
 
+            // With asynchronous I/O, further requested segments are read into
+            // free slots with the same batch of I/O requests
+            size_t maxBatch = sthread_t::io_uring_enabled() ?
+                sthread_t::io_uring_depth() : 1;
+            while (batch.size() + 1 < maxBatch && requests.size() > 0) {
+                unsigned seg = requests.front();
+                bool skip = PageID(seg * segmentSize)
+                    >= volume->num_used_pages();
+                for (size_t i = 0; !skip && i < numSegments; i++) {
+                    skip = slots[i] == (int) seg && status[i] != SLOT_FREE;
+                }
+                if (skip) {
+                    requests.pop_front();
+                    continue;
+                }
+
+                size_t i = 0;
+                while (i < numSegments && status[i] != SLOT_FREE) { i++; }
+                if (i == numSegments) { break; }
+
+                slots[i] = seg;
+                status[i] = SLOT_READING;
+                batch.push_back(std::make_pair(i, seg));
+                requests.pop_front();
+            }
+
         } // end of critical section
 
         DBG(<< "Prefetching segment " << next);
@@ -294,13 +366,29 @@ void BackupPrefetcher::run()
         }
 
         INC_TSTAT(restore_backup_reads);
-        W_COERCE(volume->read_backup(firstPage, segmentSize, readSlot));
+        if (batch.empty()) {
+            W_COERCE(volume->read_backup(firstPage, segmentSize, readSlot));
+        }
+        else {
+            std::vector<std::pair<PageID, void*> > segments;
+            segments.push_back(std::make_pair(firstPage, (void*) readSlot));
+            for (size_t b = 0; b < batch.size(); b++) {
+                segments.push_back(std::make_pair(
+                            PageID(batch[b].second * segmentSize),
+                            (void*) (buffer + batch[b].first * segmentSizeBytes)));
+            }
+            ADD_TSTAT(restore_backup_reads, batch.size());
+            W_COERCE(volume->read_backup_many(segments, segmentSize));
+        }
 
         {
-            // Re-acquire mutex to mark slot as read, i.e., unfixed
+            // Re-acquire mutex to mark slots as read, i.e., unfixed
             CRITICAL_SECTION(cs, &mutex);
             status[slotIdx] = SLOT_UNFIXED;
             DBG(<< "Read segment " << next << " into  slot " << slotIdx);
+            for (size_t b = 0; b < batch.size(); b++) {
+                status[batch[b].first] = SLOT_UNFIXED;
+            }
         }
 
         DBG(<< "Segment " << next << " read finished");
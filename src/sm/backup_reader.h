@@ -5,6 +5,7 @@
 #include "generic_page.h"
 
 #include <deque>
+#include <vector>
 
 class vol_t;
 
@@ -50,15 +51,46 @@ protected:
     char* buffer;
 };
 
+/** \brief Restore workspaces of the backup readers without prefetching
+ *
+ * Each restore thread owns slotsPerThread segment-sized slots of the reader's
+ * buffer. With more than one slot, a thread can fix a segment while segments
+ * it restored before are still being written by the asynchronous
+ * SegmentWriter (see sm_restore_pipeline). If all slots of the thread are
+ * fixed, fix() waits for an unfix.
+ */
+class WorkspaceSlots {
+public:
+    WorkspaceSlots(char* buffer, size_t segmentSize, size_t numThreads,
+            size_t slotsPerThread);
+    ~WorkspaceSlots();
+
+    char* fix(unsigned segment, unsigned thread_id);
+    void unfix(unsigned segment);
+
+private:
+    char* buffer;
+    size_t segmentSizeBytes;
+    size_t slotsPerThread;
+
+    /** Segment fixed on each slot, or -1 if free */
+    std::vector<int> fixed;
+
+    pthread_mutex_t mutex;
+};
+
 /** \brief Dummy backup reader that always returns the same unmodified buffer.
  *
  * Used for backup-less restore, i.e., using only the complete log history.
  */
 class DummyBackupReader : public BackupReader {
 public:
-    DummyBackupReader(size_t segmentSize)
-        : BackupReader(segmentSize * sizeof(generic_page)),
-        segmentSize(segmentSize)
+    DummyBackupReader(size_t segmentSize, size_t numThreads = 1,
+            size_t slotsPerThread = 1)
+        : BackupReader(segmentSize * sizeof(generic_page) * numThreads
+                * slotsPerThread),
+        segmentSize(segmentSize),
+        slots(buffer, segmentSize, numThreads, slotsPerThread)
     {
     }
 
@@ -66,27 +98,31 @@ public:
     {
     }
 
-    virtual char* fix(unsigned, unsigned = 0)
+    virtual char* fix(unsigned segment, unsigned thread_id = 0)
     {
-        memset(buffer, 0, segmentSize * sizeof(generic_page));
-        return buffer;
+        char* buf = slots.fix(segment, thread_id);
+        memset(buf, 0, segmentSize * sizeof(generic_page));
+        return buf;
     }
 
-    virtual void unfix(unsigned)
+    virtual void unfix(unsigned segment)
     {
+        slots.unfix(segment);
     }
 
     static const std::string IMPL_NAME;
 
 private:
     size_t segmentSize;
+    WorkspaceSlots slots;
 };
 
 /** \brief Simple on-demand backup reader without prefetching
  */
 class BackupOnDemandReader : public BackupReader {
 public:
-    BackupOnDemandReader(vol_t* volume, size_t segmentSize, size_t numThreads);
+    BackupOnDemandReader(vol_t* volume, size_t segmentSize, size_t numThreads,
+            size_t slotsPerThread = 1);
 
     virtual ~BackupOnDemandReader()
     {
@@ -99,9 +135,7 @@ public:
 protected:
     vol_t* volume;
     size_t segmentSize;
-
-    // Used just for assertion in debug mode
-    int fixedSegment;
+    WorkspaceSlots slots;
 
 public:
     static const std::string IMPL_NAME;
@@ -144,7 +178,8 @@ public:
 
     /**
      * Default priority is zero, which makes request go to end of FIFO queue.
-     * Any value larger than zero pushes it to the front of the queue.
+     * Any value larger than zero pushes it to the front of the queue, even
+     * if it was already requested.
      */
     virtual void prefetch(unsigned segment, int priority = 0);
     virtual char* fix(unsigned segment, unsigned thread_id = 0);
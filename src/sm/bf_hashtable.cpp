@@ -11,11 +11,14 @@
 #include "bf_hashtable.h"
 #include "latch.h"
 #include <string.h>
+#include <atomic>
 
 const size_t HASHBUCKET_INITIAL_CHUNK_SIZE = 4;
 const uint32_t BF_HASH_SEED = 0x35D0B891;
 const uint32_t HASHBUCKET_INITIAL_EXPANSION = 16;
 const uint32_t HASHBUCKET_SUBSEQUENT_EXPANSION = 4;
+/** Optimistic probes of a bucket before falling back to its read lock */
+const uint32_t HASHBUCKET_OPTIMISTIC_RETRIES = 4;
 
 inline uint32_t bf_hash(PageID x) {
     // CS TODO: use stdlib hashing
@@ -71,6 +74,14 @@ struct bf_hashbucket_chunk {
 
 /**
  * Hash bucket with chaining entries.
+ *
+ * Writers serialize on _lock and additionally make _version odd while they
+ * modify the bucket (seqlock). Readers normally do not touch _lock at all:
+ * they probe the bucket optimistically and validate the result against
+ * _version, falling back to a read critical section only if writers keep
+ * interfering. Chained chunks are never freed before the table is
+ * destroyed, so an optimistic reader may follow a stale chain pointer
+ * without crashing; it will just fail validation.
  */
 template<class T>
 class bf_hashbucket {
@@ -78,17 +89,99 @@ public:
     srwlock_t                   _lock;
     bf_hashbucket_chunk<T>         _chunk;
     uint32_t _used_count;
+    /** Incremented before and after each modification (odd while writing) */
+    std::atomic<uint32_t> _version;
 
     bool find (PageID key, T& value);
+    bool find_locked (PageID key, T& value);
     bool append_if_not_exists (PageID key, T value);
     bool update (PageID key, T value);
     bool remove (PageID key);
 private:
     bf_hashbucket(); // prohibited (not implemented). this class should be bulk-initialized by memset
+
+    /**
+     * Probes the bucket without any latch.
+     * @return false if a concurrent modification was detected, in which
+     * case found and value are meaningless.
+     */
+    bool _find_optimistic (PageID key, T& value, bool& found) const;
+
+    /** Scoped object that marks the bucket as being modified */
+    class write_section {
+    public:
+        write_section(std::atomic<uint32_t>& version) : _version(version) {
+            _version.store(_version.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+        ~write_section() {
+            _version.store(_version.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+        }
+    private:
+        std::atomic<uint32_t>& _version;
+    };
 };
 
+template<class T>
+bool bf_hashbucket<T>::_find_optimistic(PageID key, T& value, bool& found) const {
+    uint32_t version = _version.load(std::memory_order_acquire);
+    if (version & 1) {
+        return false; // writer active
+    }
+
+    // Bucket contents may change under our feet, so read the count only
+    // once and never trust the chain to be as long as it says
+    const volatile uint32_t& used_count_ref = _used_count;
+    uint32_t used_count = used_count_ref;
+    found = false;
+
+    for (uint32_t i = 0; i < used_count && i < HASHBUCKET_INITIAL_CHUNK_SIZE; ++i) {
+        if (_chunk.keys[i] == key) {
+            value = _chunk.values[i];
+            found = true;
+            break;
+        }
+    }
+
+    uint32_t cur_count = HASHBUCKET_INITIAL_CHUNK_SIZE;
+    for (bf_hashbucket_chunk_linked<T>* cur_chunk = _chunk.next_chunk;
+            !found && cur_count < used_count;
+            cur_chunk = cur_chunk->next_chunk)
+    {
+        if (cur_chunk == NULL) {
+            return false; // chain is being extended
+        }
+        for (uint32_t i = 0; i < cur_chunk->size && cur_count < used_count;
+                ++i, ++cur_count) {
+            if (cur_chunk->keys[i] == key) {
+                value = cur_chunk->values[i];
+                found = true;
+                break;
+            }
+        }
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return _version.load(std::memory_order_relaxed) == version;
+}
+
 template<class T>
 bool bf_hashbucket<T>::find(PageID key, T& value) {
+    for (uint32_t i = 0; i < HASHBUCKET_OPTIMISTIC_RETRIES; ++i) {
+        bool found;
+        T tmp;
+        if (_find_optimistic(key, tmp, found)) {
+            if (found) { value = tmp; }
+            return found;
+        }
+    }
+    return find_locked(key, value);
+}
+
+template<class T>
+bool bf_hashbucket<T>::find_locked(PageID key, T& value) {
     spinlock_read_critical_section cs(&_lock);
 
     //first, take a look at initial chunk
@@ -121,6 +214,7 @@ bool bf_hashbucket<T>::find(PageID key, T& value) {
 template<class T>
 bool bf_hashbucket<T>::update (PageID key, T value) {
     spinlock_write_critical_section cs(&_lock);
+    write_section ws(_version);
 
     for (uint32_t i = 0; i < _used_count && i < HASHBUCKET_INITIAL_CHUNK_SIZE; ++i) {
         if (_chunk.keys[i] == key) {
@@ -146,6 +240,7 @@ bool bf_hashbucket<T>::update (PageID key, T value) {
 template<class T>
 bool bf_hashbucket<T>::append_if_not_exists (PageID key, T value) {
     spinlock_write_critical_section cs(&_lock);
+    write_section ws(_version);
 
     for (uint32_t i = 0; i < _used_count && i < HASHBUCKET_INITIAL_CHUNK_SIZE; ++i) {
         if (_chunk.keys[i] == key) {
@@ -160,8 +255,11 @@ bool bf_hashbucket<T>::append_if_not_exists (PageID key, T value) {
         return true;
     }
     if (_chunk.next_chunk == NULL) {
-        _chunk.next_chunk = new bf_hashbucket_chunk_linked<T>
+        bf_hashbucket_chunk_linked<T>* chunk = new bf_hashbucket_chunk_linked<T>
             (HASHBUCKET_INITIAL_CHUNK_SIZE * HASHBUCKET_INITIAL_EXPANSION);
+        // optimistic readers must not see the chunk before it is initialized
+        std::atomic_thread_fence(std::memory_order_release);
+        _chunk.next_chunk = chunk;
     }
 
     uint32_t cur_count = HASHBUCKET_INITIAL_CHUNK_SIZE;
@@ -181,8 +279,10 @@ bool bf_hashbucket<T>::append_if_not_exists (PageID key, T value) {
         cur_count += cur_chunk->size;
         w_assert1(cur_count <= _used_count);
         if (cur_chunk->next_chunk == NULL) {
-            cur_chunk->next_chunk = new bf_hashbucket_chunk_linked<T>
+            bf_hashbucket_chunk_linked<T>* chunk = new bf_hashbucket_chunk_linked<T>
                 (cur_chunk->size * HASHBUCKET_SUBSEQUENT_EXPANSION);
+            std::atomic_thread_fence(std::memory_order_release);
+            cur_chunk->next_chunk = chunk;
         }
     }
     // shouldn't reach here
@@ -193,6 +293,7 @@ bool bf_hashbucket<T>::append_if_not_exists (PageID key, T value) {
 template<class T>
 bool bf_hashbucket<T>::remove (PageID key) {
     spinlock_write_critical_section cs(&_lock);
+    write_section ws(_version);
     bool found = false;
     //first, take a look at initial chunk
     for (uint32_t i = 0; i < _used_count && i < HASHBUCKET_INITIAL_CHUNK_SIZE; ++i) {
@@ -273,6 +374,12 @@ bool bf_hashtable<T>::lookup(PageID key, T& value) const {
     return _table[hash % _size].find(key, value);
 }
 
+template<class T>
+bool bf_hashtable<T>::lookup_locked(PageID key, T& value) const {
+    uint32_t hash = bf_hash(key);
+    return _table[hash % _size].find_locked(key, value);
+}
+
 template<class T>
 bool bf_hashtable<T>::remove(PageID key) {
     uint32_t hash = bf_hash(key);
@@ -40,6 +40,11 @@ typedef pair<bf_idx, bf_idx> bf_idx_pair;
  * while probing this hash table. It's the caller's responsibility to
  * pin the corresponding page in bufferpool.
  *
+ * Lookups are optimistic: writers bump a per-bucket version number around
+ * their modifications and readers retry if the version changed while they
+ * probed the bucket (seqlock). Hence, lookups do not write to shared cache
+ * lines, which matters on hot buckets (e.g., root pages) on many cores.
+ *
  * Because of this separation, there IS a slight chance that the page returned by
  * this hashtable is evicted and no longer available in bufferpool
  * when the client subsequently tries to pin the page. If that happens, the client
@@ -54,9 +59,18 @@ public:
     /**
      * Returns the bf_idx linked to the given key (volume and page ID, see bf_key() in bf_tree.cpp).
      * If the key doesn't exist in this bufferpool, returns 0 (invalid bf_idx).
+     * The bucket is probed without taking its latch and the result is
+     * validated with a version number; the latch is only taken if
+     * concurrent updates to the bucket keep invalidating the probe.
      */
     bool      lookup(PageID key, T& value) const;
 
+    /**
+     * Same as lookup(), but always probes the bucket inside a read critical
+     * section. Kept for comparison in benchmarks.
+     */
+    bool      lookup_locked(PageID key, T& value) const;
+
     /**
      * Imprecise-but-fast version of lookup().
      * This method doesn't take latch, so it's much faster. However false-positives/negatives
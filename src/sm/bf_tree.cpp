@@ -8,6 +8,7 @@
 #include "bf_tree_cb.h"
 #include "bf_tree_cleaner.h"
 #include "page_cleaner_decoupled.h"
+#include "bf_tree_evictor.h"
 #include "bf_tree.h"
 
 #include "smthread.h"
@@ -25,6 +26,7 @@
 #include <ostream>
 #include <limits>
 #include <algorithm>
+#include <thread>
 
 #include "sm_options.h"
 #include "latch.h"
@@ -56,21 +58,18 @@ bf_tree_m::bf_tree_m(const sm_options& options)
 
     bool bufferpool_swizzle =
         options.get_bool_option("sm_bufferpool_swizzle", false);
-    // clock or random
+    // clock, clock_pro, or random
     std::string replacement_policy =
         options.get_string_option("sm_bufferpool_replacement_policy", "clock");
+    // 0 means one shard per hardware thread
+    int freelist_shards =
+        options.get_int_option("sm_bufferpool_freelist_shards", 0);
 
     ::memset (this, 0, sizeof(bf_tree_m));
 
     _block_cnt = nbufpages;
     _enable_swizzling = bufferpool_swizzle;
-    // if (strcmp(replacement_policy.c_str(), "clock") == 0) {
-    //     _replacement_policy = POLICY_CLOCK;
-    // } else if (strcmp(replacement_policy.c_str(), "clock+priority") == 0) {
-    //     _replacement_policy = POLICY_CLOCK_PRIORITY;
-    // } else if (strcmp(replacement_policy.c_str(), "random") == 0) {
-    //     _replacement_policy = POLICY_RANDOM;
-    // }
+    _replacement_policy = make_replacement_policy(replacement_policy);
 
     DBGOUT1 (<< "constructing bufferpool with " << nbufpages << " blocks of "
             << SM_PAGESIZE << "-bytes pages... enable_swizzling=" <<
@@ -120,14 +119,25 @@ bf_tree_m::bf_tree_m(const sm_options& options)
     }
 
     // initially, all blocks are free
+    if (freelist_shards <= 0) {
+        freelist_shards = std::max(1u, std::thread::hardware_concurrency());
+    }
+    _freelist_shard_cnt = std::min<uint32_t>(freelist_shards, 64);
+    if (::posix_memalign(&buf, CACHELINE_SIZE,
+                sizeof(bf_freelist_shard) * _freelist_shard_cnt) != 0)
+    {
+        W_FATAL(eOUTOFMEMORY);
+    }
+    ::memset(buf, 0, sizeof(bf_freelist_shard) * _freelist_shard_cnt);
+    _freelist_shards = reinterpret_cast<bf_freelist_shard*>(buf);
+
     _freelist = new bf_idx[nbufpages];
     w_assert0(_freelist != NULL);
-    _freelist[0] = 1; // [0] is a special entry. it's the list head
-    for (bf_idx i = 1; i < nbufpages - 1; ++i) {
-        _freelist[i] = i + 1;
+    _freelist[0] = 0; // [0] isn't a valid block
+    // push in reverse order, so that each shard hands out ascending indexes
+    for (bf_idx i = nbufpages - 1; i > 0; --i) {
+        _add_free_block(i, i % _freelist_shard_cnt);
     }
-    _freelist[nbufpages - 1] = 0;
-    _freelist_len = nbufpages - 1; // -1 because [0] isn't a valid block
 
     //initialize hashtable
     int buckets = w_findprime(1024 + (nbufpages / 4)); // maximum load factor is 25%. this is lower than original shore-mt because we have swizzling
@@ -137,11 +147,42 @@ bf_tree_m::bf_tree_m(const sm_options& options)
     _eviction_current_frame = 0;
     DO_PTHREAD(pthread_mutex_init(&_eviction_lock, NULL));
 
+    _clock_hot_count = 0;
+    _clock_hot_target = 0;
+    _clock_nonresident_hits = 0;
+    _clock_nonresident = NULL;
+    if (_replacement_policy == bf_replacement_policy::clock_pro) {
+        // start with half of the buffer pool reserved for hot pages
+        _clock_hot_target = nbufpages / 2;
+        _clock_nonresident = new PageID[nbufpages];
+        ::memset(_clock_nonresident, 0, sizeof(PageID) * nbufpages);
+    }
+
     _cleaner_decoupled = options.get_bool_option("sm_cleaner_decoupled", false);
+
+    int prefetch_threads =
+        options.get_int_option("sm_bufferpool_prefetch_threads", 4);
+    if (prefetch_threads > 0) {
+        _prefetcher = new bf_prefetcher(this, prefetch_threads);
+    }
+
+    if (bf_tree_evictor::is_enabled(options)) {
+        _evictor = new bf_tree_evictor(this, options);
+        _evictor->fork();
+    }
 }
 
 void bf_tree_m::shutdown()
 {
+    if (_prefetcher) {
+        _prefetcher->stop();
+    }
+    // evictor uses the cleaner, so stop it first
+    if (_evictor) {
+        _evictor->stop();
+        delete _evictor;
+        _evictor = NULL;
+    }
     if (_cleaner) {
         _cleaner->stop();
         delete _cleaner;
@@ -162,10 +203,27 @@ bf_tree_m::~bf_tree_m()
         delete[] _freelist;
         _freelist = NULL;
     }
+    if (_freelist_shards != NULL) {
+        ::free(_freelist_shards);
+        _freelist_shards = NULL;
+    }
     if (_hashtable != NULL) {
         delete _hashtable;
         _hashtable = NULL;
     }
+    if (_clock_nonresident != NULL) {
+        delete[] _clock_nonresident;
+        _clock_nonresident = NULL;
+    }
+    if (_prefetcher != NULL) {
+        delete _prefetcher;
+        _prefetcher = NULL;
+    }
+    if (_evictor != NULL) {
+        _evictor->stop();
+        delete _evictor;
+        _evictor = NULL;
+    }
     if (_buffer != NULL) {
         void *buf = reinterpret_cast<void*>(_buffer);
         // note we use free(), not delete[], which corresponds to posix_memalign
@@ -186,7 +244,8 @@ page_cleaner_base* bf_tree_m::get_cleaner()
 
     if (!_cleaner) {
         if(_cleaner_decoupled) {
-            w_assert0(smlevel_0::logArchiver);
+            w_assert0(smlevel_0::logArchiver || ss_m::get_options()
+                    .get_bool_option("sm_cleaner_decoupled_log", false));
             _cleaner = new page_cleaner_decoupled(this,
                     ss_m::get_options());
         }
@@ -239,6 +298,7 @@ w_rc_t bf_tree_m::fix(generic_page* parent, generic_page*& page,
         if (mode == LATCH_EX) {
             cb.inc_ref_count_ex();
         }
+        INC_TSTAT(bf_hit_cnt);
 
         page = &(_buffer[idx]);
 
@@ -328,6 +388,8 @@ w_rc_t bf_tree_m::fix(generic_page* parent, generic_page*& page,
                 cb.init(pid, page->lsn);
             }
 
+            _clock_admit(cb, pid);
+
             w_assert1(_is_active_idx(idx));
 
             // STEP 6) Fix successful -- pin page and downgrade latch
@@ -365,6 +427,7 @@ w_rc_t bf_tree_m::fix(generic_page* parent, generic_page*& page,
             if (mode == LATCH_EX) {
                 cb.inc_ref_count_ex();
             }
+            INC_TSTAT(bf_hit_cnt);
 
             page = &(_buffer[idx]);
 
@@ -480,6 +543,94 @@ void bf_tree_m::unpin_for_refix(bf_idx idx) {
     w_assert1(get_cb(idx)._pin_cnt >= 0);
 }
 
+void bf_tree_m::prefetch(const generic_page* parent, general_recordid_t from,
+        general_recordid_t to)
+{
+    if (!_prefetcher) { return; }
+
+    w_assert1(is_bf_page(parent));
+    w_assert1(latch_mode(parent) != LATCH_NL);
+    generic_page* parent_page = const_cast<generic_page*>(parent);
+    bf_idx parent_idx = parent - _buffer;
+
+    btree_page_h parent_h;
+    parent_h.fix_nonbufferpool_page(parent_page);
+    if (from < GeneralRecordIds::FOSTER_CHILD) {
+        from = GeneralRecordIds::FOSTER_CHILD;
+    }
+    if (to > parent_h.max_child_slot()) {
+        to = parent_h.max_child_slot();
+    }
+
+    bool enqueued = false;
+    for (general_recordid_t slot = from; slot <= to; slot++) {
+        PageID pid = *parent_h.child_slot_address(slot);
+        if (pid == 0 || is_swizzled_pointer(pid)) { continue; }
+
+        bf_idx_pair p;
+        if (_hashtable->lookup(pid, p)) { continue; }
+
+        _prefetcher->enqueue(pid, parent_idx,
+                parent_h.get_emlsn_general(slot));
+        INC_TSTAT(bf_prefetch_requests);
+        enqueued = true;
+    }
+
+    if (enqueued) {
+        _prefetcher->wakeup();
+    }
+}
+
+void bf_tree_m::_prefetch_page(PageID pid, bf_idx parent_idx, lsn_t emlsn)
+{
+    // Page may have been fixed since the request was made
+    bf_idx_pair p;
+    if (_hashtable->lookup(pid, p)) { return; }
+
+    bf_idx idx = 0;
+    if (_grab_free_block(idx).is_error()) {
+        INC_TSTAT(bf_prefetch_dropped);
+        return;
+    }
+    w_assert1(_is_valid_idx(idx));
+    bf_tree_cb_t &cb = get_cb(idx);
+
+    // Same protocol as a miss in fix(): EX-latch the frame and then register
+    // it in the hashtable, so that concurrent fixes wait for the read
+    w_rc_t rc = cb.latch().latch_acquire(LATCH_EX, sthread_t::WAIT_IMMEDIATE);
+    if (rc.is_error()) {
+        _add_free_block(idx);
+        INC_TSTAT(bf_prefetch_dropped);
+        return;
+    }
+    if (!_hashtable->insert_if_not_exists(pid, bf_idx_pair(idx, parent_idx))) {
+        // some other thread is already reading the page
+        cb.latch().latch_release();
+        _add_free_block(idx);
+        return;
+    }
+
+    generic_page* page = &_buffer[idx];
+    cb.init(pid, lsn_t::null);
+    rc = smlevel_0::vol->read_page_verify(pid, page, emlsn);
+    if (rc.is_error()) {
+        // a later fix will retry the read and report the error
+        _hashtable->remove(pid);
+        cb.clear_except_latch();
+        cb.latch().latch_release();
+        _add_free_block(idx);
+        INC_TSTAT(bf_prefetch_dropped);
+        return;
+    }
+    cb.init(pid, page->lsn);
+    _clock_admit(cb, pid);
+    w_assert1(_is_active_idx(idx));
+
+    // Page stays unpinned, i.e., it may be evicted before it is used
+    cb.latch().latch_release();
+    INC_TSTAT(bf_prefetches);
+}
+
 ///////////////////////////////////   Page fix/unfix END         ///////////////////////////////////
 
 void bf_tree_m::switch_parent(PageID pid, generic_page* parent)
@@ -634,7 +785,12 @@ bool bf_tree_m::unswizzle(generic_page* parent, general_recordid_t child_slot, b
 void bf_tree_m::debug_dump(std::ostream &o) const
 {
     o << "dumping the bufferpool contents. _block_cnt=" << _block_cnt << "\n";
-    o << "  _freelist_len=" << _freelist_len << ", HEAD=" << FREELIST_HEAD << "\n";
+    o << "  _freelist_len=" << _get_freelist_len() << ", HEADS=";
+    for (uint32_t i = 0; i < _freelist_shard_cnt; ++i) {
+        o << (i > 0 ? "," : "")
+            << bf_freelist_shard::head_idx(_freelist_shards[i].head);
+    }
+    o << "\n";
 
     for (uint32_t store = 1; store < stnode_page::max; ++store) {
         if (_root_pages[store] != 0) {
@@ -654,6 +810,9 @@ void bf_tree_m::debug_dump(std::ostream &o) const
             o << ", _pin_cnt=" << cb._pin_cnt;
             o << ", _ref_count=" << cb._ref_count;
             o << ", _ref_count_ex=" << cb._ref_count_ex;
+            if (_replacement_policy == bf_replacement_policy::clock_pro) {
+                o << ", _hot=" << cb._hot.load();
+            }
             o << ", ";
             cb.latch().print(o);
         } else {
@@ -726,6 +885,7 @@ void bf_tree_m::_delete_block(bf_idx idx) {
     DBGOUT1(<<"delete block: remove page pid = " << cb._pid);
     bool removed = _hashtable->remove(cb._pid);
     w_assert1(removed);
+    _clock_forget(cb);
 
     // after all, give back this block to the freelist. other threads can see this block from now on
     _add_free_block(idx);
@@ -853,6 +1013,74 @@ w_rc_t bf_tree_m::fix_root (generic_page*& page, StoreID store,
     return RCOK;
 }
 
+generic_page* bf_tree_m::read_optimistic(PageID pid, uint32_t& version)
+{
+    version = 0;
+    bf_idx idx;
+    if (is_swizzled_pointer(pid)) {
+        idx = pid ^ SWIZZLED_PID_BIT;
+        if (!_is_valid_idx(idx)) { return NULL; }
+    }
+    else {
+        idx = lookup(pid);
+        if (idx == 0) { return NULL; }
+    }
+
+    bf_tree_cb_t &cb = get_cb(idx);
+    version = cb.latch().optimistic_version();
+    if (version & 1) {
+        // EX-latched: being read from disk, evicted or updated
+        return NULL;
+    }
+    // Read after the version, so validating the version also validates
+    // that the frame still holds the page
+    if (!cb._used || cb._pin_cnt < 0) { return NULL; }
+    if (!is_swizzled_pointer(pid) && cb._pid != pid) { return NULL; }
+    return &_buffer[idx];
+}
+
+generic_page* bf_tree_m::read_optimistic_root(StoreID store, uint32_t& version)
+{
+    w_assert1(store != 0);
+    bf_idx idx = _root_pages[store];
+    if (!_is_valid_idx(idx)) {
+        version = 0;
+        return NULL;
+    }
+    return read_optimistic(idx | SWIZZLED_PID_BIT, version);
+}
+
+bool bf_tree_m::validate_optimistic(const generic_page* page, uint32_t version) const
+{
+    return get_cb(page - _buffer).latch().optimistic_validate(version);
+}
+
+bool bf_tree_m::fix_if_unchanged(generic_page* page, uint32_t version,
+        latch_mode_t mode)
+{
+    bf_idx idx = page - _buffer;
+    w_assert1(_is_valid_idx(idx));
+    bf_tree_cb_t &cb = get_cb(idx);
+
+    w_rc_t rc = cb.latch().latch_acquire(mode, sthread_t::WAIT_FOREVER);
+    if (rc.is_error()) { return false; }
+
+    // Our own EX latch makes the version odd
+    uint32_t expected = (mode == LATCH_EX) ? version + 1 : version;
+    if (cb.latch().optimistic_version() != expected) {
+        cb.latch().latch_release();
+        return false;
+    }
+
+    w_assert1(_is_active_idx(idx));
+    cb.pin();
+    cb.inc_ref_count();
+    if (mode == LATCH_EX) {
+        cb.inc_ref_count_ex();
+    }
+    INC_TSTAT(bf_hit_cnt);
+    return true;
+}
 
 void bf_tree_m::unfix(const generic_page* p, bool evict)
 {
@@ -865,6 +1093,7 @@ void bf_tree_m::unfix(const generic_page* p, bool evict)
         bool removed = _hashtable->remove(p->pid);
         w_assert1(removed);
 
+        _clock_forget(cb);
         cb.clear_except_latch();
         // -1 indicates page was evicted (i.e., it's invalid and can be read into)
         cb._pin_cnt = -1;
@@ -1009,13 +1238,18 @@ void WarmupThread::fixChildren(btree_page_h& parent, size_t& fixed, size_t max)
         return;
     }
 
+    // Issue reads for the children we are about to fix
+    size_t nrecs = parent.nrecs();
+    size_t budget = max > fixed ? max - fixed : 0;
+    smlevel_0::bf->prefetch(parent.get_generic_page(), GeneralRecordIds::PID0,
+            std::min(nrecs, budget));
+
     page.fix_nonroot(parent, parent.pid0_opaqueptr(), LATCH_SH);
     fixed++;
     w_assert1(parent.level() > page.level());
     fixChildren(page, fixed, max);
     page.unfix();
 
-    size_t nrecs = parent.nrecs();
     for (size_t j = 0; j < nrecs; j++) {
         if (fixed >= max) {
             return;
@@ -1050,3 +1284,69 @@ void WarmupThread::run()
     ERROUT(<< "Finished warmup! Pages fixed: " << fixed << " of " << npages <<
             " with DB size " << vol->get_alloc_cache()->get_last_allocated_pid());
 }
+
+bf_prefetcher::bf_prefetcher(bf_tree_m* bufferpool, size_t thread_cnt)
+    : _bufferpool(bufferpool), _thread_cnt(thread_cnt)
+{
+}
+
+bf_prefetcher::~bf_prefetcher()
+{
+    stop();
+}
+
+void bf_prefetcher::enqueue(PageID pid, bf_idx parent_idx, lsn_t emlsn)
+{
+    std::lock_guard<std::mutex> lck(_mutex);
+    request_t req;
+    req.pid = pid;
+    req.parent_idx = parent_idx;
+    req.emlsn = emlsn;
+    _queue.push_back(req);
+}
+
+bool bf_prefetcher::_dequeue(request_t& req)
+{
+    std::lock_guard<std::mutex> lck(_mutex);
+    if (_queue.empty()) { return false; }
+    req = _queue.front();
+    _queue.pop_front();
+    return true;
+}
+
+void bf_prefetcher::wakeup()
+{
+    std::lock_guard<std::mutex> lck(_mutex);
+    if (_threads.empty()) {
+        for (size_t i = 0; i < _thread_cnt; i++) {
+            _threads.push_back(new prefetch_thread_t(this));
+            _threads.back()->fork();
+        }
+    }
+    for (auto t : _threads) {
+        t->wakeup();
+    }
+}
+
+void bf_prefetcher::stop()
+{
+    std::vector<prefetch_thread_t*> threads;
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        _queue.clear();
+        threads.swap(_threads);
+    }
+    for (auto t : threads) {
+        t->stop();
+        delete t;
+    }
+}
+
+void bf_prefetcher::prefetch_thread_t::do_work()
+{
+    request_t req;
+    while (!should_exit() && _prefetcher->_dequeue(req)) {
+        _prefetcher->_bufferpool->_prefetch_page(req.pid, req.parent_idx,
+                req.emlsn);
+    }
+}
@@ -13,6 +13,11 @@
 #include "bf_hashtable.h"
 #include "bf_tree_cb.h"
 #include <iosfwd>
+#include <string>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
 #include "page_cleaner.h"
 
 class sm_options;
@@ -23,6 +28,8 @@ class test_bf_tree;
 class test_bf_fixed;
 class bf_tree_cleaner;
 class bf_tree_cleaner_slave_thread_t;
+class bf_prefetcher;
+class bf_tree_evictor;
 class btree_page_h;
 struct EvictionContext;
 
@@ -38,6 +45,54 @@ enum evict_urgency_t {
     EVICT_COMPLETE,
 };
 
+/**
+ * Page replacement policies used to pick eviction victims.
+ * Set with the option sm_bufferpool_replacement_policy.
+ */
+enum class bf_replacement_policy {
+    /** Evict any leaf that can be latched immediately, ignoring references */
+    random,
+    /** CLOCK with second chance given to frames with a non-zero _ref_count */
+    clock,
+    /**
+     * Simplified CLOCK-Pro: new pages start cold and are only promoted to
+     * the hot set if re-referenced before the hand comes around. Hot pages
+     * are demoted only when the hot set exceeds its adaptive target size,
+     * which makes the policy resistant to scans.
+     */
+    clock_pro
+};
+
+inline bf_replacement_policy make_replacement_policy(const std::string& s)
+{
+    if (s == "random") { return bf_replacement_policy::random; }
+    if (s == "clock") { return bf_replacement_policy::clock; }
+    if (s == "clock_pro") { return bf_replacement_policy::clock_pro; }
+    return bf_replacement_policy::clock;
+}
+
+/**
+ * One shard of the buffer pool free list, i.e., a lock-free stack (Treiber
+ * stack) of free frames linked through bf_tree_m::_freelist. The lower 32
+ * bits of the head hold the index of the top frame (0 if empty) and the
+ * upper 32 bits hold a version tag which is incremented on every push and
+ * pop, so that a CAS on a stale head fails even if the same frame is on top
+ * again (ABA problem). Each shard occupies its own cache line.
+ */
+struct bf_freelist_shard {
+    std::atomic<uint64_t> head;
+    /** Approximate number of frames in this shard (may be off by a few) */
+    std::atomic<int32_t> len;
+
+    static bf_idx head_idx(uint64_t head) { return head & 0xFFFFFFFF; }
+    static uint64_t make_head(uint64_t old_head, bf_idx idx) {
+        return (((old_head >> 32) + 1) << 32) | idx;
+    }
+private:
+    char _padding[CACHELINE_SIZE - sizeof(std::atomic<uint64_t>)
+        - sizeof(std::atomic<int32_t>)];
+};
+
 /** a swizzled pointer (page ID) has this bit ON. */
 const uint32_t SWIZZLED_PID_BIT = 0x80000000;
 
@@ -71,6 +126,8 @@ class bf_tree_m {
     friend class bf_tree_cleaner_slave_thread_t; // for page cleaning
     friend class WarmupThread;
     friend class page_cleaner_decoupled;
+    friend class bf_prefetcher;
+    friend class bf_tree_evictor; // for free list watermarks
 
 public:
     /** constructs the buffer pool. */
@@ -164,6 +221,35 @@ public:
     w_rc_t fix_root (generic_page*& page, StoreID store, latch_mode_t mode,
                      bool conditional, bool virgin);
 
+    /**
+     * Optimistic (latch-free) access to a cached page for readers that
+     * validate what they read with validate_optimistic(). Returns the frame
+     * holding the page given by pid (or bufferpool index when swizzled) and
+     * the latch version to validate against, or NULL if the page is not
+     * cached (version is then 0) or is currently EX-latched (version is then
+     * odd). Nothing is pinned or latched, so
+     * anything read from the frame, including pointers to other pages, may
+     * be garbage until validated.
+     */
+    generic_page* read_optimistic(PageID pid, uint32_t& version);
+
+    /** Same as read_optimistic() for the root page of the given store. */
+    generic_page* read_optimistic_root(StoreID store, uint32_t& version);
+
+    /**
+     * Returns whether the page read optimistically was not EX-latched since
+     * read_optimistic() returned the given version.
+     */
+    bool validate_optimistic(const generic_page* page, uint32_t version) const;
+
+    /**
+     * Latches and pins a page read optimistically, provided that it was not
+     * EX-latched since read_optimistic() returned the given version, i.e.,
+     * it still has the contents that were read. Returns false, holding
+     * nothing, otherwise.
+     */
+    bool fix_if_unchanged(generic_page* page, uint32_t version, latch_mode_t mode);
+
 
     /** returns the current latch mode of the page. */
     latch_mode_t latch_mode(const generic_page* p);
@@ -183,6 +269,22 @@ public:
      */
     void unfix(const generic_page* p, bool evict = false);
 
+    /**
+     * Asynchronously reads the children of the given parent page whose
+     * child slots (as returned by find_page_id_slot) are in the range
+     * [from, to] into the buffer pool. Reads are performed by a pool of
+     * prefetch threads (option sm_bufferpool_prefetch_threads), so that
+     * multiple reads are in flight at a time. While a page is being read,
+     * its frame is registered in the hashtable and EX-latched by the
+     * prefetch thread, so a fix on that page simply waits for the read to
+     * finish. This is only a hint: children which are already cached or
+     * swizzled are ignored, and requests may be dropped if the buffer pool
+     * cannot provide a free frame.
+     * @pre parent is latched by the caller
+     */
+    void prefetch(const generic_page* parent, general_recordid_t from,
+            general_recordid_t to);
+
     /**
      * Returns if the page is already marked dirty.
      */
@@ -271,28 +373,37 @@ public:
 
 
     /**
-     * New eviction algorithm. Sweeps the buffer pool sequentially (like
-     * clock), simply evicting every leaf page for which:
+     * New eviction algorithm. Sweeps the buffer pool sequentially with a
+     * clock hand, evicting every leaf page for which:
+     * 0) The replacement policy agrees (see bf_replacement_policy)
      * 1) An EX latch can be acquired conditionally
      * 2) A parent pointer is available and up-to-date
      * 3) The parent can be latched in SH mode conditionally
      * 4) The pin count is zero
      *
-     * This is not as good as clock or LRU in terms of hit ratio, but unlike
-     * the previous hierarchical algorithm, it is thread-safe. It is also
-     * single-threaded, i.e., only one thread evicts at a time.
+     * Unlike the previous hierarchical algorithm, it is thread-safe. It is
+     * also single-threaded, i.e., only one thread evicts at a time.
+     *
+     * Stops once preferred_count frames were evicted or the free list holds
+     * preferred_count frames. Dirty victims are marked with an eviction hint
+     * for the cleaner. If max_rounds > 0, gives up after that many full
+     * rounds of the clock hand, even if nothing was evicted.
      */
     w_rc_t evict_blocks(
         uint32_t &evicted_count,
         uint32_t &unswizzled_count,
         // evict_urgency_t urgency = EVICT_NORMAL,
-        uint32_t preferred_count = 0);
+        uint32_t preferred_count = 0,
+        uint32_t max_rounds = 0);
 
 
     size_t get_size() { return _block_cnt; }
 
     page_cleaner_base* get_cleaner();
 
+    /** Background evictor; NULL if disabled (see bf_tree_evictor) */
+    bf_tree_evictor* get_evictor() { return _evictor; }
+
     /**
      * Tries to unswizzle the given child page from the parent page.  If, for
      * some reason, unswizzling was impossible or troublesome, gives up and
@@ -334,7 +445,8 @@ private:
     w_rc_t _grab_free_block(bf_idx& ret, bool evict = true);
 
     /**
-     * evict some number of blocks.
+     * Called when the free list is empty. Waits for one round of the
+     * background evictor or, if it is disabled, evicts some number of blocks.
      */
     w_rc_t _get_replacement_block();
 
@@ -358,9 +470,76 @@ private:
     bool _try_evict_block_update_emlsn(bf_tree_cb_t &parent_cb, bf_tree_cb_t &cb,
         bf_idx parent_idx, bf_idx idx, general_recordid_t child_slotid);
 
-    /** Adds a free block to the freelist. */
+    /**
+     * Adds a free block to the freelist shard of the calling thread.
+     */
     void   _add_free_block(bf_idx idx);
 
+    /** Adds a free block to the given freelist shard. */
+    void   _add_free_block(bf_idx idx, uint32_t shard);
+
+    /**
+     * Pops a free block from the given freelist shard.
+     * @return false if the shard is empty
+     */
+    bool   _pop_free_block(bf_freelist_shard& shard, bf_idx& idx);
+
+    /** Returns the freelist shard assigned to the calling thread. */
+    uint32_t _get_freelist_home() const;
+
+    /**
+     * Returns the (approximate) number of free blocks, summed over all
+     * freelist shards.
+     */
+    uint32_t _get_freelist_len() const;
+
+    /**
+     * Reads a page requested with prefetch() into a free frame. Called by
+     * the prefetch threads.
+     */
+    void _prefetch_page(PageID pid, bf_idx parent_idx, lsn_t emlsn);
+
+    /**
+     * Called by the clock hand on every used frame it visits. Updates the
+     * reference state of the frame according to the replacement policy.
+     * @return whether the frame may be evicted now
+     * @pre caller holds _eviction_lock
+     */
+    bool _clock_visit(bf_tree_cb_t& cb);
+
+    /**
+     * Sets the initial reference state of a frame into which page pid was
+     * just read from disk.
+     */
+    void _clock_admit(bf_tree_cb_t& cb, PageID pid);
+
+    /**
+     * Must be called when a used frame is freed outside of the eviction
+     * algorithm (e.g., deleted pages), to keep CLOCK-Pro counts accurate.
+     * Clears the hot flag with an atomic exchange, so that the count is
+     * decremented exactly once even if the evictor changes the flag
+     * concurrently.
+     */
+    void _clock_forget(bf_tree_cb_t& cb);
+
+    /**
+     * CLOCK-Pro: moves the frame into or out of the hot set. Only done while
+     * holding the frame's EX latch, taken without waiting, because the
+     * threads that evict a frame call _clock_forget() and then clear it
+     * while holding that latch.
+     * @return whether the hot flag changed; false if the frame was latched
+     * by others or is being freed
+     * @pre caller holds _eviction_lock
+     */
+    bool _clock_set_hot(bf_tree_cb_t& cb, bool hot);
+
+    /**
+     * CLOCK-Pro: remembers pid of an evicted page to detect re-references
+     * during its test period, and adapts the hot set target size.
+     * @pre caller holds _eviction_lock
+     */
+    void _clock_record_nonresident(PageID pid);
+
     /// returns true iff idx is in the valid range.  for assertion.
     bool   _is_valid_idx (bf_idx idx) const;
 
@@ -416,17 +595,20 @@ private:
     /**
      * singly-linked freelist. index is same as _buffer/_control_blocks. zero means no link.
      * This logically belongs to _control_blocks, but is an array by itself for efficiency.
-     * index 0 is always the head of the list (points to the first free block, or 0 if no free block).
+     * The heads of the lists are kept in _freelist_shards.
      */
     bf_idx*              _freelist;
 
-    /** count of free blocks. */
-    uint32_t _freelist_len;
-
-// Be VERY careful on deadlock to use the following.
+    /**
+     * Shards of the freelist. Threads grab and add free blocks on their own
+     * shard (see _get_freelist_home) and only steal from other shards if
+     * theirs is empty, so that page misses do not serialize on a single
+     * cache line. Array size is _freelist_shard_cnt.
+     */
+    bf_freelist_shard*   _freelist_shards;
 
-    /** spin lock to protect all freelist related stuff. */
-    tatas_lock           _freelist_lock;
+    /** Number of freelist shards (option sm_bufferpool_freelist_shards). */
+    uint32_t             _freelist_shard_cnt;
 
 
     bf_idx _eviction_current_frame;
@@ -439,9 +621,43 @@ private:
 
     // queue_based_lock_t   _eviction_mutex;
 
+    /** Policy used by the clock hand to select victims */
+    bf_replacement_policy _replacement_policy;
+
+    /** CLOCK-Pro: number of frames currently in the hot set */
+    std::atomic<uint32_t> _clock_hot_count;
+
+    /**
+     * CLOCK-Pro: adaptive target size of the hot set when the buffer pool
+     * is full. Shrinks when evicted pages are re-referenced during their
+     * test period (i.e., the cold set is too small) and grows when their
+     * test period expires unused. Protected by _eviction_lock.
+     */
+    uint32_t _clock_hot_target;
+
+    /**
+     * CLOCK-Pro: number of misses on non-resident pages since the last
+     * adaptation of _clock_hot_target. Incremented by fix without locks.
+     */
+    std::atomic<uint32_t> _clock_nonresident_hits;
+
+    /**
+     * CLOCK-Pro: direct-mapped table of recently evicted page IDs (the
+     * "non-resident cold pages" in the original algorithm). A page is in
+     * its test period while its ID is still in this table. Slot contents
+     * are approximate -- races only cause missed or spurious adaptations.
+     */
+    PageID* _clock_nonresident;
+
     /** the dirty page cleaner. */
     page_cleaner_base*   _cleaner;
 
+    /** Serves prefetch() requests; NULL if prefetching is disabled */
+    bf_prefetcher* _prefetcher;
+
+    /** Keeps free frames between watermarks; NULL if disabled */
+    bf_tree_evictor* _evictor;
+
     /** whether to swizzle non-root pages. */
     bool                 _enable_swizzling;
 
@@ -502,8 +718,60 @@ public:
     void fixChildren(btree_page_h& parent, size_t& fixed, size_t max);
 };
 
-// tiny macro to help swizzled-LRU and freelist access
-#define FREELIST_HEAD _freelist[0]
+/**
+ * Pool of threads that serve page reads requested with bf_tree_m::prefetch().
+ * Requests are kept in a FIFO queue shared by all threads, so that up to
+ * one read per thread is in flight at a time. Threads are only started on
+ * the first request.
+ */
+class bf_prefetcher {
+public:
+    bf_prefetcher(bf_tree_m* bufferpool, size_t thread_cnt);
+    ~bf_prefetcher();
+
+    /** Adds a request to the queue. Call wakeup() after a batch of these. */
+    void enqueue(PageID pid, bf_idx parent_idx, lsn_t emlsn);
+
+    /** Wakes up the prefetch threads, starting them if necessary */
+    void wakeup();
+
+    /** Stops all prefetch threads, dropping pending requests */
+    void stop();
+
+private:
+    struct request_t {
+        PageID pid;
+        bf_idx parent_idx;
+        lsn_t emlsn;
+    };
+
+    class prefetch_thread_t : public worker_thread_t {
+    public:
+        prefetch_thread_t(bf_prefetcher* prefetcher)
+            : _prefetcher(prefetcher)
+        {}
+        virtual ~prefetch_thread_t() {}
+    protected:
+        virtual void do_work();
+    private:
+        bf_prefetcher* _prefetcher;
+    };
+
+    /**
+     * Pops the next request from the queue.
+     * @return false if the queue is empty
+     */
+    bool _dequeue(request_t& req);
+
+    bf_tree_m* _bufferpool;
+    size_t _thread_cnt;
+    std::vector<prefetch_thread_t*> _threads;
+    std::deque<request_t> _queue;
+    /** Protects _queue and _threads */
+    std::mutex _mutex;
+};
+
+// tiny macro to help swizzled-LRU access
 // #define SWIZZLED_LRU_HEAD _swizzled_lru[0]
 // #define SWIZZLED_LRU_TAIL _swizzled_lru[1]
 // #define SWIZZLED_LRU_PREV(x) _swizzled_lru[x * 2]
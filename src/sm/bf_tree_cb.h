@@ -125,15 +125,20 @@ struct bf_tree_cb_t {
      * maximum value of the refcount by BP_MAX_REFCOUNT to avoid the scalability
      * bottleneck caused by excessive cache coherence traffic (cacheline ping-pongs
      * between sockets).  The counter still has enough granularity to separate cold from
-     * hot pages.  Clock decrements the counter when it visits the page.
+     * hot pages.  Clock decrements (halves) the counter when it visits the page.
      */
     uint16_t _ref_count;// +2  -> 10
 
     /// Reference count incremented only by X-latching
     uint16_t _ref_count_ex; // +2 -> 12
 
-    /// Filler
-    uint16_t _fill14;        // +2 -> 14
+    /// Whether the frame is in the hot set (CLOCK-Pro replacement only).
+    /// Changed only by atomic exchange, which also adjusts _clock_hot_count.
+    std::atomic<bool> _hot; // +1 -> 13
+
+    /// Whether the evictor picked this frame as a victim while it was dirty;
+    /// the cleaner writes such frames first. Approximate, like _ref_count.
+    bool _evict_hint;       // +1 -> 14
 
     /// true if this block is actually used
     std::atomic<bool> _used;          // +1  -> 15
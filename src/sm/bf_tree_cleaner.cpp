@@ -15,7 +15,18 @@
 #include "sm.h"
 #include "stopwatch.h"
 #include "xct.h"
+#include "log_storage.h"
 #include <vector>
+#include <unistd.h>
+
+/** Bytes of log between the two given LSNs */
+static size_t log_distance(lsn_t from, lsn_t to)
+{
+    if (to <= from) { return 0; }
+    size_t partition_size =
+        smlevel_0::log->get_storage()->get_partition_size();
+    return (to.hi() - from.hi()) * partition_size + to.lo() - from.lo();
+}
 
 class candidate_collector_thread : public worker_thread_t
 {
@@ -50,6 +61,18 @@ bf_tree_cleaner::bf_tree_cleaner(bf_tree_m* bufferpool, const sm_options& option
     string pstr = options.get_string_option("sm_cleaner_policy", "");
     policy = make_cleaner_policy(pstr);
 
+    bool adaptive = policy == cleaner_policy::adaptive;
+    max_gap = options.get_int_option("sm_cleaner_max_gap", adaptive ? 8 : 0);
+    io_budget = options.get_int_option("sm_cleaner_io_budget", 0)
+        * 1024 * 1024;
+    recovery_distance_goal =
+        options.get_int_option("sm_cleaner_recovery_distance", 128)
+        * 1024 * 1024;
+    urgent = false;
+    next_urgent = false;
+    budget_elapsed_us = 0;
+    budget_bytes = 0;
+
     if (num_candidates > 0) {
         curr_candidates->reserve(num_candidates);
         next_candidates->reserve(num_candidates);
@@ -80,6 +103,7 @@ void bf_tree_cleaner::do_work()
     else {
         collect_candidates();
         curr_candidates.swap(next_candidates);
+        urgent = next_urgent;
     }
 
     // if there's something in the current list, clean it
@@ -98,6 +122,7 @@ void bf_tree_cleaner::do_work()
         collector->wait_for_round(round + 1);
         w_assert1(curr_candidates->empty());
         curr_candidates.swap(next_candidates);
+        urgent = next_urgent;
     }
 }
 
@@ -110,19 +135,32 @@ void bf_tree_cleaner::clean_candidates()
 
     _clean_lsn = smlevel_0::log->curr_lsn();
 
+    budget_timer.reset();
+    budget_elapsed_us = 0;
+    budget_bytes = 0;
+
+    // Clusters are copied into the workspace one after the other and written
+    // with a single batch of I/O requests once the workspace is full
+    std::vector<std::pair<size_t, size_t> > runs;
+    size_t wpos = 0;
+
     size_t i = 0;
     bool ignore_min_write = ignore_min_write_now();
     while (i < curr_candidates->size()) {
         if (should_exit()) { break; }
 
-        // Get size of current cluster
-        size_t cluster_size = 1;
+        // Get size of current cluster in pages, including gaps of up to
+        // max_gap pages between candidates
+        PageID first_pid = curr_candidates->at(i).pid;
+        PageID last_pid = first_pid;
         for (size_t j = i + 1; j < curr_candidates->size(); j++) {
-            if (curr_candidates->at(j).pid != curr_candidates->at(i).pid + (j - i)) {
+            PageID pid = curr_candidates->at(j).pid;
+            if (pid > last_pid + max_gap + 1) {
                 break;
             }
-            cluster_size++;
+            last_pid = pid;
         }
+        size_t cluster_size = last_pid - first_pid + 1;
 
         // Skip if current cluster is too small
         if (!ignore_min_write && cluster_size < min_write_size) {
@@ -132,19 +170,42 @@ void bf_tree_cleaner::clean_candidates()
 
         ADD_TSTAT(cleaner_time_cpu, timer.time_us());
 
+        if (wpos == _workspace_size) {
+            log_and_flush(runs);
+            ADD_TSTAT(cleaner_time_io, timer.time_us());
+            throttle(wpos);
+            runs.clear();
+            wpos = 0;
+        }
+
         // Copy pages in the cluster to the workspace
-        if (cluster_size > _workspace_size) { cluster_size = _workspace_size; }
+        if (cluster_size > _workspace_size - wpos) {
+            cluster_size = _workspace_size - wpos;
+        }
+        size_t c = i;
         for (size_t k = 0; k < cluster_size; k++) {
-            PageID pid = curr_candidates->at(i+k).pid;
-            bf_idx idx = curr_candidates->at(i+k).idx;
+            PageID pid = first_pid + k;
+            bool is_candidate = curr_candidates->at(c).pid == pid;
+            bf_idx idx;
+            if (is_candidate) {
+                idx = curr_candidates->at(c).idx;
+            }
+            else {
+                // Fill the gap with the page cached in the buffer pool
+                idx = _bufferpool->lookup(pid);
+            }
 
-            if (!latch_and_copy(pid, idx, k)) {
+            if (idx == 0 || !latch_and_copy(pid, idx, wpos + k)) {
                 // If latch failed, cut down the current cluster
                 cluster_size = k;
                 break;
             }
+            if (is_candidate) { c++; }
         }
 
+        // Trailing gap pages are not worth writing
+        cluster_size = c > i ? curr_candidates->at(c - 1).pid - first_pid + 1 : 0;
+
         if (cluster_size == 0) {
             i++;
             continue;
@@ -152,24 +213,50 @@ void bf_tree_cleaner::clean_candidates()
 
         ADD_TSTAT(cleaner_time_copy, timer.time_us());
 
-        log_and_flush(cluster_size);
-        i += cluster_size;
+        runs.push_back(std::make_pair(wpos, cluster_size));
+        wpos += cluster_size;
+        ADD_TSTAT(cleaner_gap_pages, cluster_size - (c - i));
+        i = c;
 
-        ADD_TSTAT(cleaner_time_io, timer.time_us());
         ADD_TSTAT(cleaned_pages, cluster_size);
     }
 
+    log_and_flush(runs);
+    ADD_TSTAT(cleaner_time_io, timer.time_us());
+    throttle(wpos);
+
     curr_candidates->clear();
 }
 
-void bf_tree_cleaner::log_and_flush(size_t wpos)
+void bf_tree_cleaner::throttle(size_t pages)
+{
+    if (io_budget == 0 || urgent || pages == 0) {
+        return;
+    }
+
+    budget_bytes += pages * sizeof(generic_page);
+    budget_elapsed_us += budget_timer.time_us();
+    long long expected_us = (long long) (budget_bytes * 1000000.0 / io_budget);
+    if (expected_us > budget_elapsed_us) {
+        long long sleep_us = expected_us - budget_elapsed_us;
+        ::usleep(sleep_us);
+        ADD_TSTAT(cleaner_throttle_time, sleep_us);
+        budget_elapsed_us += budget_timer.time_us();
+    }
+}
+
+void bf_tree_cleaner::log_and_flush(
+        const std::vector<std::pair<size_t, size_t> >& runs)
 {
-    if (wpos == 0) { return; }
+    if (runs.empty()) { return; }
 
-    flush_workspace(0, wpos);
+    flush_workspace(runs);
+    ADD_TSTAT(cleaner_writes, runs.size());
 
-    PageID pid = _workspace[0].pid;
-    sysevent::log_page_write(pid, _clean_lsn, wpos);
+    for (size_t r = 0; r < runs.size(); r++) {
+        PageID pid = _workspace[runs[r].first].pid;
+        sysevent::log_page_write(pid, _clean_lsn, runs[r].second);
+    }
 
     _clean_lsn = smlevel_0::log->curr_lsn();
 }
@@ -253,8 +340,18 @@ void bf_tree_cleaner::collect_candidates()
     stopwatch_t timer;
     w_assert1(next_candidates->empty());
 
-    // Comparator to be used by the heap
-    auto heap_cmp = get_policy_predicate();
+    // Comparator to be used by the heap: true if a is a better candidate
+    // than b, so that the front of the heap is the worst candidate kept so
+    // far. Frames which the evictor could not evict because they were dirty
+    // are preferred over any other candidate, since they are the ones
+    // blocking the free list.
+    auto policy_cmp = get_policy_predicate();
+    auto heap_cmp = [&policy_cmp] (const cleaner_cb_info& a,
+            const cleaner_cb_info& b)
+    {
+        if (a.evict_hint != b.evict_hint) { return a.evict_hint; }
+        return policy_cmp(b, a);
+    };
 
     bf_idx block_cnt = _bufferpool->_block_cnt;
 
@@ -264,6 +361,10 @@ void bf_tree_cleaner::collect_candidates()
         ignore_empty_clean_lsn = get_rounds_completed() % 4 != 0;
     }
 
+    // Oldest clean LSN of any dirty page, which bounds the amount of log
+    // that restart would have to replay
+    lsn_t oldest_clean_lsn = lsn_t::null;
+
     for (bf_idx idx = 1; idx < block_cnt; ++idx) {
         bf_tree_cb_t &cb = _bufferpool->get_cb(idx);
         cb.pin();
@@ -274,6 +375,13 @@ void bf_tree_cleaner::collect_candidates()
             continue;
         }
 
+        lsn_t clean_lsn = cb.get_clean_lsn();
+        if (clean_lsn != lsn_t::null &&
+                (oldest_clean_lsn == lsn_t::null || clean_lsn < oldest_clean_lsn))
+        {
+            oldest_clean_lsn = clean_lsn;
+        }
+
         if (cb.get_clean_lsn() == lsn_t::null && ignore_empty_clean_lsn) {
             cb.unpin();
             continue;
@@ -281,11 +389,12 @@ void bf_tree_cleaner::collect_candidates()
 
         // add new element to the back of vector
         next_candidates->emplace_back(idx, cb);
+        cb._evict_hint = false;
 
         // manage heap if we are limiting the number of candidates
         if (num_candidates > 0) {
             if (next_candidates->size() < num_candidates ||
-                heap_cmp(next_candidates->front(), next_candidates->back()))
+                heap_cmp(next_candidates->back(), next_candidates->front()))
             {
                 // if it's among the top-k candidates, push it into the heap
                 std::push_heap(next_candidates->begin(), next_candidates->end(), heap_cmp);
@@ -310,5 +419,15 @@ void bf_tree_cleaner::collect_candidates()
 
     std::sort(next_candidates->begin(), next_candidates->end(), lt);
 
+    size_t distance = 0;
+    if (oldest_clean_lsn != lsn_t::null) {
+        distance = log_distance(oldest_clean_lsn, smlevel_0::log->curr_lsn());
+    }
+    next_urgent = policy == cleaner_policy::adaptive
+        && distance > recovery_distance_goal;
+    INC_TSTAT(cleaner_rounds);
+    ADD_TSTAT(cleaner_recovery_distance, distance / 1024);
+    if (next_urgent) { INC_TSTAT(cleaner_urgent_rounds); }
+
     ADD_TSTAT(cleaner_time_cpu, timer.time_us());
 }
@@ -7,6 +7,7 @@
 
 #include "page_cleaner.h"
 #include "bf_tree_cb.h"
+#include "stopwatch.h"
 #include <functional>
 
 class bf_tree_m;
@@ -19,7 +20,9 @@ enum class cleaner_policy {
     highest_refcount,
     lowest_refcount,
     oldest_lsn,
-    mixed
+    mixed,
+    // oldest_lsn, plus gap filling and a recovery distance goal
+    adaptive
 };
 
 /**
@@ -32,13 +35,15 @@ struct cleaner_cb_info {
     bf_idx idx;
     PageID pid;
     uint16_t ref_count;
+    bool evict_hint;
 
     cleaner_cb_info(bf_idx idx, const bf_tree_cb_t& cb) :
         clean_lsn(cb.get_clean_lsn()),
         page_lsn(cb.get_page_lsn()),
         idx(idx),
         pid(cb._pid),
-        ref_count(cb._ref_count_ex)
+        ref_count(cb._ref_count_ex),
+        evict_hint(cb._evict_hint)
     {}
 };
 
@@ -76,7 +81,7 @@ protected:
 
     bool ignore_min_write_now() const
     {
-        if (min_write_size <= 1) { return true; }
+        if (min_write_size <= 1 || urgent) { return true; }
         return min_write_ignore_freq > 0 &&
             (get_rounds_completed() % min_write_ignore_freq == 0);
     }
@@ -84,9 +89,15 @@ protected:
 private:
     void collect_candidates();
     void clean_candidates();
-    void log_and_flush(size_t wpos);
+    void log_and_flush(const std::vector<std::pair<size_t, size_t> >& runs);
     bool latch_and_copy(PageID, bf_idx, size_t wpos);
 
+    /**
+     * Sleeps as long as needed to keep the write bandwidth of the current
+     * round within io_budget, after the given number of pages was written.
+     */
+    void throttle(size_t pages);
+
     /**
      * List of candidate dirty frames to be considered for cleaning.
      * We use two lists -- one is filled in parallel by the candidate collector
@@ -105,6 +116,29 @@ private:
     // Ignore min write size every N rounds (0 for never)
     size_t min_write_ignore_freq;
 
+    /// Fill gaps of up to this many pages between dirty pages of a cluster
+    /// with the (clean or not) pages cached in the buffer pool, so that
+    /// near-consecutive dirty pages are written with a single request
+    size_t max_gap;
+
+    /// Write bandwidth allowed to the cleaner, in bytes/sec (0 for no limit)
+    size_t io_budget;
+
+    /// Recovery distance goal of the adaptive policy, in bytes of log
+    /// between the oldest clean LSN of a dirty page and the current LSN
+    size_t recovery_distance_goal;
+
+    /// Whether the recovery distance exceeded its goal when the current
+    /// (next) candidates were collected. Urgent rounds of the adaptive
+    /// policy ignore the minimum write size and the I/O budget.
+    bool urgent;
+    bool next_urgent;
+
+    /// State of the I/O budget of the current round
+    stopwatch_t budget_timer;
+    long long budget_elapsed_us;
+    size_t budget_bytes;
+
     /// Do not clean alloc/stnode pages, which are not managed in the buffer pool
     bool ignore_metadata;
 
@@ -121,6 +155,7 @@ inline cleaner_policy make_cleaner_policy(string s)
     if (s == "lowest_refcount") { return cleaner_policy::lowest_refcount; }
     if (s == "oldest_lsn") { return cleaner_policy::oldest_lsn; }
     if (s == "mixed") { return cleaner_policy::mixed; }
+    if (s == "adaptive") { return cleaner_policy::adaptive; }
     return cleaner_policy::oldest_lsn;
 }
 
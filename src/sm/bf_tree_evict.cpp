@@ -1,39 +1,84 @@
 #include "bf_tree_cb.h"
 #include "bf_tree.h"
+#include "bf_tree_evictor.h"
 #include "btree_page_h.h"
 #include "log_core.h" // debug: for printing log tail
 
 #include "bf_hashtable.cpp"
 
+/** Freelist shard of the calling thread, assigned round-robin on first use */
+static __thread uint32_t bf_freelist_home = UINT32_MAX;
+static std::atomic<uint32_t> bf_freelist_next_home(0);
+
+uint32_t bf_tree_m::_get_freelist_home() const
+{
+    if (bf_freelist_home == UINT32_MAX) {
+        bf_freelist_home = bf_freelist_next_home++;
+    }
+    return bf_freelist_home % _freelist_shard_cnt;
+}
+
+uint32_t bf_tree_m::_get_freelist_len() const
+{
+    int64_t len = 0;
+    for (uint32_t i = 0; i < _freelist_shard_cnt; i++) {
+        len += _freelist_shards[i].len.load(std::memory_order_relaxed);
+    }
+    return len > 0 ? len : 0;
+}
+
+bool bf_tree_m::_pop_free_block(bf_freelist_shard& shard, bf_idx& idx)
+{
+    uint64_t head = shard.head.load(std::memory_order_acquire);
+    while (true) {
+        idx = bf_freelist_shard::head_idx(head);
+        if (idx == 0) {
+            return false;
+        }
+        // If another thread pops idx concurrently, this may read garbage,
+        // but then the CAS below fails because the tag has changed
+        bf_idx next = _freelist[idx];
+        if (shard.head.compare_exchange_weak(head,
+                    bf_freelist_shard::make_head(head, next),
+                    std::memory_order_acquire, std::memory_order_acquire))
+        {
+            shard.len--;
+            DBG5(<< "Grabbing idx " << idx << " new head " << next);
+            w_assert1(_is_valid_idx(idx));
+            w_assert1(!get_cb(idx)._used);
+            return true;
+        }
+        INC_TSTAT(bf_freelist_cas_retries);
+    }
+}
+
 w_rc_t bf_tree_m::_grab_free_block(bf_idx& ret, bool evict)
 {
     ret = 0;
     while (true) {
-        // once the bufferpool becomes full, getting _freelist_lock everytime will be
-        // too costly. so, we check _freelist_len without lock first.
-        //   false positive : fine. we do real check with locks in it
+        // First try our own shard, then steal from the others. Once the
+        // bufferpool becomes full, probing every shard is wasteful, so check
+        // the (approximate) total count first.
+        //   false positive : fine. we do real check with CAS in pop
         //   false negative : fine. we will eventually get some free block anyways.
-        if (_freelist_len > 0) {
-            CRITICAL_SECTION(cs, &_freelist_lock);
-            if (_freelist_len > 0) { // here, we do the real check
-                bf_idx idx = FREELIST_HEAD;
-                DBG5(<< "Grabbing idx " << idx);
-                w_assert1(_is_valid_idx(idx));
-                w_assert1 (!get_cb(idx)._used);
-                ret = idx;
-
-                --_freelist_len;
-                if (_freelist_len == 0) {
-                    FREELIST_HEAD = 0;
-                } else {
-                    FREELIST_HEAD = _freelist[idx];
-                    w_assert1 (FREELIST_HEAD > 0 && FREELIST_HEAD < _block_cnt);
+        uint32_t free_count = _get_freelist_len();
+        if (free_count > 0) {
+            uint32_t home = _get_freelist_home();
+            for (uint32_t i = 0; i < _freelist_shard_cnt; i++) {
+                uint32_t shard = (home + i) % _freelist_shard_cnt;
+                if (_pop_free_block(_freelist_shards[shard], ret)) {
+                    if (i > 0) { INC_TSTAT(bf_freelist_steals); }
+                    // refill in the background before the free list runs dry
+                    if (evict && _evictor
+                            && free_count <= _evictor->get_low_watermark())
+                    {
+                        INC_TSTAT(bf_evictor_wakeups);
+                        _evictor->wakeup();
+                    }
+                    return RCOK;
                 }
-                DBG5(<< "New head " << FREELIST_HEAD);
-                w_assert1(ret != FREELIST_HEAD);
-                return RCOK;
             }
-        } // exit the scope to do the following out of the critical section
+        }
 
         // if the freelist was empty, let's evict some page.
         if (evict)
@@ -50,6 +95,14 @@ w_rc_t bf_tree_m::_grab_free_block(bf_idx& ret, bool evict)
 
 w_rc_t bf_tree_m::_get_replacement_block()
 {
+    if (_evictor) {
+        // Free list is empty despite the evictor -- wait for it to finish a
+        // round and let the caller retry
+        INC_TSTAT(bf_evictor_foreground_waits);
+        _evictor->wakeup(true);
+        return RCOK;
+    }
+
     get_cleaner()->wakeup();
 
     uint32_t evicted_count, unswizzled_count;
@@ -65,7 +118,7 @@ w_rc_t bf_tree_m::_get_replacement_block()
     while (true) {
     // for (int urgency = EVICT_NORMAL; urgency <= EVICT_COMPLETE; ++urgency) {
         W_DO(evict_blocks(evicted_count, unswizzled_count, (evict_urgency_t) urgency));
-        if (evicted_count > 0 || _freelist_len > 0) {
+        if (evicted_count > 0 || _get_freelist_len() > 0) {
             return RCOK;
         }
         g_me()->sleep(100);
@@ -79,19 +132,178 @@ w_rc_t bf_tree_m::_get_replacement_block()
 
 void bf_tree_m::_add_free_block(bf_idx idx)
 {
-    CRITICAL_SECTION(cs, &_freelist_lock);
+    _add_free_block(idx, _get_freelist_home());
+}
+
+void bf_tree_m::_add_free_block(bf_idx idx, uint32_t shard_idx)
+{
     // CS TODO: Eviction is apparently broken, since I'm seeing the same
     // frame being freed twice by two different threads.
-    w_assert1(idx != FREELIST_HEAD);
+    w_assert1(_is_valid_idx(idx));
     w_assert1(!get_cb(idx)._used);
-    ++_freelist_len;
-    _freelist[idx] = FREELIST_HEAD;
-    FREELIST_HEAD = idx;
+    bf_freelist_shard& shard = _freelist_shards[shard_idx];
+    uint64_t head = shard.head.load(std::memory_order_relaxed);
+    while (true) {
+        w_assert1(idx != bf_freelist_shard::head_idx(head));
+        _freelist[idx] = bf_freelist_shard::head_idx(head);
+        if (shard.head.compare_exchange_weak(head,
+                    bf_freelist_shard::make_head(head, idx),
+                    std::memory_order_release, std::memory_order_relaxed))
+        {
+            break;
+        }
+        INC_TSTAT(bf_freelist_cas_retries);
+    }
+    shard.len++;
+}
+
+bool bf_tree_m::_clock_visit(bf_tree_cb_t& cb)
+{
+    INC_TSTAT(bf_evict_visits);
+
+    switch (_replacement_policy) {
+        case bf_replacement_policy::clock:
+            // Second chance: referenced frames survive this round, but their
+            // counter is halved, so that frames which were hot a long time
+            // ago become victims after a few rounds.
+            if (cb._ref_count > 0) {
+                cb._ref_count >>= 1;
+                INC_TSTAT(bf_evict_second_chance);
+                return false;
+            }
+            return true;
+
+        case bf_replacement_policy::clock_pro:
+        {
+            // Apply adaptations caused by misses on non-resident pages
+            uint32_t hits = _clock_nonresident_hits.exchange(0);
+            if (hits > 0) {
+                uint32_t min_target = _block_cnt / 100 + 1;
+                _clock_hot_target = _clock_hot_target > min_target + hits ?
+                    _clock_hot_target - hits : min_target;
+            }
+
+            if (cb._hot) {
+                if (cb._ref_count > 0) {
+                    cb._ref_count = 0;
+                    INC_TSTAT(bf_evict_second_chance);
+                    return false;
+                }
+                // Target refers to a full buffer pool, so scale it down if
+                // there are free frames (e.g., after startup)
+                uint64_t used = _block_cnt - _get_freelist_len();
+                uint64_t target = _clock_hot_target * used / _block_cnt;
+                if (_clock_hot_count > target && _clock_set_hot(cb, false)) {
+                    // Demoted frames start a new test period as cold frames,
+                    // so they are not evicted in this round
+                    INC_TSTAT(bf_clock_demotions);
+                }
+                return false;
+            }
+
+            if (cb._ref_count > 0) {
+                // Cold frame re-referenced during its test period
+                cb._ref_count = 0;
+                if (_clock_set_hot(cb, true)) {
+                    INC_TSTAT(bf_clock_promotions);
+                }
+                return false;
+            }
+            return true;
+        }
+
+        case bf_replacement_policy::random: default:
+            return true;
+    }
+}
+
+void bf_tree_m::_clock_admit(bf_tree_cb_t& cb, PageID pid)
+{
+    switch (_replacement_policy) {
+        case bf_replacement_policy::clock:
+            // A page just read is considered referenced
+            cb.inc_ref_count();
+            break;
+
+        case bf_replacement_policy::clock_pro:
+        {
+            // New pages start cold with no references, so that pages touched
+            // only once (e.g., by a scan) are evicted on the next round. A miss
+            // on a page still in its test period means the cold set is too
+            // small, so the page is admitted as referenced and the hot target
+            // shrinks (see _clock_visit).
+            PageID& slot = _clock_nonresident[pid % _block_cnt];
+            if (slot == pid) {
+                slot = 0;
+                cb.inc_ref_count();
+                _clock_nonresident_hits++;
+                INC_TSTAT(bf_clock_nonresident_hits);
+            }
+            break;
+        }
+
+        case bf_replacement_policy::random: default:
+            break;
+    }
+}
+
+void bf_tree_m::_clock_forget(bf_tree_cb_t& cb)
+{
+    if (cb._hot.exchange(false)) {
+        w_assert1(_replacement_policy == bf_replacement_policy::clock_pro);
+        _clock_hot_count--;
+    }
+}
+
+bool bf_tree_m::_clock_set_hot(bf_tree_cb_t& cb, bool hot)
+{
+    // A latched frame is busy, hence not worth changing either
+    rc_t latch_rc = cb.latch().latch_acquire(LATCH_EX, sthread_t::WAIT_IMMEDIATE);
+    if (latch_rc.is_error()) {
+        return false;
+    }
+    bool changed = false;
+    if (cb._hot.exchange(hot) != hot) {
+        changed = true;
+        if (hot) {
+            _clock_hot_count++;
+            // _delete_block() clears _used and then calls _clock_forget()
+            // without a latch; if we set the flag after that, undo it here.
+            // Both sides access the atomics in the opposite order, so one of
+            // them clears the flag.
+            if (!cb._used) {
+                _clock_forget(cb);
+                changed = false;
+            }
+        } else {
+            _clock_hot_count--;
+        }
+    }
+    cb.latch().latch_release();
+    return changed;
+}
+
+void bf_tree_m::_clock_record_nonresident(PageID pid)
+{
+    if (_replacement_policy != bf_replacement_policy::clock_pro) {
+        return;
+    }
+
+    PageID& slot = _clock_nonresident[pid % _block_cnt];
+    if (slot != 0) {
+        // Test period of the previous page in this slot expired without a
+        // re-reference, so the hot set can grow
+        if (_clock_hot_target < _block_cnt - _block_cnt / 100 - 1) {
+            _clock_hot_target++;
+        }
+    }
+    slot = pid;
 }
 
 w_rc_t bf_tree_m::evict_blocks(uint32_t& evicted_count,
         uint32_t& unswizzled_count,
-        uint32_t preferred_count)
+        uint32_t preferred_count,
+        uint32_t max_rounds)
 {
     get_cleaner()->wakeup();
 
@@ -102,7 +314,7 @@ w_rc_t bf_tree_m::evict_blocks(uint32_t& evicted_count,
     CRITICAL_SECTION(cs, &_eviction_lock);
 
     // CS once mutex is finally acquired, check if we still need to evict
-    if (_freelist_len >= preferred_count) {
+    if (_get_freelist_len() >= preferred_count) {
         evicted_count = 0;
         unswizzled_count = 0;
         return RCOK;
@@ -115,29 +327,34 @@ w_rc_t bf_tree_m::evict_blocks(uint32_t& evicted_count,
     unsigned nonleaf_count = 0;
     unsigned dirty_count = 0;
 
+    // Frame at which a full round of the clock hand is completed
+    bf_idx round_end = _eviction_current_frame > 0 ?
+        _eviction_current_frame - 1 : _block_cnt - 1;
+
     /*
      * CS: strategy is to try acquiring an EX latch imediately. If it works,
      * page is not that busy, so we can evict it. But only evict leaf pages.
-     * This is like a random policy that only evicts uncontented pages. It is
-     * not as effective as LRU or CLOCK, but it is better than RANDOM, simple
-     * to implement and, most importantly, does not have concurrency bugs!
+     * Before latching, the replacement policy is consulted (see
+     * _clock_visit), so that recently referenced frames get a second chance.
+     * With the random policy, this only evicts uncontented pages.
      */
     while (evicted_count < preferred_count) {
         if (idx == _block_cnt) {
             idx = 0;
         }
-        if (idx == _eviction_current_frame - 1) {
+        if (idx == round_end) {
             // Wake up and wait for cleaner
             get_cleaner()->wakeup(true);
-            if (rounds > 0 && evicted_count == 0) {
-                DBG(<< "Eviction stuck! Nonleafs: " << nonleaf_count
-                        << " dirty: " << dirty_count);
-                nonleaf_count = dirty_count = 0;
-                rounds++;
-            }
-            else if (evicted_count > 0) {
+            rounds++;
+            if (evicted_count > 0) {
                 // best-effort approach: sorry, we evicted as many as we could
-                return RCOK;
+                break;
+            }
+            DBG(<< "Eviction stuck! Nonleafs: " << nonleaf_count
+                    << " dirty: " << dirty_count);
+            nonleaf_count = dirty_count = 0;
+            if (max_rounds > 0 && rounds >= max_rounds) {
+                break;
             }
         }
 
@@ -147,6 +364,12 @@ w_rc_t bf_tree_m::evict_blocks(uint32_t& evicted_count,
         bf_tree_cb_t& cb = get_cb(idx);
         rc_t latch_rc;
 
+        // Step 0: ask replacement policy if frame is a victim
+        if (!cb._used || !_clock_visit(cb)) {
+            idx++;
+            continue;
+        }
+
         // Step 1: latch page in EX mode and check if eligible for eviction
         latch_rc = cb.latch().latch_acquire(LATCH_EX,
                sthread_t::WAIT_IMMEDIATE);
@@ -166,6 +389,14 @@ w_rc_t bf_tree_m::evict_blocks(uint32_t& evicted_count,
             cb.latch().latch_release();
             DBG5(<< "Eviction failed on flags for " << idx);
             if (!p.is_leaf()) { nonleaf_count++; }
+            if (cb.is_dirty() && p.tag() == t_btree_p && p.is_leaf()) {
+                // cold enough to be a victim: ask the cleaner to write it
+                // first, so that it can be evicted in the next round
+                if (!cb._evict_hint) {
+                    cb._evict_hint = true;
+                    INC_TSTAT(bf_evict_dirty_hints);
+                }
+            }
             if (cb.is_dirty()) { dirty_count++; }
             idx++;
             continue;
@@ -275,11 +506,15 @@ w_rc_t bf_tree_m::evict_blocks(uint32_t& evicted_count,
 
         DBG2(<< "EVICTED " << idx << " pid " << pid
                 << " log-tail " << smlevel_0::log->curr_lsn());
+        _clock_forget(cb);
+        _clock_record_nonresident(pid);
         cb.clear_except_latch();
         // -1 indicates page was evicted (i.e., it's invalid and can be read into)
         cb._pin_cnt = -1;
 
-        _add_free_block(idx);
+        // spread evicted frames over all shards, so that one eviction round
+        // refills the freelist of every thread
+        _add_free_block(idx, evicted_count % _freelist_shard_cnt);
         idx++;
         evicted_count++;
 
@@ -287,6 +522,10 @@ w_rc_t bf_tree_m::evict_blocks(uint32_t& evicted_count,
         cb.latch().latch_release();
 
         INC_TSTAT(bf_evict);
+
+        if (_get_freelist_len() >= preferred_count) {
+            break;
+        }
     }
 
     _eviction_current_frame = idx;
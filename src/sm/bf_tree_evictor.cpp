@@ -0,0 +1,50 @@
+#include "bf_tree_evictor.h"
+#include "sm_base.h"
+#include "bf_tree.h"
+
+#include <algorithm>
+
+bf_tree_evictor::bf_tree_evictor(bf_tree_m* bufferpool,
+        const sm_options& options)
+    : worker_thread_t(
+            options.get_int_option("sm_evictor_interval_millisec", 1000)),
+    _bufferpool(bufferpool)
+{
+    uint64_t block_cnt = _bufferpool->get_block_cnt();
+    int low = options.get_int_option("sm_evictor_low_watermark", 1);
+    int high = options.get_int_option("sm_evictor_high_watermark", 2);
+    w_assert0(low > 0);
+
+    _low_watermark = std::max<uint64_t>(1, block_cnt * low / 100);
+    _high_watermark = std::max<uint64_t>(_low_watermark + 1,
+            block_cnt * high / 100);
+}
+
+bf_tree_evictor::~bf_tree_evictor()
+{
+}
+
+bool bf_tree_evictor::is_enabled(const sm_options& options)
+{
+    return options.get_int_option("sm_evictor_low_watermark", 1) > 0;
+}
+
+void bf_tree_evictor::do_work()
+{
+    while (!should_exit()
+            && _bufferpool->_get_freelist_len() < _high_watermark)
+    {
+        // a single round of the clock hand, so that we return to waiting
+        // threads even if nothing could be evicted
+        uint32_t evicted_count, unswizzled_count;
+        W_COERCE(_bufferpool->evict_blocks(evicted_count, unswizzled_count,
+                    _high_watermark, 1));
+        ADD_TSTAT(bf_evictor_evicted, evicted_count);
+        if (evicted_count == 0) {
+            // e.g., all victims are dirty -- the cleaner was woken up and we
+            // retry on the next activation
+            break;
+        }
+    }
+    INC_TSTAT(bf_evictor_rounds);
+}
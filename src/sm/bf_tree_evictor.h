@@ -0,0 +1,50 @@
+#ifndef BF_TREE_EVICTOR_H
+#define BF_TREE_EVICTOR_H
+
+#include "worker_thread.h"
+#include "sm_options.h"
+
+class bf_tree_m;
+
+/**
+ * Background thread that keeps the number of free frames in the buffer pool
+ * between a low and a high watermark, so that threads fixing pages do not
+ * have to evict themselves.
+ *
+ * Threads that grab a free frame wake up the evictor (without waiting) once
+ * the free list drops below the low watermark. The evictor then runs the
+ * clock hand (see bf_tree_m::evict_blocks) until the high watermark is
+ * reached. Only if the free list is completely empty does a thread block,
+ * waiting for one round of the evictor.
+ *
+ * Victims that are dirty cannot be evicted; they are marked with an eviction
+ * hint on their control block, which the cleaner uses to write them first.
+ */
+class bf_tree_evictor : public worker_thread_t {
+public:
+    /**
+     * Watermarks are given as a percentage of the buffer pool frames with
+     * options sm_evictor_low_watermark and sm_evictor_high_watermark.
+     */
+    bf_tree_evictor(bf_tree_m* bufferpool, const sm_options& options);
+    virtual ~bf_tree_evictor();
+
+    /** Whether the options enable the evictor, i.e., low watermark > 0 */
+    static bool is_enabled(const sm_options& options);
+
+    /** Number of free frames below which the evictor is woken up */
+    uint32_t get_low_watermark() const { return _low_watermark; }
+
+    /** Number of free frames the evictor tries to reach in each activation */
+    uint32_t get_high_watermark() const { return _high_watermark; }
+
+protected:
+    virtual void do_work();
+
+private:
+    bf_tree_m* _bufferpool;
+    uint32_t _low_watermark;
+    uint32_t _high_watermark;
+};
+
+#endif // BF_TREE_EVICTOR_H
@@ -69,6 +69,12 @@ btree_m::is_empty(
     return RCOK;
 }
 
+rc_t btree_m::bulk_load(StoreID store, bulk_load_source_t& source,
+                        double fill_factor) {
+    W_DO(btree_impl::_ux_bulk_load(store, source, fill_factor));
+    return RCOK;
+}
+
 rc_t btree_m::insert(StoreID store, const w_keystr_t &key, const cvec_t &el) {
     if (key.get_length_as_nonkeystr() + el.size() > btree_page_h::max_entry_size) {
         return RC(eRECWONTFIT);
@@ -77,6 +83,16 @@ rc_t btree_m::insert(StoreID store, const w_keystr_t &key, const cvec_t &el) {
     return RCOK;
 }
 
+rc_t btree_m::insert_batch(StoreID store, const std::vector<w_keystr_t>& keys,
+                           const std::vector<std::string>& elems,
+                           std::vector<w_error_codes>& results) {
+    if (keys.size() != elems.size()) {
+        return RC(eBADARGUMENT);
+    }
+    W_DO(btree_impl::_ux_insert_batch(store, keys, elems, results));
+    return RCOK;
+}
+
 rc_t btree_m::update(
     StoreID store,
     const w_keystr_t&                 key,
@@ -132,6 +148,13 @@ rc_t btree_m::lookup(
     W_DO( btree_impl::_ux_lookup(store, key, found, el, elen ));
     return RCOK;
 }
+rc_t btree_m::lookup_batch(
+    StoreID store, const std::vector<w_keystr_t>& keys,
+    std::vector<std::string>& elems, std::vector<bool>& found)
+{
+    W_DO( btree_impl::_ux_lookup_batch(store, keys, elems, found));
+    return RCOK;
+}
 rc_t btree_m::verify_tree(
         StoreID store, int hash_bits, bool &consistent)
 {
@@ -211,6 +234,9 @@ rc_t btree_m::touch(const btree_page_h& page, uint64_t &page_count) {
         W_DO(touch(next, page_count));
     }
     if (page.is_node()) {
+        // read all children in the background while we recurse
+        smlevel_0::bf->prefetch(page.get_generic_page(), GeneralRecordIds::PID0,
+                page.nrecs());
         if (page.pid0_opaqueptr())  {
             btree_page_h next;
             W_DO(next.fix_nonroot(page, page.pid0_opaqueptr(), LATCH_SH));
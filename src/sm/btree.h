@@ -12,6 +12,9 @@
  */
 #include "w_defines.h"
 
+#include <string>
+#include <vector>
+
 class btree_page_h;
 struct btree_stats_t;
 class bt_cursor_t;
@@ -20,6 +23,7 @@ struct btree_int_stats_t;
 class w_keystr_t;
 class verify_volume_result;
 struct okvl_mode;
+class bulk_load_source_t;
 /**
  * Data access API for B+Tree.
  * \ingroup SSMBTREE
@@ -50,6 +54,15 @@ public:
         PageID               root
         );
 
+    /**
+    * Fill the empty btree bottom-up with the entries of source.
+    * @see ss_m::bulk_load_index()
+    */
+    static rc_t                        bulk_load(
+        StoreID store,
+        bulk_load_source_t&               source,
+        double                            fill_factor);
+
     /**
     * Insert <key, el> into the btree.
     */
@@ -58,6 +71,17 @@ public:
         const w_keystr_t&                 key,
         const cvec_t&                     elem);
 
+    /**
+    * Insert the <key, el> pairs of a batch, sorted by key, reusing the
+    * leaf of the previous key when it contains the next one.
+    * results gets w_error_ok, eDUPLICATE or eRECWONTFIT for each key.
+    */
+    static rc_t                        insert_batch(
+        StoreID store,
+        const std::vector<w_keystr_t>&    keys,
+        const std::vector<std::string>&   elems,
+        std::vector<w_error_codes>&       results);
+
     /**
     * Update el of key with the new data.
     */
@@ -115,6 +139,16 @@ public:
         smsize_t&                      elen,
         bool&                          found);
 
+    /**
+    * Find each key of a batch, sorted by key, reusing the leaf of the
+    * previous key when it contains the next one.
+    */
+    static rc_t                        lookup_batch(
+        StoreID store,
+        const std::vector<w_keystr_t>& keys,
+        std::vector<std::string>&      elems,
+        std::vector<bool>&             found);
+
     static rc_t                 get_du_statistics(
         const PageID &root_pid,
         btree_stats_t&                btree_stats,
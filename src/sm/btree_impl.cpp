@@ -30,7 +30,8 @@ btree_impl::_ux_insert(
 {
     INC_TSTAT(bt_insert_cnt);
     while (true) {
-        rc_t rc = _ux_insert_core (store, key, el);
+        btree_page_h leaf;
+        rc_t rc = _ux_insert_core (store, key, el, leaf);
         if (rc.is_error() && rc.err_num() == eLOCKRETRY) {
             continue;
         }
@@ -39,15 +40,58 @@ btree_impl::_ux_insert(
     return RCOK;
 }
 rc_t
+btree_impl::_ux_insert_batch(
+    StoreID store,
+    const std::vector<w_keystr_t>&     keys,
+    const std::vector<std::string>&    elems,
+    std::vector<w_error_codes>&        results)
+{
+    w_assert1(keys.size() == elems.size());
+    std::vector<size_t> order;
+    _sort_batch(keys, order);
+    results.assign(keys.size(), w_error_ok);
+
+    btree_page_h leaf; // kept latched across the keys it contains
+    for (size_t i = 0; i < order.size(); ++i) {
+        const size_t k = order[i];
+        cvec_t el(elems[k].data(), elems[k].size());
+        if (keys[k].get_length_as_nonkeystr() + el.size() > btree_page_h::max_entry_size) {
+            results[k] = eRECWONTFIT;
+            continue;
+        }
+        INC_TSTAT(bt_insert_cnt);
+        while (true) {
+            rc_t rc = _ux_insert_core (store, keys[k], el, leaf);
+            if (rc.is_error() && rc.err_num() == eLOCKRETRY) {
+                leaf.unfix(); // the page changed while waiting for the lock
+                continue;
+            }
+            if (rc.is_error() && rc.err_num() == eDUPLICATE) {
+                results[k] = eDUPLICATE;
+                break;
+            }
+            W_DO(rc);
+            break;
+        }
+    }
+    return RCOK;
+}
+rc_t
 btree_impl::_ux_insert_core(
     StoreID store,
     const w_keystr_t&    key,
-    const cvec_t&        el)
+    const cvec_t&        el,
+    btree_page_h&        leaf)
 {
 
-    // find the leaf (potentially) containing the key
-    btree_page_h       leaf;
-    W_DO( _ux_traverse(store, key, t_fence_contain, LATCH_EX, leaf));
+    // find the leaf (potentially) containing the key, unless the leaf of
+    // the previous key of a batch contains it
+    if (_can_reuse_leaf(store, key, LATCH_EX, leaf)) {
+        INC_TSTAT(bt_batch_leaf_reuse_cnt);
+    } else {
+        leaf.unfix();
+        W_DO( _ux_traverse(store, key, t_fence_contain, LATCH_EX, leaf));
+    }
     w_assert1( leaf.is_fixed());
     w_assert1( leaf.is_leaf());
     w_assert1( leaf.latch_mode() == LATCH_EX);
@@ -291,6 +335,53 @@ rc_t btree_impl::_ux_reserve_ghost_core(btree_page_h &leaf, const w_keystr_t &ke
     return RCOK;
 }
 
+/**
+ * Delta encoding of before/after images: shrinks the overwritten range
+ * [offset, offset + elen) to the bytes that actually change, so that the
+ * unchanged prefix and suffix of the element are not logged twice.
+ */
+static void _trim_unchanged_range(const char* old_el, const char*& new_el,
+        smsize_t& offset, smsize_t& elen)
+{
+    smsize_t prefix = 0;
+    while (prefix < elen && old_el[offset + prefix] == new_el[prefix]) {
+        prefix++;
+    }
+    smsize_t suffix = 0;
+    while (suffix < elen - prefix
+            && old_el[offset + elen - 1 - suffix] == new_el[elen - 1 - suffix])
+    {
+        suffix++;
+    }
+
+    INC_TSTAT(log_delta_images);
+    ADD_TSTAT(log_delta_bytes_saved, 2 * (prefix + suffix));
+    new_el += prefix;
+    offset += prefix;
+    elen -= prefix + suffix;
+}
+
+/**
+ * Logs the update of an element. If delta images are enabled and the length
+ * does not change, the update is logged as an overwrite of the changed range
+ * only; redo and undo of btree_overwrite_log are equivalent in that case.
+ */
+static rc_t _log_update(const btree_page_h& leaf, const w_keystr_t& key,
+        const char* old_el, smsize_t old_elen, const cvec_t& el)
+{
+    if (smlevel_0::log_delta_images && old_elen == el.size()) {
+        char new_el[SM_PAGESIZE];
+        w_assert1(old_elen <= sizeof(new_el));
+        el.copy_to(new_el, old_elen);
+
+        const char* changed = new_el;
+        smsize_t offset = 0, elen = old_elen;
+        _trim_unchanged_range(old_el, changed, offset, elen);
+        return log_btree_overwrite(leaf, key, old_el, changed, offset, elen);
+    }
+    return log_btree_update(leaf, key, old_el, old_elen, el);
+}
+
 rc_t
 btree_impl::_ux_update(StoreID store, const w_keystr_t &key, const cvec_t &el)
 {
@@ -356,7 +447,7 @@ btree_impl::_ux_update_core(StoreID store, const w_keystr_t &key, const cvec_t &
         }
     }
 
-    W_DO(log_btree_update (leaf, key, old_element, old_element_len, el));
+    W_DO(_log_update (leaf, key, old_element, old_element_len, el));
 
     W_DO(leaf.replace_el_nolog(slot, el));
     return RCOK;
@@ -394,7 +485,7 @@ btree_impl::_ux_update_core_tail(StoreID store,
         }
     }
 
-    W_DO(log_btree_update (leaf, key, old_element, old_element_len, el));
+    W_DO(_log_update (leaf, key, old_element, old_element_len, el));
 
     W_DO(leaf.replace_el_nolog(slot, el));
     return RCOK;
@@ -456,6 +547,9 @@ rc_t btree_impl::_ux_overwrite_core(
         return RC(eRECWONTFIT);
     }
 
+    if (smlevel_0::log_delta_images) {
+        _trim_unchanged_range(old_element, el, offset, elen);
+    }
     W_DO(log_btree_overwrite (leaf, key, old_element, el, offset, elen));
     leaf.overwrite_el_nolog(slot, offset, el, elen);
     return RCOK;
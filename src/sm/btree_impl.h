@@ -105,11 +105,34 @@ public:
         StoreID store,
         const w_keystr_t&                 key,
         const cvec_t&                     elem);
-    /** _ux_insert()'s internal function without retry by itself.*/
+    /**
+    *  \brief Inserts a batch of tuples in key order.
+    * \details
+    *  Context: User transaction.
+    *  Same as calling _ux_insert() for each tuple, but the keys are processed
+    *  in sorted order and the EX-latched leaf of the previous key is kept
+    *  while the following keys fall into its fences, skipping their traversal.
+    *  Locks are still acquired for each key.
+    * @param[in] store Store ID
+    * @param[in] keys keys of the inserted tuples
+    * @param[in] elems data of the inserted tuples, same size as keys
+    * @param[out] results per-key result: w_error_ok, eDUPLICATE or eRECWONTFIT
+    */
+    static rc_t                        _ux_insert_batch(
+        StoreID store,
+        const std::vector<w_keystr_t>&    keys,
+        const std::vector<std::string>&   elems,
+        std::vector<w_error_codes>&       results);
+    /**
+    * _ux_insert()'s internal function without retry by itself.
+    * Traverses to the leaf of key unless the given leaf is already EX-latched
+    * and contains key; the leaf is left latched for the next key of a batch.
+    */
     static rc_t                        _ux_insert_core(
         StoreID store,
         const w_keystr_t&                 key,
-        const cvec_t&                     elem);
+        const cvec_t&                     elem,
+        btree_page_h&                     leaf);
     /** Last half of _ux_insert, after traversing, finding (or not) and ghost determination.*/
     static rc_t _ux_insert_core_tail
     (StoreID store,
@@ -261,6 +284,18 @@ public:
         t_follow_pid0 = -1
         // 0 to nrecs-1 is child
     };
+    /** Outcome of _ux_traverse_optimistic(). */
+    enum optimistic_result_t {
+        /** The leaf was found and latched. */
+        t_optimistic_found,
+        /** A page changed while being read; worth trying again. */
+        t_optimistic_conflict,
+        /**
+         * The traversal needs something only latch coupling does, e.g.,
+         * reading a page from disk or adopting a foster child.
+         */
+        t_optimistic_fallback
+    };
 
     /**
     * \brief Traverse the btree starting at root node to find an appropriate leaf page.
@@ -321,6 +356,30 @@ public:
         PageID&                   leaf_pid_causing_failed_upgrade
         );
 
+    /**
+    * \brief Finds the leaf without latching the pages above it.
+    * \details
+    * Inner pages are read optimistically (see bf_tree_m::read_optimistic()):
+    * each page is searched without a latch, and the child pointer is only
+    * followed after validating that the page was not EX-latched meanwhile.
+    * Only the leaf is latched, and only if it is unchanged since it was
+    * searched, so readers do not write to the latches of the upper levels.
+    * Used by _ux_traverse() before falling back to latch coupling.
+    *  Context: Both user and system transaction.
+    * @param[in] store Store ID
+    * @param[in] key  target key
+    * @param[in] traverse_mode search mode
+    * @param[in] leaf_latch_mode EX for insert/remove, SH for lookup
+    * @param[out] leaf leaf satisfying search, fixed only if t_optimistic_found
+    */
+    static optimistic_result_t  _ux_traverse_optimistic(
+        StoreID                    store,
+        const w_keystr_t&          key,
+        traverse_mode_t            traverse_mode,
+        latch_mode_t               leaf_latch_mode,
+        btree_page_h&              leaf
+        );
+
     /**
      * \brief Internal helper function to actually search for the correct slot and test fence
      * assumptions.
@@ -337,6 +396,21 @@ public:
                                     const w_keystr_t& key,
                                     bool &this_is_the_leaf_page, slot_follow_t &slot_to_follow);
 
+    /**
+     * \brief Same as _ux_traverse_search() on a page that is neither latched
+     * nor pinned and may be concurrently modified.
+     * \details
+     * Uses only robust accessors of btree_page_h, so a torn page never
+     * triggers assertions or out-of-page reads. Returns false if the page
+     * is inconsistent, which can only happen if it changed while read.
+     * Called only from _ux_traverse_optimistic.
+     */
+    static bool _ux_traverse_search_robust(btree_impl::traverse_mode_t traverse_mode,
+                                           const btree_page_h& current,
+                                           const w_keystr_t& key,
+                                           bool &this_is_the_leaf_page,
+                                           slot_follow_t &slot_to_follow);
+
     /**
      * Call this function when it seems like the next page will have VERY high contention
      * and the page should adopt childrens.
@@ -375,13 +449,48 @@ public:
         void*                      el,
         smsize_t&                  elen
         );
-    /** _ux_lookup()'s internal function which doesn't rety for locks by itself. */
+    /**
+    * _ux_lookup()'s internal function which doesn't rety for locks by itself.
+    * Traverses to the leaf of key unless the given leaf is already latched
+    * and contains key; the leaf is left latched for the next key of a batch.
+    */
     static rc_t                 _ux_lookup_core(
         StoreID store,
         const w_keystr_t&          key,
         bool&                      found,
         void*                      el,
-        smsize_t&                  elen
+        smsize_t&                  elen,
+        btree_page_h&              leaf
+        );
+
+    /**
+    *  Looks up a batch of keys in key order, keeping the latched leaf of the
+    *  previous key while the following keys fall into its fences.
+    *  Context: user transaction.
+    * @param[in] store Store ID
+    * @param[in] keys keys we want to find
+    * @param[out] elems element of each key found
+    * @param[out] found whether each key is found
+    */
+    static rc_t                 _ux_lookup_batch(
+        StoreID store,
+        const std::vector<w_keystr_t>& keys,
+        std::vector<std::string>&      elems,
+        std::vector<bool>&             found
+        );
+
+    /** Whether leaf is a latched (in latch_mode or EX) leaf of store containing key. */
+    static bool                 _can_reuse_leaf(
+        StoreID store,
+        const w_keystr_t&          key,
+        latch_mode_t               latch_mode,
+        const btree_page_h&        leaf
+        );
+
+    /** Positions of keys in stable key order, the processing order of a batch. */
+    static void                 _sort_batch(
+        const std::vector<w_keystr_t>& keys,
+        std::vector<size_t>&           order
         );
 
 #ifdef DOXYGEN_HIDE
@@ -742,6 +851,26 @@ public:
     */
     static rc_t                        _sx_grow_tree(btree_page_h& root);
 
+#ifdef DOXYGEN_HIDE
+///==========================================
+///   BEGIN: Bulk loading. implemented in btree_impl_bulk.cpp
+///==========================================
+#endif // DOXYGEN_HIDE
+
+    /**
+     * \brief Builds the tree of an empty index bottom-up from sorted entries.
+     *  \details
+     * Context: user transaction, which need not hold key locks.
+     * Holds the root page EX-latched while loading and formats every other
+     * page in its own system transaction.
+     * @see ss_m::bulk_load_index()
+     */
+    static rc_t                        _ux_bulk_load(
+        StoreID store, bulk_load_source_t& source, double fill_factor);
+
+    /// Builds the pages of one bulk load, see btree_impl_bulk.cpp.
+    class bulk_loader_t;
+
 #ifdef DOXYGEN_HIDE
 ///==========================================
 ///   BEGIN: BTree Verification. implemented in btree_impl_verify.cpp
@@ -0,0 +1,295 @@
+/*
+ * (c) Copyright 2011-2014, Hewlett-Packard Development Company, LP
+ */
+
+#include "w_defines.h"
+
+/**
+ * Implementation of bulk loading in btree_impl.h.
+ * Separated from btree_impl.cpp.
+ */
+
+#define SM_SOURCE
+#define BTREE_C
+
+#include "sm_base.h"
+#include "btree_page_h.h"
+#include "btree_impl.h"
+#include "vec_t.h"
+#include "w_key.h"
+#include "sm.h"
+#include "xct.h"
+#include "bf_tree.h"
+#include "vol.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * \brief Builds the pages of one bulk load bottom-up, one level at a time.
+ * \details
+ * Each level collects entries for the page it is currently filling: records
+ * on the leaf level, (separator key, child) pairs above it.  Once the next
+ * entry would exceed the fill target, the collected entries are written as a
+ * new page whose high fence is the key of that entry, and the page itself is
+ * added as an entry to the level above.  Thus at most one page worth of
+ * children per level waits for its parent, and pages can be evicted as soon
+ * as their parent exists.  When the input ends, the remaining entries of each
+ * level are written out the same way until they fit into the root page, which
+ * is formatted last with the top level of the tree.
+ *
+ * Every page is logged as a single page_img_format record in its own
+ * single-log system transaction.
+ */
+class btree_impl::bulk_loader_t {
+public:
+    bulk_loader_t(btree_page_h& root, size_t target)
+        : _root(root), _target(target) {}
+
+    /// Adds the next leaf record; keys must be strictly increasing
+    rc_t add_record(const w_keystr_t& key, const cvec_t& el) {
+        entry_t e;
+        e.key = key;
+        el.copy_to(e.el);
+        return _add(1, e);
+    }
+
+    /// Writes out the remaining entries and formats the root page
+    rc_t finish();
+
+private:
+    struct entry_t {
+        w_keystr_t key;
+        /// record data on the leaf level
+        std::basic_string<unsigned char> el;
+        /// child page and its EMLSN above the leaf level
+        PageID child;
+        lsn_t emlsn;
+        entry_t() : child(0), emlsn(lsn_t::null) {}
+    };
+
+    struct level_t {
+        /// low fence of the page being filled
+        w_keystr_t low;
+        /// entries of the page being filled; above the leaf level, the first
+        /// one is its pid0 and its key is the low fence
+        std::vector<entry_t> entries;
+        /// estimated item space of entries and of the low fence
+        size_t used;
+        /// pages written on this level so far
+        size_t pages;
+        level_t() : used(0), pages(0) {
+            low.construct_neginfkey();
+            used = _fence_space(low);
+        }
+    };
+
+    static size_t _fence_space(const w_keystr_t& fence) {
+        return fence.get_length_as_keystr() + btree_page::max_item_overhead;
+    }
+
+    /// upper bound of the space an entry takes in a page at the given level
+    static size_t _entry_space(int level, const entry_t& e) {
+        size_t data = e.key.get_length_as_keystr()
+            + (level == 1 ? sizeof(btree_page_h::key_length_t) + e.el.size()
+                          : sizeof(lsn_t));
+        return data + btree_page::max_item_overhead;
+    }
+
+    level_t& _level(int level) {
+        while ((int) _levels.size() < level) {
+            _levels.push_back(level_t());
+        }
+        return _levels[level - 1];
+    }
+
+    rc_t _add(int level, const entry_t& e);
+    rc_t _flush(int level, const w_keystr_t& high);
+    rc_t _format(btree_page_h& page, PageID pid, int level,
+                 const std::vector<entry_t>& entries, size_t count,
+                 const w_keystr_t& low, const w_keystr_t& high);
+
+    btree_page_h&       _root;
+    /// bytes to fill in each page
+    size_t              _target;
+    /// _levels[0] is the leaf level
+    std::vector<level_t> _levels;
+};
+
+rc_t btree_impl::bulk_loader_t::_add(int level, const entry_t& e) {
+    level_t& lv = _level(level);
+    size_t space = _entry_space(level, e);
+    if (!lv.entries.empty()) {
+        const w_keystr_t& last = lv.entries.back().key;
+        if (e.key.compare(last) <= 0) {
+            return RC(e.key.compare(last) == 0 ? eDUPLICATE : eBADARGUMENT);
+        }
+        if (lv.used + space + _fence_space(e.key) > _target) {
+            W_DO(_flush(level, e.key));
+        }
+    }
+    level_t& cur = _level(level); // _flush may have grown _levels
+    cur.entries.push_back(e);
+    cur.used += space;
+    return RCOK;
+}
+
+rc_t btree_impl::bulk_loader_t::_flush(int level, const w_keystr_t& high) {
+    level_t& lv = _level(level);
+    w_assert1(!lv.entries.empty());
+
+    // The page must hold both fences; if the entries do not fit with the
+    // given high fence, leave the last ones to the next page.
+    size_t count = lv.entries.size();
+    size_t used = lv.used;
+    w_keystr_t page_high = high;
+    while (count > 0
+            && used + _fence_space(page_high) > (size_t) btree_page::data_sz) {
+        --count;
+        used -= _entry_space(level, lv.entries[count]);
+        page_high = lv.entries[count].key;
+    }
+    if (count == 0) {
+        return RC(eRECWONTFIT);
+    }
+
+    PageID pid;
+    W_DO(smlevel_0::vol->alloc_a_page(pid, false, _root.store()));
+
+    entry_t parent_entry;
+    {
+        sys_xct_section_t sxs(true);
+        W_DO(sxs.check_error_on_start());
+
+        btree_page_h page;
+        rc_t rc = page.fix_nonroot(_root, pid, LATCH_EX, false, true);
+        if (rc.is_error()) {
+            W_DO(smlevel_0::vol->deallocate_page(pid));
+            return rc;
+        }
+        rc = _format(page, pid, level, lv.entries, count, lv.low, page_high);
+        W_DO(sxs.end_sys_xct(rc));
+        W_DO(rc);
+
+        parent_entry.key   = lv.low;
+        parent_entry.child = pid;
+        parent_entry.emlsn = page.get_page_lsn();
+        INC_TSTAT(bt_bulk_load_pages);
+    }
+
+    // the rest starts the next page on this level
+    lv.entries.erase(lv.entries.begin(), lv.entries.begin() + count);
+    lv.low  = page_high;
+    lv.used = _fence_space(lv.low);
+    for (size_t i = 0; i < lv.entries.size(); ++i) {
+        lv.used += _entry_space(level, lv.entries[i]);
+    }
+    lv.pages++;
+
+    // lv is invalidated if this adds a level
+    return _add(level + 1, parent_entry);
+}
+
+rc_t btree_impl::bulk_loader_t::_format(btree_page_h& page, PageID pid,
+        int level, const std::vector<entry_t>& entries, size_t count,
+        const w_keystr_t& low, const w_keystr_t& high)
+{
+    w_assert1(page.latch_mode() == LATCH_EX);
+    w_assert1(count > 0 && count <= entries.size());
+
+    w_keystr_t no_chain_high;
+    PageID pid0 = 0;
+    lsn_t pid0_emlsn = lsn_t::null;
+    size_t first = 0;
+    if (level > 1) {
+        pid0       = entries[0].child;
+        pid0_emlsn = entries[0].emlsn;
+        first      = 1;
+    }
+    // a virgin page has no pid in its header yet
+    W_DO(page.format_steal(page.get_page_lsn(), pid, _root.store(),
+                           _root.pid(), level, pid0, pid0_emlsn,
+                           0, lsn_t::null, // no foster
+                           low, high, no_chain_high,
+                           false)); // logged below with the records
+
+    for (size_t i = first; i < count; ++i) {
+        const entry_t& e = entries[i];
+        if (level == 1) {
+            cvec_t el(e.el.data(), e.el.size());
+            w_assert1(page.check_space_for_insert_leaf(e.key, el));
+            page.insert_nonghost(e.key, el);
+        } else {
+            w_assert1(page.check_space_for_insert_node(e.key));
+            W_DO(page.insert_node(e.key, page.nrecs(), e.child, e.emlsn));
+        }
+    }
+    W_DO(log_page_img_format(page));
+
+    // the children were fixed with the root as their parent
+    if (level > 1) {
+        int max_slot = page.max_child_slot();
+        for (general_recordid_t i = GeneralRecordIds::PID0; i <= max_slot; ++i) {
+            smlevel_0::bf->switch_parent(*page.child_slot_address(i),
+                    page.get_generic_page());
+        }
+    }
+    w_assert3(page.is_consistent(true, true));
+    return RCOK;
+}
+
+rc_t btree_impl::bulk_loader_t::finish() {
+    if (_levels.empty()) {
+        return RCOK; // no input: the root stays an empty leaf
+    }
+    w_keystr_t supremum;
+    supremum.construct_posinfkey();
+
+    // Levels with pages written already cannot go into the root; neither can
+    // entries that do not fit into one page.
+    for (int level = 1; level <= (int) _levels.size(); ++level) {
+        level_t& lv = _level(level);
+        bool top = (level == (int) _levels.size() && lv.pages == 0);
+        if (top && lv.used + _fence_space(supremum) <= (size_t) btree_page::data_sz) {
+            sys_xct_section_t sxs(true);
+            W_DO(sxs.check_error_on_start());
+            rc_t rc = _format(_root, _root.pid(), level, lv.entries,
+                              lv.entries.size(), lv.low, supremum);
+            W_DO(sxs.end_sys_xct(rc));
+            return rc;
+        }
+        while (!_level(level).entries.empty()) {
+            W_DO(_flush(level, supremum));
+        }
+    }
+    w_assert0(false); // the loop ends by formatting the root
+    return RCOK;
+}
+
+rc_t btree_impl::_ux_bulk_load(StoreID store, bulk_load_source_t& source,
+                               double fill_factor)
+{
+    if (fill_factor <= 0 || fill_factor > 1) {
+        return RC(eBADARGUMENT);
+    }
+
+    btree_page_h rp;
+    W_DO(rp.fix_root(store, LATCH_EX));
+    if (!rp.is_leaf() || rp.nrecs() > 0 || rp.get_foster() != 0) {
+        return RC(eNDXNOTEMPTY);
+    }
+
+    bulk_loader_t loader(rp, (size_t) (fill_factor * btree_page::data_sz));
+    w_keystr_t key;
+    cvec_t el;
+    while (source.next(key, el)) {
+        if (key.get_length_as_nonkeystr() + el.size() > btree_page_h::max_entry_size) {
+            return RC(eRECWONTFIT);
+        }
+        W_DO(loader.add_record(key, el));
+        el.reset();
+    }
+    W_DO(loader.finish());
+    w_assert3(rp.is_consistent(true, true));
+    return RCOK;
+}
@@ -21,12 +21,15 @@
 #include "w_key.h"
 #include "xct.h"
 
+#include <algorithm>
+
 rc_t
 btree_impl::_ux_lookup(StoreID store, const w_keystr_t& key, bool& found,
                        void* el, smsize_t& elen) {
     INC_TSTAT(bt_find_cnt);
     while (true) {
-        rc_t rc = _ux_lookup_core (store, key, found, el, elen);
+        btree_page_h leaf;
+        rc_t rc = _ux_lookup_core (store, key, found, el, elen, leaf);
         if (rc.is_error() && rc.err_num() == eLOCKRETRY) {
             continue;
         }
@@ -34,16 +37,77 @@ btree_impl::_ux_lookup(StoreID store, const w_keystr_t& key, bool& found,
     }
 }
 
+rc_t
+btree_impl::_ux_lookup_batch(StoreID store, const std::vector<w_keystr_t>& keys,
+                             std::vector<std::string>& elems,
+                             std::vector<bool>& found)
+{
+    std::vector<size_t> order;
+    _sort_batch(keys, order);
+    elems.assign(keys.size(), std::string());
+    found.assign(keys.size(), false);
+
+    char buf[SM_PAGESIZE];
+    btree_page_h leaf; // kept latched across the keys it contains
+    for (size_t i = 0; i < order.size(); ++i) {
+        const size_t k = order[i];
+        INC_TSTAT(bt_find_cnt);
+        while (true) {
+            bool key_found;
+            smsize_t elen = sizeof(buf);
+            rc_t rc = _ux_lookup_core (store, keys[k], key_found, buf, elen, leaf);
+            if (rc.is_error() && rc.err_num() == eLOCKRETRY) {
+                leaf.unfix(); // the page changed while waiting for the lock
+                continue;
+            }
+            W_DO(rc);
+            found[k] = key_found;
+            if (key_found) {
+                elems[k].assign(buf, elen);
+            }
+            break;
+        }
+    }
+    return RCOK;
+}
+
+bool
+btree_impl::_can_reuse_leaf(StoreID store, const w_keystr_t& key,
+                            latch_mode_t latch_mode, const btree_page_h& leaf)
+{
+    return leaf.is_fixed() && leaf.store() == store && leaf.is_leaf()
+        && (leaf.latch_mode() == latch_mode || leaf.latch_mode() == LATCH_EX)
+        && leaf.fence_contains(key);
+}
+
+void
+btree_impl::_sort_batch(const std::vector<w_keystr_t>& keys,
+                        std::vector<size_t>& order)
+{
+    order.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        order[i] = i;
+    }
+    // stable, so that equal keys are processed in input order
+    std::stable_sort(order.begin(), order.end(),
+        [&keys](size_t a, size_t b) { return keys[a].compare(keys[b]) < 0; });
+}
+
 rc_t
 btree_impl::_ux_lookup_core(StoreID store, const w_keystr_t& key,
-                            bool& found, void* el, smsize_t& elen) {
+                            bool& found, void* el, smsize_t& elen,
+                            btree_page_h& leaf) {
     bool need_lock     = g_xct_does_need_lock();
     bool ex_for_select = g_xct_does_ex_lock_for_select();
 
-    btree_page_h leaf; // first-leaf
-
-    // find the leaf (potentially) containing the key
-    W_DO(_ux_traverse(store, key, t_fence_contain, LATCH_SH, leaf));
+    // find the leaf (potentially) containing the key, unless the leaf of
+    // the previous key of a batch contains it
+    if (_can_reuse_leaf(store, key, LATCH_SH, leaf)) {
+        INC_TSTAT(bt_batch_leaf_reuse_cnt);
+    } else {
+        leaf.unfix();
+        W_DO(_ux_traverse(store, key, t_fence_contain, LATCH_SH, leaf));
+    }
 
     w_assert1(leaf.is_fixed());
     w_assert1(leaf.is_leaf());
@@ -99,6 +163,23 @@ btree_impl::_ux_traverse(StoreID store, const w_keystr_t &key,
         w_assert1(traverse_mode != t_fence_low_match); // surely misuse
     }
 
+    if (smlevel_0::optimistic_traverse
+            && (xct() == NULL || !xct()->is_inquery_verify()))
+    {
+        for (int times = 0; times < 3; ++times) { // arbitrary number
+            optimistic_result_t res = _ux_traverse_optimistic(store, key,
+                    traverse_mode, leaf_latch_mode, leaf);
+            if (res == t_optimistic_found) {
+                INC_TSTAT(bt_optimistic_traverse_cnt);
+                return RCOK;
+            }
+            if (res == t_optimistic_fallback) {
+                break;
+            }
+            INC_TSTAT(bt_optimistic_conflict_cnt);
+        }
+    }
+
     PageID leaf_pid_causing_failed_upgrade = 0;
     for (int times = 0; times < 20; ++times) { // arbitrary number
         inquery_verify_init(store); // initialize in-query verification
@@ -261,6 +342,164 @@ btree_impl::_ux_traverse_recurse(btree_page_h&                start,
     return RCOK;
 }
 
+btree_impl::optimistic_result_t
+btree_impl::_ux_traverse_optimistic(StoreID                      store,
+                                    const w_keystr_t&            key,
+                                    btree_impl::traverse_mode_t  traverse_mode,
+                                    latch_mode_t                 leaf_latch_mode,
+                                    btree_page_h&                leaf)
+{
+    leaf.unfix();
+
+    uint32_t version;
+    generic_page* page = smlevel_0::bf->read_optimistic_root(store, version);
+    if (page == NULL) {
+        return (version & 1) ? t_optimistic_conflict : t_optimistic_fallback;
+    }
+
+    // Pages are searched through a pseudo-fix, without latch or pin, and
+    // may be torn by a concurrent writer, so only robust accessors are used
+    // on them. Any decision taken on what was read only counts after
+    // validating the version of the page, which happens before following a
+    // child pointer (inner pages) or when latching the page (leaf).
+    btree_page_h current;
+    bool is_root = true;
+    bool followed_foster = false;
+    while (true) {
+        current.fix_nonbufferpool_page(page);
+
+        bool          this_is_the_leaf_page = false;
+        slot_follow_t slot_to_follow        = t_follow_invalid;
+        bool consistent = _ux_traverse_search_robust(traverse_mode, current,
+                key, this_is_the_leaf_page, slot_to_follow);
+
+        // Growing the tree and adopting foster children need latches
+        bool needs_smo = current.get_foster_opaqueptr() != 0
+            && (is_root || !followed_foster);
+        if (!consistent || needs_smo) {
+            current.unfix();
+            if (!smlevel_0::bf->validate_optimistic(page, version)) {
+                return t_optimistic_conflict;
+            }
+            return t_optimistic_fallback;
+        }
+
+        if (this_is_the_leaf_page) {
+            current.unfix();
+            if (!leaf.fix_if_unchanged(page, version, leaf_latch_mode)) {
+                return t_optimistic_conflict;
+            }
+            w_assert1(leaf.is_leaf());
+            return t_optimistic_found;
+        }
+
+        PageID pid_to_follow_opaqueptr;
+        if (slot_to_follow == t_follow_foster) {
+            pid_to_follow_opaqueptr = current.get_foster_opaqueptr();
+        } else if (slot_to_follow == t_follow_pid0) {
+            pid_to_follow_opaqueptr = current.pid0_opaqueptr();
+        } else {
+            pid_to_follow_opaqueptr = current.robust_child_opaqueptr(slot_to_follow);
+        }
+        followed_foster = (slot_to_follow == t_follow_foster);
+        is_root = false;
+
+        // the pointer may be garbage unless the page is unchanged
+        if (!smlevel_0::bf->validate_optimistic(page, version)) {
+            return t_optimistic_conflict;
+        }
+        if (pid_to_follow_opaqueptr == 0) {
+            return t_optimistic_fallback;
+        }
+
+        uint32_t next_version;
+        generic_page* next = smlevel_0::bf->read_optimistic(
+                pid_to_follow_opaqueptr, next_version);
+        if (next == NULL) {
+            return (next_version & 1) ? t_optimistic_conflict
+                : t_optimistic_fallback;
+        }
+        // The child cannot be evicted or replaced without EX-latching
+        // the parent, so this also validates that next holds the child
+        if (!smlevel_0::bf->validate_optimistic(page, version)) {
+            return t_optimistic_conflict;
+        }
+
+        page = next;
+        version = next_version;
+    }
+}
+
+bool btree_impl::_ux_traverse_search_robust(btree_impl::traverse_mode_t traverse_mode,
+                                            const btree_page_h& current,
+                                            const w_keystr_t& key,
+                                            bool &this_is_the_leaf_page,
+                                            slot_follow_t &slot_to_follow)
+{
+    // Same decisions as _ux_traverse_search(), but where the latter asserts,
+    // this one reports an inconsistent (torn) page instead
+    int cmp_low, cmp_high;
+    if (!current.robust_compare_with_fences(key, cmp_low, cmp_high)) {
+        return false;
+    }
+    const char* key_raw = (const char*) key.buffer_as_keystr();
+    size_t key_len = key.get_length_as_keystr();
+    bool found;
+    slotid_t slot;
+
+    if (traverse_mode == t_fence_contain) {
+        if (cmp_high >= 0) {
+            slot_to_follow = t_follow_foster;
+        } else if (cmp_low < 0) {
+            return false;
+        } else if (current.is_leaf()) {
+            this_is_the_leaf_page = true;
+        } else {
+            // same as search_node()
+            current.robust_search(key_raw, key_len, found, slot);
+            if (!found) { slot--; }
+            slot_to_follow = (slot < 0) ? t_follow_pid0 : (slot_follow_t) slot;
+        }
+    } else if (traverse_mode == t_fence_low_match) {
+        if (cmp_low == 0) {
+            if (current.is_leaf()) {
+                this_is_the_leaf_page = true;
+            } else {
+                slot_to_follow = t_follow_pid0;
+            }
+        } else if (cmp_low < 0) {
+            return false;
+        } else if (cmp_high >= 0) {
+            slot_to_follow = t_follow_foster;
+        } else if (current.is_leaf()) {
+            return false;
+        } else {
+            current.robust_search(key_raw, key_len, found, slot);
+            if (!found) { slot--; }
+            slot_to_follow = (slot < 0) ? t_follow_pid0 : (slot_follow_t) slot;
+        }
+    } else {
+        w_assert1(traverse_mode == t_fence_high_match);
+        if (cmp_high == 0) {
+            if (current.is_leaf()) {
+                this_is_the_leaf_page = true;
+            } else {
+                slot = current.robust_nrecs() - 1;
+                slot_to_follow = (slot < 0) ? t_follow_pid0 : (slot_follow_t) slot;
+            }
+        } else if (cmp_high > 0) {
+            slot_to_follow = t_follow_foster;
+        } else if (current.is_leaf()) {
+            return false;
+        } else {
+            current.robust_search(key_raw, key_len, found, slot);
+            slot--;
+            slot_to_follow = (slot < 0) ? t_follow_pid0 : (slot_follow_t) slot;
+        }
+    }
+    return true;
+}
+
 void btree_impl::_ux_traverse_search(btree_impl::traverse_mode_t traverse_mode,
                                      btree_page_h *current,
                                      const w_keystr_t& key,
@@ -5,10 +5,15 @@
 #include "btree_page.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <memory>
 #include "w_debug.h"
 #include "w_key.h"
 
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 
 void btree_page_data::init_items() {
     w_assert1(btree_level >= 1);
@@ -108,6 +113,75 @@ void btree_page_data::unset_ghost(int item) {
 
 
 
+/**
+ * Width of the window, in items, below which poor_range() stops the binary
+ * search and scans the poor_man_keys instead.  32 item heads are two cache
+ * lines, i.e., at most four AVX2 or eight SSE2 compares.
+ */
+static const int poor_scan_items = 32;
+
+void btree_page_data::poor_range(int first, int end, poor_man_key poor,
+                                 int& lower, int& upper) const {
+    w_assert1(first >= 0 && first <= end && end <= nitems);
+    lower = _poor_lower_bound(first, end, poor);
+    // runs of equal poor_man_keys are usually short: look right after lower
+    // before searching the rest of the page
+    int scan_end = std::min(end, lower + poor_scan_items);
+    upper = _poor_lower_bound(lower, scan_end, (int32_t) poor + 1);
+    if (upper == scan_end && scan_end < end) {
+        upper = _poor_lower_bound(scan_end, end, (int32_t) poor + 1);
+    }
+    w_assert1(first <= lower && lower <= upper && upper <= end);
+}
+
+int btree_page_data::_poor_lower_bound(int from, int to, int32_t bound) const {
+    while (to - from > poor_scan_items) {
+        // written to compile to conditional moves rather than branches
+        int  mid   = (from + to) / 2;
+        bool below = head[mid].poor < bound;
+        from = below ? mid + 1 : from;
+        to   = below ? to : mid;
+    }
+
+    // poor_man_keys are sorted, so the items of [from, to) below bound are
+    // a prefix of it: scan for the first item not below bound.  In each
+    // vector compare, the lanes below bound are then the low bits of the
+    // mask, and the first clear bit is that item.
+    int i = from;
+#if defined(__SSE2__)
+    // each 4-byte item_head is one 32-bit lane with the poor_man_key in its
+    // upper half (x86 is little-endian), so shifting the lane right by 16
+    // yields the poor_man_key, zero-extended
+    BOOST_STATIC_ASSERT(offsetof(item_head, poor) == 2);
+#if defined(__AVX2__)
+    const __m256i bound8 = _mm256_set1_epi32(bound);
+    for (; i + 8 <= to; i += 8) {
+        __m256i heads = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(head + i));
+        __m256i lt    = _mm256_cmpgt_epi32(bound8, _mm256_srli_epi32(heads, 16));
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(lt));
+        if (mask != 0xFF) {
+            return i + __builtin_ctz(~mask);
+        }
+    }
+#endif // __AVX2__
+    const __m128i bound4 = _mm_set1_epi32(bound);
+    for (; i + 4 <= to; i += 4) {
+        __m128i heads = _mm_loadu_si128(reinterpret_cast<const __m128i*>(head + i));
+        __m128i lt    = _mm_cmpgt_epi32(bound4, _mm_srli_epi32(heads, 16));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(lt));
+        if (mask != 0xF) {
+            return i + __builtin_ctz(~mask);
+        }
+    }
+#endif // __SSE2__
+    for (; i < to; ++i) {
+        if (head[i].poor >= bound) {
+            break;
+        }
+    }
+    return i;
+}
+
 bool btree_page_data::insert_item(int item, bool ghost, poor_man_key poor,
                 PageID child, size_t data_length) {
     w_assert1(item>=0 && item<=nitems);  // use of <= intentional
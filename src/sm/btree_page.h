@@ -167,6 +167,17 @@ protected:
     /// return a reference to the poor_man_key data for the given item
     poor_man_key& item_poor(int item);
 
+    /**
+     * Narrows [first, end) to the items whose poor_man_key equals poor:
+     * on return, items in [first, lower) have a smaller poor_man_key and
+     * items in [upper, end) a larger one.  Relies on poor_man_keys being
+     * non-decreasing over the items of [first, end), which holds for the
+     * non-fence items of a B-tree page.  The final narrowing step scans
+     * poor_man_keys with SSE2/AVX2 compares where available.
+     */
+    void          poor_range(int first, int end, poor_man_key poor,
+                             int& lower, int& upper) const;
+
     /**
      * Return a reference to the child pointer data for the given
      * item.  The reference will be 4 byte aligned and thus a suitable
@@ -516,6 +527,12 @@ private:
      */
     body_offset_t _item_bodies(body_offset_t offset) const;
 
+    /**
+     * return the first item in [from, to) whose poor_man_key is not less
+     * than bound (to if there is none)
+     */
+    int           _poor_lower_bound(int from, int to, int32_t bound) const;
+
 public:
     friend std::ostream& operator<<(std::ostream&, btree_page_data&);
 
@@ -1073,6 +1073,18 @@ btree_page_h::search(const char *key_raw, size_t key_raw_len,
         high--;
     }
 
+    if (smlevel_0::simd_search && high > 0) {
+        // only slots with an equal poor_man_key need a full key comparison
+        int lower, upper;
+        page()->poor_range(1, high + 1, poormkey, lower, upper);
+        if (lower == upper) { // no such slot
+            return_slot = lower - 1;
+            return;
+        }
+        low  = lower - 2;
+        high = upper - 1;
+    }
+
 #if 0
     // [optional] check the first record (0) if it exists to speed-up reverse sorted insert:
     if (high > 0) {
@@ -1187,6 +1199,46 @@ btree_page_h::robust_search(const char *key_raw, size_t key_raw_len,
     w_assert1(high>=0 && high<=number_of_records);
 }
 
+bool btree_page_h::robust_compare_with_fences(const w_keystr_t &key,
+                                              int& cmp_low, int& cmp_high) const {
+    size_t fences_len;
+    const char* fences = page()->robust_item_data(0, fences_len);
+    int prefix_len = ACCESS_ONCE(page()->btree_prefix_length);
+    int low_len    = ACCESS_ONCE(page()->btree_fence_low_length);
+    int high_len   = ACCESS_ONCE(page()->btree_fence_high_length);
+    // the prefix is shared by both fences and stored only in fence-low
+    if (prefix_len < 0 || low_len < prefix_len || high_len < prefix_len
+        || (size_t) (low_len + high_len - prefix_len) > fences_len) {
+        return false;
+    }
+
+    const char* key_raw = (const char*) key.buffer_as_keystr();
+    size_t key_len = key.get_length_as_keystr();
+    cmp_low = w_keystr_t::compare_bin_str(key_raw, key_len, fences, low_len);
+
+    // same as compare_with_fence_high()
+    if ((size_t) prefix_len > key_len) {
+        cmp_high = w_keystr_t::compare_bin_str(key_raw, key_len, fences, key_len);
+    } else {
+        cmp_high = w_keystr_t::compare_bin_str(key_raw, prefix_len, fences, prefix_len);
+        if (cmp_high == 0) {
+            cmp_high = w_keystr_t::compare_bin_str(key_raw + prefix_len,
+                    key_len - prefix_len, fences + low_len, high_len - prefix_len);
+        }
+    }
+    return true;
+}
+
+int btree_page_h::robust_nrecs() const {
+    int number_of_items = page()->robust_number_of_items();
+    return number_of_items > 0 ? number_of_items - 1 : 0;
+}
+
+PageID btree_page_h::robust_child_opaqueptr(slotid_t slot) const {
+    w_assert1(slot >= 0);
+    return page()->robust_item_child(slot + 1);
+}
+
 void btree_page_h::search_node(const w_keystr_t& key,
                                slotid_t&         return_slot) const {
     w_assert1(!is_leaf());
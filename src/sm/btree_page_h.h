@@ -574,6 +574,21 @@ public:
     void            robust_search(const char *key_raw, size_t key_raw_len,
                                   bool& found_key, slotid_t& return_slot) const;
 
+    /**
+     * [Robust] Compares the given key with the low and high fence keys of
+     * this page, like compare_with_fence_low() and compare_with_fence_high().
+     * Returns false if the fence keys are garbage, which can only happen
+     * while the page is being concurrently modified.
+     */
+    bool            robust_compare_with_fences(const w_keystr_t &key,
+                                               int& cmp_low, int& cmp_high) const;
+
+    /// [Robust] nrecs(); never negative nor larger than a page can hold.
+    int             robust_nrecs() const;
+
+    /// [Robust] child_opaqueptr(); slot must be less than robust_nrecs().
+    PageID          robust_child_opaqueptr(slotid_t slot) const;
+
 
     /**
      * Search for given key in this interior node, determining which
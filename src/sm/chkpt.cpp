@@ -77,6 +77,9 @@ struct RawLock;            // Lock information gathering
 #include <algorithm>
 
 #include "stopwatch.h"
+#include "bf_tree_cb.h"
+#include "alloc_cache.h"
+#include "stnode_page.h"
 
 #define LOG_INSERT(constructor_call, rlsn)            \
     do {                                              \
@@ -116,10 +119,12 @@ private:
 };
 
 chkpt_m::chkpt_m(const sm_options& options, lsn_t last_chkpt_lsn)
-    : _chkpt_thread(NULL), _chkpt_count(0), _min_rec_lsn(0), _min_xct_lsn(0),
-    _last_end_lsn(last_chkpt_lsn)
+    : _chkpt_thread(NULL), _chkpt_count(0), _delta_count(0),
+    _min_rec_lsn(0), _min_xct_lsn(0), _last_end_lsn(last_chkpt_lsn)
 {
     if (_last_end_lsn.is_null()) { _last_end_lsn = lsn_t(1, 0); }
+    _incremental = options.get_bool_option("sm_chkpt_incremental", false);
+    _full_interval = options.get_int_option("sm_chkpt_full_interval", 16);
     int interval = options.get_int_option("sm_chkpt_interval", -1);
     if (interval >= 0) {
         _chkpt_thread = new chkpt_thread_t(interval);
@@ -357,6 +362,139 @@ void chkpt_t::init()
     bkp_path.clear();
 }
 
+void chkpt_t::collect(lsn_t begin_lsn, const chkpt_t& prev)
+{
+    init();
+
+    // Dirty pages. Control blocks are read without latching: an update or
+    // write that is missed here happens after begin_lsn, so restart finds it
+    // in the log. The clean LSN is a lower bound for the first update since
+    // the page was last written; it is null only for a page formatted in the
+    // buffer pool and never written, which was thus either dirty already at
+    // the previous checkpoint or formatted after it.
+    bf_tree_m* bf = smlevel_0::bf;
+    for (bf_idx idx = 1; idx < bf->get_block_cnt(); ++idx) {
+        bf_tree_cb_t& cb = bf->get_cb(idx);
+        cb.pin();
+        if (!cb._used || !cb.is_dirty()) {
+            cb.unpin();
+            continue;
+        }
+        PageID pid = cb._pid;
+        lsn_t page_lsn = cb.get_page_lsn();
+        lsn_t rec_lsn = cb.get_clean_lsn();
+        cb.unpin();
+
+        if (rec_lsn.is_null()) {
+            buf_tab_t::const_iterator it = prev.buf_tab.find(pid);
+            rec_lsn = it != prev.buf_tab.end() ?
+                it->second.rec_lsn : prev.get_last_scan_start();
+        }
+        mark_page_dirty(pid, page_lsn, rec_lsn);
+    }
+
+    // Alloc and stnode pages are not kept in the buffer pool; their caches
+    // track the page LSN and the LSN of the last write since the system
+    // started. Without such a write, the previous checkpoint tells whether
+    // the page is dirty.
+    map<PageID, lsn_t> meta_page_lsns, meta_clean_lsns;
+    smlevel_0::vol->get_alloc_cache()->get_page_lsns(meta_page_lsns,
+            meta_clean_lsns);
+    stnode_cache_t* stcache = smlevel_0::vol->get_stnode_cache();
+    PageID stpid = stnode_page::stpid;
+    meta_page_lsns[stpid] = stcache->get_page_lsn();
+    lsn_t st_clean_lsn = stcache->get_clean_lsn();
+    if (!st_clean_lsn.is_null()) {
+        meta_clean_lsns[stpid] = st_clean_lsn;
+    }
+    for (map<PageID, lsn_t>::const_iterator it = meta_page_lsns.begin();
+            it != meta_page_lsns.end(); ++it)
+    {
+        PageID pid = it->first;
+        lsn_t page_lsn = it->second;
+        buf_tab_t::const_iterator p = prev.buf_tab.find(pid);
+        if (p != prev.buf_tab.end() && p->second.page_lsn > page_lsn) {
+            page_lsn = p->second.page_lsn;
+        }
+        if (page_lsn.is_null()) { continue; }
+
+        map<PageID, lsn_t>::const_iterator c = meta_clean_lsns.find(pid);
+        if (c != meta_clean_lsns.end()) {
+            if (page_lsn <= c->second) { continue; }
+            mark_page_dirty(pid, page_lsn, c->second);
+        }
+        else if (p != prev.buf_tab.end()) {
+            mark_page_dirty(pid, page_lsn, p->second.rec_lsn);
+        }
+        else {
+            mark_page_dirty(pid, page_lsn, prev.get_last_scan_start());
+        }
+    }
+
+    // Active transactions
+    set_highest_tid(xct_t::youngest_tid());
+    {
+        xct_i iter(true); // true == lock list
+        while (xct_t* xd = iter.next()) {
+            lsn_t last_lsn = xd->last_lsn();
+            if (xd->is_sys_xct() || xd->state() == xct_t::xct_ended
+                    || last_lsn.is_null())
+            {
+                continue;
+            }
+            mark_xct_active(xd->tid(), xd->first_lsn(), last_lsn);
+        }
+    }
+
+    // Log records of the transactions are fetched below
+    W_COERCE(smlevel_0::log->flush_all());
+
+    for (xct_tab_t::iterator it = xct_tab.begin(); it != xct_tab.end(); ) {
+        tid_t tid = it->first;
+        lsn_t stop_lsn = lsn_t::null;
+        xct_tab_t::const_iterator p = prev.xct_tab.find(tid);
+        if (p != prev.xct_tab.end()) {
+            it->second.locks = p->second.locks;
+            stop_lsn = p->second.last_lsn;
+        }
+        ++it;
+        collect_locks(tid, begin_lsn, stop_lsn);
+    }
+
+    last_scan_start = begin_lsn;
+}
+
+/*
+ * Acquires the locks of the given transaction from its log records, which
+ * are followed backwards from its last LSN until stop_lsn. Records from
+ * begin_lsn on are seen by restart in the log, so they are skipped. If the
+ * last record ends the transaction, it is removed from the table instead.
+ */
+void chkpt_t::collect_locks(tid_t tid, lsn_t begin_lsn, lsn_t stop_lsn)
+{
+    logrec_t r;
+    lsn_t lsn = xct_tab[tid].last_lsn;
+    bool last = true;
+    while (!lsn.is_null() && lsn > stop_lsn) {
+        lsn_t fetched = lsn;
+        W_COERCE(smlevel_0::log->fetch(fetched, &r, NULL, true));
+        w_assert0(fetched == lsn);
+
+        if (last && (r.type() == logrec_t::t_xct_end
+                    || r.type() == logrec_t::t_xct_abort))
+        {
+            delete_xct(tid);
+            return;
+        }
+        last = false;
+
+        if (lsn < begin_lsn && r.is_page_update() && !r.is_cpsn()) {
+            acquire_lock(r);
+        }
+        lsn = r.xid_prev();
+    }
+}
+
 void chkpt_t::mark_page_dirty(PageID pid, lsn_t page_lsn, lsn_t rec_lsn)
 {
     buf_tab_entry_t& e = buf_tab[pid];
@@ -696,6 +834,7 @@ void chkpt_m::take()
     DBGOUT1(<<"BEGIN chkpt_m::take");
 
     INC_TSTAT(log_chkpt_cnt);
+    stopwatch_t timer;
 
     // Insert chkpt_begin log record.
     logrec_t* logrec = new logrec_t;
@@ -703,17 +842,41 @@ void chkpt_m::take()
     LOG_INSERT(chkpt_begin_log(lsn_t::null), &begin_lsn);
     W_COERCE(ss_m::log->flush_all());
 
-    // Collect checkpoint information from log
-    curr_chkpt.scan_log(begin_lsn);
+    // Collect checkpoint information from the buffer pool and transaction
+    // list, if the previous checkpoint was taken by this instance after
+    // restart; otherwise from the log
+    chkpt_t prev_chkpt(std::move(curr_chkpt));
+    bool restart_done = !smlevel_0::recovery || smlevel_0::recovery->is_done();
+    if (_incremental && !_prev_lsn.is_null() && restart_done) {
+        curr_chkpt.collect(begin_lsn, prev_chkpt);
+        INC_TSTAT(log_chkpt_incremental);
+    }
+    else {
+        curr_chkpt.scan_log(begin_lsn);
+    }
+    ADD_TSTAT(log_chkpt_collect_time, timer.time_us());
 
-    // Serialize chkpt to file
+    // Serialize chkpt to file, as a delta of the previous one if possible
+    bool delta = _incremental && !_prev_lsn.is_null()
+        && _delta_count + 1 < _full_interval;
     fs::path fpath = smlevel_0::log->get_storage()->make_chkpt_path(lsn_t::null);
     fs::path newpath = smlevel_0::log->get_storage()->make_chkpt_path(begin_lsn);
     ofstream ofs(fpath.string(), ios::binary | ios::trunc);
-    curr_chkpt.serialize_binary(ofs);
+    if (delta) {
+        curr_chkpt.serialize_binary(ofs, _prev_lsn, &prev_chkpt);
+        INC_TSTAT(log_chkpt_delta);
+    }
+    else {
+        curr_chkpt.serialize_binary(ofs);
+    }
     ofs.close();
     fs::rename(fpath, newpath);
     smlevel_0::log->get_storage()->add_checkpoint(begin_lsn);
+    ADD_TSTAT(log_chkpt_write_time, timer.time_us());
+
+    _delta_count = delta ? _delta_count + 1 : 0;
+    if (!delta) { _chain_lsn = begin_lsn; }
+    _prev_lsn = begin_lsn;
 
     _min_rec_lsn = curr_chkpt.get_min_rec_lsn();
     _min_xct_lsn = curr_chkpt.get_min_xct_lsn();
@@ -725,24 +888,81 @@ void chkpt_m::take()
     delete logrec;
 }
 
-void chkpt_t::serialize_binary(ofstream& ofs)
+/*
+ * File format: LSN of the base checkpoint (null if this is a full file),
+ * highest tid, page entries, removed page IDs, transaction entries with
+ * their locks, removed tids, and backup path. In a full file, all entries
+ * are written and nothing is removed.
+ */
+void chkpt_t::serialize_binary(ofstream& ofs, lsn_t base_lsn,
+        const chkpt_t* base)
 {
+    w_assert1(base_lsn.is_null() == (base == nullptr));
+    ofs.write((char*)&base_lsn, sizeof(lsn_t));
     ofs.write((char*)&highest_tid, sizeof(tid_t));
 
-    size_t buf_tab_size = buf_tab.size();
-    ofs.write((char*)&buf_tab_size, sizeof(size_t));
+    vector<buf_tab_t::const_iterator> pages;
     for(buf_tab_t::const_iterator it = buf_tab.begin();
             it != buf_tab.end(); ++it)
     {
-        ofs.write((char*)&it->first, sizeof(PageID));
-        ofs.write((char*)&it->second, sizeof(buf_tab_entry_t));
+        if (base) {
+            buf_tab_t::const_iterator b = base->buf_tab.find(it->first);
+            if (b != base->buf_tab.end()
+                    && b->second.rec_lsn == it->second.rec_lsn
+                    && b->second.page_lsn == it->second.page_lsn
+                    && b->second.clean_lsn == it->second.clean_lsn)
+            {
+                continue;
+            }
+        }
+        pages.push_back(it);
     }
 
-    size_t xct_tab_size = xct_tab.size();
-    ofs.write((char*)&xct_tab_size, sizeof(size_t));
+    size_t buf_tab_size = pages.size();
+    ofs.write((char*)&buf_tab_size, sizeof(size_t));
+    for (size_t i = 0; i < pages.size(); i++) {
+        ofs.write((char*)&pages[i]->first, sizeof(PageID));
+        ofs.write((char*)&pages[i]->second, sizeof(buf_tab_entry_t));
+    }
+
+    vector<PageID> removed_pids;
+    if (base) {
+        for(buf_tab_t::const_iterator it = base->buf_tab.begin();
+                it != base->buf_tab.end(); ++it)
+        {
+            if (buf_tab.find(it->first) == buf_tab.end()) {
+                removed_pids.push_back(it->first);
+            }
+        }
+    }
+    size_t removed_size = removed_pids.size();
+    ofs.write((char*)&removed_size, sizeof(size_t));
+    if (removed_size > 0) {
+        ofs.write((char*)&removed_pids[0], removed_size * sizeof(PageID));
+    }
+
+    vector<xct_tab_t::const_iterator> xcts;
     for(xct_tab_t::const_iterator it=xct_tab.begin();
             it != xct_tab.end(); ++it)
     {
+        if (base) {
+            xct_tab_t::const_iterator b = base->xct_tab.find(it->first);
+            if (b != base->xct_tab.end()
+                    && b->second.state == it->second.state
+                    && b->second.last_lsn == it->second.last_lsn
+                    && b->second.first_lsn == it->second.first_lsn
+                    && b->second.locks.size() == it->second.locks.size())
+            {
+                continue;
+            }
+        }
+        xcts.push_back(it);
+    }
+
+    size_t xct_tab_size = xcts.size();
+    ofs.write((char*)&xct_tab_size, sizeof(size_t));
+    for (size_t i = 0; i < xcts.size(); i++) {
+        xct_tab_t::const_iterator it = xcts[i];
         ofs.write((char*)&it->first, sizeof(tid_t));
         ofs.write((char*)&it->second.state, sizeof(smlevel_0::xct_state_t));
         ofs.write((char*)&it->second.last_lsn, sizeof(lsn_t));
@@ -753,24 +973,49 @@ void chkpt_t::serialize_binary(ofstream& ofs)
         for(vector<lock_info_t>::const_iterator jt = it->second.locks.begin();
                 jt != it->second.locks.end(); ++jt)
         {
-            ofs.write((char*)&jt, sizeof(lock_info_t));
+            ofs.write((char*)&*jt, sizeof(lock_info_t));
+        }
+    }
+
+    vector<tid_t> removed_tids;
+    if (base) {
+        for(xct_tab_t::const_iterator it = base->xct_tab.begin();
+                it != base->xct_tab.end(); ++it)
+        {
+            if (xct_tab.find(it->first) == xct_tab.end()) {
+                removed_tids.push_back(it->first);
+            }
         }
     }
+    removed_size = removed_tids.size();
+    ofs.write((char*)&removed_size, sizeof(size_t));
+    if (removed_size > 0) {
+        ofs.write((char*)&removed_tids[0], removed_size * sizeof(tid_t));
+    }
 
     size_t bkp_path_size = bkp_path.size();
     ofs.write((char*)&bkp_path_size, sizeof(size_t));
     if (!bkp_path.empty()) {
-        ofs.write((char*)&bkp_path, bkp_path.size());
+        ofs.write(bkp_path.data(), bkp_path.size());
     }
 }
 
-void chkpt_t::deserialize_binary(ifstream& ifs)
+void chkpt_t::read_binary(ifstream& ifs)
 {
     if(!ifs.is_open()) {
         cerr << "Could not open input stream for chkpt file" << endl;;
         W_FATAL(fcINTERNAL);
     }
 
+    lsn_t base_lsn;
+    ifs.read((char*)&base_lsn, sizeof(lsn_t));
+    if (!base_lsn.is_null()) {
+        fs::path fpath = smlevel_0::log->get_storage()->make_chkpt_path(base_lsn);
+        ifstream base_ifs(fpath.string(), ios::binary);
+        read_binary(base_ifs);
+        base_ifs.close();
+    }
+
     ifs.read((char*)&highest_tid, sizeof(tid_t));
 
     size_t buf_tab_size;
@@ -778,16 +1023,15 @@ void chkpt_t::deserialize_binary(ifstream& ifs)
     for(uint i=0; i<buf_tab_size; i++) {
         PageID pid;
         ifs.read((char*)&pid, sizeof(PageID));
+        ifs.read((char*)&buf_tab[pid], sizeof(buf_tab_entry_t));
+    }
 
-        buf_tab_entry_t entry;
-        ifs.read((char*)&entry, sizeof(buf_tab_entry_t));
-
-        DBGOUT1(<<"pid[]="<<pid<< " , " <<
-                  "rec_lsn[]="<<entry.rec_lsn<< " , " <<
-                  "page_lsn[]="<<entry.page_lsn);
-
-        // buf_tab[pid] = entry;
-        mark_page_dirty(pid, entry.page_lsn, entry.rec_lsn);
+    size_t removed_size;
+    ifs.read((char*)&removed_size, sizeof(size_t));
+    for(uint i=0; i<removed_size; i++) {
+        PageID pid;
+        ifs.read((char*)&pid, sizeof(PageID));
+        buf_tab.erase(pid);
     }
 
     size_t xct_tab_size;
@@ -796,40 +1040,77 @@ void chkpt_t::deserialize_binary(ifstream& ifs)
         tid_t tid;
         ifs.read((char*)&tid, sizeof(tid_t));
 
-        xct_tab_entry_t entry;
+        xct_tab_entry_t& entry = xct_tab[tid];
         ifs.read((char*)&entry.state, sizeof(smlevel_0::xct_state_t));
         ifs.read((char*)&entry.last_lsn, sizeof(lsn_t));
         ifs.read((char*)&entry.first_lsn, sizeof(lsn_t));
 
-        DBGOUT1(<<"tid[]="<<tid<<" , " <<
+        size_t lock_tab_size;
+        ifs.read((char*)&lock_tab_size, sizeof(size_t));
+        entry.locks.resize(lock_tab_size);
+        for(uint j=0; j<lock_tab_size; j++) {
+            ifs.read((char*)&entry.locks[j], sizeof(lock_info_t));
+        }
+    }
+
+    ifs.read((char*)&removed_size, sizeof(size_t));
+    for(uint i=0; i<removed_size; i++) {
+        tid_t tid;
+        ifs.read((char*)&tid, sizeof(tid_t));
+        xct_tab.erase(tid);
+    }
+
+    size_t bkp_path_size;
+    ifs.read((char*)&bkp_path_size, sizeof(size_t));
+    bkp_path.resize(bkp_path_size);
+    if (bkp_path_size > 0) {
+        ifs.read(&bkp_path[0], bkp_path_size);
+    }
+}
+
+void chkpt_t::deserialize_binary(ifstream& ifs)
+{
+    chkpt_t file;
+    file.init();
+    file.read_binary(ifs);
+
+    if (file.highest_tid > highest_tid) {
+        highest_tid = file.highest_tid;
+    }
+
+    for(buf_tab_t::const_iterator it = file.buf_tab.begin();
+            it != file.buf_tab.end(); ++it)
+    {
+        DBGOUT1(<<"pid[]="<<it->first<< " , " <<
+                  "rec_lsn[]="<<it->second.rec_lsn<< " , " <<
+                  "page_lsn[]="<<it->second.page_lsn);
+        mark_page_dirty(it->first, it->second.page_lsn, it->second.rec_lsn);
+    }
+
+    for(xct_tab_t::const_iterator it = file.xct_tab.begin();
+            it != file.xct_tab.end(); ++it)
+    {
+        const xct_tab_entry_t& entry = it->second;
+        DBGOUT1(<<"tid[]="<<it->first<<" , " <<
                   "state[]="<<entry.state<< " , " <<
                   "last_lsn[]="<<entry.last_lsn<<" , " <<
                   "first_lsn[]="<<entry.first_lsn);
 
         if (entry.state != smlevel_0::xct_ended) {
-            mark_xct_active(tid, entry.first_lsn, entry.last_lsn);
-
-            if (is_xct_active(tid)) {
-                size_t lock_tab_size;
-                ifs.read((char*)&lock_tab_size, sizeof(size_t));
-                for(uint j=0; j<lock_tab_size; j++) {
-                    lock_info_t lock_entry;
-                    ifs.read((char*)&lock_entry, sizeof(lock_info_t));
-                    // entry.locks.push_back(lock_entry);
-                    add_lock(tid, lock_entry.lock_mode, lock_entry.lock_hash);
-
-                    DBGOUT1(<< "    lock_mode[]="<<lock_entry.lock_mode
-                            << " , lock_hash[]="<<lock_entry.lock_hash);
+            mark_xct_active(it->first, entry.first_lsn, entry.last_lsn);
+
+            if (is_xct_active(it->first)) {
+                for(vector<lock_info_t>::const_iterator jt = entry.locks.begin();
+                        jt != entry.locks.end(); ++jt)
+                {
+                    add_lock(it->first, jt->lock_mode, jt->lock_hash);
                 }
             }
-            // xct_tab[tid] = entry;
         }
     }
 
-    size_t bkp_path_size;
-    ifs.read((char*)&bkp_path_size, sizeof(size_t));
-    if (!bkp_path.empty()) {
-        ifs.read((char*)&bkp_path, bkp_path_size);
+    if (bkp_path.empty()) {
+        bkp_path = file.bkp_path;
     }
 }
 
@@ -116,6 +116,17 @@ public: // required for restart for now
 public:
     void scan_log(lsn_t scan_start = lsn_t::null);
 
+    /*
+     * Builds the checkpoint of begin_lsn without scanning the log backwards:
+     * dirty pages are taken from the buffer pool control blocks (and from the
+     * alloc and stnode caches) and active transactions from the transaction
+     * list. Locks are re-acquired from the
+     * log records of each active transaction, following its xid_prev chain
+     * only back to the last LSN it had in prev (the previous checkpoint).
+     * Requires that prev was taken after restart had finished.
+     */
+    void collect(lsn_t begin_lsn, const chkpt_t& prev);
+
     void mark_page_dirty(PageID pid, lsn_t page_lsn, lsn_t rec_lsn);
     void mark_page_clean(PageID pid, lsn_t lsn);
 
@@ -139,10 +150,25 @@ public:
 private:
     void init();
     void serialize();
-    void serialize_binary(ofstream& ofs);
-    void deserialize_binary(ifstream& ofs);
+
+    /*
+     * Writes the checkpoint to a file. If a base checkpoint is given, only
+     * entries that differ from the base are written, plus the pages and
+     * transactions that are no longer in the tables (a delta file).
+     */
+    void serialize_binary(ofstream& ofs, lsn_t base_lsn = lsn_t::null,
+            const chkpt_t* base = nullptr);
+
+    /* Merges the contents of a checkpoint file into the tables */
+    void deserialize_binary(ifstream& ifs);
+
+    /* Replaces the tables with the contents of a checkpoint file, reading
+     * the base files first in case of a delta file */
+    void read_binary(ifstream& ifs);
+
     void cleanup();
     void acquire_lock(logrec_t& r);
+    void collect_locks(tid_t tid, lsn_t last_lsn, lsn_t stop_lsn);
 };
 
 
@@ -180,6 +206,13 @@ public:
      * indicates that the system is "clean", i.e., no active transactions or
      * dirty pages. For this case, we return the LSN of the last checkpoint.
      */
+    /*
+     * Oldest checkpoint whose file is needed to read the latest one, i.e.,
+     * the last checkpoint written in full. Null if no checkpoint was taken
+     * yet by this instance.
+     */
+    lsn_t get_chain_lsn() { return _chain_lsn; }
+
     lsn_t get_min_active_lsn() {
         lsn_t min = _last_end_lsn;
         if (!_min_rec_lsn.is_null() && _min_rec_lsn < min) {
@@ -199,6 +232,18 @@ private:
 
     void             _acquire_lock(logrec_t& r, chkpt_t& new_chkpt);
 
+    // Build checkpoints from the buffer pool and transaction list instead
+    // of scanning the log (sm_chkpt_incremental)
+    bool             _incremental;
+    // Every this many checkpoints, the file is written in full rather than
+    // as a delta of the previous one (sm_chkpt_full_interval)
+    long             _full_interval;
+    // Delta files written since the last full one
+    long             _delta_count;
+    // LSN of the last checkpoint taken, and of the last full one
+    lsn_t            _prev_lsn;
+    lsn_t            _chain_lsn;
+
     // Values cached from the last checkpoint
     lsn_t _min_rec_lsn;
     lsn_t _min_xct_lsn;
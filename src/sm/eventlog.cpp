@@ -6,52 +6,63 @@
 boost::gregorian::date sysevent_timer::epoch
     = boost::gregorian::date(2015,1,1);
 
+/*
+ * Event records are small and their length is known up front, so they are
+ * constructed directly in the log buffer (see log_core::insert_direct)
+ * instead of in a temporary logrec_t.
+ */
+
 void sysevent::log(logrec_t::kind_t kind)
 {
-    // this should use TLS allocator, so it's fast
-    // (see macro DEFINE_SM_ALLOC in allocator.h and logrec.cpp)
-    logrec_t* lr = new logrec_t();
-    lr->header._type = kind;
-    lr->header._cat = 0 | logrec_t::t_status;
-    lr->fill(0, 0);
-    W_COERCE(smlevel_0::log->insert(*lr, NULL));
-    delete lr;
+    W_COERCE(smlevel_0::log->insert_direct(logrec_t::length_for(0, false),
+        [kind] (void* buf)
+        {
+            logrec_t* lr = new (buf) logrec_t;
+            lr->header._type = kind;
+            lr->header._cat = 0 | logrec_t::t_status;
+            lr->fill(0, 0);
+        }));
 }
 
 void sysevent::log_page_read(PageID shpid, uint32_t count)
 {
-    logrec_t* lr = new logrec_t();
-    lr->header._type = logrec_t::t_page_read;
-    lr->header._cat = 0 | logrec_t::t_status;
-
-    memcpy(lr->data(), &shpid, sizeof(PageID));
-    memcpy(lr->_data + sizeof(PageID), &count, sizeof(uint32_t));
-    lr->fill(0, sizeof(PageID) + sizeof(uint32_t));
-    W_COERCE(smlevel_0::log->insert(*lr, NULL));
-    delete lr;
+    const smsize_t len = sizeof(PageID) + sizeof(uint32_t);
+    W_COERCE(smlevel_0::log->insert_direct(logrec_t::length_for(len, false),
+        [&] (void* buf)
+        {
+            logrec_t* lr = new (buf) logrec_t;
+            lr->header._type = logrec_t::t_page_read;
+            lr->header._cat = 0 | logrec_t::t_status;
+
+            memcpy(lr->data(), &shpid, sizeof(PageID));
+            memcpy(lr->_data + sizeof(PageID), &count, sizeof(uint32_t));
+            lr->fill(0, len);
+        }));
 }
 
 void sysevent::log_page_write(PageID shpid, lsn_t lsn, uint32_t count)
 {
-    logrec_t* lr = new logrec_t();
-    lr->header._type = logrec_t::t_page_write;
-    lr->header._cat = 0 | logrec_t::t_status;
-
-    char* pos = lr->_data;
+    const smsize_t len = sizeof(PageID) + sizeof(lsn_t) + sizeof(uint32_t);
+    W_COERCE(smlevel_0::log->insert_direct(logrec_t::length_for(len, false),
+        [&] (void* buf)
+        {
+            logrec_t* lr = new (buf) logrec_t;
+            lr->header._type = logrec_t::t_page_write;
+            lr->header._cat = 0 | logrec_t::t_status;
 
-    memcpy(pos, &shpid, sizeof(PageID));
-    pos += sizeof(PageID);
+            char* pos = lr->_data;
 
-    memcpy(pos, &lsn, sizeof(lsn_t));
-    pos += sizeof(lsn_t);
+            memcpy(pos, &shpid, sizeof(PageID));
+            pos += sizeof(PageID);
 
-    memcpy(pos, &count, sizeof(uint32_t));
-    pos += sizeof(uint32_t);
+            memcpy(pos, &lsn, sizeof(lsn_t));
+            pos += sizeof(lsn_t);
 
+            memcpy(pos, &count, sizeof(uint32_t));
+            pos += sizeof(uint32_t);
 
-    lr->fill(0, pos - lr->_data);
-    W_COERCE(smlevel_0::log->insert(*lr, NULL));
-    delete lr;
+            lr->fill(0, pos - lr->_data);
+        }));
 }
 
 // METADATA OPERATIONS (CS TODO)
@@ -61,39 +72,54 @@ void sysevent::log_page_write(PageID shpid, lsn_t lsn, uint32_t count)
 
 void sysevent::log_alloc_page(PageID pid, lsn_t& prev_page_lsn)
 {
-    logrec_t* lr = new alloc_page_log(pid);
-    lr->set_page_prev_lsn(prev_page_lsn);
-    W_COERCE(smlevel_0::log->insert(*lr, &prev_page_lsn));
-    delete lr;
+    W_COERCE(smlevel_0::log->insert_direct(
+        alloc_page_log::length_for(sizeof(PageID)),
+        [&] (void* buf)
+        {
+            logrec_t* lr = new (buf) alloc_page_log(pid);
+            lr->set_page_prev_lsn(prev_page_lsn);
+        }, &prev_page_lsn));
 }
 
 void sysevent::log_dealloc_page(PageID pid, lsn_t& prev_page_lsn)
 {
-    logrec_t* lr = new dealloc_page_log(pid);
-    lr->set_page_prev_lsn(prev_page_lsn);
-    W_COERCE(smlevel_0::log->insert(*lr, &prev_page_lsn));
-    delete lr;
+    W_COERCE(smlevel_0::log->insert_direct(
+        dealloc_page_log::length_for(sizeof(PageID)),
+        [&] (void* buf)
+        {
+            logrec_t* lr = new (buf) dealloc_page_log(pid);
+            lr->set_page_prev_lsn(prev_page_lsn);
+        }, &prev_page_lsn));
 }
 
 void sysevent::log_create_store(PageID root, StoreID stid, lsn_t& prev_page_lsn)
 {
-    logrec_t* lr = new create_store_log(root, stid);
-    lr->set_page_prev_lsn(prev_page_lsn);
-    W_COERCE(smlevel_0::log->insert(*lr, &prev_page_lsn));
-    delete lr;
+    W_COERCE(smlevel_0::log->insert_direct(
+        create_store_log::length_for(sizeof(StoreID) + sizeof(PageID)),
+        [&] (void* buf)
+        {
+            logrec_t* lr = new (buf) create_store_log(root, stid);
+            lr->set_page_prev_lsn(prev_page_lsn);
+        }, &prev_page_lsn));
 }
 
 void sysevent::log_append_extent(extent_id_t ext, lsn_t& prev_page_lsn)
 {
-    logrec_t* lr = new append_extent_log(ext);
-    lr->set_page_prev_lsn(prev_page_lsn);
-    W_COERCE(smlevel_0::log->insert(*lr, &prev_page_lsn));
-    delete lr;
+    W_COERCE(smlevel_0::log->insert_direct(
+        append_extent_log::length_for(sizeof(extent_id_t)),
+        [&] (void* buf)
+        {
+            logrec_t* lr = new (buf) append_extent_log(ext);
+            lr->set_page_prev_lsn(prev_page_lsn);
+        }, &prev_page_lsn));
 }
 
 void sysevent::log_xct_latency_dump(unsigned long nsec)
 {
-    logrec_t* lr = new xct_latency_dump_log(nsec);
-    W_COERCE(smlevel_0::log->insert(*lr, nullptr));
-    delete lr;
+    W_COERCE(smlevel_0::log->insert_direct(
+        xct_latency_dump_log::length_for(sizeof(unsigned long)),
+        [nsec] (void* buf)
+        {
+            new (buf) xct_latency_dump_log(nsec);
+        }));
 }
@@ -92,6 +92,22 @@ w_rc_t fixable_page_h::fix_root (StoreID store, latch_mode_t mode,
     return RCOK;
 }
 
+bool fixable_page_h::fix_if_unchanged(generic_page* page, uint32_t version,
+        latch_mode_t mode)
+{
+    w_assert1(mode != LATCH_NL);
+
+    unfix();
+    if (!smlevel_0::bf->fix_if_unchanged(page, version, mode)) {
+        return false;
+    }
+
+    _pp                 = page;
+    _bufferpool_managed = true;
+    _mode               = mode;
+    return true;
+}
+
 void fixable_page_h::fix_nonbufferpool_page(generic_page* s)
 {
     w_assert1(s != NULL);
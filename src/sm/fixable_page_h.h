@@ -122,6 +122,13 @@ public:
     w_rc_t fix_root(StoreID store, latch_mode_t mode,
                     bool conditional=false, bool virgin=false);
 
+    /**
+     * Fixes a page read optimistically with bf_tree_m::read_optimistic(),
+     * provided it did not change since the given version was read.
+     * Returns false, leaving this handle unfixed, otherwise.
+     */
+    bool fix_if_unchanged(generic_page* page, uint32_t version, latch_mode_t mode);
+
     /**
      * Imaginery 'fix' for a non-bufferpool-managed page.
      *
@@ -124,6 +124,13 @@ rc_t lock_m::lock(uint32_t hash, const okvl_mode &m,
     RawXct* xct = xd->raw_lock_xct();
     w_error_codes rce = _core->acquire_lock(xct, hash, m,
             check, wait, acquire, timeout, out);
+    // statistics the lock queues collected in the shadow transaction
+    ADD_TSTAT(lock_queue_walk_cnt, xct->queue_walked);
+    ADD_TSTAT(lock_queue_collision_cnt, xct->queue_collisions);
+    ADD_TSTAT(lock_table_grow_cnt, xct->table_grows);
+    xct->queue_walked = 0;
+    xct->queue_collisions = 0;
+    xct->table_grows = 0;
     if (rce) {
         rc = RC(rce);
     } else {
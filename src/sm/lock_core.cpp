@@ -12,12 +12,13 @@
 #include "lock_lil.h"
 #include "lock_core.h"
 #include "lock_raw.h"
-#include "lock_compt.h"
 #include "sm_options.h"
 #include "xct.h"
 #include "w_okvl.h"
 #include "w_okvl_inl.h"
 
+#include <sched.h>
+
 // these are not used now
 #ifdef SWITCH_DEADLOCK_IMPL
 bool g_deadlock_use_waitmap_obsolete = true;
@@ -37,8 +38,77 @@ struct RawLockCleanerFunctor : public GcWakeupFunctor {
     RawLockBackgroundThread*    cleaner;
 };
 
-lock_core_m::lock_core_m(const sm_options &options) : _htab(NULL), _htabsz(0) {
+/** At most 2^this many partitions. */
+const uint32_t LOCK_TABLE_MAX_PARTITION_BITS = 8;
+/** A partition never grows beyond 2^this many queues. */
+const uint32_t LOCK_TABLE_MAX_QUEUE_BITS = 26;
+/** A partition starts with at least 2^this many queues. */
+const uint32_t LOCK_TABLE_MIN_QUEUE_BITS = 6;
+/**
+ * A lock request that had to check more locks of other hashes than this in its queue
+ * doubles the partition (with sm_locktable_grow).
+ */
+const uint64_t LOCK_TABLE_GROW_COLLISIONS = 8;
+/**
+ * How many times a growing partition yields while it waits for its users to leave,
+ * before it gives up. Bounds the time new requests stall, and breaks the cycle of
+ * two threads each waiting in one partition for the other's partition to grow.
+ */
+const int LOCK_TABLE_GROW_DRAIN_YIELDS = 1000;
+/** How deeply requests may nest, eg a lock request that rolls back a loser. */
+const uint32_t LOCK_TABLE_MAX_NESTED_REQUESTS = 16;
+
+/** Partitions the current thread entered with lock_core_m::_enter(), innermost last. */
+__thread RawLockPartition* tls_entered_partitions[LOCK_TABLE_MAX_NESTED_REQUESTS];
+__thread uint32_t tls_entered_partition_count = 0;
+/** The partition the current thread left to wait for a lock. */
+__thread RawLockPartition* tls_waiting_partition = NULL;
+
+/** Registers a request on the partition, waiting while it grows unless nested. */
+inline void enter_partition(RawLockPartition* partition) {
+    w_assert0(tls_entered_partition_count < LOCK_TABLE_MAX_NESTED_REQUESTS);
+    bool nested = false;
+    for (uint32_t i = 0; i < tls_entered_partition_count; ++i) {
+        if (tls_entered_partitions[i] == partition) {
+            nested = true; // a grow waits for us, so we must not wait for it
+            break;
+        }
+    }
+    if (nested) {
+        partition->users.fetch_add(1);
+    } else {
+        while (true) {
+            while (partition->growing.load(std::memory_order_acquire)) {
+                ::sched_yield();
+            }
+            // pairs with the growing thread setting growing, then reading users
+            partition->users.fetch_add(1);
+            if (!partition->growing.load()) {
+                break;
+            }
+            partition->users.fetch_sub(1);
+        }
+    }
+    tls_entered_partitions[tls_entered_partition_count++] = partition;
+}
+
+inline void leave_partition(RawLockPartition* partition) {
+    w_assert1(tls_entered_partition_count > 0);
+    w_assert1(tls_entered_partitions[tls_entered_partition_count - 1] == partition);
+    --tls_entered_partition_count;
+    partition->users.fetch_sub(1, std::memory_order_release);
+}
+
+/** Fibonacci hashing: multiplication spreads the hash to the high bits, used below. */
+inline uint64_t mix_lock_hash(uint32_t hash) {
+    return hash * 0x9E3779B97F4A7C15ULL;
+}
+
+lock_core_m::lock_core_m(const sm_options &options)
+    : _partitions(NULL), _partition_bits(0), _grow_enabled(false) {
     size_t sz = options.get_int_option("sm_locktablesize", 64000);
+    size_t partitions = options.get_int_option("sm_locktable_partitions", 16);
+    _grow_enabled = options.get_bool_option("sm_locktable_grow", false);
 
 
     // CS TODO: options below were set in the old Zero tpcc.cpp
@@ -74,25 +144,31 @@ lock_core_m::lock_core_m(const sm_options &options) : _htab(NULL), _htabsz(0) {
         << ", sm_rawlock_lockpool_segsize=" << lockpool_segsize
         << ", sm_rawlock_xctpool_segsize=" << xctpool_segsize);
 
-    // find _htabsz, a power of 2 greater than sz
-    int b=0; // count bits shifted
-    for (_htabsz = 1; _htabsz < sz; _htabsz <<= 1) b++;
-
-    w_assert1(!_htab); // just to check size
-
-    w_assert1(_htabsz >= 0x40);
-    w_assert1(b >= 6 && b <= 23);
-    // if anyone wants a hash table bigger,
-    // he's probably in trouble.
-
-    // Now convert to a prime number in that range.
-    // get highest prime for that numer:
-    b -= 6;
-
-    _htabsz = primes[b];
-    _htab = new RawLockQueue[_htabsz];
-    w_assert1(_htab);
-    ::memset(_htab, 0, _htabsz * sizeof(RawLockQueue));
+    // a power of 2 number of partitions, each with a power of 2 number of queues
+    // adding up to at least sz. Multiplicative hashing needs no prime table size.
+    while (_partition_bits < LOCK_TABLE_MAX_PARTITION_BITS
+            && (1U << _partition_bits) < partitions) {
+        ++_partition_bits;
+    }
+    uint32_t queue_bits = LOCK_TABLE_MIN_QUEUE_BITS;
+    while (queue_bits < LOCK_TABLE_MAX_QUEUE_BITS
+            && ((size_t) 1 << (queue_bits + _partition_bits)) < sz) {
+        ++queue_bits;
+    }
+    DBGOUT3(<<"lock_core_m constructor: partitions=" << (1 << _partition_bits)
+        << ", queues per partition=" << (1 << queue_bits)
+        << ", sm_locktable_grow=" << _grow_enabled);
+
+    _partitions = new RawLockPartition[1 << _partition_bits];
+    w_assert1(_partitions);
+    for (uint32_t p = 0; p < (1U << _partition_bits); ++p) {
+        RawLockQueue* queues = new RawLockQueue[1 << queue_bits];
+        ::memset(queues, 0, sizeof(RawLockQueue) << queue_bits);
+        _partitions[p].queues = queues;
+        _partitions[p].bits = queue_bits;
+        _partitions[p].users = 0;
+        _partitions[p].growing = false;
+    }
 
     _lock_pool = new GcPoolForest<RawLock>("Lock Pool", generation_count,
                                            lockpool_initseg, lockpool_segsize);
@@ -126,12 +202,15 @@ lock_core_m::~lock_core_m()
 {
     DBGOUT3( << " lock_core_m::~lock_core_m()" );
     DBGOUT1( << "Checking if all locks were released..." );
-    for (uint32_t i = 0; i < _htabsz; ++i) {
-        if (!_htab[i].head.next.is_null()) {
-            ERROUT( << "There is some lock not released!" );
-            dump(std::cerr);
-            w_assert0(false);
-            break;
+    for (uint32_t p = 0; p < (1U << _partition_bits); ++p) {
+        const RawLockQueue* queues = _partitions[p].queues;
+        for (uint32_t i = 0; i < (1U << _partitions[p].bits); ++i) {
+            if (!queues[i].head.next.is_null()) {
+                ERROUT( << "There is some lock not released!" );
+                dump(std::cerr);
+                w_assert0(false);
+                break;
+            }
         }
     }
 
@@ -144,8 +223,11 @@ lock_core_m::~lock_core_m()
     delete _lock_pool;
     delete _xct_pool;
 
-    delete[] _htab;
-    _htab = NULL;
+    for (uint32_t p = 0; p < (1U << _partition_bits); ++p) {
+        delete[] _partitions[p].queues.load();
+    }
+    delete[] _partitions;
+    _partitions = NULL;
 
     delete _lil_global_table;
     _lil_global_table = NULL;
@@ -167,14 +249,128 @@ void lock_core_m::deallocate_xct(RawXct* xct) {
 }
 
 
+size_t lock_core_m::queue_count() const {
+    size_t count = 0;
+    for (uint32_t p = 0; p < (1U << _partition_bits); ++p) {
+        count += (size_t) 1 << _partitions[p].bits.load();
+    }
+    return count;
+}
+
+RawLockPartition& lock_core_m::_partition(uint32_t hash) const {
+    if (_partition_bits == 0) {
+        return _partitions[0];
+    }
+    return _partitions[mix_lock_hash(hash) >> (64 - _partition_bits)];
+}
+
+RawLockQueue* lock_core_m::_queue(const RawLockPartition& partition,
+                                  uint32_t partition_bits, uint32_t hash) {
+    // the bits right below the partition bits, so doubling the queues splits
+    // queue i into queues 2i and 2i+1
+    uint64_t mixed = mix_lock_hash(hash) << partition_bits;
+    uint32_t bits = partition.bits.load(std::memory_order_acquire);
+    return partition.queues.load(std::memory_order_acquire) + (mixed >> (64 - bits));
+}
+
+void lock_core_m::_enter(RawLockPartition& partition) const {
+    if (_grow_enabled) {
+        enter_partition(&partition);
+    }
+}
+
+void lock_core_m::_leave(RawLockPartition& partition) const {
+    if (_grow_enabled) {
+        leave_partition(&partition);
+    }
+}
+
+bool lock_core_m::leave_partition_for_wait() {
+    // only a thread in a single request; a nested one would stall the grow anyway
+    if (tls_entered_partition_count != 1) {
+        return false;
+    }
+    tls_waiting_partition = tls_entered_partitions[0];
+    leave_partition(tls_waiting_partition);
+    return true;
+}
+
+void lock_core_m::reenter_partition_after_wait() {
+    w_assert1(tls_waiting_partition != NULL);
+    enter_partition(tls_waiting_partition);
+    tls_waiting_partition = NULL;
+}
+
+bool lock_core_m::_grow(RawLockPartition& partition, uint32_t bits) {
+    // a thread inside a request would wait for itself
+    if (tls_entered_partition_count > 0 || bits >= LOCK_TABLE_MAX_QUEUE_BITS) {
+        return false;
+    }
+    RawLockQueue* new_queues = new RawLockQueue[2 << bits];
+    ::memset(new_queues, 0, sizeof(RawLockQueue) << (bits + 1));
+    bool expected = false;
+    if (!partition.growing.compare_exchange_strong(expected, true)) {
+        delete[] new_queues; // someone else is growing it
+        return false;
+    }
+    bool drained = false;
+    for (int i = 0; i < LOCK_TABLE_GROW_DRAIN_YIELDS; ++i) {
+        if (partition.users.load() == 0) {
+            drained = true;
+            break;
+        }
+        ::sched_yield();
+    }
+    if (!drained || partition.bits.load() != bits) {
+        partition.growing.store(false, std::memory_order_release);
+        delete[] new_queues;
+        return false;
+    }
+
+    // No one is in the partition now, so the queues hold only ACTIVE and WAITING locks
+    // (releases delink their locks before leaving) and no traversal is in progress.
+    // Queue i splits into 2i and 2i+1, which keeps the order of the locks of each hash.
+    RawLockQueue* old_queues = partition.queues.load();
+    for (uint32_t i = 0; i < (1U << bits); ++i) {
+        RawLock* tails[2] = {&new_queues[2 * i].head, &new_queues[2 * i + 1].head};
+        for (RawLock* lock = old_queues[i].head.next.get_pointer(); lock != NULL;) {
+            RawLock* next = lock->next.get_pointer();
+            w_assert1(!lock->next.is_marked());
+            uint64_t mixed = mix_lock_hash(lock->hash) << _partition_bits;
+            int half = (mixed >> (63 - bits)) & 1;
+            lock->next = NULL_RAW_LOCK;
+            lock->queue = &new_queues[2 * i + half];
+            tails[half]->next = MarkablePointer<RawLock>(lock, false);
+            tails[half] = lock;
+            lock = next;
+        }
+        new_queues[2 * i].x_lock_tag = old_queues[i].x_lock_tag;
+        new_queues[2 * i + 1].x_lock_tag = old_queues[i].x_lock_tag;
+    }
+    partition.queues.store(new_queues, std::memory_order_release);
+    partition.bits.store(bits + 1, std::memory_order_release);
+    partition.growing.store(false, std::memory_order_release);
+    // waiters that left the partition find their locks through RawLock::queue
+    delete[] old_queues;
+    return true;
+}
+
 w_error_codes lock_core_m::acquire_lock(RawXct* xct, uint32_t hash, const okvl_mode& mode,
                 bool check, bool wait, bool acquire, int32_t timeout, RawLock** out)
 {
     w_assert1(timeout >= 0 || timeout == WAIT_FOREVER);
-    uint32_t idx = _table_bucket(hash);
+    RawLockPartition& partition = _partition(hash);
     while (true) {
-        w_error_codes er = _htab[idx].acquire(xct, hash, mode, timeout,
-                check, wait, acquire, out);
+        _enter(partition);
+        uint64_t collisions = xct->queue_collisions;
+        uint32_t bits = partition.bits.load(std::memory_order_acquire);
+        w_error_codes er = _queue(partition, _partition_bits, hash)->acquire(xct, hash, mode,
+                timeout, check, wait, acquire, out);
+        _leave(partition);
+        if (_grow_enabled && xct->queue_collisions - collisions > LOCK_TABLE_GROW_COLLISIONS
+                && _grow(partition, bits)) {
+            ++xct->table_grows;
+        }
         // Possible return codes:
         //   eDEADLOCK - detected deadlock, released the lock entry,
         //                         automaticlly retry here if caller does not own other locks
@@ -198,7 +394,7 @@ w_error_codes lock_core_m::acquire_lock(RawXct* xct, uint32_t hash, const okvl_m
 w_error_codes lock_core_m::retry_acquire(RawLock** lock, bool acquire, int32_t timeout) {
     w_assert1(timeout >= 0 || timeout == WAIT_FOREVER);
     uint32_t hash = (*lock)->hash;
-    uint32_t idx = _table_bucket(hash);
+    RawLockPartition& partition = _partition(hash);
     const okvl_mode& mode = (*lock)->mode;
     RawXct* xct = (*lock)->owner_xct;
     while (true) {
@@ -210,7 +406,9 @@ w_error_codes lock_core_m::retry_acquire(RawLock** lock, bool acquire, int32_t t
         //                         if true == conditional, keep the already inserted lock entry and return control to caller
         //                         caller should retry using retry_acquire
         //   w_error_ok - acquired lock, return to caller
-        w_error_codes er = _htab[idx].retry_acquire(lock, true, acquire, timeout);
+        _enter(partition);
+        w_error_codes er = (*lock)->queue->retry_acquire(lock, true, acquire, timeout);
+        _leave(partition);
         if (er == eDEADLOCK && !xct->has_locks() && timeout == WAIT_FOREVER) {
             // same as above, but now the lock was removed. we have to switch to acquire_lock.
             w_assert1(*lock == NULL);
@@ -222,9 +420,10 @@ w_error_codes lock_core_m::retry_acquire(RawLock** lock, bool acquire, int32_t t
 
 void lock_core_m::release_lock(RawLock* lock, lsn_t commit_lsn) {
     w_assert1(lock);
-    uint32_t hash = lock->hash;
-    uint32_t idx = _table_bucket(hash);
-    _htab[idx].release(lock, commit_lsn);
+    RawLockPartition& partition = _partition(lock->hash);
+    _enter(partition);
+    lock->queue->release(lock, commit_lsn);
+    _leave(partition);
 }
 
 
@@ -241,9 +440,10 @@ void lock_core_m::release_duration(bool read_lock_only, lsn_t commit_lsn) {
             if (!read_lock_only) {
                 // also do SX-ELR tag update BEFORE changing the status
                 if (commit_lsn != lsn_t::null) {
-                    uint32_t hash = lock->hash;
-                    uint32_t idx = _table_bucket(hash);
-                    _htab[idx].update_xlock_tag(commit_lsn);
+                    RawLockPartition& partition = _partition(lock->hash);
+                    _enter(partition);
+                    lock->queue->update_xlock_tag(commit_lsn);
+                    _leave(partition);
                 }
                 lock->state = RawLock::OBSOLETE;
             }
@@ -261,18 +461,14 @@ void lock_core_m::release_duration(bool read_lock_only, lsn_t commit_lsn) {
         for (RawLock* lock = xct->private_first; lock != NULL;) {
             RawLock* next = lock->xct_next;
             if (!lock->mode.contains_dirty_lock()) {
-                uint32_t hash = lock->hash;
-                uint32_t idx = _table_bucket(hash);
-                _htab[idx].release(lock, commit_lsn);
+                release_lock(lock, commit_lsn);
             }
             lock = next;
         }
     } else {
         while (xct->private_first != NULL)  {
             RawLock* lock = xct->private_first;
-            uint32_t hash = lock->hash;
-            uint32_t idx = _table_bucket(hash);
-            _htab[idx].release(lock, commit_lsn);
+            release_lock(lock, commit_lsn);
         }
     }
     DBGOUT4(<<"lock_core_m::release_duration DONE");
@@ -6,6 +6,8 @@
 #define LOCK_CORE_H
 
 #include <stdint.h>
+#include <atomic>
+#include "w_defines.h"
 #include "lsn.h"
 
 struct RawLock;
@@ -19,12 +21,41 @@ class lil_global_table;
 class vtable_t;
 class okvl_mode;
 
+/**
+ * \brief One partition of the lock table.
+ * \ingroup SSMLOCK
+ * \details
+ * The high bits of the (mixed) lock hash choose the partition, and the next bits
+ * choose one of its 2^bits lock queues. With \e sm_locktable_grow, a partition whose
+ * queues get crowded doubles its queue array on its own; see lock_core_m::_grow().
+ *
+ * While the array can grow, each request that touches a queue of the partition is
+ * counted in \e users. A growing partition sets \e growing so that no new request
+ * enters, waits until \e users drops to zero, and moves every lock to its queue in the
+ * new array. Lock waiters leave the partition while they sleep, and briefly every
+ * few thousand spins with PURE_SPIN_RAWLOCK.
+ */
+struct RawLockPartition {
+    /** Lock queues of this partition, 2^bits of them. */
+    std::atomic<RawLockQueue*>  queues;
+    /** Log2 of the number of queues. */
+    std::atomic<uint32_t>       bits;
+    /** Number of requests now using the queues; only maintained with sm_locktable_grow. */
+    std::atomic<int32_t>        users;
+    /** True while this partition moves its locks to a doubled queue array. */
+    std::atomic<bool>           growing;
+
+    char                        _pad[CACHELINE_SIZE - sizeof(RawLockQueue*)
+                                    - 2 * sizeof(uint32_t) - sizeof(bool)];
+};
+
 /**
 * \brief Lock table implementation class.
 * \ingroup SSMLOCK
 * \details
 * This is the gut of lock management in Foster B-trees.
 * Most of the implementation has been moved to lock_raw.h/cpp.
+* The lock queues are split into \e sm_locktable_partitions partitions (RawLockPartition).
 */
 class lock_core_m {
 public:
@@ -38,6 +69,20 @@ public:
 
     lil_global_table*   get_lil_global_table() { return _lil_global_table; }
 
+    /** Number of lock queues in all partitions. Grows with \e sm_locktable_grow. */
+    size_t      queue_count() const;
+
+    /**
+     * Called by RawLockQueue::wait_for() before it sleeps, and now and then while it
+     * spins: lets the thread leave the partition it is in so that the partition can
+     * grow in the meantime.
+     * @return whether the thread left a partition and must call
+     * reenter_partition_after_wait() after the sleep
+     */
+    static bool leave_partition_for_wait();
+    /** Re-enters the partition left by leave_partition_for_wait(). */
+    static void reenter_partition_after_wait();
+
 public:
     /** @copydoc RawLockQueue::acquire() */
     w_error_codes  acquire_lock(RawXct* xd, uint32_t hash, const okvl_mode& mode,
@@ -56,15 +101,34 @@ public:
     RawXct*     allocate_xct();
     void        deallocate_xct(RawXct* xct);
 private:
-    uint32_t        _table_bucket(uint32_t id) const { return id % _htabsz; }
+    /** Returns the partition of the given lock hash. */
+    RawLockPartition&   _partition(uint32_t hash) const;
+    /** Returns the queue of the given lock hash. @pre the thread entered the partition */
+    static RawLockQueue* _queue(const RawLockPartition& partition, uint32_t partition_bits,
+                                uint32_t hash);
+
+    /** Starts a request on the queues of the partition; no-op without sm_locktable_grow. */
+    void                _enter(RawLockPartition& partition) const;
+    /** Ends a request started by _enter(). */
+    void                _leave(RawLockPartition& partition) const;
+    /**
+     * Doubles the queue array of the partition if it still has 2^bits queues and
+     * its current users leave soon enough.
+     * @return whether this thread grew the partition
+     */
+    bool                _grow(RawLockPartition& partition, uint32_t bits);
 
     GcPoolForest<RawLock>*      _lock_pool;
     GcPoolForest<RawXct>*       _xct_pool;
     RawLockCleanerFunctor*      _raw_lock_cleaner_functor;
     RawLockBackgroundThread*    _raw_lock_cleaner;
 
-    RawLockQueue*       _htab;
-    uint32_t            _htabsz;
+    /** The lock table, 2^_partition_bits partitions. */
+    RawLockPartition*   _partitions;
+    /** Log2 of the number of partitions. \e sm_locktable_partitions. */
+    uint32_t            _partition_bits;
+    /** Whether crowded partitions double their queues. \e sm_locktable_grow. */
+    bool                _grow_enabled;
 
     /** Global lock table for Light-weight Intent Lock. */
     lil_global_table*  _lil_global_table;
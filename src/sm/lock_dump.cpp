@@ -23,12 +23,16 @@ lock_core_m::assert_empty() const
 {
     int found_request=0;
 
-    for (uint h = 0; h < _htabsz; h++)   {
-        // empty queue is fine. just check leftover requests
-        for (MarkablePointer<RawLock> lock = _htab[h].head.next;
-             !lock.is_null(); lock = lock->next) {
-            ++found_request;
-            DBGOUT1("leftover lock request(h=" << h << "):" << *lock.get_pointer());
+    for (uint p = 0; p < (1U << _partition_bits); p++) {
+        const RawLockQueue* queues = _partitions[p].queues;
+        for (uint h = 0; h < (1U << _partitions[p].bits); h++)   {
+            // empty queue is fine. just check leftover requests
+            for (MarkablePointer<RawLock> lock = queues[h].head.next;
+                 !lock.is_null(); lock = lock->next) {
+                ++found_request;
+                DBGOUT1("leftover lock request(p=" << p << ",h=" << h << "):"
+                    << *lock.get_pointer());
+            }
         }
     }
     w_assert1(found_request == 0);
@@ -38,12 +42,15 @@ lock_core_m::assert_empty() const
 void lock_core_m::dump(ostream &o) {
     o << " WARNING: Dumping lock table. This method is thread-unsafe!!" << std::endl;
     lintel::atomic_signal_fence(lintel::memory_order_acquire); // memory barrier
-    for (uint h = 0; h < _htabsz; h++)  {
-        // empty queue is fine. just check leftover requests
-        for (MarkablePointer<RawLock> lock = _htab[h].head.next;
-             !lock.is_null(); lock = lock->next) {
-            o << "lock request(h=" << h << "):" << *lock.get_pointer()
-            << std::endl;
+    for (uint p = 0; p < (1U << _partition_bits); p++) {
+        const RawLockQueue* queues = _partitions[p].queues;
+        for (uint h = 0; h < (1U << _partitions[p].bits); h++)  {
+            // empty queue is fine. just check leftover requests
+            for (MarkablePointer<RawLock> lock = queues[h].head.next;
+                 !lock.is_null(); lock = lock->next) {
+                o << "lock request(p=" << p << ",h=" << h << "):" << *lock.get_pointer()
+                << std::endl;
+            }
         }
     }
     o << "--end of lock table--" << std::endl;
@@ -2,6 +2,7 @@
  * (c) Copyright 2014, Hewlett-Packard Development Company, LP
  */
 #include "lock_raw.h"
+#include "lock_core.h"
 #include <time.h>
 #include <set>
 #include "w_okvl_inl.h"
@@ -128,7 +129,8 @@ w_error_codes RawLockQueue::acquire(RawXct* xct, uint32_t hash, const okvl_mode&
     RawLock* new_lock = xct->allocate_lock(hash, mode, RawLock::ACTIVE); // A1-A2
     DBGOUT4(<< "RawLockQueue::acquire() before:" << *this << "adding:" << *new_lock);
     atomic_lock_insert(new_lock); // A3 . BTW this implies a barrier in x86
-    Compatibility compatibility = check_compatiblity(new_lock); // A4-A5
+    Compatibility compatibility = check_compatiblity(new_lock,
+        &xct->queue_walked, &xct->queue_collisions); // A4-A5
 
     if (check && (compatibility.deadlocked || !compatibility.can_be_granted))
     {
@@ -225,27 +227,29 @@ w_error_codes RawLockQueue::complete_acquire(RawLock** lock, bool wait, bool acq
     if (wait && (*lock)->state == RawLock::WAITING) {
         w_error_codes err_code = wait_for(*lock, timeout_in_ms);
         if (err_code != w_error_ok) {
-            release(*lock, lsn_t::null);
+            (*lock)->queue->release(*lock, lsn_t::null);
             *lock = NULL;
             return err_code;
         }
     }
 
-    // okay, we are granted.
+    // okay, we are granted. the lock might have moved to another queue while we slept.
+    RawLockQueue* queue = (*lock)->queue;
     atomic_synchronize();
     w_assert1((*lock)->state == RawLock::ACTIVE);
     w_assert1(xct->blocker == NULL);
-    xct->update_read_watermark(x_lock_tag);
+    xct->update_read_watermark(queue->x_lock_tag);
     if (!acquire) {
         // immediately release the lock
-        release(*lock, lsn_t::null);
+        queue->release(*lock, lsn_t::null);
         *lock = NULL;
     }
-    DBGOUT4(<<"RawLockQueue::acquire() after:" << *this);
+    DBGOUT4(<<"RawLockQueue::acquire() after:" << *queue);
     return w_error_ok;
 }
 
 void RawLockQueue::atomic_lock_insert(RawLock* new_lock) {
+    new_lock->queue = this;
     // atomic CAS to append the new lock.
     // the protocol below is usual lock-free list's algortihm, not the tail swap in [JUNG13]
     MarkablePointer<RawLock> new_ptr(new_lock, false);
@@ -260,7 +264,8 @@ void RawLockQueue::atomic_lock_insert(RawLock* new_lock) {
     }
 }
 
-RawLockQueue::Compatibility RawLockQueue::check_compatiblity(RawLock *lock) const {
+RawLockQueue::Compatibility RawLockQueue::check_compatiblity(RawLock *lock,
+        uint64_t* walked, uint64_t* collisions) const {
     if (head.next.get_pointer() == lock) {
         // fast path. If it's the first, because followers respect predecessors, granted.
         // also, remember that no one can newly enter between I and head because
@@ -283,6 +288,12 @@ RawLockQueue::Compatibility RawLockQueue::check_compatiblity(RawLock *lock) cons
                 // so, we never have to check locks after myself.
                 break;
             }
+            if (walked != NULL) {
+                ++*walked;
+                if (collisions != NULL && pointer->hash != hash) {
+                    ++*collisions;
+                }
+            }
             if (pointer->state == RawLock::OBSOLETE) {
                 continue;
             }
@@ -335,6 +346,10 @@ RawLockQueue::Compatibility RawLockQueue::check_compatiblity(RawLock *lock) cons
 bool RawLockQueue::peek_compatiblity(RawXct* xct, uint32_t hash, const okvl_mode &mode) const {
     for (MarkablePointer<RawLock> lock = head.next; !lock.is_null();) {
         RawLock *pointer = lock.get_pointer();
+        ++xct->queue_walked;
+        if (pointer->hash != hash) {
+            ++xct->queue_collisions;
+        }
         if (pointer->state == RawLock::ACTIVE && pointer->hash == hash
             && pointer->owner_xct != xct) {
             if (!mode.is_compatible_grant(pointer->mode)) {
@@ -374,8 +389,13 @@ w_error_codes RawLockQueue::wait_for(RawLock* new_lock, int32_t timeout_in_ms) {
         while (true) { // pure spin implementation. much more efficient.
             if (((++spin_count) & 0xFFF) == 0) { // not too frequent barriers
                 atomic_synchronize();
+                // let the lock table partition grow if it wants to. it may move
+                // new_lock to another queue, hence new_lock->queue below instead of this.
+                if (lock_core_m::leave_partition_for_wait()) {
+                    lock_core_m::reenter_partition_after_wait();
+                }
             }
-            compatibility = check_compatiblity(new_lock);
+            compatibility = new_lock->queue->check_compatiblity(new_lock);
             if (compatibility.can_be_granted) {
                 xct->blocker = NULL;
                 new_lock->state = RawLock::ACTIVE;
@@ -383,7 +403,7 @@ w_error_codes RawLockQueue::wait_for(RawLock* new_lock, int32_t timeout_in_ms) {
                 return w_error_ok;
             } else if (compatibility.deadlocked) {
                 DBGOUT1(<<"Deadlock found by myself! lock=" << *new_lock << ", queue="
-                    << *this << ", xct=" << *xct);
+                    << *new_lock->queue << ", xct=" << *xct);
                 xct->blocker = NULL;
                 atomic_synchronize();
                 return eDEADLOCK;
@@ -405,8 +425,14 @@ w_error_codes RawLockQueue::wait_for(RawLock* new_lock, int32_t timeout_in_ms) {
             }
             struct timespec ts;
             sthread_t::timeout_to_timespec(INTERVAL, ts);
+            // let the lock table partition grow while we sleep. it may move new_lock
+            // to another queue, hence new_lock->queue below instead of this.
+            bool left = lock_core_m::leave_partition_for_wait();
             int ret = ::pthread_cond_timedwait(&xct->lock_wait_cond,
                                                 &xct->lock_wait_mutex, &ts); // A22
+            if (left) {
+                lock_core_m::reenter_partition_after_wait();
+            }
             atomic_synchronize();
             if (ret != 0 && ret != ETIMEDOUT) {
                 // unexpected error
@@ -423,7 +449,7 @@ w_error_codes RawLockQueue::wait_for(RawLock* new_lock, int32_t timeout_in_ms) {
             atomic_synchronize();
             if (xct->state == RawXct::WAITING) {
                 DBGOUT1(<<"Still waiting. lock=" << *new_lock);
-                compatibility = check_compatiblity(new_lock);
+                compatibility = new_lock->queue->check_compatiblity(new_lock);
                 if (compatibility.can_be_granted) {
                     // This shouldn't happen, but as a safety net
                     DBGOUT0(<<"Umm? Now can be granted. No one got us aware of this.");
@@ -819,6 +845,9 @@ void RawXct::init(gc_thread_id thread_id_arg,
     read_watermark = lsn_t::null;
     private_first = NULL;
     private_last = NULL;
+    queue_walked = 0;
+    queue_collisions = 0;
+    table_grows = 0;
 #ifndef PURE_SPIN_RAWLOCK
     ::pthread_mutex_init(&lock_wait_mutex, NULL);
     ::pthread_cond_init(&lock_wait_cond, NULL);
@@ -875,6 +904,7 @@ RawLock* RawXct::allocate_lock(uint32_t hash, const okvl_mode& mode, RawLock::Lo
     lock->mode = mode;
     lock->owner_xct = this;
     lock->next = NULL_RAW_LOCK;
+    lock->queue = NULL;
     lock->state = state;
 
     w_assert4(is_private_list_consistent(this));
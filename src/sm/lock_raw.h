@@ -148,6 +148,12 @@ struct RawLock : public GcPoolEntry {
     /** Constitutes a singly-linked list in RawLockQueue. */
     MarkablePointer<RawLock>    next;
 
+    /**
+     * The queue this lock is in. Set when the lock is inserted, and changed when a
+     * growing lock table partition moves the lock to a new queue (see lock_core_m).
+     */
+    RawLockQueue*               queue;
+
     /** owning xct. */
     RawXct*                     owner_xct;
 
@@ -295,8 +301,12 @@ struct RawLockQueue {
     /**
      * Checks if the given lock can be granted.
      * Called from acquire() after atomic_lock_insert() and release().
+     * @param[out] walked if given, incremented by the number of preceding locks checked
+     * @param[out] collisions if given, incremented by the number of preceding locks of
+     * other hashes, which only share this queue
      */
-    Compatibility check_compatiblity(RawLock *lock) const;
+    Compatibility check_compatiblity(RawLock *lock, uint64_t* walked = NULL,
+                                     uint64_t* collisions = NULL) const;
 
     /**
      * \brief Used for check_only=true case. Many things are much simpler and faster.
@@ -311,6 +321,8 @@ struct RawLockQueue {
     /**
      * Sleeps until the lock is granted.
      * Called from acquire() after check_compatiblity() if the lock was not immediately granted.
+     * While waiting, the lock table partition may grow and move new_lock to another queue,
+     * so this method then uses new_lock->queue rather than this queue.
      */
     w_error_codes wait_for(RawLock *new_lock, int32_t timeout_in_ms);
 
@@ -550,6 +562,19 @@ struct RawXct : GcPoolEntry {
      * NULL if zero or one entries.
      */
     RawLock*                    private_last;
+
+    /**
+     * Locks of this transaction's requests checked in lock queues since lock_m last
+     * collected the statistics (\e lock_queue_walk_cnt).
+     */
+    uint64_t                    queue_walked;
+    /**
+     * Of queue_walked, the locks of other hashes that only share the lock queue
+     * (\e lock_queue_collision_cnt).
+     */
+    uint64_t                    queue_collisions;
+    /** Lock table partitions this transaction doubled (\e lock_table_grow_cnt). */
+    uint32_t                    table_grows;
 };
 std::ostream& operator<<(std::ostream& o, const RawXct& v);
 
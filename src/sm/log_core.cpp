@@ -865,6 +865,61 @@ rc_t log_core::insert(logrec_t &rec, lsn_t* rlsn)
     return RCOK;
 }
 
+rc_t log_core::_reserve(smsize_t size, CArraySlot*& info, long& pos,
+        void*& buf)
+{
+    w_assert1(size <= sizeof(logrec_t));
+    W_DO(_join_carray(info, pos, size));
+    w_assert1(info);
+
+    // same offset computation as in _copy_raw
+    long offset = pos + info->start_pos;
+    if (offset >= _segsize) {
+        offset -= _segsize;
+    }
+
+    if (!info->error && offset + (long) size <= _segsize) {
+        buf = _buf + offset;
+        INC_TSTAT(log_inserts_in_place);
+    }
+    else {
+        // record wraps around the end of the buffer (or we will not write it
+        // at all) -- build it somewhere else
+        buf = new logrec_t;
+    }
+    return RCOK;
+}
+
+rc_t log_core::_release_reserved(smsize_t size, CArraySlot* info, long pos,
+        logrec_t* rec, lsn_t* rlsn)
+{
+    w_assert1(rec->length() == size);
+    bool in_place = reinterpret_cast<char*>(rec) >= _buf
+        && reinterpret_cast<char*>(rec) < _buf + _segsize;
+
+    lsn_t rec_lsn;
+    if (!info->error) {
+        if (in_place) {
+            rec_lsn = info->lsn + pos;
+            rec->set_lsn_ck(rec_lsn);
+        }
+        else {
+            rec_lsn = _copy_to_buffer(*rec, pos, size, info);
+        }
+    }
+    if (!in_place) {
+        delete rec;
+    }
+
+    W_DO(_leave_carray(info, size));
+
+    if(rlsn) {
+        *rlsn = rec_lsn;
+    }
+    ADD_TSTAT(log_bytes_generated,size);
+    return RCOK;
+}
+
 void log_core::_copy_raw(CArraySlot* info, long& pos, const char* data,
         size_t size)
 {
@@ -964,6 +1019,47 @@ rc_t log_core::flush(const lsn_t &to_lsn, bool block, bool signal, bool *ret_flu
     return RCOK;
 }
 
+void log_core::flush_async(const lsn_t &lsn, std::function<void()> on_durable)
+{
+    {
+        // The daemon updates _durable_lsn before taking this lock in
+        // notify_durable, so a callback registered after that check cannot
+        // be missed.
+        CRITICAL_SECTION(cs, _durable_callbacks_lock);
+        if (lsn >= *&_durable_lsn) {
+            _durable_callbacks.insert(std::make_pair(lsn, on_durable));
+            INC_TSTAT(log_durable_callbacks);
+            on_durable = nullptr;
+        }
+    }
+
+    if (on_durable) {
+        INC_TSTAT(log_dup_sync_cnt);
+        on_durable();
+        return;
+    }
+    W_COERCE(flush(lsn, false, true));
+}
+
+void log_core::notify_durable()
+{
+    std::vector<std::function<void()> > ready;
+    {
+        CRITICAL_SECTION(cs, _durable_callbacks_lock);
+        lsn_t durable = *&_durable_lsn;
+        auto it = _durable_callbacks.begin();
+        while (it != _durable_callbacks.end() && it->first < durable) {
+            ready.push_back(std::move(it->second));
+            it = _durable_callbacks.erase(it);
+        }
+    }
+
+    // callbacks may register new ones, so they run without the lock
+    for (auto& f : ready) {
+        f();
+    }
+}
+
 /**\brief Log-flush daemon driver.
  * \details
  * This method handles the wait/block of the daemon thread,
@@ -1018,6 +1114,10 @@ void log_core::flush_daemon()
         // success=true if we wrote anything
         success = (lsn != last_completed_flush_lsn);
         last_completed_flush_lsn = lsn;
+
+        if (success) {
+            notify_durable();
+        }
     }
 
     // make sure the buffer is completely empty before leaving...
@@ -1025,6 +1125,7 @@ void log_core::flush_daemon()
         (lsn=flush_daemon_work(last_completed_flush_lsn)) !=
                 last_completed_flush_lsn;
         last_completed_flush_lsn=lsn) ;
+    notify_durable();
 }
 
 /**\brief Flush unflushed-portion of log buffer.
@@ -63,6 +63,8 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
 
 #include <AtomicCounter.hpp>
 #include <vector> // only for _collect_single_page_recovery_logs()
+#include <map>
+#include <functional>
 
 // in sm_base for the purpose of log callback function argument type
 class      partition_t ; // forward
@@ -94,7 +96,38 @@ public:
     static const std::string IMPL_NAME;
 
     rc_t            insert(logrec_t &r, lsn_t* l = NULL);
+
+    /**
+     * Reserve-then-fill insertion: reserves size bytes in the log buffer and
+     * calls fill(void* buf) to construct the log record directly in them,
+     * saving the separate logrec_t buffer and the copy made by
+     * insert(logrec_t&). The record built by fill must be exactly size bytes
+     * long (see logrec_t::length_for). If the reserved space wraps around
+     * the end of the log buffer, the record is built in a temporary buffer
+     * and copied as usual.
+     */
+    template <typename F>
+    rc_t            insert_direct(smsize_t size, F fill, lsn_t* l = NULL)
+    {
+        CArraySlot* info = NULL;
+        long pos = 0;
+        void* buf = NULL;
+        W_DO(_reserve(size, info, pos, buf));
+        fill(buf);
+        return _release_reserved(size, info, pos,
+                reinterpret_cast<logrec_t*>(buf), l);
+    }
     rc_t            flush(const lsn_t &lsn, bool block=true, bool signal=true, bool *ret_flushed=NULL);
+
+    /**
+     * Non-blocking counterpart of flush(lsn): kicks the flush daemon and
+     * calls on_durable once all log records up to lsn are durable. If they
+     * already are, on_durable is called right away by the caller; otherwise
+     * it is called by the flush daemon thread, in LSN order, right after the
+     * flush that made lsn durable. The callback therefore must be short and
+     * must not wait for the log.
+     */
+    void            flush_async(const lsn_t &lsn, std::function<void()> on_durable);
     rc_t    flush_all(bool block=true) {
                           return flush(curr_lsn().advance(-1), block); }
     rc_t            compensate(const lsn_t &orig_lsn, const lsn_t& undo_lsn);
@@ -118,6 +151,9 @@ public:
 
     lsn_t           flush_daemon_work(lsn_t old_mark);
 
+    /** Calls the flush_async callbacks whose LSN became durable */
+    void            notify_durable();
+
     rc_t load_fetch_buffers();
     void discard_fetch_buffers();
 
@@ -196,6 +232,11 @@ protected:
     rc_t _join_carray(CArraySlot*& info, long& pos, int32_t size);
     rc_t _leave_carray(CArraySlot* info, int32_t size);
     void _copy_raw(CArraySlot* info, long& pos, const char* data, size_t size);
+    /** Joins the carray for insert_direct() and picks the buffer to fill */
+    rc_t _reserve(smsize_t size, CArraySlot*& info, long& pos, void*& buf);
+    /** Stamps the LSN on the record built in buf and leaves the carray */
+    rc_t _release_reserved(smsize_t size, CArraySlot* info, long pos,
+            logrec_t* rec, lsn_t* rlsn);
     /** @}*/
 
     log_storage*    _storage;
@@ -278,6 +319,11 @@ protected:
 
     bool _waiting_for_flush; // protected by log_m::_wait_flush_lock
 
+    /** Callbacks of flush_async, keyed by the LSN they wait for */
+    std::multimap<lsn_t, std::function<void()> > _durable_callbacks;
+    /** Protects _durable_callbacks */
+    tatas_lock           _durable_callbacks_lock;
+
     sthread_t*           _flush_daemon;
     /// @todo both of the below should become std::atomic_flag's at some time
     lintel::Atomic<bool> _shutting_down;
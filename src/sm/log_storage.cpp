@@ -87,14 +87,29 @@ log_storage::log_storage(const sm_options& options)
     }
     _logpath = logdir;
 
+    // Partitions are placed round-robin on the log directory and the
+    // additional directories given in sm_log_stripe_dirs (comma-separated),
+    // so that consecutive partitions are written and read on different
+    // devices. Checkpoint files stay in the log directory.
+    _stripe_paths.push_back(_logpath);
+    std::stringstream stripes(
+            options.get_string_option("sm_log_stripe_dirs", ""));
+    std::string dir;
+    while (std::getline(stripes, dir, ',')) {
+        if (!dir.empty()) { _stripe_paths.push_back(dir); }
+    }
+
     bool reformat = options.get_bool_option("sm_format", false);
 
-    if (!fs::exists(_logpath)) {
-        if (reformat) {
-            fs::create_directories(_logpath);
-        } else {
-            cerr << "Error: could not open the log directory " << logdir <<endl;
-            W_COERCE(RC(eOS));
+    for (auto& path : _stripe_paths) {
+        if (!fs::exists(path)) {
+            if (reformat) {
+                fs::create_directories(path);
+            } else {
+                cerr << "Error: could not open the log directory "
+                    << path.string() << endl;
+                W_COERCE(RC(eOS));
+            }
         }
     }
 
@@ -112,42 +127,49 @@ log_storage::log_storage(const sm_options& options)
 
     partition_number_t  last_partition = 1;
 
-    fs::directory_iterator it(_logpath), eod;
     boost::regex log_rx(log_regex, boost::regex::basic);
     boost::regex chkpt_rx(chkpt_regex, boost::regex::basic);
-    for (; it != eod; it++) {
-        fs::path fpath = it->path();
-        string fname = fpath.filename().string();
-
-        if (boost::regex_match(fname, log_rx)) {
-            if (reformat) {
-                fs::remove(fpath);
-                continue;
+    for (size_t d = 0; d < _stripe_paths.size(); d++) {
+        fs::directory_iterator it(_stripe_paths[d]), eod;
+        for (; it != eod; it++) {
+            fs::path fpath = it->path();
+            string fname = fpath.filename().string();
+
+            if (boost::regex_match(fname, log_rx)) {
+                if (reformat) {
+                    fs::remove(fpath);
+                    continue;
+                }
+
+                long pnum = std::stoi(fname.substr(log_prefix.length()));
+                if (make_log_path(pnum) != fpath) {
+                    cerr << "log_storage: partition file " << fpath.string()
+                        << " does not match sm_log_stripe_dirs" << endl;
+                    W_FATAL(eCRASH);
+                }
+                _partitions[pnum] = make_shared<partition_t>(this, pnum);
+
+                if (pnum >= last_partition) {
+                    last_partition = pnum;
+                }
             }
-
-            long pnum = std::stoi(fname.substr(log_prefix.length()));
-            _partitions[pnum] = make_shared<partition_t>(this, pnum);
-
-            if (pnum >= last_partition) {
-                last_partition = pnum;
+            else if (d == 0 && boost::regex_match(fname, chkpt_rx)) {
+                if (reformat) {
+                    fs::remove(fpath);
+                    continue;
+                }
+
+                lsn_t lsn;
+                stringstream ss(fname.substr(chkpt_prefix.length()));
+                ss >> lsn;
+                _checkpoints.push_back(lsn);
             }
-        }
-        else if (boost::regex_match(fname, chkpt_rx)) {
-            if (reformat) {
-                fs::remove(fpath);
-                continue;
+            else {
+                cerr << "log_storage: cannot parse filename " << fname << endl;
+                W_FATAL(fcINTERNAL);
             }
 
-            lsn_t lsn;
-            stringstream ss(fname.substr(chkpt_prefix.length()));
-            ss >> lsn;
-            _checkpoints.push_back(lsn);
         }
-        else {
-            cerr << "log_storage: cannot parse filename " << fname << endl;
-            W_FATAL(fcINTERNAL);
-        }
-
     }
 
     auto p = get_partition(last_partition);
@@ -433,11 +455,19 @@ unsigned log_storage::delete_old_partitions(bool chkpt_only, partition_number_t
             else { it++; }
         }
 
-        if (_checkpoints.size() > 1) {
-            old_chkpts = _checkpoints;
-            _checkpoints.clear();
-            _checkpoints.push_back(old_chkpts.back());
-            old_chkpts.pop_back();
+        // Keep the files needed to read the latest checkpoint, which may be
+        // a delta of the previous ones
+        lsn_t chain_lsn = smlevel_0::chkpt ?
+            smlevel_0::chkpt->get_chain_lsn() : lsn_t::max;
+        if (_checkpoints.size() > 1 && !chain_lsn.is_null()) {
+            vector<lsn_t> kept;
+            for (size_t i = 0; i < _checkpoints.size(); i++) {
+                if (_checkpoints[i] >= chain_lsn || i + 1 == _checkpoints.size()) {
+                    kept.push_back(_checkpoints[i]);
+                }
+                else { old_chkpts.push_back(_checkpoints[i]); }
+            }
+            _checkpoints = kept;
         }
     }
 
@@ -475,7 +505,8 @@ string log_storage::make_log_name(partition_number_t pnum) const
 
 fs::path log_storage::make_log_path(partition_number_t pnum) const
 {
-    return _logpath / fs::path(log_prefix + to_string(pnum));
+    const fs::path& dir = _stripe_paths[pnum % _stripe_paths.size()];
+    return dir / fs::path(log_prefix + to_string(pnum));
 }
 
 fs::path log_storage::make_chkpt_path(lsn_t lsn) const
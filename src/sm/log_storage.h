@@ -114,6 +114,10 @@ private:
     fs::path _logpath;
     fileoff_t _partition_size;
 
+    /// Directories on which partitions are placed round-robin (see
+    /// make_log_path); the first one is _logpath
+    vector<fs::path> _stripe_paths;
+
     partition_map_t _partitions;
     shared_ptr<partition_t> _curr_partition;
 
@@ -12,6 +12,7 @@
 #include <sstream>
 #include <sys/stat.h>
 #include <boost/regex.hpp>
+#include <thread>
 
 #include "stopwatch.h"
 
@@ -355,12 +356,14 @@ LogArchiver::LogArchiver(const sm_options& options)
             "sm_archiver_read_whole_blocks", DFT_READ_WHOLE_BLOCKS);
     slowLogGracePeriod = options.get_int_option(
             "sm_archiver_slow_log_grace_period", DFT_GRACE_PERIOD);
+    size_t sortThreads = options.get_int_option(
+            "sm_archiver_sort_threads", DFT_SORT_THREADS);
 
     directory = new ArchiveDirectory(options);
     nextActLSN = directory->getStartLSN();
 
     consumer = new LogConsumer(directory->getStartLSN(), blockSize);
-    heap = new ArchiverHeap(workspaceSize);
+    heap = new ArchiverHeap(workspaceSize, sortThreads);
     blkAssemb = new BlockAssembly(directory);
 }
 
@@ -373,6 +376,7 @@ void LogArchiver::initLogScanner(LogScanner* logScanner)
     logScanner->setIgnore(logrec_t::t_chkpt_xct_tab);
     logScanner->setIgnore(logrec_t::t_chkpt_xct_lock);
     logScanner->setIgnore(logrec_t::t_chkpt_backup_tab);
+    logScanner->setIgnore(logrec_t::t_add_backup);
     logScanner->setIgnore(logrec_t::t_chkpt_end);
     logScanner->setIgnore(logrec_t::t_chkpt_restore_tab);
     logScanner->setIgnore(logrec_t::t_xct_abort);
@@ -1061,6 +1065,10 @@ bool LogArchiver::BlockAssembly::add(logrec_t* lr)
         maxLSNLength = lr->length();
     }
 
+    if (archIndex && (blockPIDs.empty() || blockPIDs.back() != lr->pid())) {
+        blockPIDs.push_back(lr->pid());
+    }
+
     if (bucketSize > 0 && lr->pid() / bucketSize >= nextBucket) {
         PageID shpid = (lr->pid() / bucketSize) * bucketSize;
         buckets.push_back(
@@ -1087,6 +1095,8 @@ void LogArchiver::BlockAssembly::finish()
         else {
             archIndex->newBlock(buckets);
         }
+        archIndex->addPIDs(blockPIDs);
+        blockPIDs.clear();
     }
     firstPID = 0;
 
@@ -1379,10 +1389,13 @@ void LogArchiver::ArchiveScanner::RunMerger::dumpHeap(ostream& out)
     heap.Print(out);
 }
 
-LogArchiver::ArchiverHeap::ArchiverHeap(size_t workspaceSize)
-    : currentRun(0), filledFirst(false), w_heap(heapCmp)
+LogArchiver::ArchiverHeap::ArchiverHeap(size_t workspaceSize,
+        size_t sortThreads)
+    : currentRun(0), filledFirst(false), sortThreads(sortThreads),
+    w_heap(heapCmp), sortedPos(0)
 {
     workspace = new fixed_lists_mem_t(workspaceSize);
+    if (this->sortThreads == 0) { this->sortThreads = 1; }
 }
 
 LogArchiver::ArchiverHeap::~ArchiverHeap()
@@ -1412,6 +1425,10 @@ slot_t LogArchiver::ArchiverHeap::allocate(size_t length)
 
 bool LogArchiver::ArchiverHeap::push(logrec_t* lr, bool duplicate)
 {
+    if (sortThreads > 1) {
+        return pushUnsorted(lr, duplicate);
+    }
+
     slot_t dest = allocate(lr->length());
     if (!dest.address) {
         DBGTHRD(<< "heap full for logrec: " << lr->type_str()
@@ -1473,6 +1490,18 @@ bool LogArchiver::ArchiverHeap::push(logrec_t* lr, bool duplicate)
 
 void LogArchiver::ArchiverHeap::pop()
 {
+    if (sortThreads > 1) {
+        ensureSorted();
+        w_assert1(sortedPos < sorted.size());
+        W_COERCE(workspace->free(sorted[sortedPos].slot));
+        sortedPos++;
+        if (sortedPos == sorted.size()) {
+            sorted.clear();
+            sortedPos = 0;
+        }
+        return;
+    }
+
     // DBGTHRD(<< "Selecting for output: "
     //         << *((logrec_t*) w_heap.First().slot.address));
 
@@ -1488,9 +1517,148 @@ void LogArchiver::ArchiverHeap::pop()
 
 logrec_t* LogArchiver::ArchiverHeap::top()
 {
+    if (sortThreads > 1) {
+        ensureSorted();
+        return (logrec_t*) sorted[sortedPos].slot.address;
+    }
     return (logrec_t*) w_heap.First().slot.address;
 }
 
+run_number_t LogArchiver::ArchiverHeap::topRun()
+{
+    if (sortThreads > 1) {
+        ensureSorted();
+        return sorted[sortedPos].run;
+    }
+    return w_heap.First().run;
+}
+
+size_t LogArchiver::ArchiverHeap::size()
+{
+    if (sortThreads > 1) {
+        return sorted.size() - sortedPos + pending.size();
+    }
+    return w_heap.NumElements();
+}
+
+/*
+ * Load step of parallel run generation: log records are copied into the
+ * workspace and appended to the current (unsorted) run. A push fails when the
+ * workspace is full, in which case the caller invokes selection, which sorts
+ * the pending run (if the previous one was fully consumed) and frees space by
+ * consuming it.
+ */
+bool LogArchiver::ArchiverHeap::pushUnsorted(logrec_t* lr, bool duplicate)
+{
+    slot_t dest(NULL, 0);
+    W_COERCE(workspace->allocate(lr->length(), dest));
+    if (!dest.address) {
+        return false;
+    }
+    memcpy(dest.address, lr, lr->length());
+    pending.push_back(HeapEntry(0, lr->pid(), lr->lsn(), dest));
+
+    // Multi-page log records are replicated as in push() above
+    if (duplicate) {
+        lr->set_pid(lr->pid2());
+        lr->set_page_prev_lsn(lr->page2_prev_lsn());
+        if (!pushUnsorted(lr, false)) {
+            memcpy(lr, dest.address, lr->length());
+            pending.pop_back();
+            W_COERCE(workspace->free(dest));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void LogArchiver::ArchiverHeap::ensureSorted()
+{
+    if (sortedPos == sorted.size() && !pending.empty()) {
+        sortPending();
+    }
+}
+
+/*
+ * Sort step of parallel run generation. The pending run is partitioned into
+ * disjoint page ID ranges, using splitters taken from a sample of its page
+ * IDs, and each partition is sorted by (page id, lsn) on its own thread.
+ * Since partitions are disjoint and ordered, their concatenation is the
+ * sorted run, and no merge step is required.
+ */
+void LogArchiver::ArchiverHeap::sortPending()
+{
+    w_assert1(sorted.empty());
+
+    size_t count = pending.size();
+    // Avoid spawning threads for tiny runs (e.g., on flush requests)
+    const size_t minPartitionSize = 1024;
+    size_t parts = std::min(sortThreads,
+            std::max<size_t>(1, count / minPartitionSize));
+
+    std::vector<PageID> splitters;
+    if (parts > 1) {
+        const size_t samplesPerPart = 64;
+        size_t sampleCount = std::min(count, parts * samplesPerPart);
+        std::vector<PageID> sample;
+        sample.reserve(sampleCount);
+        for (size_t i = 0; i < sampleCount; i++) {
+            sample.push_back(pending[i * count / sampleCount].pid);
+        }
+        std::sort(sample.begin(), sample.end());
+        for (size_t p = 1; p < parts; p++) {
+            splitters.push_back(sample[p * sampleCount / parts]);
+        }
+    }
+
+    // Partition i gets page IDs in [splitters[i-1], splitters[i])
+    auto partitionOf = [&splitters](PageID pid) {
+        return std::upper_bound(splitters.begin(), splitters.end(), pid)
+            - splitters.begin();
+    };
+
+    std::vector<size_t> bounds(parts + 1, 0);
+    for (size_t i = 0; i < count; i++) {
+        bounds[partitionOf(pending[i].pid) + 1]++;
+    }
+    for (size_t p = 1; p <= parts; p++) {
+        bounds[p] += bounds[p-1];
+    }
+
+    sorted.resize(count);
+    std::vector<size_t> next(bounds.begin(), bounds.end() - 1);
+    for (size_t i = 0; i < count; i++) {
+        HeapEntry& e = pending[i];
+        e.run = currentRun;
+        sorted[next[partitionOf(e.pid)]++] = e;
+    }
+    pending.clear();
+    // Like in replacement selection, the first run is number zero, which is
+    // what the writer thread expects
+    currentRun++;
+
+    auto sortPartition = [this, &bounds](size_t p) {
+        std::sort(sorted.begin() + bounds[p], sorted.begin() + bounds[p+1],
+                [this](const HeapEntry& a, const HeapEntry& b) {
+                    return heapCmp.gt(a, b);
+                });
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t p = 1; p < parts; p++) {
+        threads.emplace_back(sortPartition, p);
+    }
+    // The archiver thread sorts the first partition itself
+    sortPartition(0);
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    sortedPos = 0;
+    INC_TSTAT(la_parallel_sorts);
+}
+
 // gt is actually a less than function, to produce ascending order
 bool LogArchiver::ArchiverHeap::Cmp::gt(const HeapEntry& a,
         const HeapEntry& b) const
@@ -2069,6 +2237,20 @@ void LogArchiver::ArchiveIndex::newBlock(const vector<pair<PageID, size_t> >&
     }
 }
 
+void LogArchiver::ArchiveIndex::addPIDs(const vector<PageID>& pids)
+{
+    CRITICAL_SECTION(cs, mutex);
+    w_assert1(runs.size() > 0);
+
+    std::vector<PageID>& runPIDs = runs.back().pids;
+    for (size_t i = 0; i < pids.size(); i++) {
+        // log records are sorted, so duplicates only occur across blocks
+        if (runPIDs.empty() || runPIDs.back() != pids[i]) {
+            runPIDs.push_back(pids[i]);
+        }
+    }
+}
+
 rc_t LogArchiver::ArchiveIndex::finishRun(lsn_t first, lsn_t last, int fd,
         fileoff_t offset)
 {
@@ -2083,6 +2265,11 @@ rc_t LogArchiver::ArchiveIndex::finishRun(lsn_t first, lsn_t last, int fd,
 
         runs[lastFinished].firstLSN = first;
         runs[lastFinished].lastLSN = last;
+
+        RunInfo& run = runs[lastFinished];
+        run.filter.build(run.pids, bucketSize);
+        std::vector<PageID>().swap(run.pids);
+
         W_DO(serializeRunInfo(runs[lastFinished], fd, offset));
     }
 
@@ -2128,6 +2315,36 @@ rc_t LogArchiver::ArchiveIndex::serializeRunInfo(RunInfo& run, int fd,
         i++;
     }
 
+    // Filter goes into additional index blocks without entries
+    if (run.entries.size() > 0 && !run.filter.empty()) {
+        FilterHeader fh;
+        fh.magic = FILTER_MAGIC;
+        fh.hashCount = run.filter.hashCount;
+        fh.minPID = run.filter.minPID;
+        fh.maxPID = run.filter.maxPID;
+        fh.words = run.filter.bits.size();
+
+        std::vector<char> data(sizeof(FilterHeader)
+                + fh.words * sizeof(uint64_t));
+        memcpy(&data[0], &fh, sizeof(FilterHeader));
+        memcpy(&data[sizeof(FilterHeader)], &run.filter.bits[0],
+                fh.words * sizeof(uint64_t));
+
+        size_t perBlock = blockSize - sizeof(BlockHeader);
+        for (size_t done = 0; done < data.size(); done += perBlock) {
+            size_t length = std::min(perBlock, data.size() - done);
+            memset(writeBuffer, 0, blockSize);
+            memcpy(writeBuffer + sizeof(BlockHeader), &data[done], length);
+            BlockHeader* h = (BlockHeader*) writeBuffer;
+            h->entries = 0;
+            h->blockNumber = i;
+
+            W_COERCE(me()->pwrite(fd, writeBuffer, blockSize, offset));
+            offset += blockSize;
+            i++;
+        }
+    }
+
     return RCOK;
 }
 
@@ -2150,11 +2367,18 @@ rc_t LogArchiver::ArchiveIndex::deserializeRunInfo(RunInfo& run,
     fileoff_t offset = dataBlockCount * blockSize;
     w_assert1(dataBlockCount == 0 || offset > 0);
     size_t lastOffset = 0;
+    std::vector<char> filterData;
 
     while (indexBlockCount > 0) {
         W_COERCE(me()->pread(fd, readBuffer, blockSize, offset));
         BlockHeader* h = (BlockHeader*) readBuffer;
 
+        if (h->entries == 0) {
+            // filter block
+            filterData.insert(filterData.end(),
+                    readBuffer + sizeof(BlockHeader), readBuffer + blockSize);
+        }
+
         unsigned j = 0;
         size_t bpos = sizeof(BlockHeader);
         while(j < h->entries)
@@ -2176,6 +2400,21 @@ rc_t LogArchiver::ArchiveIndex::deserializeRunInfo(RunInfo& run,
         // }
     }
 
+    if (filterData.size() >= sizeof(FilterHeader)) {
+        FilterHeader* fh = (FilterHeader*) &filterData[0];
+        size_t bytes = fh->words * sizeof(uint64_t);
+        if (fh->magic == FILTER_MAGIC
+                && filterData.size() >= sizeof(FilterHeader) + bytes)
+        {
+            run.filter.hashCount = fh->hashCount;
+            run.filter.minPID = fh->minPID;
+            run.filter.maxPID = fh->maxPID;
+            run.filter.bits.resize(fh->words);
+            memcpy(&run.filter.bits[0], &filterData[sizeof(FilterHeader)],
+                    bytes);
+        }
+    }
+
     W_DO(me()->close(fd));
     return RCOK;
 }
@@ -2366,6 +2605,15 @@ void LogArchiver::ArchiveIndex::probe(std::vector<ProbeResult>& probes,
     ProbeResult res;
     while ((int) index <= lastFinished) {
         if (runs[index].entries.size() > 0) {
+            INC_TSTAT(la_probed_runs);
+            if (!runs[index].filter.mayContainRange(startPID, endPID,
+                        bucketSize))
+            {
+                INC_TSTAT(la_skipped_runs);
+                index++;
+                continue;
+            }
+
             res.pidBegin = startPID;
             res.pidEnd = endPID;
             res.runIndex = index;
@@ -2377,6 +2625,107 @@ void LogArchiver::ArchiveIndex::probe(std::vector<ProbeResult>& probes,
 
 }
 
+// ~1% false positives with 10 bits per key and 7 hash functions
+const static size_t FILTER_BITS_PER_KEY = 10;
+const static uint32_t FILTER_HASH_COUNT = 7;
+// Larger ranges are checked only against min/max page IDs
+const static size_t FILTER_MAX_PROBE_KEYS = 64;
+
+static uint64_t filterHash(uint64_t key)
+{
+    // splitmix64 finalizer
+    key += 0x9e3779b97f4a7c15ull;
+    key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ull;
+    key = (key ^ (key >> 27)) * 0x94d049bb133111ebull;
+    return key ^ (key >> 31);
+}
+
+void LogArchiver::ArchiveIndex::RunFilter::build(
+        const std::vector<PageID>& pids, size_t bucketSize)
+{
+    bits.clear();
+    if (pids.empty()) { return; }
+
+    minPID = *std::min_element(pids.begin(), pids.end());
+    maxPID = *std::max_element(pids.begin(), pids.end());
+
+    size_t keys = pids.size() * (bucketSize > 0 ? 2 : 1);
+    size_t words = (keys * FILTER_BITS_PER_KEY + 63) / 64;
+    bits.assign(std::max<size_t>(words, 1), 0);
+    hashCount = FILTER_HASH_COUNT;
+
+    size_t nbits = bits.size() * 64;
+    auto insert = [this, nbits] (uint64_t key) {
+        uint64_t h = filterHash(key);
+        uint64_t h2 = (h >> 32) | (h << 32) | 1;
+        for (uint32_t i = 0; i < hashCount; i++) {
+            uint64_t bit = (h + i * h2) % nbits;
+            bits[bit / 64] |= 1ull << (bit % 64);
+        }
+    };
+
+    for (size_t i = 0; i < pids.size(); i++) {
+        insert(pids[i]);
+        if (bucketSize > 0) {
+            insert(bucketKey(pids[i], bucketSize));
+        }
+    }
+}
+
+bool LogArchiver::ArchiveIndex::RunFilter::mayContain(uint64_t key) const
+{
+    if (empty()) { return true; }
+
+    size_t nbits = bits.size() * 64;
+    uint64_t h = filterHash(key);
+    uint64_t h2 = (h >> 32) | (h << 32) | 1;
+    for (uint32_t i = 0; i < hashCount; i++) {
+        uint64_t bit = (h + i * h2) % nbits;
+        if (!(bits[bit / 64] & (1ull << (bit % 64)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Page range is [startPID, endPID), with endPID == 0 meaning no upper bound,
+ * as in probe().
+ */
+bool LogArchiver::ArchiveIndex::RunFilter::mayContainRange(PageID startPID,
+        PageID endPID, size_t bucketSize) const
+{
+    if (empty()) { return true; }
+
+    if (startPID > maxPID || (endPID != 0 && endPID <= minPID)) {
+        return false;
+    }
+    if (endPID == 0) { return true; }
+
+    PageID first = std::max(startPID, minPID);
+    PageID last = std::min<PageID>(endPID - 1, maxPID);
+
+    if (last - first < FILTER_MAX_PROBE_KEYS) {
+        for (PageID pid = first; pid <= last; pid++) {
+            if (mayContain(pid)) { return true; }
+        }
+        return false;
+    }
+
+    if (bucketSize > 0
+            && last / bucketSize - first / bucketSize < FILTER_MAX_PROBE_KEYS)
+    {
+        for (PageID b = first / bucketSize; b <= last / bucketSize; b++) {
+            if (mayContain(bucketKey(b * bucketSize, bucketSize))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    return true;
+}
+
 void LogArchiver::ArchiveIndex::dumpIndex(ostream& out)
 {
     for (size_t i = 0; i < runs.size(); i++) {
@@ -217,6 +217,12 @@ public:
      * This class is still under test and development, so more documentation
      * should be added later (TODO)
      *
+     * Each run also carries a RunFilter, which is used by probe() to skip
+     * runs that certainly contain no log records for the probed page range.
+     * It is persisted after the index entries, in index blocks with zero
+     * entries, so that runs written without a filter can still be read (they
+     * are simply never skipped).
+     *
      * \author Caetano Sauer
      */
     class ArchiveIndex {
@@ -237,6 +243,7 @@ public:
 
         void newBlock(PageID firstPID);
         void newBlock(const vector<pair<PageID, size_t> >& buckets);
+        void addPIDs(const vector<PageID>& pids);
 
         rc_t finishRun(lsn_t first, lsn_t last, int fd, fileoff_t);
         void probe(std::vector<ProbeResult>& probes,
@@ -251,6 +258,34 @@ public:
 
         void dumpIndex(ostream& out);
 
+        /** \brief Page ID filter of a run
+         *
+         * Keeps the exact range of page IDs in the run and a Bloom filter
+         * on its page IDs and on its buckets (if the index uses buckets),
+         * so that both point probes and probes of a few restore segments
+         * can be answered without reading the run.
+         */
+        struct RunFilter {
+            PageID minPID;
+            PageID maxPID;
+            uint32_t hashCount;
+            std::vector<uint64_t> bits;
+
+            RunFilter() : minPID(0), maxPID(0), hashCount(0) {}
+
+            bool empty() const { return bits.empty(); }
+            void build(const std::vector<PageID>& pids, size_t bucketSize);
+            bool mayContain(uint64_t key) const;
+            bool mayContainRange(PageID startPID, PageID endPID,
+                    size_t bucketSize) const;
+
+            // bucket keys are kept apart from page keys by the highest bit
+            static uint64_t bucketKey(PageID pid, size_t bucketSize)
+            {
+                return (1ull << 63) | (pid / bucketSize);
+            }
+        };
+
     private:
         struct BlockEntry {
             size_t offset;
@@ -260,6 +295,15 @@ public:
             uint32_t entries;
             uint32_t blockNumber;
         };
+        /// Stored at the beginning of the first filter block
+        struct FilterHeader {
+            uint32_t magic;
+            uint32_t hashCount;
+            PageID minPID;
+            PageID maxPID;
+            uint64_t words;
+        };
+        const static uint32_t FILTER_MAGIC = 0x46494c54; // "FILT"
         struct RunInfo {
             lsn_t firstLSN;
             // lastLSN must be equal to firstLSN of the following run.  We keep
@@ -275,6 +319,11 @@ public:
 
             std::vector<BlockEntry> entries;
 
+            RunFilter filter;
+            // Distinct page IDs added while the run is generated; used to
+            // build the filter once the run is finished
+            std::vector<PageID> pids;
+
             bool operator<(const RunInfo& other) const
             {
                 return firstLSN < other.firstLSN;
@@ -497,6 +546,8 @@ public:
         vector<pair<PageID, size_t> > buckets;
         // number of the nex bucket to be indexed
         size_t nextBucket;
+        // distinct page IDs in the current block, for the run filter
+        vector<PageID> blockPIDs;
     public:
         struct BlockHeader {
             lsn_t lsn;
@@ -654,23 +705,34 @@ public:
      * selection step pops log records out of the heap and feeds them to the
      * BlockAssembly component.
      *
+     * With more than one sort thread, the heap is replaced by load-sort-store
+     * run generation: incoming records are appended unsorted to the current
+     * run, and once the workspace is full (or the run is requested by
+     * selection), the run is partitioned into disjoint PageID ranges which
+     * are sorted concurrently, one per thread. Runs still map to contiguous
+     * LSN ranges of the recovery log and their contents are sorted by
+     * (page id, lsn), so the output is indistinguishable from the
+     * single-threaded one for the archive index and scanners.
+     *
      * \author Caetano Sauer
      */
     class ArchiverHeap {
     public:
-        ArchiverHeap(size_t workspaceSize);
+        ArchiverHeap(size_t workspaceSize, size_t sortThreads = 1);
         virtual ~ArchiverHeap();
 
         bool push(logrec_t* lr, bool duplicate);
         logrec_t* top();
         void pop();
 
-        run_number_t topRun() { return w_heap.First().run; }
-        size_t size() { return w_heap.NumElements(); }
+        run_number_t topRun();
+        size_t size();
+        size_t getSortThreads() { return sortThreads; }
     private:
         run_number_t currentRun;
         bool filledFirst;
         mem_mgmt_t* workspace;
+        size_t sortThreads;
 
         mem_mgmt_t::slot_t allocate(size_t length);
 
@@ -704,6 +766,16 @@ public:
 
         Cmp heapCmp;
         Heap<HeapEntry, Cmp> w_heap;
+
+        // Used instead of w_heap if sortThreads > 1: unsorted records of the
+        // run being filled, and the sorted run being consumed by selection
+        std::vector<HeapEntry> pending;
+        std::vector<HeapEntry> sorted;
+        size_t sortedPos;
+
+        bool pushUnsorted(logrec_t* lr, bool duplicate);
+        void ensureSorted();
+        void sortPending();
     };
 
     /** \brief Provides a record-at-a-time interface to the recovery log using
@@ -826,6 +898,7 @@ public:
     const static bool DFT_EAGER = true;
     const static bool DFT_READ_WHOLE_BLOCKS = true;
     const static int DFT_GRACE_PERIOD = 1000000; // 1 sec
+    const static int DFT_SORT_THREADS = 1;
 
     const static int IO_BLOCK_COUNT = 8; // total buffer = 8MB
     const static size_t IO_ALIGN;
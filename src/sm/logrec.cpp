@@ -146,8 +146,7 @@ logrec_t::fill(PageID p, StoreID store, uint16_t tag, smsize_t l)
         // zero out extra space to keep purify happy
         memset(dat+l, 0, ALIGN_BYTE(l)-l);
     }
-    unsigned int tmp = ALIGN_BYTE(l) + (is_single_sys_xct() ? hdr_single_sys_xct_sz : hdr_non_ssx_sz) + sizeof(lsn_t);
-    tmp = (tmp + 7) & unsigned(-8); // force 8-byte alignment
+    unsigned int tmp = length_for(l, is_single_sys_xct());
     w_assert1(tmp <= sizeof(*this));
     header._len = tmp;
     if(type() != t_skip) {
@@ -639,15 +638,17 @@ add_backup_log::add_backup_log(const string& path, lsn_t backupLSN)
 {
     *((lsn_t*) data_ssx()) = backupLSN;
     w_assert0(path.length() < smlevel_0::max_devname);
-    memcpy(data_ssx() + sizeof(lsn_t), path.data(), path.length());
-    fill((PageID) 0, sizeof(lsn_t) + path.length());
+    // copy terminating null character too
+    memcpy(data_ssx() + sizeof(lsn_t), path.c_str(), path.length() + 1);
+    fill((PageID) 0, sizeof(lsn_t) + path.length() + 1);
 }
 
 void add_backup_log::redo(fixable_page_h*)
 {
     lsn_t backupLSN = *((lsn_t*) data_ssx());
     const char* dev_name = (const char*) (data_ssx() + sizeof(lsn_t));
-    W_COERCE(smlevel_0::vol->sx_add_backup(string(dev_name), backupLSN, false));
+    W_COERCE(smlevel_0::vol->sx_add_backup(string(dev_name), backupLSN,
+                true /* redo */));
 }
 
 undo_done_log::undo_done_log()
@@ -170,6 +170,13 @@ public:
     bool             valid_header(const lsn_t & lsn_ck = lsn_t::null) const;
     smsize_t         header_size() const;
 
+    /**
+     * Length of a record with data_len bytes of data, exactly as computed
+     * by fill(). Allows reserving space in the log buffer before the record
+     * is serialized (see log_core::insert_direct).
+     */
+    static smsize_t  length_for(smsize_t data_len, bool single_sys_xct);
+
     void             redo(fixable_page_h*);
     void             undo(fixable_page_h*);
 
@@ -395,6 +402,13 @@ inline smsize_t logrec_t::header_size() const
         return hdr_non_ssx_sz;
     }
 }
+inline smsize_t logrec_t::length_for(smsize_t data_len, bool single_sys_xct)
+{
+    smsize_t len = ALIGN_BYTE(data_len)
+        + (single_sys_xct ? hdr_single_sys_xct_sz : hdr_non_ssx_sz)
+        + sizeof(lsn_t);
+    return (len + 7) & ~smsize_t(7); // force 8-byte alignment
+}
 
 struct chkpt_bf_tab_t {
     struct brec_t {
@@ -26,31 +26,52 @@ void page_cleaner_base::flush_workspace(size_t from, size_t to)
         return;
     }
 
+    std::vector<std::pair<size_t, size_t> > runs;
+    runs.push_back(std::make_pair(from, to - from));
+    flush_workspace(runs);
+}
+
+void page_cleaner_base::flush_workspace(
+        const std::vector<std::pair<size_t, size_t> >& runs)
+{
+    if (runs.empty()) {
+        return;
+    }
+
     // Flush log to guarantee WAL property
     W_COERCE(smlevel_0::log->flush(_clean_lsn));
 
-    W_COERCE(smlevel_0::vol->write_many_pages(
-                _workspace[from].pid, &(_workspace[from]), to - from,
+    W_COERCE(smlevel_0::vol->write_page_runs(&(_workspace[0]), runs,
                 true /* ignore restore */));
 
-    for (size_t i = from; i < to; ++i) {
-        bf_idx idx = _workspace_cb_indexes[i];
-        bf_tree_cb_t &cb = _bufferpool->get_cb(idx);
+    mark_clean(runs);
+}
 
-        // Assertion below may fail for decoupled cleaner, and it's OK
-        // w_assert1(i == from || _workspace[i].pid == _workspace[i - 1].pid + 1);
+void page_cleaner_base::mark_clean(
+        const std::vector<std::pair<size_t, size_t> >& runs)
+{
+    for (size_t r = 0; r < runs.size(); ++r) {
+        size_t from = runs[r].first;
+        size_t to = from + runs[r].second;
+        for (size_t i = from; i < to; ++i) {
+            bf_idx idx = _workspace_cb_indexes[i];
+            bf_tree_cb_t &cb = _bufferpool->get_cb(idx);
 
-        rc_t rc = cb.latch().latch_acquire(LATCH_EX, sthread_t::WAIT_IMMEDIATE);
-        if (rc.is_error()) {
-            continue;   // Could not latch page in EX mode -- just skip it
-        }
+            // Assertion below may fail for decoupled cleaner, and it's OK
+            // w_assert1(i == from || _workspace[i].pid == _workspace[i - 1].pid + 1);
 
-        cb.pin();
-        if (cb._pid == _workspace[i].pid && cb.get_clean_lsn() < _clean_lsn) {
-            cb.set_clean_lsn(_clean_lsn);
-        }
-        cb.unpin();
+            rc_t rc = cb.latch().latch_acquire(LATCH_EX, sthread_t::WAIT_IMMEDIATE);
+            if (rc.is_error()) {
+                continue;   // Could not latch page in EX mode -- just skip it
+            }
+
+            cb.pin();
+            if (cb._pid == _workspace[i].pid && cb.get_clean_lsn() < _clean_lsn) {
+                cb.set_clean_lsn(_clean_lsn);
+            }
+            cb.unpin();
 
-        cb.latch().latch_release();
+            cb.latch().latch_release();
+        }
     }
 }
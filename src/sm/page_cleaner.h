@@ -21,6 +21,20 @@ public:
 protected:
     void flush_workspace(size_t from, size_t to);
 
+    /**
+     * Flushes several runs of contiguous pages in the workspace, each given
+     * by the index of its first page and its number of pages, with a single
+     * batch of I/O requests.
+     */
+    void flush_workspace(const std::vector<std::pair<size_t, size_t> >& runs);
+
+    /**
+     * Called by flush_workspace after the given runs were written to update
+     * the clean LSN of the buffer pool frames holding the written pages. The
+     * default implementation latches each frame (without waiting).
+     */
+    virtual void mark_clean(const std::vector<std::pair<size_t, size_t> >& runs);
+
     /** the buffer pool this cleaner deals with. */
     bf_tree_m*                  _bufferpool;
 
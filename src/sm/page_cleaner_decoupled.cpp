@@ -6,10 +6,15 @@
 #include "log_core.h"
 #include "eventlog.h"
 
+#include <algorithm>
+
 page_cleaner_decoupled::page_cleaner_decoupled(
         bf_tree_m* _bufferpool, const sm_options& _options)
-    : page_cleaner_base(_bufferpool, _options)
+    : page_cleaner_base(_bufferpool, _options), _lrbuf_used(0)
 {
+    _log_based = _options.get_bool_option("sm_cleaner_decoupled_log", false);
+    _lrbuf.resize(LOG_BUFFER_SIZE);
+
     // CS TODO: clean_lsn must be recovered from checkpoint
     _clean_lsn = smlevel_0::log->durable_lsn();
 }
@@ -20,6 +25,16 @@ page_cleaner_decoupled::~page_cleaner_decoupled()
 
 void page_cleaner_decoupled::do_work()
 {
+    if (_log_based) {
+        lsn_t end_lsn = smlevel_0::log->durable_lsn();
+        while (_clean_lsn < end_lsn) {
+            lsn_t next_lsn = collect_from_log(end_lsn);
+            replay_collected();
+            _clean_lsn = next_lsn;
+        }
+        return;
+    }
+
     lsn_t last_lsn = smlevel_0::logArchiver->getDirectory()->getLastLSN();
     if(last_lsn <= _clean_lsn) {
         ERROUT(<< "Nothing archived to clean.");
@@ -33,69 +48,185 @@ void page_cleaner_decoupled::do_work()
     LogArchiver::ArchiveScanner::RunMerger* merger = logScan.open(0, 0,
             _clean_lsn, 1048576);
 
-    generic_page* page = nullptr;
-    PageID currentPid = 0, firstPid = 0;
     logrec_t* lr;
     while (merger && merger->next(lr)) {
         if (!lr->is_redo()) {
             continue;
         }
-
-        PageID lrpid = lr->pid();
-        if (!page || lrpid - firstPid >= _workspace_size) {
-            // first iteration of the loop or time to read new buffer
-            if (page) {
-                fill_cb_indexes();
-                flush_workspace(0, _workspace_size);
-                sysevent::log_page_write(firstPid, last_lsn, _workspace_size);
-            }
-            currentPid = lrpid;
-            firstPid = (lrpid / _workspace_size) * _workspace_size;
-            W_COERCE(smlevel_0::vol->read_many_pages(firstPid, &(_workspace[0]), _workspace_size));
-            page = &_workspace[lrpid - firstPid];
+        // records arrive in (PageID, LSN) order, so the buffer can be
+        // replayed whenever it fills up
+        if (!collect(lr, lr->pid())) {
+            replay_collected();
+            bool collected = collect(lr, lr->pid());
+            w_assert0(collected);
         }
+    }
 
-        if (lrpid > currentPid) {
-            // move to next page
-            w_assert1(page);
-            page->checksum = page->calculate_checksum();
-            page += lrpid - currentPid;
-            currentPid = lrpid;
-        }
+    if (merger) { delete merger; }
+
+    replay_collected();
 
-        if(page->lsn >= lr->lsn()) {
-            DBGOUT(<<"Not replaying log record " << lr->lsn()
-                    << ". Page " << page->pid << " is up-to-date.");
+    DBGTHRD(<< "Cleaner thread deactivating. Cleaned until " << _clean_lsn);
+    _clean_lsn = last_lsn;
+}
+
+bool page_cleaner_decoupled::collect(logrec_t* lr, PageID pid)
+{
+    if (_lrbuf_used + lr->length() > _lrbuf.size()) {
+        return false;
+    }
+
+    replay_entry_t e;
+    e.pid = pid;
+    e.lsn = lr->lsn();
+    e.offset = _lrbuf_used;
+    _entries.push_back(e);
+
+    memcpy(&_lrbuf[_lrbuf_used], lr, lr->length());
+    _lrbuf_used += lr->length();
+    return true;
+}
+
+lsn_t page_cleaner_decoupled::collect_from_log(lsn_t end_lsn)
+{
+    log_i scan(*smlevel_0::log, _clean_lsn);
+    logrec_t lr;
+    lsn_t lsn;
+    while (scan.xct_next(lsn, lr)) {
+        if (lsn >= end_lsn) {
+            return end_lsn;
+        }
+        if (!lr.is_redo()) {
+            continue;
+        }
+        // page-less log records (see restart_m::redo_log_pass)
+        if (lr.pid() == 0 && lr.type() != logrec_t::t_alloc_page
+                && lr.type() != logrec_t::t_dealloc_page)
+        {
             continue;
         }
 
-        // CS TODO setting the pid is required to redo a split on the new foster child
-        page->pid = lrpid;
-        fixable_page_h fixable;
-        fixable.setup_for_restore(page);
-        lr->redo(&fixable);
+        // multi-page records are replayed on each page, as in the archive
+        size_t needed = lr.is_multi_page() ? 2 * lr.length() : lr.length();
+        if (_lrbuf_used + needed > _lrbuf.size()) {
+            w_assert0(_lrbuf_used > 0);
+            return lsn;
+        }
+        collect(&lr, lr.pid());
+        if (lr.is_multi_page()) {
+            collect(&lr, lr.pid2());
+        }
+    }
+    return end_lsn;
+}
 
-        DBGOUT(<<"Replayed log record " << lr->lsn_ck() << " for page " << page->pid);
+void page_cleaner_decoupled::replay_collected()
+{
+    // records from the recovery log are in LSN order only
+    if (_log_based) {
+        std::sort(_entries.begin(), _entries.end());
     }
 
-    if (merger) { delete merger; }
+    std::vector<std::pair<PageID, size_t> > read_runs;
+    std::vector<std::pair<size_t, size_t> > write_runs;
+
+    size_t e = 0;
+    while (e < _entries.size()) {
+        // assign a workspace slot to each page with records, in PageID order,
+        // until the workspace is full
+        size_t first = e;
+        size_t slots = 0;
+        read_runs.clear();
+        while (e < _entries.size() && slots < _workspace_size) {
+            PageID pid = _entries[e].pid;
+            if (!read_runs.empty() && read_runs.back().first
+                    + read_runs.back().second == pid)
+            {
+                read_runs.back().second++;
+            }
+            else {
+                read_runs.push_back(std::make_pair(pid, 1));
+            }
+            slots++;
+            while (e < _entries.size() && _entries[e].pid == pid) { e++; }
+        }
 
-    if(page && currentPid - firstPid > 0) {
-        page->checksum = page->calculate_checksum();
-        fill_cb_indexes();
-        flush_workspace(0, _workspace_size);
-        sysevent::log_page_write(firstPid, last_lsn, _workspace_size);
+        W_COERCE(smlevel_0::vol->read_page_runs(&_workspace[0], read_runs));
+        ADD_TSTAT(cleaner_decoupled_page_reads, slots);
+
+        // replay, remembering which pages were actually updated
+        write_runs.clear();
+        size_t slot = 0;
+        size_t i = first;
+        while (i < e) {
+            PageID pid = _entries[i].pid;
+            generic_page* page = &_workspace[slot];
+            bool updated = false;
+            for (; i < e && _entries[i].pid == pid; i++) {
+                logrec_t* lr = (logrec_t*) &_lrbuf[_entries[i].offset];
+                if(page->lsn >= lr->lsn()) {
+                    DBGOUT(<<"Not replaying log record " << lr->lsn()
+                            << ". Page " << pid << " is up-to-date.");
+                    continue;
+                }
+
+                // CS TODO setting the pid is required to redo a split on the new foster child
+                page->pid = pid;
+                // restore the page ID of duplicated multi-page records
+                lr->set_pid(pid);
+                fixable_page_h fixable;
+                fixable.setup_for_restore(page);
+                lr->redo(&fixable);
+                updated = true;
+
+                DBGOUT(<<"Replayed log record " << lr->lsn_ck() << " for page " << pid);
+            }
+
+            if (updated) {
+                page->checksum = page->calculate_checksum();
+                _workspace_cb_indexes[slot] = _bufferpool->lookup(pid);
+                if (!write_runs.empty() && write_runs.back().first
+                        + write_runs.back().second == slot
+                        && _workspace[slot - 1].pid + 1 == pid)
+                {
+                    write_runs.back().second++;
+                }
+                else {
+                    write_runs.push_back(std::make_pair(slot, 1));
+                }
+            }
+            slot++;
+        }
+
+        flush_workspace(write_runs);
+        for (size_t r = 0; r < write_runs.size(); r++) {
+            ADD_TSTAT(cleaner_decoupled_page_writes, write_runs[r].second);
+            sysevent::log_page_write(_workspace[write_runs[r].first].pid,
+                    _clean_lsn, write_runs[r].second);
+        }
     }
 
-    DBGTHRD(<< "Cleaner thread deactivating. Cleaned until " << _clean_lsn);
-    _clean_lsn = last_lsn;
+    _entries.clear();
+    _lrbuf_used = 0;
 }
 
-void page_cleaner_decoupled::fill_cb_indexes()
+void page_cleaner_decoupled::mark_clean(
+        const std::vector<std::pair<size_t, size_t> >& runs)
 {
-    for(size_t i = 0; i < _workspace_size; i++)
-    {
-        bf_idx idx = _bufferpool->lookup(_workspace[i].pid);
-        _workspace_cb_indexes[i] = idx;
+    // No latch: if the frame was reused for another page meanwhile, that
+    // page was read after all its updates up to the image LSN were on disk,
+    // so raising its clean LSN to the image LSN never hides a dirty page.
+    for (size_t r = 0; r < runs.size(); ++r) {
+        for (size_t i = runs[r].first; i < runs[r].first + runs[r].second; ++i) {
+            bf_idx idx = _workspace_cb_indexes[i];
+            if (idx == 0) {
+                continue;   // page not in the buffer pool
+            }
+            bf_tree_cb_t &cb = _bufferpool->get_cb(idx);
+            lsn_t image_lsn = _workspace[i].lsn;
+            if (cb._pid == _workspace[i].pid && cb.get_clean_lsn() < image_lsn) {
+                cb.set_clean_lsn(image_lsn);
+            }
+        }
     }
 }
@@ -9,6 +9,19 @@
 #include "smthread.h"
 #include "page_cleaner.h"
 
+/**
+ * Cleaner that produces clean page images without touching the buffer pool:
+ * it reads pages from the volume and replays log records on them. Log
+ * records come either from the log archive or, with option
+ * sm_cleaner_decoupled_log, directly from the recovery log, in which case
+ * the cleaner does not depend on archiving having caught up.
+ *
+ * Records are collected into a buffer in (PageID, LSN) order, and only the
+ * pages that have records are read and written, coalescing adjacent pages
+ * into a single I/O request. Buffer pool frames are never latched: the clean
+ * LSN of frames holding written pages is updated with the page LSN of the
+ * written image, which is safe without a latch (see mark_clean).
+ */
 class page_cleaner_decoupled : public page_cleaner_base{
 public:
     page_cleaner_decoupled(bf_tree_m* _bufferpool, const sm_options& _options);
@@ -16,9 +29,45 @@ public:
 
 protected:
     virtual void do_work();
+    virtual void mark_clean(const std::vector<std::pair<size_t, size_t> >& runs);
 
 private:
-    void fill_cb_indexes();
+    /** Maximum amount of log records collected before replaying them */
+    static const size_t LOG_BUFFER_SIZE = 16 * 1024 * 1024;
+
+    /** Log record to be replayed on a page */
+    struct replay_entry_t {
+        PageID pid;
+        lsn_t lsn;
+        size_t offset;  // in _lrbuf
+
+        bool operator<(const replay_entry_t& other) const
+        {
+            return pid < other.pid || (pid == other.pid && lsn < other.lsn);
+        }
+    };
+
+    /** Whether to replay log records from the recovery log */
+    bool _log_based;
+
+    std::vector<char> _lrbuf;
+    size_t _lrbuf_used;
+    std::vector<replay_entry_t> _entries;
+
+    /**
+     * Copies the given log record into the buffer for replay on page pid;
+     * returns false if the buffer is full.
+     */
+    bool collect(logrec_t* lr, PageID pid);
+
+    /**
+     * Collects records of the recovery log from _clean_lsn up to end_lsn,
+     * or until the buffer is full. Returns the LSN where collection stopped.
+     */
+    lsn_t collect_from_log(lsn_t end_lsn);
+
+    /** Reads, replays and writes all pages of the collected records */
+    void replay_collected();
 };
 
 #endif // PAGE_CLEANER_H
@@ -143,8 +143,9 @@ rc_t partition_t::flush(
     w_assert0(end2 >= start2);
     long size = (end2 - start2) + (end1 - start1);
     long write_size = size;
+    long file_offset;
 
-    { // sync log: Seek the file to the right place.
+    { // sync log: Compute the position in the file.
         DBG5( << "Sync-ing log lsn " << lsn
                 << " start1 " << start1
                 << " end1 " << end1
@@ -152,7 +153,7 @@ rc_t partition_t::flush(
                 << " end2 " << end2 );
 
         // works because BLOCK_SIZE is always a power of 2
-        long file_offset = floor2(lsn.lo(), log_storage::BLOCK_SIZE);
+        file_offset = floor2(lsn.lo(), log_storage::BLOCK_SIZE);
         // offset is rounded down to a block_size
 
         long delta = lsn.lo() - file_offset;
@@ -162,13 +163,6 @@ rc_t partition_t::flush(
                                     // but works for unsigned...
         write_size += delta; // account for the extra (clean) bytes
         start1 -= delta;
-
-        /* FRJ: This seek is safe (in theory) because only one thread
-           can flush at a time and all other accesses to the file use
-           pread/pwrite (which doesn't change the file pointer).
-         */
-        fileoff_t where = file_offset;
-        W_DO(me()->lseek(_fhdl_app, where, sthread_t::SEEK_AT_SET));
     } // end sync log
 
     { // Copy a skip record to the end of the buffer.
@@ -207,7 +201,14 @@ rc_t partition_t::flush(
             iovec_t(block_of_zeros(),         grand_total-total),
         };
 
-        W_DO(me()->writev(_fhdl_app, iov, sizeof(iov)/sizeof(iovec_t)));
+        // Positioned write, so that it can be submitted asynchronously if
+        // io_uring is enabled (see sthread_t::pio)
+        sthread_t::io_request_t req(true, iov, sizeof(iov)/sizeof(iovec_t),
+                file_offset);
+        W_DO(me()->pio(_fhdl_app, &req, 1));
+        if (req.done != grand_total) {
+            return RC(stSHORTIO);
+        }
 
         ADD_TSTAT(log_bytes_written, grand_total);
     } // end copy skip record
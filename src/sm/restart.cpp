@@ -73,10 +73,119 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
 #include <fcntl.h>              // Performance reporting
 #include <unistd.h>
 #include <sstream>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+/**
+ * Thread used by parallel REDO and UNDO. It has to be an smthread_t, since
+ * fixing pages and rolling back transactions rely on me().
+ */
+class restart_worker_t : public smthread_t
+{
+public:
+    restart_worker_t(std::function<void()> f)
+        : smthread_t(t_regular, "restart_worker", WAIT_NOT_USED), _f(f)
+    {}
+    void run() { _f(); }
+private:
+    std::function<void()> _f;
+};
+
+/**
+ * Runs f(0) ... f(count-1) on count worker threads and waits for them.
+ */
+static void run_restart_workers(size_t count, std::function<void(size_t)> f)
+{
+    std::vector<restart_worker_t*> workers;
+    for (size_t i = 0; i < count; i++) {
+        workers.push_back(new restart_worker_t([f, i] { f(i); }));
+        W_COERCE(workers[i]->fork());
+    }
+    for (size_t i = 0; i < count; i++) {
+        W_COERCE(workers[i]->join());
+        delete workers[i];
+    }
+}
+
+/**
+ * Queue of log records replayed by one thread of parallel log-based REDO.
+ * The log scan copies every page log record into the queue of the thread that
+ * owns the page, so all records of a page are replayed by the same thread and
+ * in LSN order. Records are handed over in batches to keep synchronization
+ * off the per-record path, and the number of pending batches is bounded so
+ * that a slow thread throttles the scan.
+ */
+class redo_queue_t
+{
+public:
+    static const size_t BATCH_SIZE = 256 * 1024;
+    static const size_t MAX_BATCHES = 8;
+
+    redo_queue_t() : _done(false) {}
+
+    /** Called by the log scan */
+    void add(const logrec_t& r)
+    {
+        const char* data = reinterpret_cast<const char*>(&r);
+        _current.insert(_current.end(), data, data + r.length());
+        if (_current.size() >= BATCH_SIZE) {
+            _flush();
+        }
+    }
+
+    /** Called by the log scan after the last record */
+    void finish()
+    {
+        if (!_current.empty()) {
+            _flush();
+        }
+        std::unique_lock<std::mutex> lck(_mutex);
+        _done = true;
+        _cond.notify_all();
+    }
+
+    /** Called by the REDO thread; returns false once the scan is finished */
+    bool pop(std::vector<char>& batch)
+    {
+        std::unique_lock<std::mutex> lck(_mutex);
+        _cond.wait(lck, [this] { return !_batches.empty() || _done; });
+        if (_batches.empty()) {
+            return false;
+        }
+        batch = std::move(_batches.front());
+        _batches.pop_front();
+        _cond.notify_all();
+        return true;
+    }
+
+private:
+    std::vector<char> _current;
+    std::deque<std::vector<char>> _batches;
+    bool _done;
+    std::mutex _mutex;
+    std::condition_variable _cond;
+
+    void _flush()
+    {
+        std::unique_lock<std::mutex> lck(_mutex);
+        _cond.wait(lck, [this] { return _batches.size() < MAX_BATCHES; });
+        _batches.push_back(std::move(_current));
+        _current = std::vector<char>();
+        _current.reserve(BATCH_SIZE);
+        _cond.notify_all();
+    }
+};
 
-restart_m::restart_m(const sm_options&)
-    : _restart_thread(NULL)
+restart_m::restart_m(const sm_options& options)
+    : _done(false), _restart_thread(NULL)
 {
+    _redo_threads = std::max<int>(1,
+            options.get_int_option("sm_restart_redo_threads", 1));
+    _undo_threads = std::max<int>(1,
+            options.get_int_option("sm_restart_undo_threads", 1));
 }
 
 restart_m::~restart_m()
@@ -174,6 +283,41 @@ restart_m::redo_log_pass()
     // Allocate a (temporary) log record buffer for reading
     logrec_t r;
 
+    // Parallel REDO: page log records are replayed by _redo_threads threads,
+    // each one owning the pages with pid % _redo_threads equal to its index.
+    // Page-less log records are still replayed here, by the scan thread.
+    size_t redo_threads = _redo_threads;
+    std::vector<redo_queue_t> queues(redo_threads > 1 ? redo_threads : 0);
+    std::vector<uint32_t> worker_dirty_count(queues.size(), 0);
+    std::vector<restart_worker_t*> workers;
+    if (redo_threads > 1) {
+        auto replay = [this, &queues, &worker_dirty_count, redo_threads]
+            (size_t i)
+        {
+            std::vector<char> batch;
+            bool redone;
+            while (queues[i].pop(batch)) {
+                size_t pos = 0;
+                while (pos < batch.size()) {
+                    logrec_t& lr = *reinterpret_cast<logrec_t*>(&batch[pos]);
+                    if (lr.pid() % redo_threads == i) {
+                        _redo_log_with_pid(lr, lr.pid(), redone,
+                                worker_dirty_count[i]);
+                    }
+                    if (lr.is_multi_page() && lr.pid2() % redo_threads == i) {
+                        _redo_log_with_pid(lr, lr.pid2(), redone,
+                                worker_dirty_count[i]);
+                    }
+                    pos += lr.length();
+                }
+            }
+        };
+        for (size_t i = 0; i < redo_threads; i++) {
+            workers.push_back(new restart_worker_t([replay, i] { replay(i); }));
+            W_COERCE(workers[i]->fork());
+        }
+    }
+
     lsn_t lsn;
     lsn_t expected_lsn = redo_lsn;
     bool redone = false;
@@ -288,11 +432,26 @@ restart_m::redo_log_pass()
                 // achieve the 'transaction abort' effect during REDO phase, no UNDO for
                 // aborted transaction (aborted txn are not kept in transaction table).
 
-                _redo_log_with_pid(r, r.pid(), redone, dirty_count);
-                if (r.is_multi_page())
+                INC_TSTAT(restart_redo_records);
+                if (redo_threads > 1)
                 {
-                    w_assert1(r.is_single_sys_xct());
-                    _redo_log_with_pid(r, r.pid2(), redone, dirty_count);
+                    // Multi-page log records go to both owners, each of
+                    // which replays it on its own page
+                    size_t owner = r.pid() % redo_threads;
+                    queues[owner].add(r);
+                    if (r.is_multi_page() && r.pid2() % redo_threads != owner)
+                    {
+                        queues[r.pid2() % redo_threads].add(r);
+                    }
+                }
+                else
+                {
+                    _redo_log_with_pid(r, r.pid(), redone, dirty_count);
+                    if (r.is_multi_page())
+                    {
+                        w_assert1(r.is_single_sys_xct());
+                        _redo_log_with_pid(r, r.pid2(), redone, dirty_count);
+                    }
                 }
             }
         }
@@ -322,6 +481,13 @@ restart_m::redo_log_pass()
 
     }
 
+    for (size_t i = 0; i < workers.size(); i++) {
+        queues[i].finish();
+        W_COERCE(workers[i]->join());
+        delete workers[i];
+        dirty_count += worker_dirty_count[i];
+    }
+
     ADD_TSTAT(restart_redo_time, timer.time_us());
     sysevent::log(logrec_t::t_redo_done);
 }
@@ -401,6 +567,7 @@ void restart_m::undo_pass()
     if (0 == xct_t::num_active_xcts())
     {
         DBGOUT3(<<"No loser transaction to undo");
+        _done = true;
         return;
     }
 
@@ -421,6 +588,9 @@ void restart_m::undo_pass()
     // undo the loser transactions in the reverse order, which is the
     // order of execution we need
 
+    stopwatch_t timer;
+    std::vector<xct_t*> losers;
+
     xct_i iter(false); // not locking the transaction table list
     xct_t* xd = 0;
     xct_t* curr = 0;
@@ -520,11 +690,13 @@ void restart_m::undo_pass()
                     //     use_concurrent_commit_restart(): no lock acquisition
                     //     use_concurrent_lock_restart(): locks acquired during Log Analysis phase
 
-                    me()->attach_xct(curr);
-                    W_COERCE( curr->abort() );
-
-                    // Then destroy the loser transaction
-                    delete curr;
+                    if (_undo_threads > 1) {
+                        // Rolled back in parallel below
+                        losers.push_back(curr);
+                    }
+                    else {
+                        _undo_loser(curr);
+                    }
                 }
             }
             else
@@ -546,12 +718,39 @@ void restart_m::undo_pass()
         }
     }
 
+    // Loser transactions are independent of each other -- they ran
+    // concurrently before the crash, so their locks do not conflict --
+    // so they can be rolled back in parallel. Threads take them in the
+    // same order as the serial loop above.
+    if (!losers.empty()) {
+        std::atomic<size_t> next(0);
+        run_restart_workers(std::min(_undo_threads, losers.size()),
+            [this, &losers, &next] (size_t) {
+                size_t i;
+                while ((i = next++) < losers.size()) {
+                    _undo_loser(losers[i]);
+                }
+            });
+    }
+
+    ADD_TSTAT(restart_undo_time, timer.time_us());
+
     // All loser transactions have been taken care of now
     // Force a recovery log flush, this would harden the log records
     // generated by compensation operations
 
     W_COERCE( smlevel_0::log->flush_all() );
     sysevent::log(logrec_t::t_undo_done);
+    _done = true;
+}
+
+void restart_m::_undo_loser(xct_t* xd)
+{
+    me()->attach_xct(xd);
+    W_COERCE( xd->abort() );
+
+    // Then destroy the loser transaction
+    delete xd;
 }
 
 //*********************************************************************
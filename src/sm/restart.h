@@ -42,6 +42,7 @@
 #include "lock.h"               // Lock re-acquisition
 
 #include <map>
+#include <atomic>
 
 // Child thread created by restart_m for concurrent recovery operation
 // It is to carry out the REDO and UNDO phases while the system is
@@ -102,6 +103,10 @@ public:
 
     chkpt_t* get_chkpt() { return &chkpt; }
 
+    /** Whether REDO and UNDO are finished, i.e., all dirty pages and active
+     * transactions are in the buffer pool and transaction list */
+    bool is_done() const { return _done; }
+
 private:
 
     // System state object, updated by log analysis
@@ -109,6 +114,17 @@ private:
 
     bool instantRestart;
 
+    // Set at the end of undo_pass
+    std::atomic<bool> _done;
+
+    // Number of threads replaying page log records in redo_log_pass
+    // (option sm_restart_redo_threads); 1 replays them in the scan thread
+    size_t _redo_threads;
+
+    // Number of threads rolling back loser transactions in undo_pass
+    // (option sm_restart_undo_threads); 1 rolls them back one by one
+    size_t _undo_threads;
+
     // Child thread, used only if open system after Log Analysis phase while REDO and UNDO
     // will be performed with concurrent user transactions
     restart_thread_t*           _restart_thread;
@@ -187,6 +203,9 @@ private:
                                 PageID page_updated,
                                 bool &redone,                  // Out: did REDO occurred?  Validation purpose
                                 uint32_t &dirty_count);        // Out: dirty page count, validation purpose
+
+    // Rolls back and destroys the given loser transaction in the calling thread
+    void                 _undo_loser(xct_t* xd);
 };
 
 #endif
@@ -8,6 +8,7 @@
 #include "vol.h"
 #include "sm_options.h"
 #include "backup_reader.h"
+#include "bf_tree.h"
 
 #include <algorithm>
 #include <random>
@@ -139,8 +140,24 @@ RestoreScheduler::RestoreScheduler(const sm_options& options, RestoreMgr* restor
     // trySinglePass =
     //     options.get_bool_option("sm_restore_sched_singlepass", true);
     onDemand = options.get_bool_option("sm_restore_sched_ondemand", true);
+    hotFirst = options.get_bool_option("sm_restore_sched_hot", false);
+    hotCursor = 0;
     unsigned threads = options.get_int_option("sm_restore_threads", 1);
 
+    if (hotFirst && smlevel_0::bf) {
+        // Capture the working set now, before the buffer pool adapts to the
+        // failure. Reference counts are approximate and read without latches.
+        bufferedRefs.assign(restore->getSegmentForPid(lastUsedPid) + 1, 0);
+        bf_tree_m* bf = smlevel_0::bf;
+        for (bf_idx i = 1; i < bf->get_block_cnt(); i++) {
+            bf_tree_cb_t& cb = bf->get_cb(i);
+            if (cb._used && cb._pid <= lastUsedPid) {
+                bufferedRefs[restore->getSegmentForPid(cb._pid)] +=
+                    1 + cb._ref_count;
+            }
+        }
+    }
+
     segmentsPerThread = (lastUsedPid / restore->getSegmentSize()) / threads;
     for (unsigned i = 0; i < threads; i++) {
         firstNotRestoredPerThread.push_back(segmentsPerThread * i * restore->getSegmentSize());
@@ -156,6 +173,40 @@ RestoreScheduler::~RestoreScheduler()
 {
 }
 
+void RestoreScheduler::computeHotOrder(LogArchiver::ArchiveDirectory* archive)
+{
+    if (!hotFirst) { return; }
+
+    LogArchiver::ArchiveIndex* index = archive->getIndex();
+    w_assert0(index);
+
+    unsigned last = restore->getSegmentForPid(lastUsedPid);
+    bufferedRefs.resize(last + 1, 0);
+    std::vector<size_t> runCount(last + 1, 0);
+
+    // Run filters make each probe a few in-memory lookups
+    std::vector<LogArchiver::ArchiveIndex::ProbeResult> probes;
+    for (unsigned i = 0; i <= last; i++) {
+        PageID first = restore->getPidForSegment(i);
+        index->probe(probes, first, first + restore->getSegmentSize(),
+                lsn_t::null);
+        runCount[i] = probes.size();
+    }
+
+    hotOrder.resize(last + 1);
+    for (unsigned i = 0; i <= last; i++) { hotOrder[i] = i; }
+    std::stable_sort(hotOrder.begin(), hotOrder.end(),
+        [&] (unsigned a, unsigned b) {
+            if (bufferedRefs[a] != bufferedRefs[b]) {
+                return bufferedRefs[a] > bufferedRefs[b];
+            }
+            return runCount[a] > runCount[b];
+        });
+    hotCursor = 0;
+
+    DBG(<< "Hot restore order starts with segment " << hotOrder[0]);
+}
+
 void RestoreScheduler::enqueue(const PageID& pid)
 {
     spinlock_write_critical_section cs(&mutex);
@@ -212,6 +263,24 @@ bool RestoreScheduler::next(PageID& next, unsigned thread_id, bool peek)
             INC_TSTAT(restore_sched_queued);
         }
     }
+    else if (hotCursor < hotOrder.size()) {
+        // all threads follow the hot order, skipping segments restored on
+        // demand in the meantime
+        RestoreBitmap* bitmap = restore->getBitmap();
+        while (hotCursor < hotOrder.size()
+                && !bitmap->is_unrestored(hotOrder[hotCursor]))
+        {
+            hotCursor++;
+        }
+        // remaining segments are being restored by other threads
+        if (hotCursor == hotOrder.size()) { return false; }
+
+        next = restore->getPidForSegment(hotOrder[hotCursor]);
+        if (!peek) {
+            hotCursor++;
+            INC_TSTAT(restore_sched_hot);
+        }
+    }
     else if (singlePass) {
         next = firstNotRestored;
         // if queue is empty, find the first not-yet-restored PID
@@ -288,13 +357,60 @@ private:
     pthread_mutex_t requestMutex;
 };
 
+/** Read stage of pipelined restore (see RestoreMgr::pipelined)
+ *  Each restore thread has its own reader, which prepares the next segment
+ *  of the thread: it fixes the backup segment and opens the log archive scan
+ *  on it, which reads the first block of each run with updates on the
+ *  segment.
+ */
+class SegmentReader : public smthread_t {
+public:
+    SegmentReader(RestoreMgr* restore, unsigned thread_id);
+    virtual ~SegmentReader();
+
+    /** \brief Request read of a segment claimed by the restore thread.
+     * Only one read may be pending, i.e., not yet collected with waitRead().
+     */
+    void requestRead(unsigned segment);
+
+    /** \brief Wait for the pending read and collect its results.
+     * The merger is NULL if there are no log records to replay.
+     */
+    void waitRead(char*& workspace,
+            LogArchiver::ArchiveScanner::RunMerger*& merger);
+
+    virtual void run();
+
+    void shutdown();
+
+private:
+    RestoreMgr* restore;
+    unsigned threadId;
+    LogArchiver::ArchiveScanner logScan;
+
+    // Pending read and its results
+    bool pending;
+    bool requested;
+    bool done;
+    unsigned segment;
+    char* workspace;
+    LogArchiver::ArchiveScanner::RunMerger* merger;
+
+    // Signal to reader thread that it must exit
+    bool shutdownFlag;
+
+    pthread_cond_t requestCond;
+    pthread_cond_t doneCond;
+    pthread_mutex_t mutex;
+};
+
 RestoreMgr::RestoreMgr(const sm_options& options,
         LogArchiver::ArchiveDirectory* archive, vol_t* volume, bool useBackup,
         bool takeBackup)
     :
     archive(archive), volume(volume), numRestoredPages(0),
     useBackup(useBackup), takeBackup(takeBackup),
-    failureLSN(lsn_t::null), pinCount(0)
+    failureLSN(lsn_t::null), incrementalLSN(lsn_t::null), pinCount(0)
 {
     w_assert0(archive);
     w_assert0(volume);
@@ -319,6 +435,10 @@ RestoreMgr::RestoreMgr(const sm_options& options,
     logReadSize =
         options.get_int_option("sm_restore_log_read_size", 1048576);
 
+    pipelined = options.get_bool_option("sm_restore_pipeline", false);
+    // a segment being read, one being replayed, and one being written
+    size_t slotsPerThread = pipelined ? 3 : 1;
+
     DO_PTHREAD(pthread_mutex_init(&restoreCondMutex, NULL));
     DO_PTHREAD(pthread_cond_init(&restoreCond, NULL));
 
@@ -339,7 +459,8 @@ RestoreMgr::RestoreMgr(const sm_options& options,
         string backupImpl = options.get_string_option("sm_backup_kind",
                 BackupOnDemandReader::IMPL_NAME);
         if (backupImpl == BackupOnDemandReader::IMPL_NAME) {
-            backup = new BackupOnDemandReader(volume, segmentSize, restoreThreadCount);
+            backup = new BackupOnDemandReader(volume, segmentSize,
+                    restoreThreadCount, slotsPerThread);
         }
         else if (backupImpl == BackupPrefetcher::IMPL_NAME) {
             int numSegments = options.get_int_option(
@@ -367,7 +488,17 @@ RestoreMgr::RestoreMgr(const sm_options& options,
          * BackupReader object is still used for the restore workspace, which
          * is basically the buffer on which pages are restored.
          */
-        backup = new DummyBackupReader(segmentSize);
+        backup = new DummyBackupReader(segmentSize, restoreThreadCount,
+                slotsPerThread);
+    }
+
+    // Readers without prefetching can also write asynchronously if each
+    // thread has more than one workspace
+    if (pipelined && !asyncWriter
+            && options.get_bool_option("sm_backup_async_write", true))
+    {
+        asyncWriter = new SegmentWriter(this);
+        asyncWriter->fork();
     }
 
     scheduler = new RestoreScheduler(options, this);
@@ -399,6 +530,12 @@ bool RestoreMgr::try_shutdown()
     }
     restoreThreads.clear();
 
+    for (auto& r : segmentReaders) {
+        r->shutdown();
+        r->join();
+    }
+    segmentReaders.clear();
+
     if (asyncWriter) {
         asyncWriter->shutdown();
         asyncWriter->join();
@@ -465,6 +602,8 @@ bool RestoreMgr::requestRestore(const PageID& pid, generic_page* addr)
 
     DBGTHRD(<< "Requesting restore of page " << pid);
     scheduler->enqueue(pid);
+    // on-demand requests also go ahead of background prefetching
+    backup->prefetch(getSegmentForPid(pid), 1);
 
     if (addr && reuseRestoredBuffer) {
         spinlock_write_critical_section cs(&requestMutex);
@@ -614,8 +753,33 @@ void RestoreMgr::restoreSegment(char* workspace,
     INC_TSTAT(restore_invocations);
 }
 
+bool RestoreMgr::claimSegment(PageID requested, unsigned& segment)
+{
+    segment = getSegmentForPid(requested);
+
+    if (!bitmap->attempt_restore(segment)) {
+        // someone is already restoring or has already restored the segment
+        return false;
+    }
+
+    if (!segmentChanged.empty() && !segmentChanged[segment]) {
+        // incremental backup: segment is unchanged since last backup
+        bitmap->mark_replayed(segment);
+        markSegmentRestored(segment, true /* redo */);
+        INC_TSTAT(backup_skipped_segs);
+        return false;
+    }
+
+    return true;
+}
+
 void RestoreMgr::restoreLoop(unsigned id)
 {
+    if (pipelined) {
+        pipelinedRestoreLoop(id);
+        return;
+    }
+
     LogArchiver::ArchiveScanner logScan(archive);
 
     stopwatch_t timer;
@@ -631,13 +795,11 @@ void RestoreMgr::restoreLoop(unsigned id)
         timer.reset();
 
         // FOR EACH SEGMENT
-        unsigned segment = getSegmentForPid(requested);
-        PageID firstPage = getPidForSegment(segment);
-
-        if (!bitmap->attempt_restore(segment)) {
-            // someone is already restoring or has already restored the segment
+        unsigned segment;
+        if (!claimSegment(requested, segment)) {
             continue;
         }
+        PageID firstPage = getPidForSegment(segment);
 
         timer.reset();
 
@@ -677,6 +839,57 @@ void RestoreMgr::restoreLoop(unsigned id)
             << " pages restored");
 }
 
+void RestoreMgr::pipelinedRestoreLoop(unsigned id)
+{
+    SegmentReader* reader = segmentReaders[id].get();
+    bool pending = false;
+    unsigned segment = 0;
+    stopwatch_t timer;
+
+    while (numRestoredPages < lastUsedPid || pending) {
+        if (!pending) {
+            PageID requested;
+            if (!scheduler->next(requested, id)) {
+                // no page available for now
+                usleep(2000); // 2 ms
+                continue;
+            }
+            if (!claimSegment(requested, segment)) {
+                continue;
+            }
+            reader->requestRead(segment);
+        }
+
+        timer.reset();
+        char* workspace;
+        LogArchiver::ArchiveScanner::RunMerger* merger;
+        reader->waitRead(workspace, merger);
+        ADD_TSTAT(restore_pipeline_wait, timer.time_us());
+        unsigned current = segment;
+
+        // read the next segment while replaying this one
+        PageID requested;
+        pending = scheduler->next(requested, id)
+            && claimSegment(requested, segment);
+        if (pending) {
+            reader->requestRead(segment);
+        }
+
+        if (!merger) {
+            // segment does not need any log replay
+            finishSegment(workspace, current, segmentSize);
+            INC_TSTAT(restore_skipped_segs);
+            continue;
+        }
+
+        restoreSegment(workspace, merger, getPidForSegment(current), id);
+        delete merger;
+    }
+
+    DBG(<< "Restore thread finished! " << numRestoredPages
+            << " pages restored");
+}
+
 void RestoreMgr::finishSegment(char* workspace, unsigned segment, size_t count)
 {
     bitmap->mark_replayed(segment);
@@ -803,16 +1016,43 @@ void RestoreMgr::start()
         ERROUT(<< "Log archiver finished in " << timer.time() << " seconds");
     }
 
-    // if doing offline or single-pass restore, prefetch all segments
-    if (!scheduler->isOnDemand() || !instantRestore) {
+    if (!incrementalLSN.is_null()) {
+        w_assert0(takeBackup);
+        findChangedSegments();
+    }
+
+    // runs older than the backup also count towards hotness, since the
+    // backup LSN cannot be read while mark_failed holds the volume mutex
+    scheduler->computeHotOrder(archive);
+
+    // if doing offline or single-pass restore, prefetch all segments; with
+    // hot scheduling, prefetch them in the order in which they are restored
+    const std::vector<unsigned>& hotOrder = scheduler->getHotOrder();
+    if (!hotOrder.empty()) {
+        for (unsigned seg : hotOrder) {
+            if (segmentChanged.empty() || segmentChanged[seg]) {
+                backup->prefetch(seg);
+            }
+        }
+    }
+    else if (!scheduler->isOnDemand() || !instantRestore) {
         unsigned last = getSegmentForPid(lastUsedPid);
         for (unsigned i = 0; i <= last; i++) {
-            backup->prefetch(i);
+            if (segmentChanged.empty() || segmentChanged[i]) {
+                backup->prefetch(i);
+            }
         }
     }
 
     // kick-off restore threads
     w_assert0(restoreThreadCount > 0);
+    if (pipelined) {
+        for (unsigned i = 0; i < restoreThreadCount; i++) {
+            SegmentReader* r = new SegmentReader(this, i);
+            r->fork();
+            segmentReaders.emplace_back(r);
+        }
+    }
     for (unsigned i = 0; i < restoreThreadCount; i++) {
         // restoreThreads.emplace_back(new std::thread {&RestoreMgr::restoreLoop, this});
         RestoreThread* t = new RestoreThread {this, i};
@@ -821,6 +1061,34 @@ void RestoreMgr::start()
     }
 }
 
+void RestoreMgr::findChangedSegments()
+{
+    // Run filters of the index let probes skip runs without log records of
+    // a segment, so this costs a few in-memory filter lookups per segment
+    LogArchiver::ArchiveIndex* index = archive->getIndex();
+    w_assert0(index);
+
+    unsigned last = getSegmentForPid(lastUsedPid);
+    segmentChanged.assign(last + 1, false);
+    changedSegments.clear();
+
+    std::vector<LogArchiver::ArchiveIndex::ProbeResult> probes;
+    for (unsigned i = 0; i <= last; i++) {
+        PageID first = getPidForSegment(i);
+        index->probe(probes, first, first + segmentSize, incrementalLSN);
+        // probe only returns runs ending after the given LSN; false
+        // positives of the filters only cause unchanged segments to be
+        // written again
+        if (!probes.empty()) {
+            segmentChanged[i] = true;
+            changedSegments.push_back(i);
+        }
+    }
+
+    DBG(<< "Incremental backup since " << incrementalLSN << " includes "
+            << changedSegments.size() << " of " << last + 1 << " segments");
+}
+
 void RestoreMgr::shutdown()
 {
     w_assert1(bufferedRequests.size() == 0);
@@ -894,3 +1162,85 @@ void SegmentWriter::shutdown()
     CRITICAL_SECTION(cs, &requestMutex);
     shutdownFlag = true;
 }
+
+SegmentReader::SegmentReader(RestoreMgr* restore, unsigned thread_id)
+    : smthread_t(t_regular, "SegmentReader"),
+    restore(restore), threadId(thread_id), logScan(restore->archive),
+    pending(false), requested(false), done(false), segment(0),
+    workspace(NULL), merger(NULL), shutdownFlag(false)
+{
+    DO_PTHREAD(pthread_mutex_init(&mutex, NULL));
+    DO_PTHREAD(pthread_cond_init(&requestCond, NULL));
+    DO_PTHREAD(pthread_cond_init(&doneCond, NULL));
+}
+
+SegmentReader::~SegmentReader()
+{
+    DO_PTHREAD(pthread_cond_destroy(&doneCond));
+    DO_PTHREAD(pthread_cond_destroy(&requestCond));
+    DO_PTHREAD(pthread_mutex_destroy(&mutex));
+}
+
+void SegmentReader::requestRead(unsigned s)
+{
+    CRITICAL_SECTION(cs, &mutex);
+    w_assert1(!pending);
+    pending = true;
+    requested = true;
+    segment = s;
+    DO_PTHREAD(pthread_cond_signal(&requestCond));
+}
+
+void SegmentReader::waitRead(char*& w,
+        LogArchiver::ArchiveScanner::RunMerger*& m)
+{
+    CRITICAL_SECTION(cs, &mutex);
+    w_assert1(pending);
+    while (!done) {
+        DO_PTHREAD(pthread_cond_wait(&doneCond, &mutex));
+    }
+    w = workspace;
+    m = merger;
+    done = false;
+    pending = false;
+}
+
+void SegmentReader::run()
+{
+    while (true) {
+        unsigned s;
+        {
+            CRITICAL_SECTION(cs, &mutex);
+            while (!requested) {
+                if (shutdownFlag) { return; }
+                DO_PTHREAD(pthread_cond_wait(&requestCond, &mutex));
+            }
+            requested = false;
+            s = segment;
+        }
+
+        stopwatch_t timer;
+
+        char* w = restore->backup->fix(s, threadId);
+        ADD_TSTAT(restore_time_read, timer.time_us());
+
+        PageID firstPage = restore->getPidForSegment(s);
+        LogArchiver::ArchiveScanner::RunMerger* m = logScan.open(firstPage,
+                firstPage + restore->segmentSize,
+                restore->volume->get_backup_lsn(), 0);
+        ADD_TSTAT(restore_time_openscan, timer.time_us());
+
+        CRITICAL_SECTION(cs, &mutex);
+        workspace = w;
+        merger = m;
+        done = true;
+        DO_PTHREAD(pthread_cond_signal(&doneCond));
+    }
+}
+
+void SegmentReader::shutdown()
+{
+    CRITICAL_SECTION(cs, &mutex);
+    shutdownFlag = true;
+    DO_PTHREAD(pthread_cond_signal(&requestCond));
+}
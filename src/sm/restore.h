@@ -17,6 +17,7 @@ class RestoreScheduler;
 class generic_page;
 class BackupReader;
 class SegmentWriter;
+class SegmentReader;
 class RestoreThread;
 
 /** \brief Class that controls the process of restoring a failed volume
@@ -89,6 +90,23 @@ public:
      */
     void setFailureLSN(lsn_t l) { failureLSN = l; }
 
+    /** \brief Restrict a backup being taken to segments changed since LSN
+     *
+     * Only valid with takeBackup. Segments for which the log archive index
+     * has no log records with LSN greater than the given one are neither read
+     * nor written, so that the new backup only contains the segments changed
+     * since the backup taken at that LSN (i.e., an incremental backup). Must
+     * be called before start().
+     */
+    void setIncremental(lsn_t sinceLSN) { incrementalLSN = sinceLSN; }
+
+    /** \brief Segments written by an incremental backup
+     *
+     * Valid after start(). Empty if not taking an incremental backup.
+     */
+    const std::vector<unsigned>& getChangedSegments()
+    { return changedSegments; }
+
     /** \brief Gives the segment number of a certain page ID.
      */
     unsigned getSegmentForPid(const PageID& pid);
@@ -163,6 +181,19 @@ protected:
      */
     SegmentWriter* asyncWriter;
 
+    /** \brief Restore segments in a pipeline of three stages
+     *
+     * While a restore thread replays the log on one segment, its
+     * SegmentReader fixes the backup segment and opens the log archive scan
+     * (i.e., reads the first block of each run) for the next segment, and
+     * the SegmentWriter writes the segments restored before. Segments are
+     * then restored one at a time, i.e., without preemptive scheduling.
+     */
+    bool pipelined;
+
+    /** \brief Read stage of each restore thread (with pipelined) */
+    std::vector<std::unique_ptr<SegmentReader>> segmentReaders;
+
     /** \brief Size of a segment in pages
      *
      * The segment is the unit of restore, i.e., one segment is restored at a
@@ -214,6 +245,21 @@ protected:
      */
     lsn_t failureLSN;
 
+    /** \brief If not null, take an incremental backup of the segments changed
+     * since this LSN (see setIncremental)
+     */
+    lsn_t incrementalLSN;
+
+    /** \brief Whether each segment must be restored, in incremental backups
+     */
+    std::vector<bool> segmentChanged;
+    std::vector<unsigned> changedSegments;
+
+    /** \brief Probe the log archive index for segments that must be written
+     * to an incremental backup
+     */
+    void findChangedSegments();
+
     /** \brief Pin mechanism used to avoid the restore manager being destroyed
      * while other reader or writer thredas may still access it, even if just
      * to check whether restore finished or not
@@ -249,6 +295,16 @@ protected:
      */
     void restoreLoop(unsigned id);
 
+    /** \brief Restore loop of pipelined restore (see pipelined) */
+    void pipelinedRestoreLoop(unsigned id);
+
+    /** \brief Claims the segment of a page ID given by the scheduler
+     *
+     * Returns false if the segment is already being restored or has already
+     * been restored, or if an incremental backup skips it.
+     */
+    bool claimSegment(PageID requested, unsigned& segment);
+
     /** \brief Performs restore of a single segment; invoked from restoreLoop()
      *
      * Returns the number of pages that were restored in the segment. It may be
@@ -279,6 +335,8 @@ protected:
     friend class vol_t;
     // .. and from asynchronous writer (declared and defined on cpp file)
     friend class SegmentWriter;
+    // .. and from the read stage of pipelined restore
+    friend class SegmentReader;
 
     friend class RestoreThread;
 };
@@ -357,6 +415,13 @@ protected:
  * is a simple FIFO queue. When the queue is empty, the first non-restored
  * segment in disk order is returned. This means that if no requests come in,
  * the restore loop behaves like a single-pass restore.
+ *
+ * With option sm_restore_sched_hot, segments without requests are instead
+ * restored by all threads in descending order of an estimated hotness: the
+ * reference counts of the frames that the buffer pool held for each segment
+ * when the scheduler was created (i.e., at the time of the failure), and,
+ * as a secondary criterion, the number of log archive runs with updates on
+ * the segment. Queued on-demand requests always come first.
  */
 class RestoreScheduler {
 public:
@@ -369,6 +434,17 @@ public:
 
     bool isOnDemand() { return onDemand; }
 
+    /** \brief Computes the background restore order of hot scheduling
+     *
+     * Must be called before restore threads start and once the log archive
+     * contains all log records up to the failure. No-op without
+     * sm_restore_sched_hot.
+     */
+    void computeHotOrder(LogArchiver::ArchiveDirectory* archive);
+
+    /** \brief Segments in hot scheduling order (empty if not enabled) */
+    const std::vector<unsigned>& getHotOrder() { return hotOrder; }
+
 protected:
     RestoreMgr* restore;
 
@@ -378,6 +454,16 @@ protected:
     /// Support on-demand scheduling (if false, trySinglePass must be true)
     bool onDemand;
 
+    /// Restore segments without requests in order of hotness
+    bool hotFirst;
+
+    /// Buffer pool references of each segment at the time of the failure
+    std::vector<uint32_t> bufferedRefs;
+
+    /// Segments in descending order of hotness and position of next()
+    std::vector<unsigned> hotOrder;
+    size_t hotCursor;
+
     PageID firstDataPid;
     PageID lastUsedPid;
 
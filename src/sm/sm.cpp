@@ -97,6 +97,9 @@ bool        smlevel_0::logging_enabled = true;
 bool        smlevel_0::do_prefetch = false;
 
 bool        smlevel_0::statistics_enabled = true;
+bool        smlevel_0::log_delta_images = true;
+bool        smlevel_0::optimistic_traverse = false;
+bool        smlevel_0::simd_search = false;
 
 /*
  * _being_xct_mutex: Used to prevent xct creation during volume dismount.
@@ -236,6 +239,11 @@ ss_m::_construct_once()
      */
     shutting_down = false;
     shutdown_clean = _options.get_bool_option("sm_shutdown_clean", false);
+
+    // I/O backend for batched requests (page cleaner, backup prefetcher and
+    // log flusher)
+    sthread_t::set_io_uring(_options.get_bool_option("sm_io_uring", false),
+            _options.get_int_option("sm_io_uring_depth", 64));
     // if (_options.get_bool_option("sm_format", false)) {
     //     shutdown_clean = true;
     // }
@@ -313,6 +321,12 @@ ss_m::_construct_once()
     }
 
     smlevel_0::statistics_enabled = _options.get_bool_option("sm_statistics", true);
+    smlevel_0::log_delta_images =
+        _options.get_bool_option("sm_log_delta_images", true);
+    smlevel_0::optimistic_traverse =
+        _options.get_bool_option("sm_btree_optimistic_traverse", false);
+    smlevel_0::simd_search =
+        _options.get_bool_option("sm_btree_simd_search", false);
 
     ERROUT(<< "[" << timer.time_ms() << "] Initializing buffer cleaner and other services");
 
@@ -636,6 +650,30 @@ ss_m::commit_xct(bool lazy, lsn_t* plastlsn)
     return RCOK;
 }
 
+/*--------------------------------------------------------------*
+ *  ss_m::commit_xct_async()                                    *
+ *--------------------------------------------------------------*/
+rc_t
+ss_m::commit_xct_async(std::function<void()> on_durable, lsn_t* plastlsn)
+{
+    lsn_t commit_lsn = lsn_t::null;
+    W_DO(commit_xct(true, &commit_lsn));
+    INC_TSTAT(commit_xct_async_cnt);
+    if (plastlsn) { *plastlsn = commit_lsn; }
+
+    if (!log) {
+        on_durable();
+        return RCOK;
+    }
+    if (!commit_lsn.valid()) {
+        // read-only transaction
+        commit_lsn = log->curr_lsn().advance(-1);
+    }
+    log->flush_async(commit_lsn, on_durable);
+
+    return RCOK;
+}
+
 /*--------------------------------------------------------------*
  *  ss_m::abort_xct()                                *
  *--------------------------------------------------------------*/
@@ -74,6 +74,8 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
 #include <smstats.h> // declares sm_stats_info_t and sm_config_info_t
 #include <lsn.h>
 #include <string>
+#include <vector>
+#include <functional>
 #include "sm_options.h"
 
 /* DOXYGEN Documentation : */
@@ -168,11 +170,55 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
  *      - required?: no
  *
  * -sm_bufferpool_replacement_policy
- *      - type: string (one of clock|random)
+ *      - type: string (one of clock|clock_pro|random)
  *      - description: Sets the page replacement policy of the buffer pool.
+ *      clock gives a second chance to referenced frames; clock_pro is a
+ *      scan-resistant variant that separates hot and cold frames; random
+ *      evicts any leaf page that can be latched.
  *      - default: clock
  *      - required?: no
  *
+ * -sm_bufferpool_prefetch_threads
+ *      - type: int
+ *      - description: Number of threads that read pages requested with
+ *      bf_tree_m::prefetch() (e.g., by B-tree scans and buffer pool warmup),
+ *      i.e., the maximum number of prefetch reads in flight. 0 disables
+ *      prefetching.
+ *      - default: 4
+ *      - required?: no
+ *
+ * -sm_bufferpool_freelist_shards
+ *      - type: int
+ *      - description: Number of shards of the buffer pool free list. Each
+ *      thread grabs free frames from its own shard and only steals from
+ *      other shards when its own is empty. 0 means one shard per hardware
+ *      thread (at most 64).
+ *      - default: 0
+ *      - required?: no
+ *
+ * -sm_evictor_low_watermark
+ *      - type: int
+ *      - description: Percentage of buffer pool frames below which the
+ *      number of free frames wakes up the background evictor. 0 disables the
+ *      evictor, in which case threads that find no free frame evict pages
+ *      themselves.
+ *      - default: 1
+ *      - required?: no
+ *
+ * -sm_evictor_high_watermark
+ *      - type: int
+ *      - description: Percentage of buffer pool frames that the background
+ *      evictor tries to keep free once woken up.
+ *      - default: 2
+ *      - required?: no
+ *
+ * -sm_evictor_interval_millisec
+ *      - type: int
+ *      - description: Interval at which the background evictor checks the
+ *      watermarks even if not woken up (negative means only on wakeup).
+ *      - default: 1000
+ *      - required?: no
+ *
  * -sm_bufferpool_swizzle
  *      - type: Boolean
  *      - description: Enables pointer swizzling in buffer pool.
@@ -186,6 +232,22 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
  *      - default: 1
  *      - required?: no
  *
+ * -sm_io_uring
+ *      - type: Boolean
+ *      - description: Submits batched I/O requests of the page cleaner,
+ *      the backup prefetcher and the log flusher asynchronously with Linux
+ *      io_uring. If the kernel does not support io_uring, the requests are
+ *      executed synchronously with preadv/pwritev.
+ *      - default: no
+ *      - required?: no
+ *
+ * -sm_io_uring_depth
+ *      - type: number
+ *      - description: Queue depth of the io_uring of each thread, i.e., the
+ *      maximum number of requests in flight per thread.
+ *      - default: 64
+ *      - required?: no
+ *
  * -sm_prefetch
  *      - type: Boolean
  *      - description: Enables prefetching for scans.
@@ -207,6 +269,14 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
  *      - default: yes
  *      - required?: no
  *
+ * -sm_log_delta_images
+ *      - type: Boolean
+ *      - description: Delta-encodes the before and after images of B-tree
+ *      updates and overwrites, i.e., only the range of bytes that actually
+ *      changes is logged (same-length updates are logged as overwrites).
+ *      - default: yes
+ *      - required?: no
+ *
  * -sm_lock_caching
  *      - type: Boolean
  *      - description: Enables caching of transaction locks in transaction.
@@ -230,6 +300,22 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
  *  - default: see sm.cpp for initial setting
  *  - required?: no
  *
+ * -sm_restart_redo_threads
+ *  - type: number
+ *  - description: number of threads replaying page log records in log-based
+ *     REDO (non-instant restart). Records are assigned to threads by page ID,
+ *     so that each page is still recovered in LSN order. With 1, records are
+ *     replayed by the log scan thread.
+ *  - default: 1
+ *  - required?: no
+ *
+ * -sm_restart_undo_threads
+ *  - type: number
+ *  - description: number of threads rolling back loser transactions during
+ *     UNDO. With 1, loser transactions are rolled back one at a time.
+ *  - default: 1
+ *  - required?: no
+ *
  *  -sm_archdir;
  *      - type: string
  *      - description: directory in which to store log archive runs
@@ -277,6 +363,15 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
  *      - description: Size of sort workspace of log archiver
  *      - default: 104857600 (100 MB)
  *      - required?: no
+ *
+ *  -sm_archiver_sort_threads;
+ *      - type:  int
+ *      - description: Number of threads used by the log archiver to sort
+ *      runs. With 1, runs are generated with replacement selection on a
+ *      single heap; with more, each run is loaded into the workspace and
+ *      sorted in parallel over disjoint page ID ranges.
+ *      - default: 1
+ *      - required?: no
  *
   */
 
@@ -403,11 +498,30 @@ class lid_m;
 class sm_stats_cache_t;
 class prologue_rc_t;
 class w_keystr_t;
+class cvec_t;
 class verify_volume_result;
 class lil_global_table;
 struct okvl_mode;
 
 class key_ranges_map;
+
+/**\brief Supplies the entries of a bulk load in ascending key order.
+ * \ingroup SSMBTREE
+ * \details
+ * See ss_m::bulk_load_index().
+ */
+class bulk_load_source_t {
+public:
+    virtual ~bulk_load_source_t() {}
+
+    /**
+     * Returns the next entry in key and el, or false if there are no more.
+     * Keys must be strictly increasing.  The data el refers to only needs to
+     * stay valid until the next call.
+     */
+    virtual bool next(w_keystr_t& key, cvec_t& el) = 0;
+};
+
 /**\addtogroup SSMSP
  * A transaction may perform a partial rollback using savepoints.
  * The transaction populates a savepoint by calling ss_m::save_work,
@@ -740,6 +854,27 @@ public:
                                     bool              lazy = false,
                                     lsn_t*            plastlsn=NULL);
 
+    /**\brief Commit a transaction without waiting for its log records
+     * to become durable.
+     *\ingroup SSMXCT
+     * @param[in] on_durable  Called once the commit is durable.
+     * @param[out] plastlsn   If non-null, receives the LSN of the last log
+     *                    record of this transaction, as in commit_xct.
+     * \details
+     *
+     * Commits the attached transaction like a lazy commit_xct, releasing its
+     * locks and detaching it, and returns without waiting for the log flush.
+     * The flush daemon calls \a on_durable (see log_core::flush_async) as
+     * soon as the commit log record is durable, so that the caller can run
+     * further transactions while the flush is in progress and report the
+     * outcome of this one only afterwards. A read-only transaction may have
+     * read updates of commits that are not durable yet, so it is notified
+     * once everything logged before its commit is durable.
+     */
+    static rc_t            commit_xct_async(
+                                    std::function<void()> on_durable,
+                                    lsn_t*                plastlsn=NULL);
+
     /**
      * \brief Commit a system transaction, which doesn't cause log sync.
      * \ingroup SSMXCT
@@ -1210,6 +1345,26 @@ public:
      */
     static rc_t            touch_index(StoreID stid, uint64_t &page_count);
 
+    /**
+     * \brief Fills an empty B+-Tree index with entries supplied in key order.
+     * \ingroup SSMBTREE
+     * @param[in] stid  ID of the index, which must be empty.
+     * @param[in] source  Supplies the entries in strictly increasing key order.
+     * @param[in] fill_factor  Fraction of each page to fill, in (0, 1].
+     * \details
+     * Builds the tree bottom-up: leaves are filled in key order up to
+     * fill_factor and the interior levels are built from them directly,
+     * without traversals, key locks or splits.  Each page is logged as one
+     * page image instead of one log record per entry.
+     *
+     * Takes an exclusive lock on the index.  The pages are created by system
+     * transactions, so the loaded entries are \e not removed if the calling
+     * transaction aborts.  Returns eNDXNOTEMPTY if the index has entries,
+     * eDUPLICATE or eBADARGUMENT if the keys are not strictly increasing.
+     */
+    static rc_t            bulk_load_index(StoreID stid, bulk_load_source_t& source,
+                                           double fill_factor = 1.0);
+
     /**
      * \brief Create an entry in a B+-Tree index.
      * \ingroup SSMBTREE
@@ -1235,6 +1390,29 @@ public:
         const vec_t&             el
     );
 
+    /**
+     * \brief Create the entries of a batch in a B+-Tree index.
+     * \ingroup SSMBTREE
+     *
+     * @param[in] stid  ID of the index.
+     * @param[in] keys  Keys of the associations to be created.
+     * @param[in] elems  Elements of the associations, one for each key.
+     * @param[out] results  For each key, w_error_ok if it was created,
+     *                 eDUPLICATE if the key exists or eRECWONTFIT if the
+     *                 entry exceeds \ref max_entry_size.
+     *
+     * Same as create_assoc() for each entry, but the entries are inserted in
+     * key order and keys falling into the leaf page of the previous key are
+     * inserted without traversing the tree again.  Each key is still locked
+     * individually.
+     */
+    static rc_t            create_assoc_batch(
+        StoreID                            stid,
+        const std::vector<w_keystr_t>&     keys,
+        const std::vector<std::string>&    elems,
+        std::vector<w_error_codes>&        results
+    );
+
     /**
      * \brief Update record data of an entry in a B+-Tree index.
      * \ingroup SSMBTREE
@@ -1306,6 +1484,25 @@ public:
         bool&                   found
     );
 
+    /** \brief Find the entries associated with a batch of keys in a B+-Tree index.
+     * \ingroup SSMBTREE
+     *
+     * @param[in] stid  ID of the index.
+     * @param[in] keys  Keys to look up.
+     * @param[out] elems  Element associated with each key found.
+     * @param[out] found  True for each key with an entry.
+     *
+     * Same as find_assoc() for each key, but the keys are looked up in key
+     * order and keys falling into the leaf page of the previous key are found
+     * without traversing the tree again.
+     */
+    static rc_t            find_assoc_batch(
+        StoreID                         stid,
+        const std::vector<w_keystr_t>&  keys,
+        std::vector<std::string>&       elems,
+        std::vector<bool>&              found
+    );
+
     /**
      * \brief Defrags the given page to remove holes and ghost records in the page.
      * \ingroup SSMBTREE
@@ -328,6 +328,9 @@ public:
     static bool         lock_caching_default;
     static bool         do_prefetch;
     static bool         statistics_enabled;
+    static bool         log_delta_images;
+    static bool         optimistic_traverse;
+    static bool         simd_search;
 
     // This is a zeroed page for use wherever initialized memory
     // is needed.
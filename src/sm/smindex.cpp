@@ -56,6 +56,18 @@ rc_t ss_m::touch_index(StoreID stid, uint64_t &page_count)
     return RCOK;
 }
 
+rc_t ss_m::bulk_load_index(StoreID stid, bulk_load_source_t& source,
+                           double fill_factor)
+{
+    PageID root_pid;
+    if (g_xct_does_need_lock()) {
+        W_DO(lm->intent_store_lock(stid, okvl_mode::X));
+    }
+    W_DO(open_store_nolock (stid, root_pid));
+    W_DO( bt->bulk_load(stid, source, fill_factor) );
+    return RCOK;
+}
+
 rc_t ss_m::create_assoc(StoreID stid, const w_keystr_t& key, const vec_t& el)
 {
     PageID root_pid;
@@ -64,6 +76,16 @@ rc_t ss_m::create_assoc(StoreID stid, const w_keystr_t& key, const vec_t& el)
     return RCOK;
 }
 
+rc_t ss_m::create_assoc_batch(StoreID stid, const std::vector<w_keystr_t>& keys,
+                              const std::vector<std::string>& elems,
+                              std::vector<w_error_codes>& results)
+{
+    PageID root_pid;
+    W_DO(open_store (stid, root_pid, true));
+    W_DO( bt->insert_batch(stid, keys, elems, results) );
+    return RCOK;
+}
+
 rc_t ss_m::update_assoc(StoreID stid, const w_keystr_t& key, const vec_t& el)
 {
     PageID root_pid;
@@ -107,6 +129,17 @@ rc_t ss_m::find_assoc(StoreID stid, const w_keystr_t& key,
     return RCOK;
 }
 
+rc_t ss_m::find_assoc_batch(StoreID stid, const std::vector<w_keystr_t>& keys,
+                            std::vector<std::string>& elems,
+                            std::vector<bool>& found)
+{
+    PageID root_pid;
+    bool for_update = g_xct_does_ex_lock_for_select();
+    W_DO(open_store (stid, root_pid, for_update));
+    W_DO( bt->lookup_batch(stid, keys, elems, found) );
+    return RCOK;
+}
+
 rc_t ss_m::verify_index(StoreID stid, int hash_bits, bool &consistent)
 {
     PageID root_pid;
@@ -9,6 +9,7 @@
 #include "eventlog.h"
 
 stnode_cache_t::stnode_cache_t(bool create)
+    : clean_lsn(lsn_t::null)
 {
     int res= posix_memalign((void**) &_stnode_page, sizeof(generic_page),
             sizeof(generic_page));
@@ -132,6 +133,11 @@ lsn_t stnode_cache_t::get_page_lsn() {
     return prev_page_lsn;
 }
 
+lsn_t stnode_cache_t::get_clean_lsn() {
+    CRITICAL_SECTION (cs, _latch);
+    return clean_lsn;
+}
+
 rc_t stnode_cache_t::write_page(lsn_t rec_lsn)
 {
     generic_page* buf;
@@ -142,6 +148,10 @@ rc_t stnode_cache_t::write_page(lsn_t rec_lsn)
     W_DO(smlevel_0::vol->read_page_verify(stnode_page::stpid, buf, emlsn));
     W_DO(smlevel_0::vol->write_page(stnode_page::stpid, buf));
     sysevent::log_page_write(stnode_page::stpid, rec_lsn, 1);
+    {
+        CRITICAL_SECTION (cs, _latch);
+        clean_lsn = rec_lsn;
+    }
 
     delete[] buf;
     return RCOK;
@@ -132,6 +132,10 @@ public:
 
     lsn_t get_page_lsn();
 
+    /** rec_lsn given to the last write_page, or null if not written since
+     * the system started */
+    lsn_t get_clean_lsn();
+
     rc_t write_page(lsn_t rec_lsn);
 
 private:
@@ -147,6 +151,8 @@ private:
     /// Required to maintain per-page log chain (see comments on alloc_cache.h)
     lsn_t prev_page_lsn;
 
+    lsn_t clean_lsn;
+
     /// Returns the first StoreID that can be used for a new store in
     /// this volume or stnode_page::max if all available stores of
     /// this volume are already allocated.
@@ -22,6 +22,8 @@
 #include "restore.h"
 #include "logarchiver.h"
 #include "eventlog.h"
+
+#include <fstream>
 #include "restart.h"
 
 #include "sm.h"
@@ -35,7 +37,7 @@ vol_t::vol_t(const sm_options& options, chkpt_t* chkpt_info)
                _fake_disk_latency(0),
                _alloc_cache(NULL), _stnode_cache(NULL),
                _failed(false),
-               _restore_mgr(NULL), _dirty_pages(NULL), _backup_fd(-1),
+               _restore_mgr(NULL), _dirty_pages(NULL),
                _current_backup_lsn(lsn_t::null), _backup_write_fd(-1),
                _log_page_reads(false)
 {
@@ -45,6 +47,7 @@ vol_t::vol_t(const sm_options& options, chkpt_t* chkpt_info)
     _log_page_reads = options.get_bool_option("sm_vol_log_reads", false);
     _use_o_sync = options.get_bool_option("sm_vol_o_sync", true);
     _use_o_direct = options.get_bool_option("sm_vol_o_direct", false);
+    _alloc_chunk_pages = options.get_int_option("sm_alloc_chunk_pages", 64);
 
     spinlock_write_critical_section cs(&_mutex);
 
@@ -82,7 +85,7 @@ vol_t::~vol_t()
     }
 
     w_assert1(_unix_fd == -1);
-    w_assert1(_backup_fd == -1);
+    w_assert1(_backup_chain.empty());
     if (_restore_mgr) {
         delete _restore_mgr;
     }
@@ -100,7 +103,8 @@ void vol_t::build_caches(bool truncate)
     w_assert1(_stnode_cache);
     _stnode_cache->dump(cerr);
 
-    _alloc_cache = new alloc_cache_t(*_stnode_cache, truncate);
+    _alloc_cache = new alloc_cache_t(*_stnode_cache, truncate,
+            _alloc_chunk_pages);
     w_assert1(_alloc_cache);
 }
 
@@ -125,22 +129,120 @@ void vol_t::delete_dirty_page(PageID pid)
     }
 }
 
+/**
+ * Segment map of an incremental backup: LSN of the backup it is based on,
+ * segment size, and the segments contained in the backup file.
+ */
+static string segment_map_path(const string& backupPath)
+{
+    return backupPath + ".segmap";
+}
+
+static void write_segment_map(const string& backupPath, lsn_t baseLSN,
+        size_t segmentSize, const std::vector<unsigned>& segments)
+{
+    ofstream ofs(segment_map_path(backupPath), ios::binary | ios::trunc);
+    size_t count = segments.size();
+    ofs.write((char*) &baseLSN, sizeof(lsn_t));
+    ofs.write((char*) &segmentSize, sizeof(size_t));
+    ofs.write((char*) &count, sizeof(size_t));
+    if (count > 0) {
+        ofs.write((char*) &segments[0], sizeof(unsigned) * count);
+    }
+    ofs.flush();
+    w_assert0(ofs.good());
+}
+
+/** Returns false if the given backup is a full backup (i.e., has no map) */
+static bool read_segment_map(const string& backupPath, lsn_t& baseLSN,
+        size_t& segmentSize, std::vector<bool>& segmentSet)
+{
+    ifstream ifs(segment_map_path(backupPath), ios::binary);
+    if (!ifs.is_open()) { return false; }
+
+    size_t count = 0;
+    ifs.read((char*) &baseLSN, sizeof(lsn_t));
+    ifs.read((char*) &segmentSize, sizeof(size_t));
+    ifs.read((char*) &count, sizeof(size_t));
+    std::vector<unsigned> segments(count);
+    if (count > 0) {
+        ifs.read((char*) &segments[0], sizeof(unsigned) * count);
+    }
+    w_assert0(ifs.good());
+
+    segmentSet.clear();
+    for (size_t i = 0; i < count; i++) {
+        if (segments[i] >= segmentSet.size()) {
+            segmentSet.resize(segments[i] + 1, false);
+        }
+        segmentSet[segments[i]] = true;
+    }
+    return true;
+}
+
 rc_t vol_t::open_backup()
 {
     // mutex held by caller -- no concurrent backup being added
-    string backupFile = _backups.back();
+    w_assert1(_backup_chain.empty());
+
+    // An incremental backup only contains the segments changed since the
+    // backup before it, so the chain goes back to the last full backup
+    std::vector<backup_file_t> chain;
+    std::vector<size_t> chainIdx;
+    size_t i = _backups.size();
+    while (i > 0) {
+        i--;
+        backup_file_t f;
+        f.fd = -1;
+        f.segment_size = 0;
+        lsn_t baseLSN = lsn_t::null;
+        bool incremental = read_segment_map(_backups[i], baseLSN,
+                f.segment_size, f.segments);
+        if (incremental && (i == 0 || _backup_lsns[i - 1] != baseLSN)) {
+            W_FATAL_MSG(eNO_BACKUP_FILE, << "Base of incremental backup "
+                    << _backups[i] << " (LSN " << baseLSN << ") is missing");
+        }
+        if (incremental && f.segments.empty()) {
+            // nothing changed -- keep an empty map, but read nothing from it
+            f.segments.push_back(false);
+        }
+        chain.insert(chain.begin(), f);
+        chainIdx.insert(chainIdx.begin(), i);
+        if (!incremental) { break; }
+    }
+
     // Using direct I/O
     int open_flags = smthread_t::OPEN_RDONLY | smthread_t::OPEN_SYNC;
     if (_use_o_direct) {
         open_flags |= smthread_t::OPEN_DIRECT;
     }
-    W_DO(me()->open(backupFile.c_str(), open_flags, 0666, _backup_fd));
-    w_assert0(_backup_fd > 0);
+    for (size_t k = 0; k < chain.size(); k++) {
+        string backupFile = _backups[chainIdx[k]];
+        W_DO(me()->open(backupFile.c_str(), open_flags, 0666, chain[k].fd));
+        w_assert0(chain[k].fd > 0);
+    }
+    _backup_chain = chain;
     _current_backup_lsn = _backup_lsns.back();
 
     return RCOK;
 }
 
+void vol_t::close_backup()
+{
+    for (size_t k = 0; k < _backup_chain.size(); k++) {
+        W_COERCE(me()->close(_backup_chain[k].fd));
+    }
+    _backup_chain.clear();
+    _current_backup_lsn = lsn_t::null;
+}
+
+size_t vol_t::backup_for_pid(PageID pid) const
+{
+    size_t k = _backup_chain.size() - 1;
+    while (k > 0 && !_backup_chain[k].contains(pid)) { k--; }
+    return k;
+}
+
 lsn_t vol_t::get_backup_lsn()
 {
     spinlock_read_critical_section cs(&_mutex);
@@ -168,7 +270,7 @@ rc_t vol_t::mark_failed(bool /*evict*/, bool redo)
      */
 
     // open backup file -- may already be open due to new backup being taken
-    if (useBackup && _backup_fd < 0) {
+    if (useBackup && _backup_chain.empty()) {
         W_DO(open_backup());
     }
 
@@ -246,12 +348,8 @@ bool vol_t::check_restore_finished()
             delete _restore_mgr;
             _restore_mgr = NULL;
 
-            // close backup file
-            if (_backup_fd > 0) {
-                W_COERCE(me()->close(_backup_fd));
-                _backup_fd = -1;
-                _current_backup_lsn = lsn_t::null;
-            }
+            // close backup files
+            close_backup();
 
             _failed = false;
             return true;
@@ -281,11 +379,7 @@ rc_t vol_t::dismount(bool abrupt)
         if (_failed) {
             // wait for ongoing restore to complete
             _restore_mgr->shutdown();
-            if (_backup_fd > 0) {
-                W_COERCE(me()->close(_backup_fd));
-                _backup_fd = -1;
-                _current_backup_lsn = lsn_t::null;
-            }
+            close_backup();
             _failed = false;
         }
         // CS TODO -- also make sure no restart is ongoing
@@ -339,10 +433,10 @@ void vol_t::shutdown(bool abrupt)
     W_COERCE(dismount(abrupt));
 }
 
-rc_t vol_t::alloc_a_page(PageID& shpid, bool redo)
+rc_t vol_t::alloc_a_page(PageID& shpid, bool redo, StoreID stid)
 {
     w_assert1(_alloc_cache);
-    W_DO(_alloc_cache->sx_allocate_page(shpid, redo));
+    W_DO(_alloc_cache->sx_allocate_page(shpid, redo, stid));
     INC_TSTAT(page_alloc_cnt);
 
     return RCOK;
@@ -559,9 +653,49 @@ rc_t vol_t::read_many_pages(PageID first_page, generic_page* const buf, int cnt,
     return RCOK;
 }
 
+rc_t vol_t::read_page_runs(generic_page* const buf,
+        const std::vector<std::pair<PageID, size_t> >& runs)
+{
+    if (_failed) {
+        // let read_many_pages deal with restore
+        generic_page* dest = buf;
+        for (size_t i = 0; i < runs.size(); i++) {
+            W_DO(read_many_pages(runs[i].first, dest, runs[i].second));
+            dest += runs[i].second;
+        }
+        return RCOK;
+    }
+
+    std::vector<sthread_t::iovec_t> iov(runs.size());
+    std::vector<sthread_t::io_request_t> reqs;
+    reqs.reserve(runs.size());
+    generic_page* dest = buf;
+    for (size_t i = 0; i < runs.size(); i++) {
+        w_assert1(runs[i].second > 0);
+        memset(dest, '\0', runs[i].second * sizeof(generic_page));
+        iov[i] = sthread_t::iovec_t(dest,
+                runs[i].second * sizeof(generic_page));
+        reqs.push_back(sthread_t::io_request_t(false, &iov[i], 1,
+                    size_t(runs[i].first) * sizeof(generic_page)));
+        dest += runs[i].second;
+    }
+    if (reqs.empty()) { return RCOK; }
+
+    // short reads are fine: pages past the end of the volume stay zeroed
+    W_DO(me()->pio(_unix_fd, &reqs[0], reqs.size()));
+
+    if (_log_page_reads) {
+        for (size_t i = 0; i < runs.size(); i++) {
+            sysevent::log_page_read(runs[i].first, runs[i].second);
+        }
+    }
+
+    return RCOK;
+}
+
 rc_t vol_t::read_backup(PageID first, size_t count, void* buf)
 {
-    if (_backup_fd < 0) {
+    if (_backup_chain.empty()) {
         W_FATAL_MSG(eINTERNAL,
                 << "Cannot read from backup because it is not active");
     }
@@ -575,8 +709,28 @@ rc_t vol_t::read_backup(PageID first, size_t count, void* buf)
     memset(buf, 0, sizeof(generic_page) * count);
 
     int read_count = 0;
-    W_DO(me()->pread_short(_backup_fd, (char *) buf, count * sizeof(generic_page),
-                offset, read_count));
+    if (_backup_chain.size() == 1) {
+        W_DO(me()->pread_short(_backup_chain[0].fd, (char *) buf,
+                    count * sizeof(generic_page), offset, read_count));
+    }
+    else {
+        // Read each run of pages from the newest backup in the chain that
+        // contains it
+        size_t i = 0;
+        while (i < count) {
+            size_t k = backup_for_pid(first + i);
+            size_t j = i + 1;
+            while (j < count && backup_for_pid(first + j) == k) { j++; }
+
+            int run_count = 0;
+            W_DO(me()->pread_short(_backup_chain[k].fd,
+                        (char*) buf + i * sizeof(generic_page),
+                        (j - i) * sizeof(generic_page),
+                        offset + i * sizeof(generic_page), run_count));
+            read_count += run_count;
+            i = j;
+        }
+    }
 
     // Short I/O is still possible because backup is only taken until last used
     // page, i.e., the file may be smaller than the total quota.
@@ -596,10 +750,51 @@ rc_t vol_t::read_backup(PageID first, size_t count, void* buf)
     return RCOK;
 }
 
-rc_t vol_t::take_backup(string path, bool flushArchive)
+rc_t vol_t::read_backup_many(
+        const std::vector<std::pair<PageID, void*> >& segments, size_t count)
+{
+    if (_backup_chain.empty()) {
+        W_FATAL_MSG(eINTERNAL,
+                << "Cannot read from backup because it is not active");
+    }
+
+    if (_backup_chain.size() > 1) {
+        // segments may come from different files of an incremental chain
+        for (size_t i = 0; i < segments.size(); i++) {
+            W_DO(read_backup(segments[i].first, count, segments[i].second));
+        }
+        return RCOK;
+    }
+
+    std::vector<sthread_t::iovec_t> iov(segments.size());
+    std::vector<sthread_t::io_request_t> reqs;
+    reqs.reserve(segments.size());
+    for (size_t i = 0; i < segments.size(); i++) {
+        PageID first = segments[i].first;
+        size_t segCount = count;
+        // adjust count to avoid short I/O (see read_backup)
+        if (first + segCount > num_used_pages()) {
+            segCount = num_used_pages() - first;
+        }
+        memset(segments[i].second, 0, sizeof(generic_page) * segCount);
+
+        iov[i] = sthread_t::iovec_t(segments[i].second,
+                segCount * sizeof(generic_page));
+        reqs.push_back(sthread_t::io_request_t(false, &iov[i], 1,
+                    size_t(first) * sizeof(generic_page)));
+    }
+
+    W_DO(me()->pio(_backup_chain[0].fd, &reqs[0], reqs.size()));
+
+    return RCOK;
+}
+
+rc_t vol_t::take_backup(string path, bool flushArchive, bool incremental)
 {
     // Open old backup file, if available
     bool useBackup = false;
+    bool openedBackup = false;
+    lsn_t baseLSN = lsn_t::null;
     {
         spinlock_write_critical_section cs(&_mutex);
 
@@ -614,49 +809,77 @@ rc_t vol_t::take_backup(string path, bool flushArchive)
 
         useBackup = _backups.size() > 0;
 
-        if (useBackup && _backup_fd < 0) {
+        if (useBackup && _backup_chain.empty()) {
             // no ongoing restore -- we must open old backup ourselves
             W_DO(open_backup());
+            openedBackup = true;
+        }
+
+        // Incremental backups require the LSN of the previous backup;
+        // otherwise, a full backup is taken
+        if (incremental && useBackup) {
+            baseLSN = _backup_lsns.back();
         }
     }
 
     // No need to hold latch here -- mutual exclusion is guaranteed because
     // only one thread may set _backup_write_fd (i.e., open file) above.
 
-    // Maximum LSN which is guaranteed to be reflected in the backup
-    // lsn_t backupLSN = ss_m::logArchiver->getDirectory()->getLastLSN();
-    // DBG1(<< "Taking backup until LSN " << backupLSN);
+    LogArchiver* la = ss_m::logArchiver;
+    lsn_t currLSN = smlevel_0::log->durable_lsn();
+    if (flushArchive) {
+        la->archiveUntilLSN(currLSN);
+        DBGTHRD(<< "Taking sharp backup until " << currLSN);
+    }
+
+    // Maximum LSN which is guaranteed to be reflected in the backup: all
+    // runs archived so far are seen by every segment restored below
+    lsn_t backupLSN = la->getDirectory()->getLastLSN();
+    DBG1(<< "Taking backup until LSN " << backupLSN);
 
     // Instantiate special restore manager for taking backup
-    RestoreMgr restore(ss_m::get_options(), ss_m::logArchiver->getDirectory(),
+    RestoreMgr restore(ss_m::get_options(), la->getDirectory(),
             this, useBackup, true /* takeBackup */);
 
     restore.setInstant(false);
     if (flushArchive) {
-        lsn_t currLSN = smlevel_0::log->durable_lsn();
         restore.setFailureLSN(currLSN);
-        DBGTHRD(<< "Taking sharp backup until " << currLSN);
+    }
+    if (!baseLSN.is_null()) {
+        restore.setIncremental(baseLSN);
     }
 
     restore.start();
     restore.shutdown();
     // TODO -- do we have to catch errors from restore thread?
 
+    ADD_TSTAT(backup_full_bytes,
+            size_t(restore.getLastUsedPid() + 1) * sizeof(generic_page));
+
+    if (!baseLSN.is_null()) {
+        write_segment_map(path, baseLSN, restore.getSegmentSize(),
+                restore.getChangedSegments());
+    }
+
     // Write volume header and metadata to new backup
     // (must be done after restore so that alloc pages are correct)
     // CS TODO
     // volhdr_t vhdr(_vid, _num_pages, backupLSN);
     // W_DO(vhdr.write(_backup_write_fd));
 
-    // At this point, new backup is fully written
-    // add_backup(path, backupLSN);
     {
         // critical section to guarantee visibility of the fd update
         spinlock_write_critical_section cs(&_mutex);
         W_DO(me()->close(_backup_write_fd));
         _backup_write_fd = -1;
+        if (openedBackup && !_failed) {
+            close_backup();
+        }
     }
 
+    // At this point, new backup is fully written
+    W_DO(sx_add_backup(path, backupLSN));
+
     DBG1(<< "Finished taking backup");
 
     return RCOK;
@@ -670,6 +893,7 @@ rc_t vol_t::write_backup(PageID first, size_t count, void* buf)
 
     W_DO(me()->pwrite(_backup_write_fd, buf, sizeof(generic_page) * count,
                 offset));
+    ADD_TSTAT(backup_bytes_written, sizeof(generic_page) * count);
 
     DBG(<< "Wrote out " << count << " pages into backup offset " << offset);
 
@@ -756,6 +980,52 @@ rc_t vol_t::write_many_pages(PageID first_page, const generic_page* const buf, i
     return RCOK;
 }
 
+rc_t vol_t::write_page_runs(const generic_page* const buf,
+        const std::vector<std::pair<size_t, size_t> >& runs,
+        bool ignoreRestore)
+{
+    if (_readonly) {
+        // Write elision!
+        return RCOK;
+    }
+
+    // see write_many_pages
+    if (_failed && !ignoreRestore) {
+        check_restore_finished();
+    }
+
+    std::vector<sthread_t::iovec_t> iov(runs.size());
+    std::vector<sthread_t::io_request_t> reqs;
+    reqs.reserve(runs.size());
+    size_t total = 0;
+    for (size_t i = 0; i < runs.size(); i++) {
+        const generic_page* first = buf + runs[i].first;
+        w_assert1(runs[i].second > 0);
+        iov[i] = sthread_t::iovec_t((void*) first,
+                runs[i].second * sizeof(generic_page));
+        reqs.push_back(sthread_t::io_request_t(true, &iov[i], 1,
+                    size_t(first->pid) * sizeof(generic_page)));
+        total += runs[i].second;
+    }
+    if (reqs.empty()) { return RCOK; }
+
+    long start = 0;
+    if(_apply_fake_disk_latency) start = gethrtime();
+
+    W_COERCE(me()->pio(_unix_fd, &reqs[0], reqs.size()));
+    for (size_t i = 0; i < reqs.size(); i++) {
+        if (reqs[i].done != (int) iov[i].iov_len) {
+            return RC(stSHORTIO);
+        }
+    }
+
+    fake_disk_latency(start);
+    ADD_TSTAT(vol_blks_written, total);
+    ADD_TSTAT(vol_writes, reqs.size());
+
+    return RCOK;
+}
+
 uint32_t vol_t::get_last_allocated_pid() const
 {
     w_assert1(_alloc_cache);
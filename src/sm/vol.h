@@ -47,6 +47,17 @@ public:
         int                 cnt,
         bool ignoreRestore = false);
 
+    /**
+     * Writes several runs of contiguous pages with a single batch of I/O
+     * requests (see sthread_t::pio). Each run is given by the index of its
+     * first page in buf and its number of pages; the page ID of the first
+     * page determines where the run is written.
+     */
+    rc_t write_page_runs(
+        const generic_page* buf,
+        const std::vector<std::pair<size_t, size_t> >& runs,
+        bool ignoreRestore = false);
+
     rc_t write_page(PageID page, generic_page* buf) {
         return write_many_pages(page, buf, 1);
     }
@@ -67,7 +78,24 @@ public:
         int                 cnt,
         bool ignoreRestore = false);
 
+    /**
+     * Reads several runs of contiguous pages with a single batch of I/O
+     * requests. Each run is given by its first page ID and its number of
+     * pages; runs are read one after the other into buf. Pages past the end
+     * of the volume are zeroed, like in read_many_pages.
+     */
+    rc_t read_page_runs(
+        generic_page* const buf,        //caller must align this buffer
+        const std::vector<std::pair<PageID, size_t> >& runs);
+
     rc_t read_backup(PageID first, size_t count, void* buf);
+    /**
+     * Reads several segments of count pages from the backup with a single
+     * batch of I/O requests. Each segment is given by its first page ID and
+     * the buffer to read into.
+     */
+    rc_t read_backup_many(const std::vector<std::pair<PageID, void*> >& segments,
+            size_t count);
     rc_t write_backup(PageID first, size_t count, void* buf);
 
     /** Add a backup file to be used for restore */
@@ -88,7 +116,12 @@ public:
     bool            set_fake_disk_latency(const int adelay);
     void            fake_disk_latency(long start);
 
-    rc_t            alloc_a_page(PageID& pid, bool redo = false);
+    /**
+     * Allocates a page, clustering it with the pages previously allocated
+     * for the same store by the calling thread (see alloc_cache_t).
+     */
+    rc_t            alloc_a_page(PageID& pid, bool redo = false,
+                                 StoreID stid = 0);
     rc_t            deallocate_page(const PageID& pid, bool redo = false);
 
     bool                is_allocated_page(PageID pid) const;
@@ -117,8 +150,18 @@ public:
         _readonly = r;
     }
 
-    /** Take a backup on the given file path. */
-    rc_t take_backup(string path, bool forceArchive = false);
+    /**
+     * Take a backup on the given file path.
+     *
+     * If incremental is set and a backup was taken before, only the segments
+     * changed since that backup (according to the log archive index) are
+     * written, and a segment map is written to path + ".segmap". Restore then
+     * reconstructs each segment from the newest backup in the chain that
+     * contains it (see open_backup). The new backup is registered with
+     * sx_add_backup.
+     */
+    rc_t take_backup(string path, bool forceArchive = false,
+            bool incremental = false);
 
     bool is_failed() const
     {
@@ -179,8 +222,26 @@ private:
     // CS TODO: this should be destroyed once recovery is complete
     buf_tab_t* _dirty_pages;
 
-    /** Currently opened backup (during restore only) */
-    int _backup_fd;
+    /** Backup file being read; an incremental backup contains only the
+     * segments set in the map read from its .segmap file */
+    struct backup_file_t {
+        int fd;
+        size_t segment_size;
+        std::vector<bool> segments;
+
+        bool contains(PageID pid) const
+        {
+            if (segments.empty()) { return true; } // full backup
+            size_t s = pid / segment_size;
+            return s < segments.size() && segments[s];
+        }
+    };
+
+    /**
+     * Currently opened backups (during restore or backup only): the last full
+     * backup followed by incremental backups taken after it, newest last
+     */
+    std::vector<backup_file_t> _backup_chain;
     lsn_t _current_backup_lsn;
 
     /** Backup being currently taken */
@@ -200,10 +261,17 @@ private:
     /** Whether to open file with O_DIRECT */
     bool _use_o_direct;
 
+    /** Page IDs reserved at once per thread and store by the alloc cache */
+    size_t _alloc_chunk_pages;
+
     rc_t dismount(bool abrupt = false);
 
-    /** Open backup file descriptor for retore or taking new backup */
+    /** Open backup file descriptors for retore or taking new backup */
     rc_t open_backup();
+    void close_backup();
+
+    /** Index in _backup_chain of the newest backup containing pid */
+    size_t backup_for_pid(PageID pid) const;
 
     lsn_t get_dirty_page_emlsn(PageID pid) const;
     void delete_dirty_page(PageID pid);
@@ -0,0 +1,171 @@
+#include "w_defines.h"
+#include "w.h"
+#include "sthread.h"
+#include "sthread_stats.h"
+#include "io_uring_queue.h"
+#include "stopwatch.h"
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Tests for batched positioned I/O (sthread_t::pio) with both backends:
+ * synchronous preadv/pwritev and io_uring.
+ */
+
+const int BLOCK_SIZE = 4096;
+
+/** Runs the given function in an sthread (I/O requires sthread stats) */
+class pio_thread_t : public sthread_t {
+public:
+    pio_thread_t(std::function<void()> f)
+        : sthread_t(t_regular, "pio_test"), _f(f)
+    {}
+    virtual void run() { _f(); }
+private:
+    std::function<void()> _f;
+};
+
+void run_in_thread(std::function<void()> f)
+{
+    pio_thread_t t(f);
+    EXPECT_FALSE(t.fork().is_error());
+    EXPECT_FALSE(t.join().is_error());
+}
+
+std::string make_path()
+{
+    return "/tmp/test_pio." + std::to_string(getpid());
+}
+
+/**
+ * Writes blocks in reverse order at scattered positions, some of them with
+ * two iovecs, and reads them back in a single batch.
+ */
+void write_read_batch(int count)
+{
+    std::string path = make_path();
+    int fd;
+    W_COERCE(sthread_t::open(path.c_str(), sthread_t::OPEN_RDWR
+                | sthread_t::OPEN_CREATE | sthread_t::OPEN_TRUNC, 0644, fd));
+
+    std::vector<char> wbuf(count * BLOCK_SIZE);
+    std::vector<sthread_t::iovec_t> iov(count * 2);
+    std::vector<sthread_t::io_request_t> reqs;
+    for (int i = 0; i < count; i++) {
+        char* block = &wbuf[i * BLOCK_SIZE];
+        memset(block, 'a' + (i % 26), BLOCK_SIZE);
+        memcpy(block, &i, sizeof(int));
+        int split = (i % 2 == 0) ? BLOCK_SIZE : BLOCK_SIZE / 4;
+        iov[2 * i] = sthread_t::iovec_t(block, split);
+        iov[2 * i + 1] = sthread_t::iovec_t(block + split, BLOCK_SIZE - split);
+        sthread_t::fileoff_t pos = (sthread_t::fileoff_t) (count - 1 - i)
+            * 2 * BLOCK_SIZE;
+        reqs.push_back(sthread_t::io_request_t(true, &iov[2 * i],
+                    split == BLOCK_SIZE ? 1 : 2, pos));
+    }
+    W_COERCE(sthread_t::pio(fd, &reqs[0], reqs.size()));
+    for (int i = 0; i < count; i++) {
+        EXPECT_EQ(BLOCK_SIZE, reqs[i].done);
+    }
+
+    std::vector<char> rbuf(count * BLOCK_SIZE + BLOCK_SIZE);
+    std::vector<sthread_t::iovec_t> riov(count + 1);
+    std::vector<sthread_t::io_request_t> rreqs;
+    for (int i = 0; i < count; i++) {
+        riov[i] = sthread_t::iovec_t(&rbuf[i * BLOCK_SIZE], BLOCK_SIZE);
+        sthread_t::fileoff_t pos = (sthread_t::fileoff_t) (count - 1 - i)
+            * 2 * BLOCK_SIZE;
+        rreqs.push_back(sthread_t::io_request_t(false, &riov[i], 1, pos));
+    }
+    // read past the end of the file is short
+    riov[count] = sthread_t::iovec_t(&rbuf[count * BLOCK_SIZE], BLOCK_SIZE);
+    rreqs.push_back(sthread_t::io_request_t(false, &riov[count], 1,
+                (sthread_t::fileoff_t) count * 2 * BLOCK_SIZE));
+
+    W_COERCE(sthread_t::pio(fd, &rreqs[0], rreqs.size()));
+    for (int i = 0; i < count; i++) {
+        EXPECT_EQ(BLOCK_SIZE, rreqs[i].done);
+        EXPECT_EQ(0, memcmp(&wbuf[i * BLOCK_SIZE], &rbuf[i * BLOCK_SIZE],
+                    BLOCK_SIZE)) << "block " << i;
+    }
+    EXPECT_EQ(0, rreqs[count].done);
+
+    W_COERCE(sthread_t::close(fd));
+    unlink(path.c_str());
+}
+
+TEST(PioTest, Sync) {
+    sthread_t::set_io_uring(false);
+    run_in_thread([] { write_read_batch(100); });
+}
+
+TEST(PioTest, IoUring) {
+    // queue depth smaller than the batch, so it is submitted in chunks
+    sthread_t::set_io_uring(true, 8);
+    run_in_thread([] {
+        write_read_batch(100);
+        if (io_uring_queue_t::get_thread_queue(8)) {
+            EXPECT_EQ(201U, GET_STH_STATS(io_uring_requests));
+            EXPECT_EQ(0U, GET_STH_STATS(io_sync_requests));
+        }
+    });
+    sthread_t::set_io_uring(false);
+}
+
+/**
+ * Random 4KB reads of a file with both backends and batches of 1 to 64
+ * requests. Only reports throughput; it does not assert on it.
+ */
+TEST(PioTest, ReadBenchmark) {
+    const int file_blocks = 4096;
+    const int reads = 20000;
+    std::string path = make_path();
+
+    run_in_thread([&] {
+        int fd;
+        W_COERCE(sthread_t::open(path.c_str(), sthread_t::OPEN_RDWR
+                    | sthread_t::OPEN_CREATE | sthread_t::OPEN_TRUNC, 0644, fd));
+        std::vector<char> block(BLOCK_SIZE, 'x');
+        for (int i = 0; i < file_blocks; i++) {
+            W_COERCE(sthread_t::pwrite(fd, &block[0], BLOCK_SIZE,
+                        (sthread_t::fileoff_t) i * BLOCK_SIZE));
+        }
+        W_COERCE(sthread_t::close(fd));
+    });
+
+    for (int uring = 0; uring <= 1; uring++) {
+        for (int batch = 1; batch <= 64; batch *= 4) {
+            sthread_t::set_io_uring(uring, 64);
+            double secs = 0;
+            run_in_thread([&] {
+                int fd;
+                W_COERCE(sthread_t::open(path.c_str(), sthread_t::OPEN_RDONLY,
+                            0, fd));
+                std::vector<char> buf(batch * BLOCK_SIZE);
+                std::vector<sthread_t::iovec_t> iov(batch);
+                std::vector<sthread_t::io_request_t> reqs(batch);
+                stopwatch_t timer;
+                for (int r = 0; r < reads; r += batch) {
+                    for (int b = 0; b < batch; b++) {
+                        iov[b] = sthread_t::iovec_t(&buf[b * BLOCK_SIZE],
+                                BLOCK_SIZE);
+                        reqs[b] = sthread_t::io_request_t(false, &iov[b], 1,
+                                (sthread_t::fileoff_t) (rand() % file_blocks)
+                                * BLOCK_SIZE);
+                    }
+                    W_COERCE(sthread_t::pio(fd, &reqs[0], batch));
+                }
+                secs = timer.time();
+                W_COERCE(sthread_t::close(fd));
+            });
+            std::cout << (uring ? "io_uring" : "sync") << " batch=" << batch
+                << " reads/sec=" << (uint64_t) (reads / secs) << std::endl;
+        }
+    }
+    sthread_t::set_io_uring(false);
+    unlink(path.c_str());
+}
@@ -188,6 +188,44 @@ TEST (AllocTest, ReuseSerialize) {
     EXPECT_EQ(test_env->runBtreeTest(reuse_serialize_test), 0);
 }
 
+w_rc_t store_chunks_test(ss_m* ssm, test_volume_t *) {
+    W_DO(ssm->begin_xct());
+    alloc_cache_t *ac = get_alloc_cache(ssm);
+
+    // allocations for two stores interleaved by the same thread
+    const int count = 10;
+    PageID pids1[count], pids2[count];
+    for (int i = 0; i < count; i++) {
+        W_DO(ssm->vol->alloc_a_page(pids1[i], false, 1));
+        W_DO(ssm->vol->alloc_a_page(pids2[i], false, 2));
+    }
+
+    // pages of each store are contiguous, in separate chunks
+    EXPECT_EQ(pids1[0], FIRST_PID);
+    for (int i = 1; i < count; i++) {
+        EXPECT_EQ(pids1[i], pids1[0] + i);
+        EXPECT_EQ(pids2[i], pids2[0] + i);
+    }
+    EXPECT_GE(pids2[0], pids1[count - 1] + 1);
+    for (int i = 0; i < count; i++) {
+        EXPECT_TRUE(ac->is_allocated(pids1[i]));
+        EXPECT_TRUE(ac->is_allocated(pids2[i]));
+    }
+
+    // the rest of the chunk of store 1 is reserved but not allocated
+    EXPECT_FALSE(ac->is_allocated(pids1[count - 1] + 1));
+    EXPECT_EQ(ac->get_last_allocated_pid(), pids2[count - 1]);
+
+    W_DO(ssm->commit_xct());
+
+    return RCOK;
+}
+
+TEST (AllocTest, StoreChunks) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(store_chunks_test), 0);
+}
+
 // w_rc_t allocate_consecutive(ss_m* ssm, test_volume_t *test_volume) {
 //     W_DO(ssm->begin_xct());
 //     PageID pid;
@@ -0,0 +1,145 @@
+#include "btree_test_env.h"
+#include "sm_options.h"
+#include "logarchiver.h"
+#include "logfactory.h"
+
+/**
+ * Tests for the page ID filters of the log archive index, which let probes
+ * skip runs that contain no log records for the probed pages.
+ */
+
+btree_test_env *test_env;
+
+const size_t RUN_COUNT = 4;
+const PageID RUN_PID_SPACING = 100000;
+const size_t BUCKET_SIZE = 100;
+const size_t BUCKETS_PER_RUN = 20;
+const size_t PIDS_PER_BUCKET = 50;
+
+/**
+ * Pages of a run: even-numbered pages in the even-numbered buckets of the
+ * run's page ID range. Odd pages and odd buckets have no log records.
+ */
+void runPIDs(size_t run, std::vector<PageID>& pids)
+{
+    pids.clear();
+    PageID base = run * RUN_PID_SPACING;
+    for (size_t b = 0; b < BUCKETS_PER_RUN; b += 2) {
+        for (size_t j = 0; j < PIDS_PER_BUCKET; j++) {
+            pids.push_back(base + b * BUCKET_SIZE + 2 * j);
+        }
+    }
+}
+
+void generateArchive(LogArchiver::ArchiveDirectory* dir)
+{
+    LogFactory factory;
+    LogArchiver::BlockAssembly assemb(dir);
+    logrec_t lr;
+    std::vector<PageID> pids;
+
+    for (size_t run = 0; run < RUN_COUNT; run++) {
+        runPIDs(run, pids);
+        assemb.start(run);
+        for (size_t i = 0; i < pids.size(); i++) {
+            factory.next(&lr);
+            lr.set_pid(pids[i]);
+            if (!assemb.add(&lr)) {
+                assemb.finish();
+                assemb.start(run);
+                EXPECT_TRUE(assemb.add(&lr));
+            }
+        }
+        assemb.finish();
+    }
+    assemb.shutdown();
+}
+
+/** Returns whether the given run is among the probe results */
+bool probeFinds(LogArchiver::ArchiveIndex* index, PageID start, PageID end,
+        size_t run, size_t& resultCount)
+{
+    std::vector<LogArchiver::ArchiveIndex::ProbeResult> probes;
+    index->probe(probes, start, end, lsn_t::null);
+    resultCount = probes.size();
+    for (auto& p : probes) {
+        if (p.runIndex == run) { return true; }
+    }
+    return false;
+}
+
+void checkProbes(LogArchiver::ArchiveIndex* index)
+{
+    std::vector<PageID> pids;
+    size_t count;
+    size_t falsePositives = 0;
+    size_t pointProbes = 0;
+
+    for (size_t run = 0; run < RUN_COUNT; run++) {
+        runPIDs(run, pids);
+        for (PageID pid : pids) {
+            // page with log records: found only in its run
+            EXPECT_TRUE(probeFinds(index, pid, pid + 1, run, count));
+            EXPECT_EQ(1U, count);
+
+            // page without log records between two pages that have them
+            probeFinds(index, pid + 1, pid + 2, run, count);
+            falsePositives += count;
+            pointProbes++;
+        }
+
+        // odd buckets are skipped using the bucket keys of the filter
+        PageID base = run * RUN_PID_SPACING;
+        for (size_t b = 1; b < BUCKETS_PER_RUN; b += 2) {
+            probeFinds(index, base + b * BUCKET_SIZE,
+                    base + (b + 1) * BUCKET_SIZE, run, count);
+            falsePositives += count;
+        }
+
+        // whole page range of the run
+        EXPECT_TRUE(probeFinds(index, base, base + RUN_PID_SPACING, run,
+                    count));
+        EXPECT_EQ(1U, count);
+    }
+
+    // unbounded probe
+    probeFinds(index, 0, 0, 0, count);
+    EXPECT_EQ(RUN_COUNT, count);
+
+    // Bloom filters have ~1% false positives
+    EXPECT_LT(falsePositives * 20, pointProbes);
+}
+
+w_rc_t filterProbe(ss_m*, test_volume_t*)
+{
+    sm_options options;
+    options.set_string_option("sm_archdir", test_env->archive_dir);
+    options.set_int_option("sm_archiver_bucket_size", BUCKET_SIZE);
+
+    {
+        LogArchiver::ArchiveDirectory dir(options);
+        generateArchive(&dir);
+
+        uint64_t skippedBefore = me()->TL_stats().sm.la_skipped_runs;
+        checkProbes(dir.getIndex());
+        EXPECT_GT(me()->TL_stats().sm.la_skipped_runs, skippedBefore);
+    }
+
+    // filters are loaded from the run files
+    LogArchiver::ArchiveDirectory dir(options);
+    checkProbes(dir.getIndex());
+
+    return RCOK;
+}
+
+TEST (ArchiveIndexTest, FilterProbe) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(filterProbe), 0);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    test_env = new btree_test_env();
+    ::testing::AddGlobalTestEnvironment(test_env);
+    return RUN_ALL_TESTS();
+}
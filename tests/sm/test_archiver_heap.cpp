@@ -0,0 +1,182 @@
+#include "btree_test_env.h"
+#include "logarchiver.h"
+#include "logfactory.h"
+#include "stopwatch.h"
+
+#include <algorithm>
+
+/**
+ * Tests for run generation in the log archiver heap, both with replacement
+ * selection (one sort thread) and with parallel sorting of PageID ranges.
+ */
+
+btree_test_env *test_env;
+
+struct OutputEntry {
+    run_number_t run;
+    PageID pid;
+    lsn_t lsn;
+};
+
+/**
+ * Feeds count log records from a LogFactory into the heap, consuming one
+ * "block" of the top run whenever the heap is full, like the archiver's
+ * replacement and selection steps do. Returns the output sequence.
+ */
+void generateRuns(LogArchiver::ArchiverHeap& heap, size_t count,
+        std::vector<lsn_t>& input, std::vector<OutputEntry>& output)
+{
+    const size_t recordsPerBlock = 64;
+    LogFactory factory;
+    logrec_t lr;
+
+    auto selection = [&heap, &output] (size_t max) {
+        run_number_t run = heap.topRun();
+        for (size_t i = 0; i < max && heap.size() > 0
+                && heap.topRun() == run; i++)
+        {
+            logrec_t* top = heap.top();
+            OutputEntry e = { run, top->pid(), top->lsn_ck() };
+            output.push_back(e);
+            heap.pop();
+        }
+    };
+
+    for (size_t i = 0; i < count; i++) {
+        factory.next(&lr);
+        input.push_back(lr.lsn_ck());
+        while (!heap.push(&lr, false)) {
+            ASSERT_TRUE(heap.size() > 0);
+            selection(recordsPerBlock);
+        }
+    }
+    while (heap.size() > 0) {
+        selection(recordsPerBlock);
+    }
+}
+
+/**
+ * Checks that runs are numbered consecutively, sorted by (pid, lsn), cover
+ * disjoint and ascending LSN ranges, and contain each input record once.
+ */
+void checkRuns(std::vector<lsn_t>& input, std::vector<OutputEntry>& output,
+        size_t& runCount)
+{
+    EXPECT_EQ(input.size(), output.size());
+
+    runCount = 0;
+    lsn_t prevRunMax = lsn_t::null;
+    lsn_t runMin = lsn_t::null, runMax = lsn_t::null;
+    for (size_t i = 0; i < output.size(); i++) {
+        OutputEntry& e = output[i];
+        if (i == 0 || e.run != output[i-1].run) {
+            if (i > 0) {
+                EXPECT_EQ(output[i-1].run + 1, e.run);
+                EXPECT_LT(prevRunMax, runMin);
+                prevRunMax = runMax;
+            }
+            runMin = runMax = e.lsn;
+            runCount++;
+        }
+        else {
+            OutputEntry& prev = output[i-1];
+            EXPECT_TRUE(prev.pid < e.pid ||
+                    (prev.pid == e.pid && prev.lsn < e.lsn))
+                << "entry " << i << " out of order in run " << e.run;
+            runMin = std::min(runMin, e.lsn);
+            runMax = std::max(runMax, e.lsn);
+        }
+    }
+    EXPECT_LT(prevRunMax, runMin);
+
+    std::vector<lsn_t> outputLSNs;
+    for (auto& e : output) {
+        outputLSNs.push_back(e.lsn);
+    }
+    std::sort(outputLSNs.begin(), outputLSNs.end());
+    EXPECT_TRUE(input == outputLSNs);
+}
+
+w_rc_t runGeneration(size_t threads)
+{
+    // small workspace, so that many runs are generated
+    LogArchiver::ArchiverHeap heap(1024 * 1024, threads);
+    std::vector<lsn_t> input;
+    std::vector<OutputEntry> output;
+    generateRuns(heap, 100000, input, output);
+
+    size_t runCount;
+    checkRuns(input, output, runCount);
+    EXPECT_GT(runCount, 10U);
+    return RCOK;
+}
+
+w_rc_t sortThreads1(ss_m*, test_volume_t*) { return runGeneration(1); }
+w_rc_t sortThreads2(ss_m*, test_volume_t*) { return runGeneration(2); }
+w_rc_t sortThreads7(ss_m*, test_volume_t*) { return runGeneration(7); }
+
+TEST (ArchiverHeapTest, Sequential) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(sortThreads1), 0);
+}
+TEST (ArchiverHeapTest, Parallel2) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(sortThreads2), 0);
+}
+TEST (ArchiverHeapTest, Parallel7) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(sortThreads7), 0);
+}
+
+/**
+ * Run generation throughput with 1 to 8 sort threads. Only reports it; the
+ * log records are generated beforehand so that only push/pop is measured.
+ */
+w_rc_t benchmark(ss_m*, test_volume_t*)
+{
+    const size_t count = 500000;
+    std::vector<char> buffer;
+    std::vector<size_t> offsets;
+    {
+        LogFactory factory;
+        logrec_t lr;
+        for (size_t i = 0; i < count; i++) {
+            factory.next(&lr);
+            offsets.push_back(buffer.size());
+            buffer.insert(buffer.end(), (char*) &lr, (char*) &lr + lr.length());
+        }
+    }
+
+    for (size_t threads = 1; threads <= 8; threads *= 2) {
+        LogArchiver::ArchiverHeap heap(32 * 1024 * 1024, threads);
+        stopwatch_t timer;
+        for (size_t off : offsets) {
+            logrec_t* lr = (logrec_t*) &buffer[off];
+            while (!heap.push(lr, false)) {
+                run_number_t run = heap.topRun();
+                for (int i = 0; i < 1000 && heap.size() > 0
+                        && heap.topRun() == run; i++)
+                {
+                    heap.pop();
+                }
+            }
+        }
+        while (heap.size() > 0) { heap.pop(); }
+        double secs = timer.time();
+        std::cout << "sort threads=" << threads << " records/sec="
+            << (uint64_t) (offsets.size() / secs) << std::endl;
+    }
+    return RCOK;
+}
+
+TEST (ArchiverHeapTest, Benchmark) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(benchmark), 0);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    test_env = new btree_test_env();
+    ::testing::AddGlobalTestEnvironment(test_env);
+    return RUN_ALL_TESTS();
+}
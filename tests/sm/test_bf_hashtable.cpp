@@ -0,0 +1,161 @@
+#include "gtest/gtest.h"
+#include "w_defines.h"
+#include "w_findprime.h"
+#include "bf_hashtable.h"
+#include "bf_hashtable.cpp"
+#include "stopwatch.h"
+#include "sthread.h"
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+/**
+ * Unit tests and microbenchmark for the buffer pool hash table
+ * (bf_hashtable), in particular its optimistic lookups.
+ */
+
+// small table so that buckets overflow into chained chunks
+const uint32_t SMALL_TABLE_SIZE = 7;
+
+/** Runs the given function in an sthread (srwlock_t needs sthread stats) */
+class hashtable_thread_t : public sthread_t {
+public:
+    hashtable_thread_t(std::function<void()> f)
+        : sthread_t(t_regular, "hashtable_test"), _f(f)
+    {}
+    virtual void run() { _f(); }
+private:
+    std::function<void()> _f;
+};
+
+void join_all(std::vector<hashtable_thread_t*>& threads)
+{
+    for (auto t : threads) {
+        EXPECT_FALSE(t->join().is_error());
+        delete t;
+    }
+    threads.clear();
+}
+
+TEST (BfHashtableTest, InsertLookupRemove) {
+    bf_hashtable<bf_idx_pair> table(SMALL_TABLE_SIZE);
+    const PageID count = 500;
+
+    for (PageID pid = 1; pid <= count; ++pid) {
+        EXPECT_TRUE(table.insert_if_not_exists(pid, bf_idx_pair(pid * 2, pid)));
+    }
+    EXPECT_FALSE(table.insert_if_not_exists(10, bf_idx_pair(0, 0)));
+
+    for (PageID pid = 1; pid <= count; ++pid) {
+        bf_idx_pair p, q;
+        EXPECT_TRUE(table.lookup(pid, p));
+        EXPECT_TRUE(table.lookup_locked(pid, q));
+        EXPECT_EQ(pid * 2, p.first);
+        EXPECT_EQ(pid, p.second);
+        EXPECT_EQ(p, q);
+    }
+    bf_idx_pair p;
+    EXPECT_FALSE(table.lookup(count + 1, p));
+
+    EXPECT_TRUE(table.update(20, bf_idx_pair(1, 2)));
+    EXPECT_TRUE(table.lookup(20, p));
+    EXPECT_EQ(bf_idx_pair(1, 2), p);
+
+    for (PageID pid = 1; pid <= count; pid += 2) {
+        EXPECT_TRUE(table.remove(pid));
+    }
+    for (PageID pid = 1; pid <= count; ++pid) {
+        EXPECT_EQ(pid % 2 == 0, table.lookup(pid, p)) << "pid " << pid;
+    }
+}
+
+TEST (BfHashtableTest, ConcurrentLookupWhileModifying) {
+    bf_hashtable<bf_idx_pair> table(SMALL_TABLE_SIZE);
+    // stable keys are never modified; volatile keys share their buckets
+    const PageID stable_count = 100;
+    const PageID volatile_base = 1000;
+    for (PageID pid = 1; pid <= stable_count; ++pid) {
+        table.insert_if_not_exists(pid, bf_idx_pair(pid, pid));
+    }
+
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> errors(0);
+    std::vector<hashtable_thread_t*> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.push_back(new hashtable_thread_t([&] {
+            while (!stop) {
+                for (PageID pid = 1; pid <= stable_count; ++pid) {
+                    bf_idx_pair p;
+                    if (!table.lookup(pid, p) || p.first != pid
+                            || p.second != pid)
+                    {
+                        errors++;
+                    }
+                }
+            }
+        }));
+        EXPECT_FALSE(readers.back()->fork().is_error());
+    }
+
+    for (int round = 0; round < 5000; ++round) {
+        for (PageID pid = volatile_base; pid < volatile_base + 50; ++pid) {
+            table.insert_if_not_exists(pid, bf_idx_pair(0, 0));
+        }
+        // removal shifts the stable entries around in their buckets
+        for (PageID pid = volatile_base; pid < volatile_base + 50; ++pid) {
+            table.remove(pid);
+        }
+    }
+    stop = true;
+    join_all(readers);
+
+    EXPECT_EQ(0U, errors.load());
+}
+
+/**
+ * Compares optimistic and latched lookups on a set of hot keys with 1 to 64
+ * threads. Only reports throughput; it does not assert on it.
+ */
+TEST (BfHashtableTest, LookupBenchmark) {
+    const uint32_t table_size = w_findprime(1024 + 10000 / 4);
+    bf_hashtable<bf_idx_pair> table(table_size);
+    const PageID hot_count = 16; // e.g., root and stnode pages
+    for (PageID pid = 1; pid <= hot_count; ++pid) {
+        table.insert_if_not_exists(pid, bf_idx_pair(pid, 0));
+    }
+
+    const size_t lookups_per_thread = 200000;
+    for (size_t nthreads = 1; nthreads <= 64; nthreads *= 2) {
+        for (int locked = 0; locked <= 1; ++locked) {
+            std::vector<hashtable_thread_t*> threads;
+            for (size_t t = 0; t < nthreads; ++t) {
+                threads.push_back(new hashtable_thread_t([&, t] {
+                    bf_idx_pair p;
+                    for (size_t i = 0; i < lookups_per_thread; ++i) {
+                        PageID pid = (i + t) % hot_count + 1;
+                        if (locked) { table.lookup_locked(pid, p); }
+                        else { table.lookup(pid, p); }
+                    }
+                }));
+            }
+            stopwatch_t timer;
+            for (auto t : threads) {
+                EXPECT_FALSE(t->fork().is_error());
+            }
+            join_all(threads);
+            double secs = timer.time();
+
+            std::cout << "threads=" << nthreads
+                << (locked ? " locked" : " optimistic")
+                << " lookups/sec="
+                << (uint64_t) (nthreads * lookups_per_thread / secs)
+                << std::endl;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
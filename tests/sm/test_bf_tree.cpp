@@ -8,6 +8,7 @@
 
 #include "bf_tree_cb.h"
 #include "bf_tree.h"
+#include "bf_tree_evictor.h"
 #include "sm_base.h"
 
 #include <vector>
@@ -28,6 +29,16 @@ public:
         bf_idx idx = get_bf_idx(bf, page);
         return bf->get_cbp(idx);
     }
+    static uint32_t get_freelist_len (bf_tree_m *bf) {
+        return bf->_get_freelist_len();
+    }
+    static w_rc_t grab_free_block (bf_tree_m *bf, bf_idx &idx,
+            bool evict = false) {
+        return bf->_grab_free_block(idx, evict);
+    }
+    static void add_free_block (bf_tree_m *bf, bf_idx idx) {
+        bf->_add_free_block(idx);
+    }
 
 
     /** manually emulate the btree page layout */
@@ -49,7 +60,8 @@ enum test_size_t {
 };
 
 void run_bf_test(w_rc_t (*func)(ss_m*, test_volume_t*),
-    test_size_t size, bool initially_enable_cleaners, bool enable_swizzling)
+    test_size_t size, bool initially_enable_cleaners, bool enable_swizzling,
+    const char* replacement_policy = "clock", bool enable_evictor = true)
 {
     size_t npages = (size == LARGE ? 10000 : (size == NORMAL ? 1024 : 256));
     // (some of) tests in this file needs REALLY big log.
@@ -66,6 +78,10 @@ void run_bf_test(w_rc_t (*func)(ss_m*, test_volume_t*),
     options.set_int_option("sm_cleaner_write_buffer_pages", 64);
     options.set_bool_option("sm_backgroundflush", initially_enable_cleaners);
     options.set_bool_option("sm_bufferpool_swizzle", enable_swizzling);
+    options.set_string_option("sm_bufferpool_replacement_policy", replacement_policy);
+    options.set_int_option("sm_evictor_low_watermark", enable_evictor ? 1 : 0);
+    options.set_int_option("sm_evictor_high_watermark", 2);
+    options.set_int_option("sm_evictor_interval_millisec", -1);
 
     options.set_int_option("sm_rawlock_lockpool_initseg",
         (size == LARGE ? 100 : (size == NORMAL ? 50 : 20)));
@@ -296,6 +312,168 @@ TEST (TreeBufferpoolTest, EvictNoSwizzle) {
 TEST (TreeBufferpoolTest, EvictSwizzle) {
     run_bf_test(test_bf_evict, NORMAL, false, true);
 }
+TEST (TreeBufferpoolTest, EvictRandom) {
+    run_bf_test(test_bf_evict, NORMAL, false, false, "random");
+}
+TEST (TreeBufferpoolTest, EvictClockPro) {
+    run_bf_test(test_bf_evict, NORMAL, false, false, "clock_pro");
+}
+
+w_rc_t test_bf_evict_hot(ss_m* ssm, test_volume_t *test_volume) {
+    StoreID stid;
+    PageID root_pid;
+    W_DO (prepare_test(ssm, test_volume, stid, root_pid));
+
+    bf_tree_m &pool(*smlevel_0::bf);
+    btree_page_h root_p;
+    W_DO(root_p.fix_root(stid, LATCH_SH));
+    EXPECT_TRUE (root_p.nrecs() > 30);
+
+    // make one leaf much hotter than all others
+    const size_t hot_i = 7;
+    PageID hot_pid = root_p.child(hot_i);
+    for (size_t i = 0; i < 2 * bf_tree_cb_t::BP_MAX_REFCOUNT; ++i) {
+        btree_page_h child_p;
+        W_DO(child_p.fix_nonroot(root_p, hot_pid, LATCH_SH));
+        child_p.unfix();
+    }
+    root_p.unfix();
+
+    // evict_blocks does nothing if enough frames are free already
+    uint32_t evicted_count, unswizzled_count;
+    uint32_t free_count = test_bf_tree::get_freelist_len(&pool);
+    W_DO(pool.evict_blocks(evicted_count, unswizzled_count, free_count + 5));
+    EXPECT_TRUE(evicted_count > 0);
+
+    // clock gives referenced pages a second chance, so the hot leaf survives
+    EXPECT_NE(0U, pool.lookup(hot_pid));
+    return RCOK;
+}
+TEST (TreeBufferpoolTest, EvictHotClock) {
+    run_bf_test(test_bf_evict_hot, SMALL, false, false, "clock", false);
+}
+
+w_rc_t test_bf_prefetch(ss_m* ssm, test_volume_t *test_volume) {
+    StoreID stid;
+    PageID root_pid;
+    W_DO (prepare_test(ssm, test_volume, stid, root_pid));
+
+    bf_tree_m &pool(*smlevel_0::bf);
+    btree_page_h root_p;
+    W_DO(root_p.fix_root(stid, LATCH_SH));
+    EXPECT_TRUE (root_p.nrecs() > 30);
+
+    // evict the first children (pages are clean after prepare_test)
+    const size_t count = 10;
+    for (size_t i = 0; i < count; ++i) {
+        btree_page_h child_p;
+        W_DO(child_p.fix_nonroot(root_p, root_p.child(i), LATCH_EX));
+        child_p.unfix(true);
+        EXPECT_EQ(0U, pool.lookup(root_p.child(i)));
+    }
+
+    // general slot of child(i) is i + 1 (0 is pid0)
+    pool.prefetch(root_p.get_generic_page(), 1, count);
+
+    // wait for the prefetch threads to read all pages
+    for (int retries = 0; retries < 1000; ++retries) {
+        size_t cached = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (pool.lookup(root_p.child(i)) != 0) { cached++; }
+        }
+        if (cached == count) { break; }
+        ::usleep(10000);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        PageID pid = root_p.child(i);
+        EXPECT_NE(0U, pool.lookup(pid)) << "i" << i;
+        btree_page_h child_p;
+        W_DO(child_p.fix_nonroot(root_p, pid, LATCH_SH));
+        EXPECT_EQ(pid, child_p.pid());
+        EXPECT_TRUE(child_p.is_leaf());
+        EXPECT_TRUE(child_p.nrecs() > 0);
+    }
+    root_p.unfix();
+    return RCOK;
+}
+TEST (TreeBufferpoolTest, Prefetch) {
+    run_bf_test(test_bf_prefetch, SMALL, false, false);
+}
+
+w_rc_t test_bf_freelist(ss_m* /*ssm*/, test_volume_t */*test_volume*/) {
+    bf_tree_m &pool(*smlevel_0::bf);
+    uint32_t free_count = test_bf_tree::get_freelist_len(&pool);
+    EXPECT_TRUE(free_count > 0);
+
+    // grab every free frame, stealing from all shards; none twice
+    std::set<bf_idx> grabbed;
+    bf_idx idx;
+    while (!test_bf_tree::grab_free_block(&pool, idx).is_error()) {
+        EXPECT_TRUE(grabbed.insert(idx).second) << "idx" << idx;
+    }
+    EXPECT_EQ(free_count, grabbed.size());
+    EXPECT_EQ(0U, test_bf_tree::get_freelist_len(&pool));
+
+    for (std::set<bf_idx>::const_iterator it = grabbed.begin();
+            it != grabbed.end(); ++it) {
+        test_bf_tree::add_free_block(&pool, *it);
+    }
+    EXPECT_EQ(free_count, test_bf_tree::get_freelist_len(&pool));
+    return RCOK;
+}
+TEST (TreeBufferpoolTest, Freelist) {
+    run_bf_test(test_bf_freelist, SMALL, false, false, "clock", false);
+}
+
+w_rc_t test_bf_evictor(ss_m* ssm, test_volume_t *test_volume) {
+    StoreID stid;
+    PageID root_pid;
+    W_DO (prepare_test(ssm, test_volume, stid, root_pid));
+
+    bf_tree_m &pool(*smlevel_0::bf);
+    bf_tree_evictor* evictor = pool.get_evictor();
+    EXPECT_TRUE(evictor != NULL);
+    EXPECT_TRUE(evictor->get_low_watermark() < evictor->get_high_watermark());
+
+    // empty the free list without waking up the evictor
+    std::vector<bf_idx> grabbed;
+    bf_idx idx;
+    while (!test_bf_tree::grab_free_block(&pool, idx).is_error()) {
+        grabbed.push_back(idx);
+    }
+    EXPECT_EQ(0U, test_bf_tree::get_freelist_len(&pool));
+
+    // the next grab waits for the evictor, which frees clean leaf pages
+    // until the high watermark is reached
+    unsigned long rounds = evictor->get_rounds_completed();
+    W_DO(test_bf_tree::grab_free_block(&pool, idx, true));
+    grabbed.push_back(idx);
+    EXPECT_TRUE(evictor->get_rounds_completed() > rounds);
+    EXPECT_EQ(evictor->get_high_watermark() - 1,
+            test_bf_tree::get_freelist_len(&pool));
+
+    // grabbing below the low watermark wakes up the evictor in the background
+    while (test_bf_tree::get_freelist_len(&pool) >
+            evictor->get_low_watermark()) {
+        W_DO(test_bf_tree::grab_free_block(&pool, idx, true));
+        grabbed.push_back(idx);
+    }
+    rounds = evictor->get_rounds_completed();
+    W_DO(test_bf_tree::grab_free_block(&pool, idx, true));
+    grabbed.push_back(idx);
+    evictor->wait_for_round(rounds + 1);
+    EXPECT_TRUE(test_bf_tree::get_freelist_len(&pool) >=
+            evictor->get_high_watermark());
+
+    for (size_t i = 0; i < grabbed.size(); ++i) {
+        test_bf_tree::add_free_block(&pool, grabbed[i]);
+    }
+    return RCOK;
+}
+TEST (TreeBufferpoolTest, Evictor) {
+    run_bf_test(test_bf_evictor, SMALL, false, false);
+}
 
 w_rc_t _test_bf_swizzle(ss_m* /*ssm*/, test_volume_t *test_volume, bool enable_swizzle) {
     bf_tree_m &pool(*smlevel_0::bf);
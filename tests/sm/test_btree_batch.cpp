@@ -0,0 +1,291 @@
+#include "btree_test_env.h"
+#include "gtest/gtest.h"
+#include "sm_vas.h"
+#include "btree.h"
+#include "sm_base.h"
+
+#include <stdio.h>
+#include <chrono>
+#include <algorithm>
+
+btree_test_env *test_env;
+
+// Tests ss_m::find_assoc_batch() and ss_m::create_assoc_batch(), which handle
+// the keys of a batch in key order and reuse the leaf of the previous key, and
+// compares their per-key cost with single-key calls for 16 to 256-key batches.
+
+const int DATA_SIZE = 100;
+
+void make_key(w_keystr_t& key, int i)
+{
+    char buf[16];
+    sprintf(buf, "key%08d", i);
+    key.construct_regularkey(buf, ::strlen(buf));
+}
+
+std::string make_data(int i)
+{
+    char buf[16];
+    sprintf(buf, "data%08d", i);
+    return std::string(buf) + std::string(DATA_SIZE - ::strlen(buf), 'd');
+}
+
+/** Inserts the even keys 0, 2, ..., 2 * (count - 1) one by one */
+w_rc_t insert_even(StoreID stid, int count)
+{
+    for (int i = 0; i < count; i++) {
+        if (i % 1000 == 0) {
+            if (i > 0) { W_DO(ss_m::commit_xct()); }
+            W_DO(ss_m::begin_xct());
+        }
+        w_keystr_t key;
+        make_key(key, 2 * i);
+        std::string data = make_data(2 * i);
+        W_DO(ss_m::create_assoc(stid, key, vec_t(data.data(), data.size())));
+    }
+    W_DO(ss_m::commit_xct());
+    return RCOK;
+}
+
+w_rc_t lookup_batch(ss_m* ssm, test_volume_t *test_volume)
+{
+    StoreID stid;
+    PageID root_pid;
+    W_DO(x_btree_create_index(ssm, test_volume, stid, root_pid));
+    W_DO(insert_even(stid, 5000));
+
+    // unsorted, with missing keys and a key looked up twice
+    std::vector<w_keystr_t> keys;
+    const int ids[] = {9998, 4, 5, 20, 3, 4, 7000, 12000, 0, 6000};
+    const int n = sizeof(ids) / sizeof(ids[0]);
+    for (int i = 0; i < n; i++) {
+        w_keystr_t key;
+        make_key(key, ids[i]);
+        keys.push_back(key);
+    }
+
+    sm_stats_info_t before, after;
+    W_DO(ss_m::gather_stats(before));
+    std::vector<std::string> elems;
+    std::vector<bool> found;
+    W_DO(ss_m::begin_xct());
+    W_DO(ss_m::find_assoc_batch(stid, keys, elems, found));
+    W_DO(ss_m::commit_xct());
+    W_DO(ss_m::gather_stats(after));
+
+    EXPECT_EQ((size_t) n, found.size());
+    EXPECT_EQ((size_t) n, elems.size());
+    for (int i = 0; i < n; i++) {
+        bool expected = ids[i] % 2 == 0 && ids[i] < 10000;
+        EXPECT_EQ(expected, found[i]) << "key " << ids[i];
+        if (expected) {
+            EXPECT_EQ(make_data(ids[i]), elems[i]);
+        } else {
+            EXPECT_TRUE(elems[i].empty());
+        }
+    }
+    // 0, 3, 4, 4, 5 and 20 are on the first leaf
+    EXPECT_GE(after.sm.bt_batch_leaf_reuse_cnt - before.sm.bt_batch_leaf_reuse_cnt, 5U);
+    EXPECT_EQ((uint64_t) n, after.sm.bt_find_cnt - before.sm.bt_find_cnt);
+    return RCOK;
+}
+
+w_rc_t insert_batch(ss_m* ssm, test_volume_t *test_volume)
+{
+    StoreID stid;
+    PageID root_pid;
+    W_DO(x_btree_create_index(ssm, test_volume, stid, root_pid));
+    W_DO(insert_even(stid, 100));
+
+    // odd keys in descending order, enough to split leaves, plus an existing
+    // key, a key given twice and an entry too large
+    std::vector<w_keystr_t> keys;
+    std::vector<std::string> elems;
+    const int count = 3000;
+    for (int i = count - 1; i >= 0; i--) {
+        w_keystr_t key;
+        make_key(key, 2 * i + 1);
+        keys.push_back(key);
+        elems.push_back(make_data(2 * i + 1));
+    }
+    w_keystr_t key;
+    make_key(key, 10); // exists
+    keys.push_back(key);
+    elems.push_back("dup");
+    make_key(key, 11); // given twice
+    keys.push_back(key);
+    elems.push_back("dup");
+    make_key(key, 100001);
+    keys.push_back(key);
+    elems.push_back(std::string(SM_PAGESIZE, 'x'));
+
+    std::vector<w_error_codes> results;
+    W_DO(ss_m::begin_xct());
+    W_DO(ss_m::create_assoc_batch(stid, keys, elems, results));
+    W_DO(ss_m::commit_xct());
+
+    EXPECT_EQ(keys.size(), results.size());
+    for (int i = 0; i < count; i++) {
+        EXPECT_EQ(w_error_ok, results[i]);
+    }
+    EXPECT_EQ(eDUPLICATE, results[count]);
+    EXPECT_EQ(eDUPLICATE, results[count + 1]);
+    EXPECT_EQ(eRECWONTFIT, results[count + 2]);
+
+    W_DO(x_btree_verify(ssm, stid));
+    x_btree_scan_result s;
+    W_DO(test_env->btree_scan(stid, s));
+    EXPECT_EQ(100 + count, s.rownum);
+
+    // the first of two equal keys was inserted
+    W_DO(test_env->begin_xct());
+    std::string data;
+    W_DO(test_env->btree_lookup(stid, "key00000011", data));
+    EXPECT_EQ(make_data(11), data);
+    W_DO(test_env->commit_xct());
+
+    // a batch insert is rolled back with its transaction
+    keys.clear();
+    elems.clear();
+    for (int i = 0; i < 500; i++) {
+        make_key(key, 200000 + i);
+        keys.push_back(key);
+        elems.push_back(make_data(i));
+    }
+    W_DO(ss_m::begin_xct());
+    W_DO(ss_m::create_assoc_batch(stid, keys, elems, results));
+    W_DO(ss_m::abort_xct());
+    W_DO(x_btree_verify(ssm, stid));
+    W_DO(test_env->btree_scan(stid, s));
+    EXPECT_EQ(100 + count, s.rownum);
+    return RCOK;
+}
+
+const int BENCH_KEYS = 50000;
+const int BENCH_OPS = 50000;
+const int ROUNDS = 3;
+
+/**
+ * Per-key cost of single-key calls and of batches of clustered keys: each
+ * batch looks up (or inserts) batch_size keys at a random position, as the
+ * stock lookups and order-line inserts of a TPC-C NewOrder do.
+ */
+w_rc_t bench_lookups(StoreID stid, int batch_size, double& ns_per_key)
+{
+    unsigned seed = 1;
+    std::vector<w_keystr_t> keys(batch_size);
+    std::vector<std::string> elems;
+    std::vector<bool> found;
+    char buf[SM_PAGESIZE];
+    ns_per_key = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        auto start = std::chrono::steady_clock::now();
+        W_DO(ss_m::begin_xct());
+        for (int done = 0; done < BENCH_OPS; done += batch_size) {
+            int first = ::rand_r(&seed) % (BENCH_KEYS - batch_size);
+            for (int i = 0; i < batch_size; i++) {
+                make_key(keys[i], 2 * (first + (i * 7) % batch_size));
+            }
+            if (batch_size == 1) {
+                smsize_t elen = sizeof(buf);
+                bool key_found;
+                W_DO(ss_m::find_assoc(stid, keys[0], buf, elen, key_found));
+                EXPECT_TRUE(key_found);
+            } else {
+                W_DO(ss_m::find_assoc_batch(stid, keys, elems, found));
+                EXPECT_EQ(batch_size, std::count(found.begin(), found.end(), true));
+            }
+        }
+        W_DO(ss_m::commit_xct());
+        auto end = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(end - start).count()
+            / BENCH_OPS;
+        if (round == 0 || ns < ns_per_key) {
+            ns_per_key = ns;
+        }
+    }
+    return RCOK;
+}
+
+w_rc_t bench_inserts(ss_m* ssm, test_volume_t *test_volume, int batch_size,
+                     double& ns_per_key)
+{
+    StoreID stid;
+    PageID root_pid;
+    W_DO(x_btree_create_index(ssm, test_volume, stid, root_pid));
+    W_DO(insert_even(stid, BENCH_KEYS));
+
+    // inserts the odd keys next to the clustered even ones
+    unsigned seed = 1;
+    std::vector<w_keystr_t> keys(batch_size);
+    std::vector<std::string> elems(batch_size, std::string(DATA_SIZE, 'i'));
+    std::vector<w_error_codes> results;
+    vec_t el(elems[0].data(), elems[0].size());
+    std::vector<bool> used(BENCH_KEYS, false);
+    auto start = std::chrono::steady_clock::now();
+    W_DO(ss_m::begin_xct());
+    int done = 0;
+    while (done < BENCH_OPS / 5) {
+        int first = ::rand_r(&seed) % (BENCH_KEYS - batch_size);
+        if (used[first]) {
+            continue;
+        }
+        for (int i = 0; i < batch_size; i++) {
+            used[first + i] = true;
+            make_key(keys[i], 2 * (first + (i * 7) % batch_size) + 1);
+        }
+        if (batch_size == 1) {
+            rc_t rc = ss_m::create_assoc(stid, keys[0], el);
+            EXPECT_TRUE(!rc.is_error() || rc.err_num() == eDUPLICATE);
+        } else {
+            W_DO(ss_m::create_assoc_batch(stid, keys, elems, results));
+        }
+        done += batch_size;
+    }
+    W_DO(ss_m::commit_xct());
+    auto end = std::chrono::steady_clock::now();
+    ns_per_key = std::chrono::duration<double, std::nano>(end - start).count()
+        / done;
+    return RCOK;
+}
+
+w_rc_t batch_benchmark(ss_m* ssm, test_volume_t *test_volume)
+{
+    StoreID stid;
+    PageID root_pid;
+    W_DO(x_btree_create_index(ssm, test_volume, stid, root_pid));
+    W_DO(insert_even(stid, BENCH_KEYS));
+
+    const int sizes[] = {1, 16, 64, 256};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        double lookup_ns, insert_ns;
+        W_DO(bench_lookups(stid, sizes[s], lookup_ns));
+        W_DO(bench_inserts(ssm, test_volume, sizes[s], insert_ns));
+        std::cout << "batch size=" << sizes[s]
+            << " lookup ns/key=" << (uint64_t) lookup_ns
+            << " insert ns/key=" << (uint64_t) insert_ns << std::endl;
+    }
+    return RCOK;
+}
+
+TEST (BtreeBatchTest, Lookup) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(lookup_batch), 0);
+}
+
+TEST (BtreeBatchTest, Insert) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(insert_batch), 0);
+}
+
+TEST (BtreeBatchTest, Benchmark) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(batch_benchmark), 0);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    test_env = new btree_test_env();
+    ::testing::AddGlobalTestEnvironment(test_env);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,287 @@
+#include "btree_test_env.h"
+#include "gtest/gtest.h"
+#include "sm_vas.h"
+#include "btree.h"
+#include "btree_page_h.h"
+#include "w_key.h"
+
+#include <stdio.h>
+#include <chrono>
+
+btree_test_env *test_env;
+
+// Tests ss_m::bulk_load_index(), which builds the B-tree of an empty index
+// bottom-up from sorted entries, and compares its speed with inserting the
+// same entries one by one.
+
+const int DATA_SIZE = 100;
+
+void make_key(char* buf, int i)
+{
+    sprintf(buf, "key%08d", i);
+}
+
+/** Supplies keys first, first+step, ... (count keys) with 100-byte data */
+class key_source_t : public bulk_load_source_t {
+public:
+    key_source_t(int count, int first = 0, int step = 1)
+        : _count(count), _first(first), _step(step), _i(0),
+        _data(DATA_SIZE, 'd')
+    {}
+
+    bool next(w_keystr_t& key, cvec_t& el)
+    {
+        if (_i >= _count) {
+            return false;
+        }
+        char buf[16];
+        make_key(buf, _first + _i * _step);
+        key.construct_regularkey(buf, ::strlen(buf));
+        el.put(_data.c_str(), _data.size());
+        _i++;
+        return true;
+    }
+
+    int _count;
+    int _first;
+    int _step;
+    int _i;
+    std::string _data;
+};
+
+/** Loads count keys and checks the result with verification, scan and lookups */
+w_rc_t load_and_check(ss_m* ssm, test_volume_t *test_volume, int count,
+        double fill_factor, int& levels)
+{
+    StoreID stid;
+    PageID root_pid;
+    W_DO(x_btree_create_index(ssm, test_volume, stid, root_pid));
+
+    key_source_t source(count, 0, 2);
+    W_DO(test_env->begin_xct());
+    W_DO(ss_m::bulk_load_index(stid, source, fill_factor));
+    W_DO(test_env->commit_xct());
+
+    W_DO(x_btree_verify(ssm, stid));
+
+    x_btree_scan_result s;
+    W_DO(test_env->btree_scan(stid, s));
+    EXPECT_EQ(count, s.rownum);
+    char key[16];
+    make_key(key, 0);
+    EXPECT_EQ(std::string(key), s.minkey);
+    make_key(key, 2 * (count - 1));
+    EXPECT_EQ(std::string(key), s.maxkey);
+
+    W_DO(test_env->begin_xct());
+    for (int i = 0; i < 2 * count; i += 7) {
+        make_key(key, i);
+        std::string data;
+        W_DO(test_env->btree_lookup(stid, key, data));
+        if (i % 2 == 0) {
+            EXPECT_EQ((size_t) DATA_SIZE, data.size());
+        } else {
+            EXPECT_EQ((size_t) 0, data.size());
+        }
+    }
+    W_DO(test_env->commit_xct());
+
+    // the loaded tree takes regular inserts, into and between the loaded leaves
+    W_DO(test_env->begin_xct());
+    for (int i = 1; i < 2 * count; i += 20) {
+        make_key(key, i);
+        W_DO(test_env->btree_insert(stid, key, "inserted"));
+    }
+    W_DO(test_env->commit_xct());
+    W_DO(x_btree_verify(ssm, stid));
+    W_DO(test_env->btree_scan(stid, s));
+    EXPECT_EQ(count + (2 * count - 1 + 19) / 20, s.rownum);
+
+    btree_page_h root;
+    W_DO(root.fix_root(stid, LATCH_SH));
+    levels = root.level();
+    return RCOK;
+}
+
+w_rc_t bulk_load_small(ss_m* ssm, test_volume_t *test_volume)
+{
+    int levels;
+    W_DO(load_and_check(ssm, test_volume, 20, 1.0, levels));
+    EXPECT_EQ(1, levels); // fits into the root
+    return RCOK;
+}
+
+w_rc_t bulk_load_many(ss_m* ssm, test_volume_t *test_volume)
+{
+    int levels;
+    W_DO(load_and_check(ssm, test_volume, 100000, 1.0, levels));
+    EXPECT_GE(levels, 2);
+    return RCOK;
+}
+
+w_rc_t bulk_load_half_full(ss_m* ssm, test_volume_t *test_volume)
+{
+    int levels;
+    W_DO(load_and_check(ssm, test_volume, 100000, 0.5, levels));
+    EXPECT_GE(levels, 2);
+    return RCOK;
+}
+
+w_rc_t bulk_load_empty(ss_m* ssm, test_volume_t *test_volume)
+{
+    StoreID stid;
+    PageID root_pid;
+    W_DO(x_btree_create_index(ssm, test_volume, stid, root_pid));
+
+    key_source_t source(0);
+    W_DO(test_env->begin_xct());
+    W_DO(ss_m::bulk_load_index(stid, source));
+    W_DO(test_env->commit_xct());
+
+    x_btree_scan_result s;
+    W_DO(test_env->btree_scan(stid, s));
+    EXPECT_EQ(0, s.rownum);
+    W_DO(test_env->btree_insert_and_commit(stid, "a", "data"));
+    W_DO(test_env->btree_scan(stid, s));
+    EXPECT_EQ(1, s.rownum);
+    return RCOK;
+}
+
+w_rc_t bulk_load_errors(ss_m* ssm, test_volume_t *test_volume)
+{
+    StoreID stid;
+    PageID root_pid;
+    W_DO(x_btree_create_index(ssm, test_volume, stid, root_pid));
+
+    W_DO(test_env->begin_xct());
+    key_source_t bad_fill(10);
+    rc_t rc = ss_m::bulk_load_index(stid, bad_fill, 1.5);
+    EXPECT_EQ(eBADARGUMENT, rc.err_num());
+
+    key_source_t descending(10, 100, -1);
+    rc = ss_m::bulk_load_index(stid, descending);
+    EXPECT_EQ(eBADARGUMENT, rc.err_num());
+    W_DO(test_env->abort_xct());
+
+    W_DO(test_env->btree_insert_and_commit(stid, "a", "data"));
+    W_DO(test_env->begin_xct());
+    key_source_t source(10);
+    rc = ss_m::bulk_load_index(stid, source);
+    EXPECT_EQ(eNDXNOTEMPTY, rc.err_num());
+    W_DO(test_env->commit_xct());
+    return RCOK;
+}
+
+const int BENCH_KEYS = 200000;
+const int INSERTS_PER_XCT = 1000;
+
+/** Loads the same keys by inserting them one by one and by bulk loading */
+w_rc_t bulk_load_benchmark(ss_m* ssm, test_volume_t *test_volume)
+{
+    StoreID insert_stid, load_stid;
+    PageID root_pid;
+    W_DO(x_btree_create_index(ssm, test_volume, insert_stid, root_pid));
+    W_DO(x_btree_create_index(ssm, test_volume, load_stid, root_pid));
+
+    std::string data(DATA_SIZE, 'd');
+    vec_t el(data.c_str(), data.size());
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_KEYS; i++) {
+        if (i % INSERTS_PER_XCT == 0) {
+            if (i > 0) { W_DO(ss_m::commit_xct()); }
+            W_DO(ss_m::begin_xct());
+        }
+        char buf[16];
+        make_key(buf, i);
+        w_keystr_t key;
+        key.construct_regularkey(buf, ::strlen(buf));
+        W_DO(ss_m::create_assoc(insert_stid, key, el));
+    }
+    W_DO(ss_m::commit_xct());
+    auto middle = std::chrono::steady_clock::now();
+
+    key_source_t source(BENCH_KEYS);
+    W_DO(ss_m::begin_xct());
+    W_DO(ss_m::bulk_load_index(load_stid, source));
+    W_DO(ss_m::commit_xct());
+    auto end = std::chrono::steady_clock::now();
+
+    double insert_secs = std::chrono::duration<double>(middle - start).count();
+    double load_secs = std::chrono::duration<double>(end - middle).count();
+    std::cout << "insert rows/sec=" << (uint64_t) (BENCH_KEYS / insert_secs)
+        << " bulk load rows/sec=" << (uint64_t) (BENCH_KEYS / load_secs)
+        << std::endl;
+
+    x_btree_scan_result s;
+    W_DO(test_env->btree_scan(load_stid, s));
+    EXPECT_EQ(BENCH_KEYS, s.rownum);
+    return RCOK;
+}
+
+TEST (BtreeBulkLoadTest, Small) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(bulk_load_small), 0);
+}
+
+TEST (BtreeBulkLoadTest, Many) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(bulk_load_many), 0);
+}
+
+TEST (BtreeBulkLoadTest, HalfFull) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(bulk_load_half_full), 0);
+}
+
+TEST (BtreeBulkLoadTest, Empty) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(bulk_load_empty), 0);
+}
+
+TEST (BtreeBulkLoadTest, Errors) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(bulk_load_errors), 0);
+}
+
+TEST (BtreeBulkLoadTest, Benchmark) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(bulk_load_benchmark), 0);
+}
+
+/** The page images logged by a bulk load recover the tree after a crash */
+class restart_bulk_load : public restart_test_base
+{
+public:
+    w_rc_t pre_shutdown(ss_m *ssm) {
+        _stid_list = new StoreID[1];
+        W_DO(x_btree_create_index(ssm, &_volume, _stid_list[0], _root_pid));
+        key_source_t source(20000);
+        W_DO(test_env->begin_xct());
+        W_DO(ss_m::bulk_load_index(_stid_list[0], source));
+        W_DO(test_env->commit_xct());
+        return RCOK;
+    }
+
+    w_rc_t post_shutdown(ss_m *ssm) {
+        W_DO(x_btree_verify(ssm, _stid_list[0]));
+        x_btree_scan_result s;
+        W_DO(test_env->btree_scan(_stid_list[0], s));
+        EXPECT_EQ (20000, s.rownum);
+        return RCOK;
+    }
+};
+
+TEST (BtreeBulkLoadTest, RestartC) {
+    test_env->empty_logdata_dir();
+    restart_bulk_load context;
+    restart_test_options options;
+    options.shutdown_mode = simulated_crash;
+    EXPECT_EQ(test_env->runRestartTest(&context, &options), 0);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    test_env = new btree_test_env();
+    ::testing::AddGlobalTestEnvironment(test_env);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,330 @@
+#include "btree_test_env.h"
+#include "gtest/gtest.h"
+#include "sm_vas.h"
+#include "btree.h"
+#include "xct.h"
+#include "sm_base.h"
+
+#include <stdio.h>
+#include <chrono>
+#include <atomic>
+
+btree_test_env *test_env;
+
+// Read-only scaling benchmark for B-tree lookups: several threads look up
+// random keys of the same index, with traversals latching every page from the
+// root down (latch coupling) or only the leaf (optimistic traversal, option
+// sm_btree_optimistic_traverse). Reports lookups/sec for each thread count.
+// Also checks optimistic lookups running concurrently with inserts that
+// split the pages being traversed.
+
+const int KEY_COUNT = 50000;
+const int LOOKUPS_PER_THREAD = 50000;
+const int LOOKUPS_PER_XCT = 1000;
+
+void make_key(char* buf, int i)
+{
+    sprintf(buf, "key%08d", i);
+}
+
+class lookup_thread_t : public smthread_t {
+public:
+    lookup_thread_t(StoreID stid, int seed)
+        : smthread_t(t_regular, "lookup_thread_t"),
+        _stid(stid), _seed(seed), _found(0)
+    {}
+
+    virtual void run()
+    {
+        _rc = _run();
+    }
+
+    rc_t _run()
+    {
+        char keystr[16];
+        char data[SM_PAGESIZE];
+        for (int i = 0; i < LOOKUPS_PER_THREAD; i++) {
+            if (i % LOOKUPS_PER_XCT == 0) {
+                if (i > 0) { W_DO(ss_m::commit_xct()); }
+                W_DO(ss_m::begin_xct());
+            }
+            make_key(keystr, ::rand_r(&_seed) % KEY_COUNT);
+            w_keystr_t key;
+            key.construct_regularkey(keystr, ::strlen(keystr));
+            smsize_t elen = SM_PAGESIZE;
+            bool found;
+            W_DO(ss_m::find_assoc(_stid, key, data, elen, found));
+            if (found) { _found++; }
+        }
+        W_DO(ss_m::commit_xct());
+        return RCOK;
+    }
+
+    StoreID _stid;
+    unsigned _seed;
+    int _found;
+    rc_t _rc;
+};
+
+w_rc_t run_lookups(StoreID stid, int threads, bool optimistic)
+{
+    smlevel_0::optimistic_traverse = optimistic;
+
+    sm_stats_info_t before, after;
+    W_DO(ss_m::gather_stats(before));
+
+    std::vector<lookup_thread_t*> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < threads; i++) {
+        workers.push_back(new lookup_thread_t(stid, i + 1));
+        W_DO(workers[i]->fork());
+    }
+    for (int i = 0; i < threads; i++) {
+        W_DO(workers[i]->join());
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < threads; i++) {
+        EXPECT_FALSE(workers[i]->_rc.is_error());
+        EXPECT_EQ(LOOKUPS_PER_THREAD, workers[i]->_found);
+        delete workers[i];
+    }
+
+    W_DO(ss_m::gather_stats(after));
+    uint64_t optimistic_cnt = after.sm.bt_optimistic_traverse_cnt
+        - before.sm.bt_optimistic_traverse_cnt;
+    if (optimistic) {
+        EXPECT_GT(optimistic_cnt, 0U);
+    } else {
+        EXPECT_EQ(0U, optimistic_cnt);
+    }
+
+    double secs = std::chrono::duration<double>(end - start).count();
+    std::cout << (optimistic ? "optimistic" : "latch coupling")
+        << " threads=" << threads
+        << " lookups/sec="
+        << (uint64_t) (secs > 0 ? threads * LOOKUPS_PER_THREAD / secs : 0)
+        << " conflicts="
+        << after.sm.bt_optimistic_conflict_cnt
+            - before.sm.bt_optimistic_conflict_cnt
+        << std::endl;
+    return RCOK;
+}
+
+w_rc_t lookup_scaling(ss_m* ssm, test_volume_t *test_volume)
+{
+    StoreID stid;
+    PageID root_pid;
+    W_DO(x_btree_create_index(ssm, test_volume, stid, root_pid));
+
+    // values large enough for the tree to have inner levels below the root
+    std::string data(100, 'd');
+    char key[16];
+    for (int x = 0; x < KEY_COUNT / LOOKUPS_PER_XCT; x++) {
+        W_DO(test_env->begin_xct());
+        for (int i = 0; i < LOOKUPS_PER_XCT; i++) {
+            make_key(key, x * LOOKUPS_PER_XCT + i);
+            W_DO(test_env->btree_insert(stid, key, data.c_str()));
+        }
+        W_DO(test_env->commit_xct());
+    }
+
+    bool optimistic = smlevel_0::optimistic_traverse;
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        W_DO(run_lookups(stid, threads, false));
+        W_DO(run_lookups(stid, threads, true));
+    }
+    smlevel_0::optimistic_traverse = optimistic;
+
+    return RCOK;
+}
+
+const int CONCURRENT_KEYS = 20000;
+const int INSERT_THREADS = 2;
+const int CONCURRENT_LOOKUP_THREADS = 4;
+
+/** Inserts the odd keys, each thread a disjoint share, one per transaction */
+class insert_thread_t : public smthread_t {
+public:
+    insert_thread_t(StoreID stid, int first)
+        : smthread_t(t_regular, "insert_thread_t"),
+        _stid(stid), _first(first), _done(false)
+    {}
+
+    virtual void run()
+    {
+        _rc = _run();
+        _done = true;
+    }
+
+    rc_t _run()
+    {
+        char keystr[16];
+        std::string data(100, 'i');
+        vec_t el(data.c_str(), data.size());
+        for (int i = _first; i < CONCURRENT_KEYS; i += INSERT_THREADS) {
+            make_key(keystr, 2 * i + 1);
+            w_keystr_t key;
+            key.construct_regularkey(keystr, ::strlen(keystr));
+            W_DO(ss_m::begin_xct());
+            W_DO(ss_m::create_assoc(_stid, key, el));
+            W_DO(ss_m::commit_xct());
+        }
+        return RCOK;
+    }
+
+    StoreID _stid;
+    int _first;
+    std::atomic<bool> _done;
+    rc_t _rc;
+};
+
+/** Looks up the even keys, which are all there, until the inserts finish */
+class reader_thread_t : public smthread_t {
+public:
+    reader_thread_t(StoreID stid, int seed,
+            const std::vector<insert_thread_t*>& inserters)
+        : smthread_t(t_regular, "reader_thread_t"),
+        _stid(stid), _seed(seed), _inserters(inserters),
+        _lookups(0), _missing(0)
+    {}
+
+    virtual void run()
+    {
+        _rc = _run();
+    }
+
+    bool _inserting() const
+    {
+        for (size_t i = 0; i < _inserters.size(); i++) {
+            if (!_inserters[i]->_done) { return true; }
+        }
+        return false;
+    }
+
+    rc_t _run()
+    {
+        char keystr[16];
+        char data[SM_PAGESIZE];
+        while (_inserting()) {
+            W_DO(ss_m::begin_xct());
+            for (int i = 0; i < LOOKUPS_PER_XCT; i++) {
+                make_key(keystr, 2 * (::rand_r(&_seed) % CONCURRENT_KEYS));
+                w_keystr_t key;
+                key.construct_regularkey(keystr, ::strlen(keystr));
+                smsize_t elen = SM_PAGESIZE;
+                bool found;
+                W_DO(ss_m::find_assoc(_stid, key, data, elen, found));
+                _lookups++;
+                if (!found) { _missing++; }
+            }
+            W_DO(ss_m::commit_xct());
+        }
+        return RCOK;
+    }
+
+    StoreID _stid;
+    unsigned _seed;
+    const std::vector<insert_thread_t*>& _inserters;
+    int _lookups;
+    int _missing;
+    rc_t _rc;
+};
+
+w_rc_t lookups_during_splits(ss_m* ssm, test_volume_t *test_volume)
+{
+    StoreID stid;
+    PageID root_pid;
+    W_DO(x_btree_create_index(ssm, test_volume, stid, root_pid));
+
+    std::string data(100, 'd');
+    char key[16];
+    for (int x = 0; x < CONCURRENT_KEYS / LOOKUPS_PER_XCT; x++) {
+        W_DO(test_env->begin_xct());
+        for (int i = 0; i < LOOKUPS_PER_XCT; i++) {
+            make_key(key, 2 * (x * LOOKUPS_PER_XCT + i));
+            W_DO(test_env->btree_insert(stid, key, data.c_str()));
+        }
+        W_DO(test_env->commit_xct());
+    }
+
+    smlevel_0::optimistic_traverse = true;
+    sm_stats_info_t before, after;
+    W_DO(ss_m::gather_stats(before));
+
+    std::vector<insert_thread_t*> inserters;
+    for (int i = 0; i < INSERT_THREADS; i++) {
+        inserters.push_back(new insert_thread_t(stid, i));
+    }
+    std::vector<reader_thread_t*> readers;
+    for (int i = 0; i < CONCURRENT_LOOKUP_THREADS; i++) {
+        readers.push_back(new reader_thread_t(stid, i + 1, inserters));
+        W_DO(readers[i]->fork());
+    }
+    for (int i = 0; i < INSERT_THREADS; i++) {
+        W_DO(inserters[i]->fork());
+    }
+    for (int i = 0; i < INSERT_THREADS; i++) {
+        W_DO(inserters[i]->join());
+        EXPECT_FALSE(inserters[i]->_rc.is_error());
+    }
+    for (int i = 0; i < CONCURRENT_LOOKUP_THREADS; i++) {
+        W_DO(readers[i]->join());
+        EXPECT_FALSE(readers[i]->_rc.is_error());
+        EXPECT_GT(readers[i]->_lookups, 0);
+        EXPECT_EQ(0, readers[i]->_missing);
+        delete readers[i];
+    }
+    for (int i = 0; i < INSERT_THREADS; i++) {
+        delete inserters[i];
+    }
+
+    W_DO(ss_m::gather_stats(after));
+    smlevel_0::optimistic_traverse = false;
+    EXPECT_GT(after.sm.bt_optimistic_traverse_cnt,
+            before.sm.bt_optimistic_traverse_cnt);
+    // readers raced with the page splits and restarted
+    EXPECT_GT(after.sm.bt_optimistic_conflict_cnt,
+            before.sm.bt_optimistic_conflict_cnt);
+    std::cout << "optimistic traversals="
+        << after.sm.bt_optimistic_traverse_cnt
+            - before.sm.bt_optimistic_traverse_cnt
+        << " conflicts="
+        << after.sm.bt_optimistic_conflict_cnt
+            - before.sm.bt_optimistic_conflict_cnt
+        << std::endl;
+
+    // all keys, old and new, are found with optimistic traversals
+    W_DO(test_env->begin_xct());
+    smlevel_0::optimistic_traverse = true;
+    for (int i = 0; i < 2 * CONCURRENT_KEYS; i++) {
+        make_key(key, i);
+        std::string found_data;
+        W_DO(test_env->btree_lookup(stid, key, found_data));
+        EXPECT_EQ((size_t) 100, found_data.size());
+    }
+    smlevel_0::optimistic_traverse = false;
+    W_DO(test_env->commit_xct());
+
+    x_btree_scan_result s;
+    W_DO(test_env->btree_scan(stid, s));
+    EXPECT_EQ(2 * CONCURRENT_KEYS, s.rownum);
+    return RCOK;
+}
+
+TEST (BtreeLookupScalingTest, Lookups) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(lookup_scaling), 0);
+}
+
+TEST (BtreeLookupScalingTest, LookupsDuringSplits) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(lookups_during_splits), 0);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    test_env = new btree_test_env();
+    ::testing::AddGlobalTestEnvironment(test_env);
+    return RUN_ALL_TESTS();
+}
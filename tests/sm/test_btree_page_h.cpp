@@ -4,6 +4,11 @@
 #include "btree.h"
 #include "btcursor.h"
 #include "btree_page_h.h"
+#include "sm_base.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
 
 btree_test_env *test_env;
 
@@ -231,6 +236,124 @@ TEST (BtreePTest, SearchLeafLong2) {
     EXPECT_EQ(test_env->runBtreeTest(test_search_leaf_long2), 0);
 }
 
+/** 8-byte integer key, big-endian so that byte order is numeric order */
+void make_int_key(w_keystr_t& key, uint64_t value) {
+    char buf[sizeof(uint64_t)];
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+        buf[i] = (char) (value >> (8 * (sizeof(uint64_t) - 1 - i)));
+    }
+    key.construct_regularkey(buf, sizeof(buf));
+}
+
+// few enough probe keys to stay in cache, so that the timings are of the
+// searches rather than of fetching the probes
+const int PROBES = 4096;
+const int REPEATS = 50;
+const int ROUNDS = 5;
+
+/**
+ * Fills a root leaf with random 8-byte integer keys up to the given
+ * percentage of its space, then checks that searches narrowed by the
+ * SIMD poor_man_key kernel (sm_btree_simd_search) return the same results
+ * as the plain binary search, and reports the time per search of each.
+ */
+w_rc_t search_fill_factor(ss_m* ssm, test_volume_t *test_volume, int fill_percent) {
+    StoreID stid;
+    PageID root_pid;
+    W_DO(x_btree_create_index(ssm, test_volume, stid, root_pid));
+
+    unsigned seed = fill_percent;
+    std::vector<uint64_t> values;
+    vec_t data("data1234", 8);
+    W_DO(test_env->begin_xct());
+    while (true) {
+        {
+            btree_page_h root;
+            W_DO(root.fix_root(stid, LATCH_SH));
+            smsize_t total = root.used_space() + root.usable_space();
+            if (root.used_space() * 100 >= total * fill_percent) {
+                break;
+            }
+        }
+        uint64_t value = ((uint64_t) ::rand_r(&seed) << 32) | ::rand_r(&seed);
+        w_keystr_t key;
+        make_int_key(key, value);
+        W_DO(ssm->create_assoc(stid, key, data));
+        values.push_back(value);
+    }
+    W_DO(test_env->commit_xct());
+
+    // half of the probes hit an existing key
+    std::vector<w_keystr_t> probes(PROBES);
+    for (int i = 0; i < PROBES; ++i) {
+        uint64_t value = (i % 2 == 0) ? values[::rand_r(&seed) % values.size()]
+            : ((uint64_t) ::rand_r(&seed) << 32) | ::rand_r(&seed);
+        make_int_key(probes[i], value);
+    }
+
+    btree_page_h root;
+    W_DO(root.fix_root(stid, LATCH_SH));
+    EXPECT_TRUE(root.is_leaf());
+    EXPECT_EQ(0U, root.get_foster());
+    EXPECT_EQ((int) values.size(), root.nrecs());
+
+    bool simd_search = smlevel_0::simd_search;
+    std::vector<slotid_t> slots[2];
+    double nsecs[2] = {0, 0};
+    // alternate between the two searches and keep the best round of each
+    for (int round = 0; round < 2 * ROUNDS; ++round) {
+        int simd = round % 2;
+        smlevel_0::simd_search = simd;
+        slots[simd].resize(PROBES);
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < REPEATS; ++r) {
+            for (int i = 0; i < PROBES; ++i) {
+                bool found;
+                root.search(probes[i], found, slots[simd][i]);
+                if (found) {
+                    slots[simd][i] = -1 - slots[simd][i];
+                }
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(end - start).count()
+            / (PROBES * REPEATS);
+        if (round < 2 || ns < nsecs[simd]) {
+            nsecs[simd] = ns;
+        }
+    }
+    smlevel_0::simd_search = simd_search;
+
+    EXPECT_TRUE(slots[0] == slots[1]);
+    std::cout << "fill=" << fill_percent << "% records=" << root.nrecs()
+        << " binary search ns/search=" << nsecs[0]
+        << " simd poor_man_key search ns/search=" << nsecs[1] << std::endl;
+    return RCOK;
+}
+
+w_rc_t test_search_simd_25(ss_m* ssm, test_volume_t *test_volume) {
+    return search_fill_factor(ssm, test_volume, 25);
+}
+w_rc_t test_search_simd_50(ss_m* ssm, test_volume_t *test_volume) {
+    return search_fill_factor(ssm, test_volume, 50);
+}
+w_rc_t test_search_simd_90(ss_m* ssm, test_volume_t *test_volume) {
+    return search_fill_factor(ssm, test_volume, 90);
+}
+
+TEST (BtreePTest, SearchSimd25) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(test_search_simd_25), 0);
+}
+TEST (BtreePTest, SearchSimd50) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(test_search_simd_50), 0);
+}
+TEST (BtreePTest, SearchSimd90) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(test_search_simd_90), 0);
+}
+
 // TODO more and more testcases here
 
 int main(int argc, char **argv) {
@@ -5,6 +5,7 @@
 #include "chkpt.h"
 #include "btree_logrec.h"
 #include "eventlog.h"
+#include "log_storage.h"
 
 #include <vector>
 
@@ -386,6 +387,92 @@ rc_t cleanerLostUpdate(ss_m*, test_volume_t*)
     return RCOK;
 }
 
+/** Same pages, transactions and number of locks in both checkpoints */
+void expectSameTables(chkpt_t& a, chkpt_t& b)
+{
+    EXPECT_EQ(a.buf_tab.size(), b.buf_tab.size());
+    for (buf_tab_t::iterator it = a.buf_tab.begin(); it != a.buf_tab.end(); ++it) {
+        EXPECT_TRUE(b.buf_tab.find(it->first) != b.buf_tab.end());
+    }
+    EXPECT_EQ(a.xct_tab.size(), b.xct_tab.size());
+    for (xct_tab_t::iterator it = a.xct_tab.begin(); it != a.xct_tab.end(); ++it) {
+        EXPECT_TRUE(b.xct_tab.find(it->first) != b.xct_tab.end());
+        EXPECT_EQ(it->second.first_lsn, b.xct_tab[it->first].first_lsn);
+        EXPECT_EQ(it->second.locks.size(), b.xct_tab[it->first].locks.size());
+    }
+}
+
+rc_t incrementalChkpt(ss_m* ssm, test_volume_t* test_volume)
+{
+    StoreID stid;
+    PageID root_pid;
+    W_DO(x_btree_create_index(ssm, test_volume, stid, root_pid));
+    W_DO(test_env->btree_insert_and_commit(stid, "key0", "data0"));
+
+    const sm_stats_t& stats = me()->TL_stats().sm;
+    uint64_t incremental = stats.log_chkpt_incremental;
+    uint64_t delta = stats.log_chkpt_delta;
+
+    // first checkpoint of the instance scans the log
+    smlevel_0::chkpt->take();
+    lsn_t first_lsn = smlevel_0::chkpt->get_chain_lsn();
+    EXPECT_EQ(incremental, stats.log_chkpt_incremental);
+
+    // active transaction with locks, detached so that statistics go to
+    // this thread
+    W_DO(test_env->begin_xct());
+    W_DO(test_env->btree_insert(stid, "key1", "data1"));
+    W_DO(test_env->btree_insert(stid, "key2", "data2"));
+    xct_t* xd = xct();
+    ss_m::detach_xct();
+    flushLog();
+    chkpt_t before;
+    before.scan_log();
+
+    smlevel_0::chkpt->take();
+    EXPECT_EQ(incremental + 1, stats.log_chkpt_incremental);
+    EXPECT_EQ(delta + 1, stats.log_chkpt_delta);
+
+    // read back from the delta file
+    chkpt_t after;
+    after.scan_log();
+    expectSameTables(before, after);
+    EXPECT_EQ(1, after.xct_tab.size());
+    EXPECT_EQ(2, after.xct_tab.begin()->second.locks.size());
+
+    ss_m::attach_xct(xd);
+    W_DO(test_env->commit_xct());
+    smlevel_0::chkpt->take();
+    EXPECT_EQ(delta + 2, stats.log_chkpt_delta);
+    after.scan_log();
+    EXPECT_EQ(0, after.xct_tab.size());
+
+    // base files of a delta are kept
+    log_storage* storage = smlevel_0::log->get_storage();
+    storage->delete_old_partitions(true);
+    EXPECT_TRUE(fs::exists(storage->make_chkpt_path(first_lsn)));
+
+    // full file every third checkpoint; older files can then be deleted
+    smlevel_0::chkpt->take();
+    EXPECT_EQ(delta + 2, stats.log_chkpt_delta);
+    EXPECT_EQ(incremental + 3, stats.log_chkpt_incremental);
+    EXPECT_NE(first_lsn, smlevel_0::chkpt->get_chain_lsn());
+    storage->delete_old_partitions(true);
+    EXPECT_FALSE(fs::exists(storage->make_chkpt_path(first_lsn)));
+    EXPECT_TRUE(fs::exists(storage->make_chkpt_path(
+                    smlevel_0::chkpt->get_chain_lsn())));
+
+    return RCOK;
+}
+
+TEST (CheckpointTest, incrementalChkpt) {
+    test_env->empty_logdata_dir();
+    sm_options options;
+    options.set_bool_option("sm_chkpt_incremental", true);
+    options.set_int_option("sm_chkpt_full_interval", 3);
+    EXPECT_EQ(test_env->runBtreeTest(incrementalChkpt, options), 0);
+}
+
 #define DFT_TEST(name) \
 TEST (CheckpointTest, name) { \
     test_env->empty_logdata_dir(); \
@@ -4,6 +4,7 @@
 #include "vol.h"
 #include "logarchiver.h"
 #include "page_cleaner_decoupled.h"
+#include "bf_tree_cb.h"
 
 // use small block to test boundaries
 const size_t BLOCK_SIZE = 1024 * 1024;
@@ -64,6 +65,108 @@ rc_t cleaner(ss_m* ssm, test_volume_t* test_vol)
 
     return RCOK;
 }
+/**
+ * Decoupled cleaner replaying from the recovery log: after one round, the
+ * volume holds the latest image of every updated page, and the buffer pool
+ * frames of these pages are clean.
+ */
+rc_t decoupledLog(ss_m* ssm, test_volume_t* test_vol)
+{
+    init();
+    W_DO(populateBtree(ssm, test_vol, 2000));
+    W_DO(ssm->log->flush_all());
+
+    page_cleaner_base* cleaner = smlevel_0::bf->get_cleaner();
+    EXPECT_TRUE(cleaner != NULL);
+    cleaner->wakeup(true /* wait */);
+
+    generic_page page;
+    size_t checked = 0;
+    for (PageID pid = root_pid; pid <= volMgr->get_last_allocated_pid(); pid++)
+    {
+        bf_idx idx = smlevel_0::bf->lookup(pid);
+        if (idx == 0) { continue; }
+        bf_tree_cb_t& cb = smlevel_0::bf->get_cb(idx);
+        W_DO(volMgr->read_page(pid, &page));
+        EXPECT_EQ(cb.get_page_lsn(), page.lsn) << "page " << pid;
+        EXPECT_FALSE(cb.is_dirty()) << "page " << pid;
+        checked++;
+    }
+    EXPECT_GT(checked, 1U);
+
+    return RCOK;
+}
+
+TEST (CleanerTest, decoupledLog) {
+    test_env->empty_logdata_dir();
+    sm_options options;
+    options.set_bool_option("sm_cleaner_decoupled", true);
+    options.set_bool_option("sm_cleaner_decoupled_log", true);
+    options.set_int_option("sm_cleaner_interval_millisec", 100000);
+    EXPECT_EQ(test_env->runBtreeTest(decoupledLog, options), 0);
+}
+
+/** Dirty pages among the cached pages of the B-tree */
+size_t countDirty()
+{
+    size_t dirty = 0;
+    for (PageID pid = root_pid; pid <= volMgr->get_last_allocated_pid(); pid++)
+    {
+        bf_idx idx = smlevel_0::bf->lookup(pid);
+        if (idx != 0 && smlevel_0::bf->get_cb(idx).is_dirty()) { dirty++; }
+    }
+    return dirty;
+}
+
+/**
+ * Adaptive policy: dirty pages scattered over the B-tree are written with
+ * the clean pages in between, so that they take few write requests.
+ */
+rc_t adaptiveGapFill(ss_m* ssm, test_volume_t* test_vol)
+{
+    init();
+    W_DO(populateBtree(ssm, test_vol, 2000));
+
+    page_cleaner_base* cleaner = smlevel_0::bf->get_cleaner();
+    EXPECT_TRUE(cleaner != NULL);
+    cleaner->wakeup(true /* wait */);
+    EXPECT_EQ(0U, countDirty());
+
+    // dirty a few leaves spread over the key range
+    const int updates = 5;
+    W_DO(test_env->begin_xct());
+    for (int i = 0; i < updates; i++) {
+        std::stringstream ss;
+        ss << "key" << i * 400 << "a";
+        W_DO(test_env->btree_insert(stid, ss.str().c_str(), HUNDRED_BYTES));
+    }
+    W_DO(test_env->commit_xct());
+    size_t dirty = countDirty();
+    EXPECT_GT(dirty, 1U);
+
+    sm_stats_info_t before, after;
+    W_DO(ss_m::gather_stats(before));
+    cleaner->wakeup(true /* wait */);
+    W_DO(ss_m::gather_stats(after));
+
+    EXPECT_EQ(0U, countDirty());
+    EXPECT_GT(after.sm.cleaner_gap_pages, before.sm.cleaner_gap_pages);
+    EXPECT_LT(after.sm.cleaner_writes - before.sm.cleaner_writes, dirty);
+    EXPECT_GT(after.sm.cleaner_rounds, before.sm.cleaner_rounds);
+
+    return RCOK;
+}
+
+TEST (CleanerTest, adaptiveGapFill) {
+    test_env->empty_logdata_dir();
+    sm_options options;
+    options.set_string_option("sm_cleaner_policy", "adaptive");
+    options.set_int_option("sm_cleaner_max_gap", 64);
+    options.set_int_option("sm_cleaner_io_budget", 100);
+    options.set_int_option("sm_cleaner_interval_millisec", 100000);
+    EXPECT_EQ(test_env->runBtreeTest(adaptiveGapFill, options), 0);
+}
+
 TEST (CleanerTest, cleaner) {
     test_env->empty_logdata_dir();
     sm_options options;
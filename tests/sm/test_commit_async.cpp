@@ -0,0 +1,107 @@
+#include "btree_test_env.h"
+#include "gtest/gtest.h"
+#include "sm_vas.h"
+#include "btree.h"
+#include "xct.h"
+#include "log_core.h"
+
+#include <mutex>
+#include <atomic>
+
+btree_test_env *test_env;
+
+/**
+ * Testcases for commits that do not wait for the log flush
+ * (ss_m::commit_xct_async), as used for pipelined commit in kits.
+ */
+
+const int XCT_COUNT = 200;
+
+struct durable_notes {
+    std::mutex mutex;
+    // commit LSN and durable LSN seen by each callback, in call order
+    std::vector<std::pair<lsn_t, lsn_t> > calls;
+
+    std::function<void()> callback(const lsn_t* commit_lsn)
+    {
+        return [this, commit_lsn] {
+            std::lock_guard<std::mutex> guard(mutex);
+            calls.push_back(std::make_pair(*commit_lsn,
+                        smlevel_0::log->durable_lsn()));
+        };
+    }
+
+    size_t count()
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        return calls.size();
+    }
+};
+
+w_rc_t pipelined_commits(ss_m* ssm, test_volume_t *test_volume)
+{
+    StoreID stid;
+    PageID root_pid;
+    W_DO(x_btree_create_index(ssm, test_volume, stid, root_pid));
+
+    durable_notes notes;
+    // the callback reads the commit LSN when called, which is after
+    // commit_xct_async filled it in
+    std::vector<lsn_t> commit_lsns(XCT_COUNT);
+    char key[16];
+    for (int i = 0; i < XCT_COUNT; i++) {
+        W_DO(test_env->begin_xct());
+        sprintf(key, "key%05d", i);
+        W_DO(test_env->btree_insert(stid, key, "data"));
+        W_DO(ss_m::commit_xct_async(notes.callback(&commit_lsns[i]),
+                    &commit_lsns[i]));
+        EXPECT_TRUE(commit_lsns[i].valid());
+    }
+
+    W_DO(smlevel_0::log->flush_all());
+    // the flush daemon calls back right after making the commits durable
+    for (int tries = 0; notes.count() < XCT_COUNT && tries < 1000; tries++) {
+        ::usleep(1000);
+    }
+    EXPECT_EQ((size_t) XCT_COUNT, notes.count());
+
+    for (size_t i = 0; i < notes.calls.size(); i++) {
+        // called only once durable, and in commit order
+        EXPECT_LT(notes.calls[i].first, notes.calls[i].second);
+        if (i > 0) {
+            EXPECT_LT(notes.calls[i - 1].first, notes.calls[i].first);
+        }
+    }
+
+    // a read-only commit is notified once everything before it is durable
+    lsn_t ro_lsn = lsn_t::null;
+    std::atomic<bool> called(false);
+    W_DO(test_env->begin_xct());
+    std::string data;
+    W_DO(test_env->btree_lookup(stid, "key00000", data));
+    EXPECT_EQ(std::string("data"), data);
+    W_DO(ss_m::commit_xct_async([&called] { called = true; }, &ro_lsn));
+    EXPECT_FALSE(ro_lsn.valid());
+    W_DO(smlevel_0::log->flush_all());
+    for (int tries = 0; !called && tries < 1000; tries++) {
+        ::usleep(1000);
+    }
+    EXPECT_TRUE(called);
+
+    x_btree_scan_result s;
+    W_DO(test_env->btree_scan(stid, s));
+    EXPECT_EQ(XCT_COUNT, s.rownum);
+    return RCOK;
+}
+
+TEST (CommitAsyncTest, PipelinedCommits) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(pipelined_commits), 0);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    test_env = new btree_test_env();
+    ::testing::AddGlobalTestEnvironment(test_env);
+    return RUN_ALL_TESTS();
+}
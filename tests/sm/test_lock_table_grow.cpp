@@ -0,0 +1,233 @@
+#include "btree_test_env.h"
+#include "gtest/gtest.h"
+#include "sm_options.h"
+#include "lock_raw.h"
+#include "lock_core.h"
+#include "sm_base.h"
+#include "lock.h"
+#include "w_okvl_inl.h"
+#include "../common/local_random.h"
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+btree_test_env *test_env;
+
+// Tests lock table partitions that double their lock queues when they get
+// crowded (sm_locktable_grow), and compares the cost of lock requests in a
+// crowded fixed-size lock table with a growing one.
+
+sm_options make_options(int table_size, int partitions, bool grow) {
+    sm_options options;
+    options.set_int_option("sm_locktablesize", table_size);
+    options.set_int_option("sm_locktable_partitions", partitions);
+    options.set_bool_option("sm_locktable_grow", grow);
+    options.set_bool_option("sm_truncate", true);
+    options.set_bool_option("sm_testenv_init_vol", true);
+    options.set_int_option("sm_rawlock_lockpool_initseg", 20);
+    options.set_int_option("sm_rawlock_xctpool_initseg", 20);
+    options.set_int_option("sm_rawlock_lockpool_segsize", 1 << 12);
+    options.set_int_option("sm_rawlock_xctpool_segsize", 1 << 8);
+    options.set_int_option("sm_rawlock_gc_interval_ms", 100);
+    options.set_int_option("sm_rawlock_gc_generation_count", 10);
+    options.set_int_option("sm_rawlock_gc_free_segment_count", 20);
+    options.set_int_option("sm_rawlock_gc_max_segment_count", 200);
+    return options;
+}
+
+TEST (LockTableGrowTest, Create) {
+    lock_core_m fixed(make_options(64000, 16, false));
+    EXPECT_EQ((size_t) 65536, fixed.queue_count());
+    lock_core_m tiny(make_options(10, 4, true));
+    EXPECT_EQ((size_t) 4 * 64, tiny.queue_count());
+    lock_core_m one(make_options(1000, 1, true));
+    EXPECT_EQ((size_t) 1024, one.queue_count());
+}
+
+const int GROW_LOCKS = 20000;
+
+/**
+ * Without the storage manager there is no transaction table, so conflicts must
+ * not look for loser transactions to roll back.
+ */
+void no_losers() {
+    RawLockQueue::loser_count = 0;
+}
+
+TEST (LockTableGrowTest, Grow) {
+    no_losers();
+    lock_core_m core(make_options(64, 2, true));
+    EXPECT_EQ((size_t) 128, core.queue_count());
+
+    RawXct* xct = core.allocate_xct();
+    std::vector<RawLock*> locks(GROW_LOCKS);
+    uint64_t collisions_before_last = 0;
+    for (int i = 0; i < GROW_LOCKS; ++i) {
+        if (i == GROW_LOCKS - 1000) {
+            collisions_before_last = xct->queue_collisions;
+        }
+        EXPECT_EQ(w_error_ok, core.acquire_lock(xct, i * 2654435761U, ALL_S_GAP_S,
+                                                true, true, true, 100, &locks[i]));
+        EXPECT_TRUE(locks[i] != NULL);
+    }
+    EXPECT_GT(xct->table_grows, 0U);
+    EXPECT_GE(core.queue_count(), (size_t) GROW_LOCKS / 8);
+    // the last locks hardly share their queues
+    EXPECT_LT(xct->queue_collisions - collisions_before_last, (uint64_t) 1000 * 8);
+
+    // locks still conflict after they moved to new queues
+    RawXct* other = core.allocate_xct();
+    for (int i = 0; i < GROW_LOCKS; i += 97) {
+        RawLock* lock = NULL;
+        EXPECT_EQ(eCONDLOCKTIMEOUT, core.acquire_lock(other, i * 2654435761U,
+                                    ALL_X_GAP_X, true, false, true, 0, &lock));
+        EXPECT_TRUE(lock != NULL);
+        core.release_lock(lock);
+    }
+
+    for (int i = 0; i < GROW_LOCKS; ++i) {
+        core.release_lock(locks[i]);
+    }
+    EXPECT_FALSE(xct->has_locks());
+    for (int i = 0; i < GROW_LOCKS; i += 97) {
+        RawLock* lock = NULL;
+        EXPECT_EQ(w_error_ok, core.acquire_lock(other, i * 2654435761U,
+                                    ALL_X_GAP_X, true, false, true, 0, &lock));
+        core.release_lock(lock);
+    }
+    core.deallocate_xct(other);
+    core.deallocate_xct(xct);
+}
+
+const int THREAD_COUNT = 6;
+const int REP_COUNT = 50;
+const int LOCK_COUNT = 300;
+const uint32_t HOT_HASH = 12345;
+
+struct GrowSharedContext {
+    lock_core_m*        core;
+    std::atomic<int>    holders;
+    std::atomic<int>    grows;
+};
+
+struct GrowThreadContext {
+    int id;
+    GrowSharedContext *shared;
+};
+
+/**
+ * Each transaction takes the hot lock and then enough other locks to grow the
+ * partition while the other workers sleep waiting for the hot lock.
+ */
+void *grow_worker(void *t) {
+    GrowThreadContext &context = *reinterpret_cast<GrowThreadContext*>(t);
+    GrowSharedContext &shared = *context.shared;
+    tlr_t rand (context.id);
+    for (int i = 0; i < REP_COUNT; ++i) {
+        RawXct* xct = shared.core->allocate_xct();
+        RawLock* hot = NULL;
+        EXPECT_EQ(w_error_ok, shared.core->acquire_lock(xct, HOT_HASH, ALL_X_GAP_X,
+                                true, true, true, WAIT_FOREVER, &hot));
+        EXPECT_EQ(1, ++shared.holders);
+        RawLock *out[LOCK_COUNT];
+        for (int j = 0; j < LOCK_COUNT; ++j) {
+            EXPECT_EQ(w_error_ok, shared.core->acquire_lock(xct, rand.nextInt32(),
+                                ALL_S_GAP_S, true, true, true, 100, out + j));
+        }
+        for (int j = 0; j < LOCK_COUNT; ++j) {
+            shared.core->release_lock(out[j]);
+        }
+        shared.grows += xct->table_grows;
+        --shared.holders;
+        shared.core->release_lock(hot);
+        shared.core->deallocate_xct(xct);
+    }
+    ::pthread_exit(NULL);
+    return NULL;
+}
+
+TEST (LockTableGrowTest, WaitersSurviveGrow) {
+    no_losers();
+    lock_core_m core(make_options(64, 1, true));
+    GrowSharedContext shared;
+    shared.core = &core;
+    shared.holders = 0;
+    shared.grows = 0;
+
+    GrowThreadContext contexts[THREAD_COUNT];
+    pthread_t threads[THREAD_COUNT];
+    for (int i = 0; i < THREAD_COUNT; ++i) {
+        contexts[i].id = i;
+        contexts[i].shared = &shared;
+        EXPECT_EQ(0, ::pthread_create(threads + i, NULL, grow_worker, contexts + i));
+    }
+    for (int i = 0; i < THREAD_COUNT; ++i) {
+        EXPECT_EQ(0, ::pthread_join(threads[i], NULL));
+    }
+    EXPECT_GT(shared.grows.load(), 0);
+    EXPECT_GT(core.queue_count(), (size_t) 64);
+    core.assert_empty();
+}
+
+const int BENCH_LOCKS = 100000;
+
+/** Takes BENCH_LOCKS locks in one transaction, like a bulk load or a batch job */
+void bench_locks(const sm_options& options, const char* label) {
+    lock_core_m core(options);
+    RawXct* xct = core.allocate_xct();
+    std::vector<RawLock*> locks(BENCH_LOCKS);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_LOCKS; ++i) {
+        EXPECT_EQ(w_error_ok, core.acquire_lock(xct, i * 2654435761U, ALL_S_GAP_S,
+                                                true, true, true, 100, &locks[i]));
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::cout << label << ": queues=" << core.queue_count()
+        << " ns/lock=" << (uint64_t) (std::chrono::duration<double, std::nano>(
+            end - start).count() / BENCH_LOCKS)
+        << " walked/lock=" << (double) xct->queue_walked / BENCH_LOCKS
+        << " collisions/lock=" << (double) xct->queue_collisions / BENCH_LOCKS
+        << " grows=" << xct->table_grows << std::endl;
+    for (int i = 0; i < BENCH_LOCKS; ++i) {
+        core.release_lock(locks[i]);
+    }
+    core.deallocate_xct(xct);
+}
+
+TEST (LockTableGrowTest, Benchmark) {
+    bench_locks(make_options(1024, 16, false), "fixed 1024");
+    bench_locks(make_options(1024, 16, true), "growing from 1024");
+    bench_locks(make_options(64000, 16, false), "fixed 64000");
+    bench_locks(make_options(64000, 16, true), "growing from 64000");
+}
+
+/** lock_m collects the statistics of the lock queues */
+w_rc_t grow_stats(ss_m*, test_volume_t*) {
+    sm_stats_info_t before, after;
+    W_DO(ss_m::gather_stats(before));
+    W_DO(test_env->begin_xct());
+    for (uint32_t i = 0; i < (uint32_t) GROW_LOCKS; ++i) {
+        W_DO(smlevel_0::lm->lock(i * 2654435761U, ALL_S_GAP_S, true, true, true,
+                                 g_xct(), 100));
+    }
+    W_DO(test_env->commit_xct());
+    W_DO(ss_m::gather_stats(after));
+    EXPECT_GT(after.sm.lock_table_grow_cnt, before.sm.lock_table_grow_cnt);
+    EXPECT_GT(after.sm.lock_queue_collision_cnt, before.sm.lock_queue_collision_cnt);
+    EXPECT_GE(after.sm.lock_queue_walk_cnt - before.sm.lock_queue_walk_cnt,
+              after.sm.lock_queue_collision_cnt - before.sm.lock_queue_collision_cnt);
+    return RCOK;
+}
+
+TEST (LockTableGrowTest, Stats) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(grow_stats, true, make_options(64, 2, true)), 0);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    test_env = new btree_test_env();
+    ::testing::AddGlobalTestEnvironment(test_env);
+    return RUN_ALL_TESTS();
+}
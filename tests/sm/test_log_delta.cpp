@@ -0,0 +1,155 @@
+#include "btree_test_env.h"
+#include "sm_base.h"
+#include "log_core.h"
+
+#include <stdio.h>
+
+/**
+ * Tests and log volume benchmark for delta-encoded before/after images of
+ * B-tree updates and overwrites (option sm_log_delta_images).
+ */
+
+btree_test_env *test_env;
+
+const int RECORD_COUNT = 200;
+const size_t ELEMENT_SIZE = 100;
+
+void make_key(int i, char* keystr)
+{
+    sprintf(keystr, "key%05d", i);
+}
+
+/** Element of the given version; versions differ only in a few bytes */
+std::string make_element(int i, int version)
+{
+    std::string el(ELEMENT_SIZE, 'a' + (i % 26));
+    char tag[16];
+    sprintf(tag, "v%04d", version);
+    el.replace(ELEMENT_SIZE / 2, strlen(tag), tag);
+    return el;
+}
+
+w_rc_t check_elements(StoreID stid, int version)
+{
+    char keystr[16];
+    for (int i = 0; i < RECORD_COUNT; i++) {
+        make_key(i, keystr);
+        std::string data;
+        W_DO(test_env->btree_lookup_and_commit(stid, keystr, data));
+        EXPECT_EQ(make_element(i, version), data) << "key " << keystr;
+    }
+    return RCOK;
+}
+
+/** Updates all records to the given version and returns log bytes used */
+w_rc_t update_all(StoreID stid, int version, bool commit, size_t& bytes)
+{
+    char keystr[16];
+    lsn_t begin = smlevel_0::log->curr_lsn();
+    W_DO(test_env->begin_xct());
+    for (int i = 0; i < RECORD_COUNT; i++) {
+        make_key(i, keystr);
+        W_DO(test_env->btree_update(stid, keystr,
+                    make_element(i, version).c_str()));
+    }
+    lsn_t end = smlevel_0::log->curr_lsn();
+    if (commit) {
+        W_DO(test_env->commit_xct());
+    }
+    else {
+        W_DO(test_env->abort_xct());
+    }
+
+    EXPECT_EQ(begin.hi(), end.hi());
+    bytes = end.lo() - begin.lo();
+    return RCOK;
+}
+
+w_rc_t update_delta(ss_m* ssm, test_volume_t* test_volume)
+{
+    StoreID stid;
+    PageID root_pid;
+    W_DO(x_btree_create_index(ssm, test_volume, stid, root_pid));
+
+    char keystr[16];
+    W_DO(test_env->begin_xct());
+    for (int i = 0; i < RECORD_COUNT; i++) {
+        make_key(i, keystr);
+        W_DO(test_env->btree_insert(stid, keystr, make_element(i, 0).c_str()));
+    }
+    W_DO(test_env->commit_xct());
+
+    size_t plain_bytes, delta_bytes;
+
+    smlevel_0::log_delta_images = false;
+    W_DO(update_all(stid, 1, true, plain_bytes));
+    W_DO(check_elements(stid, 1));
+
+    smlevel_0::log_delta_images = true;
+    W_DO(update_all(stid, 2, true, delta_bytes));
+    W_DO(check_elements(stid, 2));
+
+    std::cout << "log bytes for " << RECORD_COUNT << " updates: plain="
+        << plain_bytes << " delta=" << delta_bytes << std::endl;
+    EXPECT_LT(delta_bytes * 2, plain_bytes);
+
+    // rollback must restore the before images from the deltas
+    size_t dummy;
+    W_DO(update_all(stid, 3, false, dummy));
+    W_DO(check_elements(stid, 2));
+
+    W_DO(x_btree_verify(ssm, stid));
+    return RCOK;
+}
+
+TEST (LogDeltaTest, UpdateDelta) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(update_delta), 0);
+}
+TEST (LogDeltaTest, UpdateDeltaLock) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(update_delta, true), 0);
+}
+
+w_rc_t overwrite_delta(ss_m* ssm, test_volume_t* test_volume)
+{
+    StoreID stid;
+    PageID root_pid;
+    W_DO(x_btree_create_index(ssm, test_volume, stid, root_pid));
+
+    W_DO(test_env->begin_xct());
+    W_DO(test_env->btree_insert(stid, "key1", "abcdefghij"));
+    W_DO(test_env->commit_xct());
+
+    // only "X" differs from the current bytes
+    W_DO(test_env->begin_xct());
+    W_DO(test_env->btree_overwrite(stid, "key1", "cdXfg", 2));
+    W_DO(test_env->abort_xct());
+
+    std::string data;
+    W_DO(test_env->btree_lookup_and_commit(stid, "key1", data));
+    EXPECT_EQ(std::string("abcdefghij"), data);
+
+    W_DO(test_env->btree_overwrite_and_commit(stid, "key1", "cdXfg", 2));
+    W_DO(test_env->btree_lookup_and_commit(stid, "key1", data));
+    EXPECT_EQ(std::string("abcdXfghij"), data);
+
+    // overwrite with identical bytes
+    W_DO(test_env->btree_overwrite_and_commit(stid, "key1", "abcd", 0));
+    W_DO(test_env->btree_lookup_and_commit(stid, "key1", data));
+    EXPECT_EQ(std::string("abcdXfghij"), data);
+
+    return RCOK;
+}
+
+TEST (LogDeltaTest, OverwriteDelta) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(overwrite_delta), 0);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    test_env = new btree_test_env();
+    ::testing::AddGlobalTestEnvironment(test_env);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,157 @@
+#include "btree_test_env.h"
+#include "sm_base.h"
+#include "log_core.h"
+#include "logrec.h"
+#include "eventlog.h"
+#include "sm_options.h"
+
+#include "logdef_gen.cpp"
+
+#include <string.h>
+
+/**
+ * Tests for reserve-then-fill log insertion (log_core::insert_direct) and
+ * the record lengths it relies on (logrec_t::length_for), as well as for
+ * partitions placed on multiple log directories (sm_log_stripe_dirs).
+ */
+
+btree_test_env *test_env;
+logrec_t logrec;
+
+w_rc_t length_for(ss_m*, test_volume_t*)
+{
+    // length_for must predict the length computed by the constructors
+    for (size_t len = 0; len < 100; len++) {
+        std::string msg(len, 'a');
+        new (&logrec) comment_log(msg.c_str());
+        EXPECT_EQ(logrec.length(), comment_log::length_for(len + 1));
+        EXPECT_EQ(logrec.length(), logrec_t::length_for(len + 1, false));
+        EXPECT_EQ(0U, logrec.length() % 8);
+    }
+
+    // single-log system transactions have a shorter header
+    new (&logrec) alloc_page_log(1234);
+    EXPECT_TRUE(logrec.is_single_sys_xct());
+    EXPECT_EQ(logrec.length(), alloc_page_log::length_for(sizeof(PageID)));
+    EXPECT_EQ(logrec.length() + sizeof(xidChainLogHeader),
+            logrec_t::length_for(sizeof(PageID), false));
+    return RCOK;
+}
+
+TEST (LogInsertTest, LengthFor) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(length_for), 0);
+}
+
+w_rc_t insert_direct(ss_m*, test_volume_t*)
+{
+    const char* msg = "reserve-then-fill";
+    const size_t count = 1000;
+    std::vector<lsn_t> lsns;
+    for (size_t i = 0; i < count; i++) {
+        lsn_t lsn;
+        if (i % 2 == 0) {
+            W_DO(smlevel_0::log->insert_direct(
+                comment_log::length_for(strlen(msg) + 1),
+                [msg] (void* buf) { new (buf) comment_log(msg); },
+                &lsn));
+        }
+        else {
+            lsn_t prev = lsn_t(1, i);
+            lsn = prev;
+            sysevent::log_alloc_page(i, lsn);
+        }
+        EXPECT_TRUE(lsns.empty() || lsns.back() < lsn);
+        lsns.push_back(lsn);
+    }
+    W_DO(smlevel_0::log->flush_all());
+
+    // records must be read back exactly as constructed
+    for (size_t i = 0; i < count; i++) {
+        lsn_t lsn = lsns[i];
+        W_DO(smlevel_0::log->fetch(lsn, &logrec, NULL, true));
+        EXPECT_EQ(lsns[i], lsn);
+        EXPECT_EQ(lsns[i], logrec.lsn_ck());
+        if (i % 2 == 0) {
+            EXPECT_EQ(logrec_t::t_comment, logrec.type());
+            EXPECT_STREQ(msg, logrec.data());
+        }
+        else {
+            EXPECT_EQ(logrec_t::t_alloc_page, logrec.type());
+            EXPECT_EQ(lsn_t(1, i), logrec.page_prev_lsn());
+            EXPECT_EQ((PageID) i, *((PageID*) logrec.data_ssx()));
+        }
+    }
+    return RCOK;
+}
+
+TEST (LogInsertTest, InsertDirect) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(test_env->runBtreeTest(insert_direct), 0);
+}
+
+std::string stripe_dir()
+{
+    return std::string(test_env->log_dir) + "_stripe";
+}
+
+w_rc_t striped_partitions(ss_m*, test_volume_t*)
+{
+    std::string msg(100, 'a');
+    const size_t count = 3000;
+    std::vector<lsn_t> lsns;
+    for (size_t i = 0; i < count; i++) {
+        lsn_t lsn;
+        W_DO(smlevel_0::log->insert_direct(
+            comment_log::length_for(msg.size() + 1),
+            [&msg] (void* buf) { new (buf) comment_log(msg.c_str()); },
+            &lsn));
+        lsns.push_back(lsn);
+
+        // start a new partition every 1000 records
+        if (i % 1000 == 999 && i + 1 < count) {
+            W_DO(smlevel_0::log->flush_all());
+            W_DO(smlevel_0::log->truncate());
+        }
+    }
+    W_DO(smlevel_0::log->flush_all());
+
+    uint32_t first = lsns.front().hi();
+    uint32_t last = lsns.back().hi();
+    EXPECT_GT(last, first + 1);
+
+    // partitions alternate between the two directories; the log archiver
+    // also finds them with make_log_name
+    for (uint32_t p = first; p <= last; p++) {
+        std::string name = "/log." + std::to_string(p);
+        std::string expected = (p % 2 == 0) ? test_env->log_dir : stripe_dir();
+        std::string other = (p % 2 == 0) ? stripe_dir() : test_env->log_dir;
+        EXPECT_TRUE(fs::exists(expected + name));
+        EXPECT_FALSE(fs::exists(other + name));
+        EXPECT_EQ(expected + name, smlevel_0::log->make_log_name(p));
+    }
+
+    // records are read back in LSN order from all devices
+    for (size_t i = 0; i < count; i += 7) {
+        lsn_t lsn = lsns[i];
+        W_DO(smlevel_0::log->fetch(lsn, &logrec, NULL, true));
+        EXPECT_EQ(lsns[i], logrec.lsn_ck());
+        EXPECT_EQ(logrec_t::t_comment, logrec.type());
+    }
+
+    return RCOK;
+}
+
+TEST (LogInsertTest, StripedPartitions) {
+    test_env->empty_logdata_dir();
+    sm_options options;
+    options.set_string_option("sm_log_stripe_dirs", stripe_dir());
+    EXPECT_EQ(test_env->runBtreeTest(striped_partitions, options), 0);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    test_env = new btree_test_env();
+    ::testing::AddGlobalTestEnvironment(test_env);
+    return RUN_ALL_TESTS();
+}
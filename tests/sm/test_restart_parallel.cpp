@@ -0,0 +1,140 @@
+#include "btree_test_env.h"
+#include "gtest/gtest.h"
+#include "sm_vas.h"
+#include "btree.h"
+#include "xct.h"
+#include "sm_base.h"
+
+#include <stdio.h>
+
+btree_test_env *test_env;
+
+// Test cases for non-instant restart with log-based REDO replayed by several
+// threads (sm_restart_redo_threads) and loser transactions rolled back by
+// several threads (sm_restart_undo_threads). Each test also reports the REDO
+// throughput, so running the test case is a recovery-time benchmark.
+
+const int COMMITTED_XCTS = 40;
+const int KEYS_PER_XCT = 100;
+const int LOSER_XCTS = 4;
+const int KEYS_PER_LOSER = 50;
+
+void make_key(char* buf, char prefix, int i)
+{
+    sprintf(buf, "%c%06d", prefix, i);
+}
+
+class restart_parallel : public restart_test_base
+{
+public:
+    restart_parallel(int threads) : _threads(threads) {}
+
+    static void loserRun(StoreID* stid_list) {
+        static int next_loser = 0;
+        char prefix = 'b' + (next_loser++);
+        char key[16];
+        test_env->begin_xct();
+        for (int i = 0; i < KEYS_PER_LOSER; i++) {
+            make_key(key, prefix, i);
+            test_env->btree_insert(stid_list[0], key, "loser data");
+        }
+        ss_m::detach_xct();
+    }
+
+    w_rc_t pre_shutdown(ss_m *ssm) {
+        _stid_list = new StoreID[1];
+        W_DO(x_btree_create_index(ssm, &_volume, _stid_list[0], _root_pid));
+
+        char key[16];
+        for (int x = 0; x < COMMITTED_XCTS; x++) {
+            W_DO(test_env->begin_xct());
+            for (int i = 0; i < KEYS_PER_XCT; i++) {
+                // interleave keys of different transactions, so that
+                // updates and splits are spread over all pages
+                make_key(key, 'a', i * COMMITTED_XCTS + x);
+                W_DO(test_env->btree_insert(_stid_list[0], key,
+                            "committed data"));
+            }
+            W_DO(test_env->commit_xct());
+        }
+
+        std::vector<transact_thread_t*> losers;
+        for (int i = 0; i < LOSER_XCTS; i++) {
+            losers.push_back(new transact_thread_t(_stid_list, loserRun));
+            W_DO(losers[i]->fork());
+            W_DO(losers[i]->join());
+        }
+        for (int i = 0; i < LOSER_XCTS; i++) {
+            delete losers[i];
+        }
+        return RCOK;
+    }
+
+    w_rc_t post_shutdown(ss_m *) {
+        const sm_stats_t& stats = me()->TL_stats().sm;
+        double secs = stats.restart_redo_time / 1000000.0;
+        EXPECT_GT(stats.restart_redo_records, 0U);
+        std::cout << "redo threads=" << _threads
+            << " records=" << stats.restart_redo_records
+            << " records/sec="
+            << (uint64_t) (secs > 0 ? stats.restart_redo_records / secs : 0)
+            << " undo usec=" << stats.restart_undo_time
+            << std::endl;
+
+        // only the committed keys are left after UNDO of the losers
+        x_btree_scan_result s;
+        W_DO(test_env->btree_scan(_stid_list[0], s));
+        EXPECT_EQ(COMMITTED_XCTS * KEYS_PER_XCT, s.rownum);
+        char key[16];
+        make_key(key, 'a', 0);
+        EXPECT_EQ(std::string(key), s.minkey);
+        make_key(key, 'a', COMMITTED_XCTS * KEYS_PER_XCT - 1);
+        EXPECT_EQ(std::string(key), s.maxkey);
+        return RCOK;
+    }
+
+private:
+    int _threads;
+};
+
+int run_parallel_restart(int threads)
+{
+    restart_parallel context(threads);
+    restart_test_options options;
+    options.shutdown_mode = simulated_crash;
+
+    std::vector<std::pair<const char*, int64_t> > int_params;
+    int_params.push_back(std::make_pair("sm_restart_redo_threads", threads));
+    int_params.push_back(std::make_pair("sm_restart_undo_threads", threads));
+    std::vector<std::pair<const char*, bool> > bool_params;
+    bool_params.push_back(std::make_pair("sm_restart_instant", false));
+    std::vector<std::pair<const char*, const char*> > string_params;
+
+    return test_env->runRestartTest(&context, &options, false,
+            btree_test_env::make_sm_options(default_locktable_size,
+                default_bufferpool_size_in_pages, 1, 1000, 256000, 64, true,
+                default_enable_swizzling, int_params, bool_params,
+                string_params));
+}
+
+TEST (RestartParallelTest, Threads1) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(run_parallel_restart(1), 0);
+}
+
+TEST (RestartParallelTest, Threads2) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(run_parallel_restart(2), 0);
+}
+
+TEST (RestartParallelTest, Threads4) {
+    test_env->empty_logdata_dir();
+    EXPECT_EQ(run_parallel_restart(4), 0);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    test_env = new btree_test_env();
+    ::testing::AddGlobalTestEnvironment(test_env);
+    return RUN_ALL_TESTS();
+}
@@ -8,6 +8,9 @@
 #include "alloc_cache.h"
 #include "sm_options.h"
 
+#include <sys/stat.h>
+#include <fstream>
+
 
 const size_t RECORD_SIZE = 100;
 const size_t SEGMENT_SIZE = 8;
@@ -217,6 +220,82 @@ rc_t takeBackupMultiThreadedTest(ss_m* ssm, test_volume_t* test_volume)
     return RCOK;
 }
 
+/** Number of bytes actually allocated on disk for a (sparse) file */
+size_t diskUsage(const string& path)
+{
+    struct stat st;
+    EXPECT_EQ(0, stat(path.c_str(), &st));
+    return st.st_blocks * 512;
+}
+
+rc_t incrementalBackupTest(ss_m* ssm, test_volume_t* test_volume)
+{
+    W_DO(populatePages(ssm, test_volume, 16 * SEGMENT_SIZE));
+    smlevel_0::bf->get_cleaner()->wakeup(true);
+    vol_t* volume = smlevel_0::vol;
+
+    string fullPath = string(test_env->vol_dir) + "/backup";
+    W_DO(volume->take_backup(fullPath, true /* flushArchive */));
+    EXPECT_EQ(1U, volume->num_backups());
+
+    // update a single record, so that only one segment changes
+    W_DO(test_env->btree_update_and_commit(stid, "key0", RECORD_STR));
+
+    string incrPath = string(test_env->vol_dir) + "/backup_incr";
+    W_DO(volume->take_backup(incrPath, true /* flushArchive */,
+                true /* incremental */));
+    EXPECT_EQ(2U, volume->num_backups());
+
+    // only changed segments are written, plus a segment map
+    std::ifstream segmap(incrPath + ".segmap");
+    EXPECT_TRUE(segmap.is_open());
+    EXPECT_LT(diskUsage(incrPath) * 4, diskUsage(fullPath));
+
+    // restore reconstructs segments from the chain of backups
+    W_DO(volume->mark_failed());
+    W_DO(lookupPages(16 * SEGMENT_SIZE));
+
+    return RCOK;
+}
+
+rc_t hotRestoreTest(ss_m* ssm, test_volume_t* test_volume)
+{
+    W_DO(populatePages(ssm, test_volume, 16 * SEGMENT_SIZE));
+
+    sm_stats_info_t before, after;
+    W_DO(ss_m::gather_stats(before));
+
+    vol_t* volume = smlevel_0::vol;
+    W_DO(volume->mark_failed());
+    W_DO(lookupPages(16 * SEGMENT_SIZE));
+
+    while (!volume->check_restore_finished()) {
+        ::usleep(1000);
+    }
+
+    // background restore followed the hot order of segments
+    W_DO(ss_m::gather_stats(after));
+    EXPECT_GT(after.sm.restore_sched_hot, before.sm.restore_sched_hot);
+
+    return RCOK;
+}
+
+rc_t pipelinedRestoreTest(ss_m* ssm, test_volume_t* test_volume)
+{
+    W_DO(populatePages(ssm, test_volume, 16 * SEGMENT_SIZE));
+
+    vol_t* volume = smlevel_0::vol;
+    W_DO(volume->mark_failed());
+    W_DO(lookupPages(16 * SEGMENT_SIZE));
+
+    while (!volume->check_restore_finished()) {
+        ::usleep(1000);
+    }
+    W_DO(lookupPages(16 * SEGMENT_SIZE));
+
+    return RCOK;
+}
+
 #define DEFAULT_TEST(test, function, option_reuse, option_singlepass, option_threads) \
     TEST (test, function) { \
         test_env->empty_logdata_dir(); \
@@ -232,10 +311,43 @@ rc_t takeBackupMultiThreadedTest(ss_m* ssm, test_volume_t* test_volume)
 DEFAULT_TEST(BackupLess, singlePageTest, false, false, 1);
 DEFAULT_TEST(BackupLess, multiPageTest, false, false, 1);
 DEFAULT_TEST(BackupTest, takeBackupTest, false, false, 1);
+DEFAULT_TEST(BackupTest, incrementalBackupTest, false, false, 1);
 DEFAULT_TEST(BackupTest, takeBackupMultiThreadedTest, false, false, 4);
 DEFAULT_TEST(RestoreTest, fullRestoreTest, true, true, 1);
 DEFAULT_TEST(RestoreTest, multiThreadedRestoreTest, true, true, 4);
 
+TEST (RestoreTest, hotRestoreTest) {
+    test_env->empty_logdata_dir();
+    sm_options options;
+    options.set_bool_option("sm_archiving", true);
+    options.set_string_option("sm_archdir", test_env->archive_dir);
+    options.set_int_option("sm_restore_segsize", SEGMENT_SIZE);
+    options.set_int_option("sm_restore_threads", 4);
+    options.set_bool_option("sm_restore_sched_hot", true);
+    EXPECT_EQ(test_env->runBtreeTest(hotRestoreTest, options), 0);
+}
+
+TEST (RestoreTest, pipelinedRestoreTest) {
+    test_env->empty_logdata_dir();
+    sm_options options;
+    options.set_bool_option("sm_archiving", true);
+    options.set_string_option("sm_archdir", test_env->archive_dir);
+    options.set_int_option("sm_restore_segsize", SEGMENT_SIZE);
+    options.set_int_option("sm_restore_threads", 2);
+    options.set_bool_option("sm_restore_pipeline", true);
+    EXPECT_EQ(test_env->runBtreeTest(pipelinedRestoreTest, options), 0);
+}
+
+TEST (BackupTest, pipelinedBackupTest) {
+    test_env->empty_logdata_dir();
+    sm_options options;
+    options.set_bool_option("sm_archiving", true);
+    options.set_string_option("sm_archdir", test_env->archive_dir);
+    options.set_int_option("sm_restore_segsize", SEGMENT_SIZE);
+    options.set_bool_option("sm_restore_pipeline", true);
+    EXPECT_EQ(test_env->runBtreeTest(takeBackupTest, options), 0);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     test_env = new btree_test_env();
@@ -200,6 +200,7 @@ sub def_rec {
 
     my $redo_stmt = ($redo) ? 'void redo(fixable_page_h*);' : '';
     my $undo_stmt = ($undo) ? 'void undo(fixable_page_h*);' : '';
+    my $ssx = ($singsys) ? 'true' : 'false';
     print DEF<<CLASSDEF;
     class $class : public logrec_t {
     void fill(const PageID p, StoreID store, uint16_t tag, int l) {
@@ -222,6 +223,11 @@ sub def_rec {
     $class $arg;
     $class (logrec_t*)   {};
 
+    // header size is fixed by the category, so it is known before construction
+    static smsize_t length_for(smsize_t data_len) {
+      return logrec_t::length_for(data_len, $ssx);
+    }
+
     $redo_stmt
     $undo_stmt
     };